@@ -0,0 +1,231 @@
+// Animation Sampling Benchmark
+//
+// Animates a crowd of procedural characters and compares the scalar keyframe path
+// (compute_bone_matrices) with SoA stream sampling (compute_bone_matrices_streams),
+// with and without slerp correction, with compressed keys decoded inline, and as a
+// two-clip blend. Also reports the largest palette difference and compression ratio.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <cglm/cglm.h>
+
+#include "cetra/animation.h"
+#include "cetra/animation_blend.h"
+#include "cetra/animation_compress.h"
+#include "cetra/animation_stream.h"
+
+#define BONE_COUNT     MAX_BONES
+#define INSTANCE_COUNT 256
+#define FRAME_COUNT    120
+#define CLIP_TICKS     90.0f
+#define CLIP_RATE      30.0f // Ticks per second; keys are authored at every tick
+#define FRAME_DELTA    (1.0f / 60.0f)
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static float random_range(float lo, float hi) {
+    return lo + (hi - lo) * ((float)rand() / (float)RAND_MAX);
+}
+
+// Binary-tree skeleton with unit offsets between bones
+static Skeleton* build_bench_skeleton(void) {
+    Skeleton* skeleton = create_skeleton("bench");
+    if (!skeleton)
+        return NULL;
+
+    for (int i = 0; i < BONE_COUNT; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "bone_%d", i);
+
+        mat4 local, inverse_bind;
+        glm_translate_make(local, (vec3){0.0f, i == 0 ? 0.0f : 1.0f, 0.0f});
+        glm_mat4_identity(inverse_bind);
+        add_bone_to_skeleton(skeleton, name, i == 0 ? -1 : (i - 1) / 2, inverse_bind, local);
+    }
+    return skeleton;
+}
+
+// Every bone wobbles around a random axis with a key on each tick
+static Animation* build_bench_animation(Skeleton* skeleton) {
+    Animation* animation = create_animation("wobble", CLIP_TICKS, CLIP_RATE);
+    if (!animation)
+        return NULL;
+    animation->skeleton = skeleton;
+
+    for (int b = 0; b < BONE_COUNT; b++) {
+        AnimationChannel* channel = create_animation_channel(b, skeleton->bones[b].name);
+        vec3 axis = {random_range(-1.0f, 1.0f), random_range(-1.0f, 1.0f),
+                     random_range(-1.0f, 1.0f)};
+        glm_vec3_normalize(axis);
+        float amplitude = random_range(0.2f, 1.2f);
+        float phase = random_range(0.0f, 6.28f);
+
+        for (int k = 0; k <= (int)CLIP_TICKS; k++) {
+            float t = (float)k;
+            versor rot;
+            glm_quatv(rot, amplitude * sinf(t * 0.15f + phase), axis);
+            add_rotation_key(channel, t, rot);
+            add_position_key(channel, t, (vec3){0.0f, 1.0f + 0.1f * sinf(t * 0.2f), 0.0f});
+            add_scale_key(channel, t, (vec3){1.0f, 1.0f, 1.0f});
+        }
+
+        add_channel_to_animation(animation, channel);
+        free(channel);
+    }
+    return animation;
+}
+
+static double run_pass(AnimationState** states, bool use_streams) {
+    double start = now_seconds();
+    for (int f = 0; f < FRAME_COUNT; f++) {
+        for (int i = 0; i < INSTANCE_COUNT; i++) {
+            AnimationState* state = states[i];
+            state->current_time = fmodf(state->current_time + FRAME_DELTA * CLIP_RATE, CLIP_TICKS);
+            if (use_streams)
+                compute_bone_matrices_streams(state);
+            else
+                compute_bone_matrices(state);
+        }
+    }
+    return now_seconds() - start;
+}
+
+static double run_blend_pass(AnimationState** states) {
+    double start = now_seconds();
+    for (int f = 0; f < FRAME_COUNT; f++) {
+        for (int i = 0; i < INSTANCE_COUNT; i++) {
+            update_animation(states[i], FRAME_DELTA);
+        }
+    }
+    return now_seconds() - start;
+}
+
+// Largest absolute palette difference between the two paths over sampled times
+static float palette_error(AnimationState* state) {
+    float max_error = 0.0f;
+    mat4 reference[BONE_COUNT];
+
+    for (int s = 0; s < 200; s++) {
+        state->current_time = random_range(0.0f, CLIP_TICKS);
+        compute_bone_matrices(state);
+        for (int b = 0; b < BONE_COUNT; b++)
+            glm_mat4_copy(state->bone_matrices[b], reference[b]);
+
+        compute_bone_matrices_streams(state);
+        for (int b = 0; b < BONE_COUNT; b++) {
+            for (int c = 0; c < 4; c++) {
+                for (int r = 0; r < 4; r++) {
+                    float d = fabsf(state->bone_matrices[b][c][r] - reference[b][c][r]);
+                    if (d > max_error)
+                        max_error = d;
+                }
+            }
+        }
+    }
+    return max_error;
+}
+
+int main(int argc, const char* argv[]) {
+    (void)argc;
+    (void)argv;
+
+    printf("=== CETRA Animation Sampling Benchmark ===\n\n");
+    srand(1234);
+
+    Skeleton* skeleton = build_bench_skeleton();
+    Animation* animation = skeleton ? build_bench_animation(skeleton) : NULL;
+    if (!animation) {
+        fprintf(stderr, "Failed to build benchmark clip\n");
+        free_skeleton(skeleton);
+        return -1;
+    }
+
+    AnimationState* states[INSTANCE_COUNT];
+    for (int i = 0; i < INSTANCE_COUNT; i++) {
+        states[i] = create_animation_state(skeleton);
+        set_animation(states[i], animation);
+        states[i]->current_time = random_range(0.0f, CLIP_TICKS);
+    }
+
+    printf("Rig:    %d bones, %zu channels, %.0f ticks\n", BONE_COUNT, animation->channel_count,
+           CLIP_TICKS);
+    printf("Crowd:  %d instances x %d frames\n\n", INSTANCE_COUNT, FRAME_COUNT);
+
+    double scalar_time = run_pass(states, false);
+
+    if (build_animation_streams(animation, CLIP_RATE) != 0) {
+        fprintf(stderr, "Failed to build animation streams\n");
+        return -1;
+    }
+    double stream_time = run_pass(states, true);
+
+    animation->streams->slerp_correction = true;
+    double corrected_time = run_pass(states, true);
+    float corrected_error = palette_error(states[0]);
+
+    animation->streams->slerp_correction = false;
+    float nlerp_error = palette_error(states[0]);
+
+    double updates = (double)INSTANCE_COUNT * FRAME_COUNT;
+    printf("%-28s %8.2f us/instance\n", "compute_bone_matrices", scalar_time / updates * 1e6);
+    printf("%-28s %8.2f us/instance (%.2fx, max error %.2e)\n", "streams (nlerp)",
+           stream_time / updates * 1e6, scalar_time / stream_time, nlerp_error);
+    printf("%-28s %8.2f us/instance (%.2fx, max error %.2e)\n", "streams (slerp correction)",
+           corrected_time / updates * 1e6, scalar_time / corrected_time, corrected_error);
+
+    // Same clip with compressed keys, sampled through compute_bone_matrices
+    srand(1234);
+    Animation* packed = build_bench_animation(skeleton);
+    if (packed && compress_animation(packed, NULL) == 0) {
+        for (int i = 0; i < INSTANCE_COUNT; i++) {
+            set_animation(states[i], packed);
+        }
+        double packed_time = run_pass(states, false);
+        const AnimationCompressionStats* stats = &packed->compressed->stats;
+
+        printf("%-28s %8.2f us/instance (%.2fx)\n", "compressed keys",
+               packed_time / updates * 1e6, scalar_time / packed_time);
+        printf("\nCompression: %zu -> %zu bytes (%.1fx), %zu -> %zu keys\n",
+               stats->source_bytes, stats->compressed_bytes, stats->ratio, stats->source_keys,
+               stats->kept_keys);
+        printf("Max error:   %.2e position, %.2e rad rotation, %.2e scale\n",
+               stats->max_position_error, stats->max_rotation_error, stats->max_scale_error);
+    } else {
+        fprintf(stderr, "Failed to compress benchmark clip\n");
+    }
+
+    // Two clips mid-crossfade, blended in TRS space with one palette pass
+    int blended = 0;
+    for (int i = 0; i < INSTANCE_COUNT; i++) {
+        AnimationBlend* blend = create_animation_blend(skeleton);
+        if (!blend)
+            break;
+        add_animation_layer(blend, animation, ANIMATION_LAYER_BLEND, 0.5f);
+        add_animation_layer(blend, animation, ANIMATION_LAYER_BLEND, 0.5f);
+        blend->layers[1].time = CLIP_TICKS * 0.5f;
+        set_animation_blend(states[i], blend);
+        play_animation(states[i]);
+        blended++;
+    }
+    if (blended == INSTANCE_COUNT) {
+        double blend_time = run_blend_pass(states);
+        printf("%-28s %8.2f us/instance (%.2fx vs two palettes)\n", "blend (2 layers)",
+               blend_time / updates * 1e6, 2.0 * scalar_time / blend_time);
+    }
+
+    for (int i = 0; i < INSTANCE_COUNT; i++) {
+        free_animation_state(states[i]);
+    }
+    free_animation(packed);
+    free_animation(animation);
+    free_skeleton(skeleton);
+
+    return 0;
+}
@@ -0,0 +1,159 @@
+// Ray Query Benchmark
+//
+// Builds a grid of procedural meshes and reports batched ray query throughput
+// (Mrays/s) across worker thread counts, against the single-ray pick path.
+
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <cglm/cglm.h>
+
+#include "cetra/engine.h"
+#include "cetra/geometry.h"
+#include "cetra/intersect.h"
+#include "cetra/mesh.h"
+#include "cetra/scene.h"
+
+#define GRID_SIZE        16
+#define GRID_SPACING     40.0f
+#define RAYS_X           1024
+#define RAYS_Y           1024
+#define ITERATIONS       5
+#define PICK_RAY_STRIDE  64 // Single-ray baseline only traces every Nth ray
+#define CYLINDER_DETAIL  48
+
+static SceneNode* build_bench_scene(size_t* out_triangles) {
+    SceneNode* root = create_node();
+    set_node_name(root, "root");
+    *out_triangles = 0;
+
+    for (int z = 0; z < GRID_SIZE; z++) {
+        for (int x = 0; x < GRID_SIZE; x++) {
+            Mesh* mesh = create_mesh();
+            if ((x + z) % 2 == 0) {
+                Cylinder cyl = {.position = {0.0f, 0.0f, 0.0f},
+                                .base_radius = 10.0f,
+                                .top_radius = 4.0f,
+                                .height = 30.0f,
+                                .segments = CYLINDER_DETAIL};
+                generate_cylinder_to_mesh(mesh, &cyl);
+                calculate_aabb(mesh);
+            } else {
+                Box box = {.position = {0.0f, 0.0f, 0.0f}, .size = {20.0f, 25.0f, 20.0f}};
+                generate_box_to_mesh(mesh, &box);
+            }
+            *out_triangles += (mesh->index_count ? mesh->index_count : mesh->vertex_count) / 3;
+
+            SceneNode* node = create_node();
+            add_mesh_to_node(node, mesh);
+
+            mat4 transform;
+            glm_translate_make(transform, (vec3){(x - GRID_SIZE / 2) * GRID_SPACING, 0.0f,
+                                                 (z - GRID_SIZE / 2) * GRID_SPACING});
+            glm_rotate_y(transform, (float)(x * 7 + z * 13) * 0.1f, transform);
+            glm_mat4_copy(transform, node->original_transform);
+
+            add_child_node(root, node);
+        }
+    }
+
+    mat4 identity = GLM_MAT4_IDENTITY_INIT;
+    apply_transform_to_nodes(root, identity);
+    return root;
+}
+
+// Pinhole camera rays over the grid, row-major so neighbouring rays form coherent packets
+static void build_camera_rays(Ray* rays, int width, int height) {
+    vec3 eye = {0.0f, 250.0f, 420.0f};
+    vec3 center = {0.0f, 0.0f, 0.0f};
+    mat4 view, projection;
+    glm_lookat(eye, center, (vec3){0.0f, 1.0f, 0.0f}, view);
+    glm_perspective(glm_rad(60.0f), (float)width / (float)height, 0.1f, 5000.0f, projection);
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            Ray* ray = &rays[y * width + x];
+            glm_vec3_copy(eye, ray->origin);
+            compute_ray_from_screen(x + 0.5f, y + 0.5f, width, height, projection, view, eye,
+                                    ray->dir);
+            ray->t_max = 0.0f;
+        }
+    }
+}
+
+int main(int argc, const char* argv[]) {
+    (void)argc;
+    (void)argv;
+
+    printf("=== CETRA Ray Query Benchmark ===\n\n");
+
+    // Meshes need a GL context for their buffers
+    Engine* engine = create_engine("Ray Bench", 320, 240);
+    if (!engine) {
+        fprintf(stderr, "Failed to create engine\n");
+        return -1;
+    }
+    if (init_engine(engine) != 0) {
+        fprintf(stderr, "Failed to initialize engine\n");
+        free_engine(engine);
+        return -1;
+    }
+
+    size_t triangle_count = 0;
+    SceneNode* root = build_bench_scene(&triangle_count);
+
+    size_t ray_count = (size_t)RAYS_X * RAYS_Y;
+    Ray* rays = malloc(ray_count * sizeof(Ray));
+    RayHit* hits = malloc(ray_count * sizeof(RayHit));
+    if (!rays || !hits) {
+        fprintf(stderr, "Failed to allocate %zu rays\n", ray_count);
+        free(rays);
+        free(hits);
+        free_node(root);
+        free_engine(engine);
+        return -1;
+    }
+    build_camera_rays(rays, RAYS_X, RAYS_Y);
+
+    printf("Scene: %d meshes, %zu triangles\n", GRID_SIZE * GRID_SIZE, triangle_count);
+    printf("Rays:  %zu per batch, %d iterations\n\n", ray_count, ITERATIONS);
+
+    // First call builds the mesh BVHs; keep it out of the timings
+    double build_start = glfwGetTime();
+    size_t hit_count = intersect_rays(root, rays, hits, ray_count, 1);
+    printf("BVH build + warmup: %.1f ms (%zu hits)\n\n", (glfwGetTime() - build_start) * 1000.0,
+           hit_count);
+
+    // Single-ray baseline
+    size_t pick_rays = 0;
+    double pick_start = glfwGetTime();
+    for (size_t i = 0; i < ray_count; i += PICK_RAY_STRIDE) {
+        pick_scene_node(root, rays[i].origin, rays[i].dir);
+        pick_rays++;
+    }
+    double pick_time = glfwGetTime() - pick_start;
+    printf("%-22s %8.3f Mrays/s\n", "pick_scene_node", pick_rays / pick_time / 1e6);
+
+    for (int threads = 1; threads <= RAY_QUERY_MAX_THREADS; threads *= 2) {
+        double start = glfwGetTime();
+        for (int i = 0; i < ITERATIONS; i++) {
+            hit_count = intersect_rays(root, rays, hits, ray_count, threads);
+        }
+        double elapsed = glfwGetTime() - start;
+
+        char label[32];
+        snprintf(label, sizeof(label), "intersect_rays x%d", threads);
+        printf("%-22s %8.3f Mrays/s (%zu hits)\n", label,
+               (double)ray_count * ITERATIONS / elapsed / 1e6, hit_count);
+    }
+
+    free(rays);
+    free(hits);
+    free_node(root);
+    free_engine(engine);
+
+    return 0;
+}
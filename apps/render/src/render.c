@@ -56,6 +56,7 @@ typedef struct {
     const char* hdr_path;
     const char* anim_files[MAX_ANIM_FILES];
     int anim_count;
+    int compress_anims;
     int width;
     int height;
     int show_help;
@@ -68,6 +69,7 @@ static void print_usage(const char* prog) {
     fprintf(stderr, "  -t, --textures <dir>   Texture directory\n");
     fprintf(stderr, "  -e, --env <path>       HDR environment map for IBL\n");
     fprintf(stderr, "  -a, --anim <path>      Animation file (can be repeated)\n");
+    fprintf(stderr, "  -c, --compress-anims   Compress animation keys at import\n");
     fprintf(stderr, "  -W, --width <int>      Window width (default: %d)\n", DEFAULT_WIDTH);
     fprintf(stderr, "  -H, --height <int>     Window height (default: %d)\n", DEFAULT_HEIGHT);
     fprintf(stderr, "  -h, --help             Show this help message\n");
@@ -113,6 +115,8 @@ static int parse_args(int argc, char** argv, RenderArgs* args) {
                 return -1;
             }
             args->anim_files[args->anim_count++] = argv[i];
+        } else if (strcmp(argv[i], "-c") == 0 || strcmp(argv[i], "--compress-anims") == 0) {
+            args->compress_anims = 1;
         } else if (strcmp(argv[i], "-W") == 0 || strcmp(argv[i], "--width") == 0) {
             if (++i >= argc) {
                 fprintf(stderr, "Error: %s requires an argument\n", argv[i - 1]);
@@ -165,7 +169,7 @@ static int parse_args(int argc, char** argv, RenderArgs* args) {
 static MouseDragController* drag_controller = NULL;
 
 /*
- * Animation playback state
+ * Animation playback state (owned by the scene's animation world)
  */
 static AnimationState* anim_state = NULL;
 static float last_frame_time = 0.0f;
@@ -240,11 +244,10 @@ void render_scene_callback(Engine* engine, Scene* current_scene) {
     float delta_time = time_value - last_frame_time;
     last_frame_time = time_value;
 
-    // Update animation
-    if (anim_state && anim_state->playing) {
-        update_animation(anim_state, delta_time);
-        set_render_animation_state(anim_state);
-    }
+    // Update all animation instances, LOD picked against last frame's camera
+    set_animation_world_view(current_scene->animation_world, engine->view_matrix,
+                             engine->projection_matrix);
+    update_animation_world(current_scene->animation_world, delta_time);
 
     // Update camera via drag controller
     if (drag_controller) {
@@ -387,6 +390,11 @@ int main(int argc, char** argv) {
      * Import model with async texture loading.
      */
 
+    if (args.compress_anims) {
+        AnimationCompressionConfig compression = animation_compression_default_config();
+        set_import_animation_compression(&compression);
+    }
+
     Scene* scene =
         create_scene_from_model_path_async(args.model_path, args.texture_dir, engine->async_loader);
     if (!scene) {
@@ -428,7 +436,8 @@ int main(int argc, char** argv) {
 
         IBLResources* ibl = create_ibl_resources();
         if (ibl && load_hdr_environment(ibl, args.hdr_path) == 0) {
-            if (precompute_ibl(ibl, engine) == 0) {
+            // Low quality now, refined to full quality over the first frames
+            if (begin_progressive_ibl(ibl, engine) == 0) {
                 scene->ibl = ibl;
                 scene->render_skybox = true;
                 scene->skybox_exposure = 1.0f;
@@ -463,7 +472,8 @@ int main(int argc, char** argv) {
 
     // Start playing the first animation if available
     if (scene->animation_count > 0 && scene->skeleton_count > 0) {
-        anim_state = create_animation_state(scene->skeletons[0]);
+        anim_state = add_animation_instance(scene->animation_world, scene->skeletons[0],
+                                            scene->root_node);
         if (anim_state) {
             set_animation(anim_state, scene->animations[0]);
             anim_state->looping = true;
@@ -525,9 +535,6 @@ int main(int argc, char** argv) {
     run_engine_render_loop(engine, render_scene_callback);
 
     printf("Cleaning up...\n");
-    if (anim_state) {
-        free_animation_state(anim_state);
-    }
     free_mouse_drag_controller(drag_controller);
     free_engine(engine);
 
@@ -0,0 +1,157 @@
+// Vertex Animation Bake Tool
+//
+// Imports a skinned model, plays every clip (its own and any loaded with -a) on one of
+// its skinned meshes, and writes the baked positions and normals to a .vat file that
+// load_vertex_animation reads back for crowd rendering. A window is opened only
+// because import needs a GL context for textures.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cetra/engine.h"
+#include "cetra/import.h"
+#include "cetra/mesh.h"
+#include "cetra/scene.h"
+#include "cetra/vat.h"
+
+#define MAX_ANIM_FILES 32
+
+typedef struct BakeArgs {
+    const char* model_path;
+    const char* output_path;
+    const char* anim_files[MAX_ANIM_FILES];
+    int anim_count;
+    int mesh_index;
+    float fps;
+} BakeArgs;
+
+static void print_usage(const char* prog) {
+    fprintf(stderr, "Usage: %s -m <model> -o <output.vat> [options]\n\n", prog);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  -m, --model <path>     Skinned model file [required]\n");
+    fprintf(stderr, "  -o, --output <path>    Baked vertex animation file [required]\n");
+    fprintf(stderr, "  -a, --anim <path>      Animation file (can be repeated)\n");
+    fprintf(stderr, "  -f, --fps <float>      Bake rate (default: %.0f)\n", VAT_DEFAULT_FPS);
+    fprintf(stderr, "  -i, --mesh <int>       Skinned mesh to bake (default: 0)\n");
+    fprintf(stderr, "  -h, --help             Show this help message\n");
+    fprintf(stderr, "\nExample:\n");
+    fprintf(stderr, "  %s -m character.fbx -a walk.fbx -a idle.fbx -o crowd.vat\n", prog);
+}
+
+static int parse_args(int argc, char** argv, BakeArgs* args) {
+    memset(args, 0, sizeof(BakeArgs));
+    args->fps = VAT_DEFAULT_FPS;
+
+    for (int i = 1; i < argc; i++) {
+        const char* opt = argv[i];
+        if (strcmp(opt, "-h") == 0 || strcmp(opt, "--help") == 0)
+            return -1;
+
+        if (i + 1 >= argc) {
+            fprintf(stderr, "Error: %s requires an argument\n", opt);
+            return -1;
+        }
+        const char* value = argv[++i];
+
+        if (strcmp(opt, "-m") == 0 || strcmp(opt, "--model") == 0) {
+            args->model_path = value;
+        } else if (strcmp(opt, "-o") == 0 || strcmp(opt, "--output") == 0) {
+            args->output_path = value;
+        } else if (strcmp(opt, "-a") == 0 || strcmp(opt, "--anim") == 0) {
+            if (args->anim_count >= MAX_ANIM_FILES) {
+                fprintf(stderr, "Error: too many animation files (max %d)\n", MAX_ANIM_FILES);
+                return -1;
+            }
+            args->anim_files[args->anim_count++] = value;
+        } else if (strcmp(opt, "-f") == 0 || strcmp(opt, "--fps") == 0) {
+            args->fps = (float)atof(value);
+            if (args->fps <= 0.0f) {
+                fprintf(stderr, "Error: invalid fps '%s'\n", value);
+                return -1;
+            }
+        } else if (strcmp(opt, "-i") == 0 || strcmp(opt, "--mesh") == 0) {
+            args->mesh_index = atoi(value);
+        } else {
+            fprintf(stderr, "Error: unknown option '%s'\n", opt);
+            return -1;
+        }
+    }
+
+    if (!args->model_path || !args->output_path) {
+        fprintf(stderr, "Error: model and output are required\n");
+        return -1;
+    }
+    return 0;
+}
+
+// Depth-first search for the index-th skinned mesh
+static Mesh* find_skinned_mesh(SceneNode* node, int* index) {
+    if (!node)
+        return NULL;
+
+    for (size_t i = 0; i < node->mesh_count; i++) {
+        Mesh* mesh = node->meshes[i];
+        if (mesh && mesh->is_skinned && (*index)-- == 0)
+            return mesh;
+    }
+    for (size_t i = 0; i < node->children_count; i++) {
+        Mesh* mesh = find_skinned_mesh(node->children[i], index);
+        if (mesh)
+            return mesh;
+    }
+    return NULL;
+}
+
+int main(int argc, char** argv) {
+    BakeArgs args;
+    if (parse_args(argc, argv, &args) != 0) {
+        print_usage(argv[0]);
+        return -1;
+    }
+
+    Engine* engine = create_engine("vatbake", 320, 240);
+    if (!engine || init_engine(engine) != 0) {
+        fprintf(stderr, "Failed to initialize engine\n");
+        return -1;
+    }
+
+    Scene* scene = create_scene_from_model_path(args.model_path, NULL);
+    if (!scene) {
+        fprintf(stderr, "Failed to import model: %s\n", args.model_path);
+        free_engine(engine);
+        return -1;
+    }
+
+    int index = args.mesh_index;
+    Mesh* mesh = find_skinned_mesh(scene->root_node, &index);
+    if (!mesh) {
+        fprintf(stderr, "Model has no skinned mesh %d\n", args.mesh_index);
+        free_scene(scene);
+        free_engine(engine);
+        return -1;
+    }
+
+    for (int i = 0; i < args.anim_count; i++) {
+        if (load_animations_from_file(scene, mesh->skeleton, args.anim_files[i]) < 0)
+            fprintf(stderr, "Failed to load animations from %s\n", args.anim_files[i]);
+    }
+
+    int result = -1;
+    VertexAnimation* vat =
+        bake_vertex_animation(mesh, scene->animations, scene->animation_count, args.fps);
+    if (vat && save_vertex_animation(vat, args.output_path) == 0) {
+        printf("Baked %zu vertices x %zu frames to %s\n", vat->vertex_count, vat->frame_count,
+               args.output_path);
+        for (size_t i = 0; i < vat->clip_count; i++) {
+            printf("  clip %zu: %-24s %u frames @ %.0f fps\n", i, vat->clips[i].name,
+                   vat->clips[i].frame_count, vat->clips[i].fps);
+        }
+        result = 0;
+    }
+
+    free_vertex_animation(vat);
+    free_scene(scene);
+    free_engine(engine);
+    return result;
+}
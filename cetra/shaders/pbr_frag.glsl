@@ -88,16 +88,30 @@ uniform int anisotropyTexExists;
 uniform int subsurfaceTexExists;
 
 // Shadow mapping uniforms
-#define MAX_SHADOW_LIGHTS 3
-uniform sampler2DArray shadowMaps;
-uniform mat4 lightSpaceMatrix[MAX_SHADOW_LIGHTS];
-uniform int shadowLightIndex[MAX_SHADOW_LIGHTS];
+#define MAX_SHADOW_LIGHTS 4
+#define MAX_SHADOW_CASCADES 4
+#define MAX_SHADOW_LAYERS 8
+#define SHADOW_TILE_TEXELS 6
+uniform sampler2DArrayShadow shadowMaps;
+uniform sampler2DArray shadowDepthMaps;             // shadowMaps without comparison, for PCSS
+uniform mat4 lightSpaceMatrix[MAX_SHADOW_LAYERS];   // Per array layer
+uniform int shadowLightIndex[MAX_SHADOW_LIGHTS];    // Light using each shadow slot
+uniform int shadowFirstLayer[MAX_SHADOW_LIGHTS];    // First cascade layer of each slot
+uniform int shadowCascadeCount[MAX_SHADOW_LIGHTS];   // 0 for atlas lights
+uniform int shadowFirstTile[MAX_SHADOW_LIGHTS];      // First atlas tile (cube face +X) of each slot
+uniform float cascadeSplits[MAX_SHADOW_CASCADES];   // Far view depth of each cascade
 uniform int numShadowLights;
 uniform float shadowBias;
 uniform vec2 shadowTexelSize;
+uniform int shadowFilter;            // 0 single tap, 1 Poisson disk, 2 PCSS
+uniform float shadowFilterRadius;    // Poisson disk radius in texels
+uniform float shadowLightSize;       // PCSS light size in texels
+uniform sampler2DShadow shadowAtlas; // Point and spot light tiles
+uniform sampler2D shadowAtlasDepth;  // shadowAtlas without comparison, for PCSS
+uniform samplerBuffer shadowTiles;   // Per tile: matrix columns, atlas offset, scale, bias, near, far
 
 // IBL (Image-Based Lighting) uniforms
-uniform samplerCube irradianceMap;
+uniform vec3 shIrradiance[9];   // SH9 irradiance over pi, cosine lobe folded in
 uniform samplerCube prefilteredMap;
 uniform sampler2D brdfLUT;
 uniform int iblEnabled;
@@ -237,8 +251,120 @@ float calculateAttenuation(float distance, float constant, float linear, float q
     return 1.0 / (constant + linear * distance + quadratic * (distance * distance));
 }
 
-// PCF soft shadow calculation
-float calculateShadow(int shadowIndex, vec3 worldPos, float NdotL) {
+#define SHADOW_POISSON_TAPS 12
+
+const vec2 poissonDisk[SHADOW_POISSON_TAPS] = vec2[](
+    vec2(-0.326, -0.406), vec2(-0.840, -0.074), vec2(-0.696,  0.457),
+    vec2(-0.203,  0.621), vec2( 0.962, -0.195), vec2( 0.473, -0.480),
+    vec2( 0.519,  0.767), vec2( 0.185, -0.893), vec2( 0.507,  0.064),
+    vec2( 0.896,  0.412), vec2(-0.322, -0.933), vec2(-0.792, -0.598)
+);
+
+// One shadow map for the filters below: a cascade layer, or an atlas tile whose taps are
+// clamped to bounds (min.xy, max.xy) so neighbouring tiles never bleed in. depthRange is an
+// atlas tile's near and far planes; for a cascade, x is the world distance its depth spans.
+struct ShadowMapRef {
+    bool atlas;
+    float layer;
+    vec4 bounds;
+    vec2 texel;
+    vec2 depthRange;
+};
+
+// Hardware comparison: lit fraction of the 2x2 texels around uv
+float shadowTap(ShadowMapRef map, vec2 uv, float depth) {
+    if (map.atlas) {
+        return texture(shadowAtlas, vec3(clamp(uv, map.bounds.xy, map.bounds.zw), depth));
+    }
+    return texture(shadowMaps, vec4(uv, map.layer, depth));
+}
+
+float shadowDepth(ShadowMapRef map, vec2 uv) {
+    if (map.atlas) {
+        return texture(shadowAtlasDepth, clamp(uv, map.bounds.xy, map.bounds.zw)).r;
+    }
+    return texture(shadowDepthMaps, vec3(uv, map.layer)).r;
+}
+
+// Per-pixel disk rotation, so the taps' banding turns into fine noise
+mat2 poissonRotation() {
+    float angle = 6.2831853 * fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+    float c = cos(angle);
+    float s = sin(angle);
+    return mat2(c, s, -s, c);
+}
+
+float poissonShadow(ShadowMapRef map, vec2 uv, float depth, float radiusTexels) {
+    mat2 rotation = poissonRotation();
+    float lit = 0.0;
+    for (int i = 0; i < SHADOW_POISSON_TAPS; ++i) {
+        vec2 offset = rotation * poissonDisk[i] * radiusTexels * map.texel;
+        lit += shadowTap(map, uv + offset, depth);
+    }
+    return lit / float(SHADOW_POISSON_TAPS);
+}
+
+// Stored depth as distance from the light: perspective atlas tiles are linearized with their
+// planes, orthographic cascades are already linear
+float shadowLinearDepth(ShadowMapRef map, float depth) {
+    if (map.atlas) {
+        float n = map.depthRange.x;
+        float f = map.depthRange.y;
+        return 2.0 * n * f / (f + n - (depth * 2.0 - 1.0) * (f - n));
+    }
+    return depth * map.depthRange.x;
+}
+
+// Percentage-closer soft shadows: the average blocker depth inside the light's footprint
+// sets the penumbra width, which the Poisson disk then filters over
+float pcssShadow(ShadowMapRef map, vec2 uv, float depth) {
+    mat2 rotation = poissonRotation();
+    float blockerSum = 0.0;
+    int blockers = 0;
+    for (int i = 0; i < SHADOW_POISSON_TAPS; ++i) {
+        vec2 offset = rotation * poissonDisk[i] * shadowLightSize * map.texel;
+        float blockerDepth = shadowDepth(map, uv + offset);
+        if (blockerDepth < depth) {
+            blockerSum += blockerDepth;
+            blockers++;
+        }
+    }
+    if (blockers == 0) {
+        return 1.0;
+    }
+
+    float receiver = shadowLinearDepth(map, depth);
+    float blocker = shadowLinearDepth(map, blockerSum / float(blockers));
+
+    // Point and spot lights: similar triangles from the light. Directional lights have no
+    // position, so the penumbra grows with the receiver-blocker distance alone.
+    float penumbra = map.atlas ? (receiver - blocker) / max(blocker, 1e-4) * shadowLightSize
+                               : (receiver - blocker) * shadowLightSize;
+    return poissonShadow(map, uv, depth, clamp(penumbra, 1.0, shadowLightSize));
+}
+
+float filterShadow(ShadowMapRef map, vec2 uv, float depth) {
+    if (shadowFilter == 2) {
+        return pcssShadow(map, uv, depth);
+    }
+    if (shadowFilter == 1) {
+        return poissonShadow(map, uv, depth, shadowFilterRadius);
+    }
+    return shadowTap(map, uv, depth);
+}
+
+// Soft shadow calculation, sampling the cascade that covers this fragment's view depth
+float calculateShadow(int shadowSlot, vec3 worldPos, float NdotL) {
+    float viewDepth = -ViewPos.z;
+    int cascade = 0;
+    while (cascade < shadowCascadeCount[shadowSlot] && viewDepth > cascadeSplits[cascade]) {
+        cascade++;
+    }
+    if (cascade >= shadowCascadeCount[shadowSlot]) {
+        return 1.0;  // Beyond the shadow distance
+    }
+    int shadowIndex = shadowFirstLayer[shadowSlot] + cascade;
+
     vec4 fragPosLightSpace = lightSpaceMatrix[shadowIndex] * vec4(worldPos, 1.0);
     vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
     projCoords = projCoords * 0.5 + 0.5;
@@ -249,18 +375,71 @@ float calculateShadow(int shadowIndex, vec3 worldPos, float NdotL) {
     }
 
     float bias = max(shadowBias * (1.0 - NdotL), shadowBias * 0.1);
-    float currentDepth = projCoords.z;
-
-    // PCF 3x3 kernel
-    float shadow = 0.0;
-    for (int x = -1; x <= 1; ++x) {
-        for (int y = -1; y <= 1; ++y) {
-            vec2 offset = vec2(float(x), float(y)) * shadowTexelSize;
-            float pcfDepth = texture(shadowMaps, vec3(projCoords.xy + offset, float(shadowIndex))).r;
-            shadow += currentDepth - bias > pcfDepth ? 1.0 : 0.0;
+
+    // Orthographic clip z changes by 2 / (far - near) per world unit along the light
+    mat4 m = lightSpaceMatrix[shadowIndex];
+    float depthSpan = 2.0 / length(vec3(m[0][2], m[1][2], m[2][2]));
+
+    ShadowMapRef map = ShadowMapRef(false, float(shadowIndex), vec4(0.0, 0.0, 1.0, 1.0),
+                                    shadowTexelSize, vec2(depthSpan, 0.0));
+    return filterShadow(map, projCoords.xy, projCoords.z - bias);
+}
+
+// Shadow from a point or spot light's atlas tile; point lights pick the cube face by the
+// major axis of the light-to-fragment vector
+float calculateAtlasShadow(int shadowSlot, int lightIndex, vec3 worldPos, float NdotL) {
+    int tile = shadowFirstTile[shadowSlot];
+    if (lights[lightIndex].type == 1) {
+        vec3 d = worldPos - lights[lightIndex].position;
+        vec3 a = abs(d);
+        if (a.x >= a.y && a.x >= a.z) {
+            tile += d.x > 0.0 ? 0 : 1;
+        } else if (a.y >= a.z) {
+            tile += d.y > 0.0 ? 2 : 3;
+        } else {
+            tile += d.z > 0.0 ? 4 : 5;
         }
     }
-    return 1.0 - (shadow / 9.0);
+
+    int base = tile * SHADOW_TILE_TEXELS;
+    mat4 tileMatrix = mat4(texelFetch(shadowTiles, base), texelFetch(shadowTiles, base + 1),
+                           texelFetch(shadowTiles, base + 2), texelFetch(shadowTiles, base + 3));
+    vec4 rect = texelFetch(shadowTiles, base + 4);
+    vec2 planes = texelFetch(shadowTiles, base + 5).xy;
+
+    vec4 fragPosLightSpace = tileMatrix * vec4(worldPos, 1.0);
+    if (fragPosLightSpace.w <= 0.0) {
+        return 1.0;
+    }
+    vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w * 0.5 + 0.5;
+    if (projCoords.z > 1.0 || any(lessThan(projCoords.xy, vec2(0.0))) ||
+        any(greaterThan(projCoords.xy, vec2(1.0)))) {
+        return 1.0;
+    }
+
+    // Keep the kernel inside the tile so neighbours never bleed in
+    vec2 atlasTexel = 1.0 / vec2(textureSize(shadowAtlas, 0));
+    vec4 bounds = vec4(rect.xy + atlasTexel * 0.5, rect.xy + vec2(rect.z) - atlasTexel * 0.5);
+    vec2 uv = rect.xy + projCoords.xy * rect.z;
+
+    float bias = max(rect.w * (1.0 - NdotL), rect.w * 0.1);
+
+    ShadowMapRef map = ShadowMapRef(true, 0.0, bounds, atlasTexel, planes);
+    return filterShadow(map, uv, projCoords.z - bias);
+}
+
+// Irradiance from the 9 SH coefficients, in the basis order project_sh9_irradiance uses
+vec3 evaluateSHIrradiance(vec3 n) {
+    vec3 irradiance = shIrradiance[0] * 0.282095
+                    + shIrradiance[1] * 0.488603 * n.y
+                    + shIrradiance[2] * 0.488603 * n.z
+                    + shIrradiance[3] * 0.488603 * n.x
+                    + shIrradiance[4] * 1.092548 * n.x * n.y
+                    + shIrradiance[5] * 1.092548 * n.y * n.z
+                    + shIrradiance[6] * 0.315392 * (3.0 * n.z * n.z - 1.0)
+                    + shIrradiance[7] * 1.092548 * n.x * n.z
+                    + shIrradiance[8] * 0.546274 * (n.x * n.x - n.y * n.y);
+    return max(irradiance, vec3(0.0));
 }
 
 // Find shadow slot for a given light index (-1 if not shadow-casting)
@@ -524,12 +703,14 @@ void main() {
         // Lambertian diffuse
         float NdotL = max(dot(N, L), 0.0);
 
-        // Shadow calculation for directional lights
+        // Cascades for directional lights, atlas tiles for point and spot lights
         float shadow = 1.0;
-        if (lights[i].type == 0) {  // LIGHT_DIRECTIONAL = 0
-            int shadowSlot = getShadowSlot(i);
-            if (shadowSlot >= 0) {
+        int shadowSlot = getShadowSlot(i);
+        if (shadowSlot >= 0) {
+            if (shadowCascadeCount[shadowSlot] > 0) {
                 shadow = calculateShadow(shadowSlot, WorldPos, NdotL);
+            } else {
+                shadow = calculateAtlasShadow(shadowSlot, i, WorldPos, NdotL);
             }
         }
 
@@ -552,8 +733,8 @@ void main() {
         vec3 kD = vec3(1.0) - kS;
         kD *= 1.0 - metallicMap;
 
-        // Diffuse IBL: sample irradiance map with surface normal
-        vec3 irradiance = texture(irradianceMap, N).rgb;
+        // Diffuse IBL: evaluate SH irradiance at the surface normal
+        vec3 irradiance = evaluateSHIrradiance(N);
         vec3 diffuse = irradiance * albedoMap;
 
         // Specular IBL: sample prefiltered env map with reflection vector
@@ -21,7 +21,6 @@ out vec4 VertexColor;
 out mat3 TBN;
 
 #define MAX_LIGHTS 70
-#define MAX_BONES  128
 
 struct Light {
     int type;
@@ -49,39 +48,36 @@ uniform mat4 projection;
 uniform vec3 camPos;
 uniform float time;
 
-// Skinning uniforms
+// Skinning uniforms. Instance records live in the bone palette buffer: 3 texels of
+// model matrix followed by the first vertex of the mesh's pre-skinned output, which
+// holds 4 texels per vertex (position, normal, tangent, bitangent).
 uniform bool skinned;
-uniform mat4 boneMatrices[MAX_BONES];
+uniform samplerBuffer bonePalette;
+uniform samplerBuffer skinnedVertices;
+uniform int instanceOffset; // First record of this instanced draw
+
+mat4 fetchMatrix(int texel) {
+    return transpose(mat4(texelFetch(bonePalette, texel), texelFetch(bonePalette, texel + 1),
+                          texelFetch(bonePalette, texel + 2), vec4(0.0, 0.0, 0.0, 1.0)));
+}
 
 void main() {
     vec4 localPos;
     vec3 localNormal;
     vec3 localTangent;
     vec3 localBitangent;
+    mat4 modelMatrix = model;
 
     if (skinned) {
-        // Apply bone transforms weighted by bone weights
-        mat4 boneTransform = mat4(0.0);
-        float totalWeight = 0.0;
-
-        for (int i = 0; i < 4; i++) {
-            if (aBoneIds[i] >= 0 && aBoneIds[i] < MAX_BONES) {
-                boneTransform += boneMatrices[aBoneIds[i]] * aBoneWeights[i];
-                totalWeight += aBoneWeights[i];
-            }
-        }
-
-        // Fallback to identity if no valid bones
-        if (totalWeight < 0.001) {
-            boneTransform = mat4(1.0);
-        }
-
-        // Transform position and normals by bone matrix
-        localPos = boneTransform * vec4(aPos, 1.0);
-        mat3 boneRotation = mat3(boneTransform);
-        localNormal = boneRotation * aNormal;
-        localTangent = boneRotation * aTangent;
-        localBitangent = boneRotation * aBitangent;
+        int record = instanceOffset + gl_InstanceID * 4;
+        modelMatrix = fetchMatrix(record);
+        int vertex = (int(texelFetch(bonePalette, record + 3).x) + gl_VertexID) * 4;
+
+        // Already skinned by the pre-pass
+        localPos = vec4(texelFetch(skinnedVertices, vertex).xyz, 1.0);
+        localNormal = texelFetch(skinnedVertices, vertex + 1).xyz;
+        localTangent = texelFetch(skinnedVertices, vertex + 2).xyz;
+        localBitangent = texelFetch(skinnedVertices, vertex + 3).xyz;
     } else {
         // Non-skinned: pass through unchanged
         localPos = vec4(aPos, 1.0);
@@ -91,7 +87,7 @@ void main() {
     }
 
     // Transform to world space
-    vec4 worldPos = model * localPos;
+    vec4 worldPos = modelMatrix * localPos;
     WorldPos = worldPos.xyz;
 
     vec4 viewPos = view * worldPos;
@@ -104,16 +100,16 @@ void main() {
     FragDepth = clipPos.z / clipPos.w;
 
     // Transform normals to world space
-    mat3 normalMatrix = mat3(transpose(inverse(model)));
+    mat3 normalMatrix = mat3(transpose(inverse(modelMatrix)));
     Normal = normalize(normalMatrix * localNormal);
     TexCoords = aTexCoords;
     TexCoords2 = aTexCoords2;
     VertexColor = aColor;
 
     // Calculate TBN matrix for normal mapping
-    vec3 T = normalize(mat3(model) * localTangent);
-    vec3 B = normalize(mat3(model) * localBitangent);
-    vec3 N = normalize(mat3(model) * localNormal);
+    vec3 T = normalize(mat3(modelMatrix) * localTangent);
+    vec3 B = normalize(mat3(modelMatrix) * localBitangent);
+    vec3 N = normalize(mat3(modelMatrix) * localNormal);
     TBN = mat3(T, B, N);
 
     gl_Position = clipPos;
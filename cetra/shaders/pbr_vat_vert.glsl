@@ -0,0 +1,142 @@
+#version 330 core
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec3 aNormal;
+layout(location = 2) in vec2 aTexCoords;
+layout(location = 3) in vec3 aTangent;
+layout(location = 4) in vec3 aBitangent;
+layout(location = 5) in vec4 aColor;
+layout(location = 8) in vec2 aTexCoords2;
+
+out vec3 Normal;
+out vec3 WorldPos;
+out vec3 ViewPos;
+out vec3 FragPos;
+out float ClipDepth;
+out float FragDepth;
+out vec2 TexCoords;
+out vec2 TexCoords2;
+out vec4 VertexColor;
+out mat3 TBN;
+
+#define MAX_LIGHTS 70
+
+struct Light {
+    int type;
+    vec3 position;
+    vec3 direction;
+    vec3 color;
+    vec3 specular;
+    vec3 ambient;
+    float intensity;
+    float constant;
+    float linear;
+    float quadratic;
+    float cutOff;
+    float outerCutOff;
+    vec2 size;
+};
+
+uniform Light lights[MAX_LIGHTS];
+uniform int numLights;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+uniform vec3 camPos;
+uniform float time;
+
+// Crowd uniforms. Instance records are 3 texels of transform (relative to model)
+// followed by clip, time offset and rate. Baked frames are rows of vatWidth texels.
+#define MAX_VAT_CLIPS 16
+
+struct VatClip {
+    int firstFrame;
+    int frameCount;
+    float fps;
+    bool looping;
+};
+
+uniform VatClip clips[MAX_VAT_CLIPS];
+uniform samplerBuffer crowdInstances;
+uniform sampler2D vatPositions;
+uniform sampler2D vatNormals;
+uniform int vatWidth;
+uniform int vatRowsPerFrame;
+
+mat4 fetchMatrix(int texel) {
+    return transpose(mat4(texelFetch(crowdInstances, texel),
+                          texelFetch(crowdInstances, texel + 1),
+                          texelFetch(crowdInstances, texel + 2), vec4(0.0, 0.0, 0.0, 1.0)));
+}
+
+ivec2 frameTexel(int frame) {
+    return ivec2(gl_VertexID % vatWidth, frame * vatRowsPerFrame + gl_VertexID / vatWidth);
+}
+
+void main() {
+    int record = gl_InstanceID * 4;
+    mat4 modelMatrix = model * fetchMatrix(record);
+    vec4 params = texelFetch(crowdInstances, record + 3);
+
+    // Clip clock from frame time; nothing is advanced on the CPU
+    VatClip clip = clips[int(params.x)];
+    float frame = max((time * params.z + params.y) * clip.fps, 0.0);
+    int frame0;
+    int frame1;
+    if (clip.looping) {
+        frame = mod(frame, float(clip.frameCount));
+        frame0 = int(frame);
+        frame1 = (frame0 + 1) % clip.frameCount;
+    } else {
+        frame = min(frame, float(clip.frameCount - 1));
+        frame0 = int(frame);
+        frame1 = min(frame0 + 1, clip.frameCount - 1);
+    }
+    float blend = fract(frame);
+
+    ivec2 texel0 = frameTexel(clip.firstFrame + frame0);
+    ivec2 texel1 = frameTexel(clip.firstFrame + frame1);
+    vec4 localPos = vec4(mix(texelFetch(vatPositions, texel0, 0).xyz,
+                             texelFetch(vatPositions, texel1, 0).xyz, blend), 1.0);
+    vec3 localNormal = normalize(mix(texelFetch(vatNormals, texel0, 0).xyz,
+                                     texelFetch(vatNormals, texel1, 0).xyz, blend));
+
+    // Tangents are not baked: re-orthogonalize the rest tangent against the baked normal
+    vec3 localTangent = aTangent - localNormal * dot(localNormal, aTangent);
+    if (dot(localTangent, localTangent) < 1e-8) {
+        localTangent = abs(localNormal.y) < 0.99 ? cross(vec3(0.0, 1.0, 0.0), localNormal)
+                                                 : vec3(1.0, 0.0, 0.0);
+    }
+    localTangent = normalize(localTangent);
+    float handedness = dot(cross(aNormal, aTangent), aBitangent) < 0.0 ? -1.0 : 1.0;
+    vec3 localBitangent = cross(localNormal, localTangent) * handedness;
+
+    // Transform to world space
+    vec4 worldPos = modelMatrix * localPos;
+    WorldPos = worldPos.xyz;
+
+    vec4 viewPos = view * worldPos;
+    ViewPos = viewPos.xyz;
+
+    vec4 clipPos = projection * viewPos;
+    FragPos = clipPos.xyz;
+    ClipDepth = clipPos.z;
+
+    FragDepth = clipPos.z / clipPos.w;
+
+    // Transform normals to world space
+    mat3 normalMatrix = mat3(transpose(inverse(modelMatrix)));
+    Normal = normalize(normalMatrix * localNormal);
+    TexCoords = aTexCoords;
+    TexCoords2 = aTexCoords2;
+    VertexColor = aColor;
+
+    // Calculate TBN matrix for normal mapping
+    vec3 T = normalize(mat3(modelMatrix) * localTangent);
+    vec3 B = normalize(mat3(modelMatrix) * localBitangent);
+    vec3 N = normalize(mat3(modelMatrix) * localNormal);
+    TBN = mat3(T, B, N);
+
+    gl_Position = clipPos;
+}
@@ -4,7 +4,15 @@ layout (location = 0) in vec3 aPos;
 uniform mat4 model;
 uniform mat4 lightSpaceMatrix;
 
+// Skinned meshes read positions from the skinning pre-pass, 4 texels per vertex
+uniform bool skinned;
+uniform samplerBuffer skinnedVertices;
+uniform int vertexBase;
+
 void main()
 {
-    gl_Position = lightSpaceMatrix * model * vec4(aPos, 1.0);
+    vec3 pos = aPos;
+    if (skinned)
+        pos = texelFetch(skinnedVertices, (vertexBase + gl_VertexID) * 4).xyz;
+    gl_Position = lightSpaceMatrix * model * vec4(pos, 1.0);
 }
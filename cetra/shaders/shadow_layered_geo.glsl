@@ -0,0 +1,24 @@
+#version 410 core
+// Single-pass shadows: each triangle is instanced once per shadow map array layer and
+// emitted only into the layers whose light volume its mesh overlaps. The vertex shader
+// runs with an identity lightSpaceMatrix, so positions arrive in world space.
+#define MAX_SHADOW_LAYERS 8
+
+layout(triangles, invocations = MAX_SHADOW_LAYERS) in;
+layout(triangle_strip, max_vertices = 3) out;
+
+uniform mat4 layerMatrices[MAX_SHADOW_LAYERS];
+uniform int layerMask; // Bit per layer the current mesh is drawn into
+
+void main()
+{
+    if ((layerMask & (1 << gl_InvocationID)) == 0)
+        return;
+
+    for (int i = 0; i < 3; ++i) {
+        gl_Position = layerMatrices[gl_InvocationID] * gl_in[i].gl_Position;
+        gl_Layer = gl_InvocationID;
+        EmitVertex();
+    }
+    EndPrimitive();
+}
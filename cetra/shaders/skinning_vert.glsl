@@ -0,0 +1,46 @@
+#version 330 core
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec3 aNormal;
+layout(location = 3) in vec3 aTangent;
+layout(location = 4) in vec3 aBitangent;
+layout(location = 6) in ivec4 aBoneIds;
+layout(location = 7) in vec4 aBoneWeights;
+
+// Captured by transform feedback, interleaved, one texel each
+out vec4 skinnedPosition;
+out vec4 skinnedNormal;
+out vec4 skinnedTangent;
+out vec4 skinnedBitangent;
+
+// A bone is 3 texels of the palette buffer (rows of its 3x4 matrix)
+uniform samplerBuffer bonePalette;
+uniform int paletteOffset;
+
+mat4 fetchMatrix(int texel) {
+    return transpose(mat4(texelFetch(bonePalette, texel), texelFetch(bonePalette, texel + 1),
+                          texelFetch(bonePalette, texel + 2), vec4(0.0, 0.0, 0.0, 1.0)));
+}
+
+void main() {
+    // Apply bone transforms weighted by bone weights
+    mat4 boneTransform = mat4(0.0);
+    float totalWeight = 0.0;
+
+    for (int i = 0; i < 4; i++) {
+        if (aBoneIds[i] >= 0) {
+            boneTransform += fetchMatrix(paletteOffset + aBoneIds[i] * 3) * aBoneWeights[i];
+            totalWeight += aBoneWeights[i];
+        }
+    }
+
+    // Fallback to identity if no valid bones
+    if (totalWeight < 0.001) {
+        boneTransform = mat4(1.0);
+    }
+
+    mat3 boneRotation = mat3(boneTransform);
+    skinnedPosition = vec4((boneTransform * vec4(aPos, 1.0)).xyz, 1.0);
+    skinnedNormal = vec4(boneRotation * aNormal, 0.0);
+    skinnedTangent = vec4(boneRotation * aTangent, 0.0);
+    skinnedBitangent = vec4(boneRotation * aBitangent, 0.0);
+}
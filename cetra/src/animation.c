@@ -1,4 +1,7 @@
 #include "animation.h"
+#include "animation_blend.h"
+#include "animation_compress.h"
+#include "animation_stream.h"
 #include "util.h"
 #include "ext/log.h"
 
@@ -22,6 +25,7 @@ Skeleton* create_skeleton(const char* name) {
     skeleton->bones = NULL;
     skeleton->bone_count = 0;
     skeleton->bone_map = NULL;
+    skeleton->bone_lod = NULL;
 
     return skeleton;
 }
@@ -48,6 +52,7 @@ void free_skeleton(Skeleton* skeleton) {
 
     if (skeleton->bones)
         free(skeleton->bones);
+    free(skeleton->bone_lod);
 
     if (skeleton->name)
         free(skeleton->name);
@@ -89,6 +94,10 @@ int add_bone_to_skeleton(Skeleton* skeleton, const char* name, int parent_index,
 
     skeleton->bone_count = new_count;
 
+    // LOD masks cover a fixed bone set; rebuild them once the skeleton is complete
+    free(skeleton->bone_lod);
+    skeleton->bone_lod = NULL;
+
     // Add to hash map for name lookup
     BoneIndexEntry* entry = malloc(sizeof(BoneIndexEntry));
     if (entry) {
@@ -127,6 +136,76 @@ Bone* get_bone_by_index(Skeleton* skeleton, int index) {
     return &skeleton->bones[index];
 }
 
+static int _ensure_bone_lod(Skeleton* skeleton) {
+    if (skeleton->bone_lod)
+        return 0;
+
+    skeleton->bone_lod = malloc(skeleton->bone_count ? skeleton->bone_count : 1);
+    if (!skeleton->bone_lod) {
+        log_error("Failed to allocate LOD masks for skeleton '%s'", skeleton->name);
+        return -1;
+    }
+    memset(skeleton->bone_lod, ANIMATION_LOD_LEVELS - 1, skeleton->bone_count);
+    return 0;
+}
+
+int build_skeleton_lod(Skeleton* skeleton) {
+    if (!skeleton || _ensure_bone_lod(skeleton) < 0)
+        return -1;
+
+    // Height above the deepest leaf below each bone, capped at the coarsest LOD: every
+    // bone raises its ancestors. Roots keep moving at every LOD.
+    memset(skeleton->bone_lod, 0, skeleton->bone_count);
+    for (size_t i = 0; i < skeleton->bone_count; i++) {
+        int parent = skeleton->bones[i].parent_index;
+        if (parent < 0 || (size_t)parent >= skeleton->bone_count)
+            skeleton->bone_lod[i] = ANIMATION_LOD_LEVELS - 1;
+
+        for (size_t height = 1; parent >= 0 && (size_t)parent < skeleton->bone_count &&
+                                height < ANIMATION_LOD_LEVELS;
+             height++) {
+            if (skeleton->bone_lod[parent] < height)
+                skeleton->bone_lod[parent] = (uint8_t)height;
+            parent = skeleton->bones[parent].parent_index;
+        }
+    }
+
+    return 0;
+}
+
+int set_skeleton_bone_lod(Skeleton* skeleton, const char* root_bone, int max_lod) {
+    if (!skeleton || !root_bone || max_lod < 0)
+        return -1;
+
+    int root = get_bone_index_by_name(skeleton, root_bone);
+    if (root < 0) {
+        log_warn("LOD root bone '%s' not found in skeleton '%s'", root_bone, skeleton->name);
+        return -1;
+    }
+    if (_ensure_bone_lod(skeleton) < 0)
+        return -1;
+
+    if (max_lod > ANIMATION_LOD_LEVELS - 1)
+        max_lod = ANIMATION_LOD_LEVELS - 1;
+
+    for (size_t i = 0; i < skeleton->bone_count; i++) {
+        // Walk up to see whether root is an ancestor (or the bone itself)
+        int bone = (int)i;
+        for (size_t depth = 0; bone >= 0 && bone != root && depth < skeleton->bone_count;
+             depth++) {
+            int parent = skeleton->bones[bone].parent_index;
+            bone = (size_t)parent < skeleton->bone_count ? parent : -1;
+        }
+        if (bone == root && skeleton->bone_lod[i] > max_lod)
+            skeleton->bone_lod[i] = (uint8_t)max_lod;
+    }
+    return 0;
+}
+
+bool skeleton_bone_reduced(const Skeleton* skeleton, size_t bone, int lod) {
+    return skeleton->bone_lod && lod > skeleton->bone_lod[bone];
+}
+
 // ============================================================================
 // Animation Channel
 // ============================================================================
@@ -238,6 +317,8 @@ Animation* create_animation(const char* name, float duration, float ticks_per_se
     animation->channels = NULL;
     animation->channel_count = 0;
     animation->skeleton = NULL;
+    animation->streams = NULL;
+    animation->compressed = NULL;
 
     return animation;
 }
@@ -262,6 +343,9 @@ void free_animation(Animation* animation) {
     if (animation->channels)
         free(animation->channels);
 
+    free_animation_streams(animation->streams);
+    free_compressed_animation(animation->compressed);
+
     if (animation->name)
         free(animation->name);
 
@@ -354,11 +438,22 @@ AnimationState* create_animation_state(Skeleton* skeleton) {
     // Allocate scratch space
     state->local_transforms = malloc(skeleton->bone_count * sizeof(mat4));
     state->global_transforms = malloc(skeleton->bone_count * sizeof(mat4));
-
-    if (!state->local_transforms || !state->global_transforms) {
+    state->bone_channels = malloc(skeleton->bone_count * sizeof(int));
+    state->cursors = calloc(skeleton->bone_count, sizeof(KeyframeCursor));
+    state->sample_time = 0.0f;
+    state->blend = NULL;
+    state->lod = 0;
+    state->evaluated_bones = 0;
+    state->palette_offset = -1;
+    state->palette_frame = 0;
+
+    if (skeleton->bone_count > 0 && (!state->local_transforms || !state->global_transforms ||
+                                     !state->bone_channels || !state->cursors)) {
         log_error("Failed to allocate scratch space for AnimationState");
         free(state->local_transforms);
         free(state->global_transforms);
+        free(state->bone_channels);
+        free(state->cursors);
         free(state);
         return NULL;
     }
@@ -367,6 +462,7 @@ AnimationState* create_animation_state(Skeleton* skeleton) {
     for (size_t i = 0; i < skeleton->bone_count; i++) {
         glm_mat4_identity(state->local_transforms[i]);
         glm_mat4_identity(state->global_transforms[i]);
+        state->bone_channels[i] = -1;
     }
 
     // Compute initial bind pose
@@ -383,6 +479,11 @@ void free_animation_state(AnimationState* state) {
         free(state->local_transforms);
     if (state->global_transforms)
         free(state->global_transforms);
+    if (state->bone_channels)
+        free(state->bone_channels);
+    if (state->cursors)
+        free(state->cursors);
+    free_animation_blend(state->blend);
 
     free(state);
 }
@@ -393,6 +494,29 @@ void set_animation(AnimationState* state, Animation* animation) {
 
     state->current_animation = animation;
     state->current_time = 0.0f;
+    state->sample_time = 0.0f;
+
+    size_t bone_count = state->skeleton->bone_count;
+    build_bone_channel_table(animation, bone_count, state->bone_channels);
+    memset(state->cursors, 0, bone_count * sizeof(KeyframeCursor));
+}
+
+void build_bone_channel_table(const Animation* animation, size_t bone_count, int* bone_channels) {
+    if (!bone_channels)
+        return;
+
+    // Like get_channel_for_bone, the first channel targeting a bone wins
+    for (size_t i = 0; i < bone_count; i++) {
+        bone_channels[i] = -1;
+    }
+    if (!animation)
+        return;
+
+    for (size_t i = 0; i < animation->channel_count; i++) {
+        int bone = animation->channels[i].bone_index;
+        if (bone >= 0 && (size_t)bone < bone_count && bone_channels[bone] < 0)
+            bone_channels[bone] = (int)i;
+    }
 }
 
 void play_animation(AnimationState* state) {
@@ -419,7 +543,14 @@ void reset_animation(AnimationState* state) {
         return;
 
     state->current_time = 0.0f;
-    if (state->current_animation) {
+    if (state->blend) {
+        for (size_t i = 0; i < state->blend->layer_count; i++) {
+            state->blend->layers[i].time = 0.0f;
+        }
+        evaluate_animation_blend(state->blend, state);
+    } else if (state->current_animation && state->current_animation->streams) {
+        compute_bone_matrices_streams(state);
+    } else if (state->current_animation) {
         compute_bone_matrices(state);
     } else {
         compute_bind_pose_matrices(state);
@@ -427,62 +558,70 @@ void reset_animation(AnimationState* state) {
 }
 
 void update_animation(AnimationState* state, float delta_time) {
-    if (!state || !state->playing || !state->current_animation)
+    if (!state || !state->playing)
+        return;
+
+    // Layered playback drives the pose on its own clocks
+    if (state->blend) {
+        advance_animation_blend(state->blend, delta_time * state->speed);
+        evaluate_animation_blend(state->blend, state);
+        return;
+    }
+
+    if (!state->current_animation)
         return;
 
     const Animation* anim = state->current_animation;
 
     // Advance time
     float ticks_delta = delta_time * anim->ticks_per_second * state->speed;
-    state->current_time += ticks_delta;
+    if (!advance_animation_time(anim, &state->current_time, ticks_delta, state->looping))
+        state->playing = false;
+
+    // Recompute bone matrices
+    if (anim->streams)
+        compute_bone_matrices_streams(state);
+    else
+        compute_bone_matrices(state);
+}
+
+bool advance_animation_time(const Animation* animation, float* time, float delta_ticks,
+                            bool looping) {
+    if (!animation || !time)
+        return false;
+
+    *time += delta_ticks;
 
     // Handle looping/end
-    if (state->looping) {
-        if (anim->duration > 0.0f) {
-            state->current_time = fmodf(state->current_time, anim->duration);
-            if (state->current_time < 0.0f)
-                state->current_time += anim->duration;
-        }
-    } else {
-        if (state->current_time >= anim->duration) {
-            state->current_time = anim->duration;
-            state->playing = false;
-        } else if (state->current_time < 0.0f) {
-            state->current_time = 0.0f;
-            state->playing = false;
+    if (looping) {
+        if (animation->duration > 0.0f) {
+            *time = fmodf(*time, animation->duration);
+            if (*time < 0.0f)
+                *time += animation->duration;
         }
+        return true;
     }
 
-    // Recompute bone matrices
-    compute_bone_matrices(state);
+    if (*time >= animation->duration) {
+        *time = animation->duration;
+        return false;
+    }
+    if (*time < 0.0f) {
+        *time = 0.0f;
+        return false;
+    }
+    return true;
 }
 
 // ============================================================================
 // Keyframe Interpolation
 // ============================================================================
 
-// Find the two keyframes surrounding a time value for position keys
-static size_t find_position_keyframe_index(const PositionKey* keys, size_t count, float time) {
-    if (count < 2)
-        return 0;
-
-    // Binary search
-    size_t lo = 0;
-    size_t hi = count - 1;
-
-    while (hi - lo > 1) {
-        size_t mid = (lo + hi) / 2;
-        if (keys[mid].time <= time)
-            lo = mid;
-        else
-            hi = mid;
-    }
+// All key types start with their time, so one search serves them all
+#define KEY_TIME(keys, stride, i) (*(const float*)((const char*)(keys) + (i) * (stride)))
 
-    return lo;
-}
-
-// Find the two keyframes surrounding a time value for rotation keys
-static size_t find_rotation_keyframe_index(const RotationKey* keys, size_t count, float time) {
+// Find the index of the key at or before time (binary search)
+static size_t _find_keyframe_index(const void* keys, size_t stride, size_t count, float time) {
     if (count < 2)
         return 0;
 
@@ -491,7 +630,7 @@ static size_t find_rotation_keyframe_index(const RotationKey* keys, size_t count
 
     while (hi - lo > 1) {
         size_t mid = (lo + hi) / 2;
-        if (keys[mid].time <= time)
+        if (KEY_TIME(keys, stride, mid) <= time)
             lo = mid;
         else
             hi = mid;
@@ -500,26 +639,33 @@ static size_t find_rotation_keyframe_index(const RotationKey* keys, size_t count
     return lo;
 }
 
-// Find the two keyframes surrounding a time value for scale keys
-static size_t find_scale_keyframe_index(const ScaleKey* keys, size_t count, float time) {
-    if (count < 2)
-        return 0;
-
-    size_t lo = 0;
-    size_t hi = count - 1;
+// Like _find_keyframe_index, but starts from a cursor when playing forward. Small steps
+// are walked linearly; seeks, rewinds and large jumps fall back to the binary search.
+static size_t _seek_keyframe_index(const void* keys, size_t stride, size_t count, float time,
+                                   size_t* cursor, bool forward) {
+    size_t idx = *cursor;
 
-    while (hi - lo > 1) {
-        size_t mid = (lo + hi) / 2;
-        if (keys[mid].time <= time)
-            lo = mid;
-        else
-            hi = mid;
+    if (forward && idx + 1 < count && KEY_TIME(keys, stride, idx) <= time) {
+        int steps = 0;
+        while (idx + 2 < count && KEY_TIME(keys, stride, idx + 1) <= time &&
+               steps < KEYFRAME_CURSOR_MAX_STEPS) {
+            idx++;
+            steps++;
+        }
+        if (idx + 2 >= count || KEY_TIME(keys, stride, idx + 1) > time) {
+            *cursor = idx;
+            return idx;
+        }
     }
 
-    return lo;
+    idx = _find_keyframe_index(keys, stride, count, time);
+    *cursor = idx;
+    return idx;
 }
 
-void interpolate_position(PositionKey* keys, size_t count, float time, vec3 out) {
+// Sample keys around time. cursor may be NULL for a stateless lookup.
+static void _sample_position(PositionKey* keys, size_t count, float time, size_t* cursor,
+                             bool forward, vec3 out) {
     if (!keys || count == 0) {
         glm_vec3_zero(out);
         return;
@@ -540,7 +686,9 @@ void interpolate_position(PositionKey* keys, size_t count, float time, vec3 out)
         return;
     }
 
-    size_t idx = find_position_keyframe_index(keys, count, time);
+    size_t idx = cursor ? _seek_keyframe_index(keys, sizeof(PositionKey), count, time, cursor,
+                                               forward)
+                        : _find_keyframe_index(keys, sizeof(PositionKey), count, time);
 
     // Interpolate between keys[idx] and keys[idx+1]
     float t1 = keys[idx].time;
@@ -554,7 +702,8 @@ void interpolate_position(PositionKey* keys, size_t count, float time, vec3 out)
     glm_vec3_lerp(keys[idx].position, keys[idx + 1].position, factor, out);
 }
 
-void interpolate_rotation(RotationKey* keys, size_t count, float time, versor out) {
+static void _sample_rotation(RotationKey* keys, size_t count, float time, size_t* cursor,
+                             bool forward, versor out) {
     if (!keys || count == 0) {
         glm_quat_identity(out);
         return;
@@ -575,7 +724,9 @@ void interpolate_rotation(RotationKey* keys, size_t count, float time, versor ou
         return;
     }
 
-    size_t i = find_rotation_keyframe_index(keys, count, time);
+    size_t i = cursor ? _seek_keyframe_index(keys, sizeof(RotationKey), count, time, cursor,
+                                             forward)
+                      : _find_keyframe_index(keys, sizeof(RotationKey), count, time);
 
     // Interpolate between keys[i] and keys[i+1] using SLERP
     float t1 = keys[i].time;
@@ -589,7 +740,8 @@ void interpolate_rotation(RotationKey* keys, size_t count, float time, versor ou
     glm_quat_slerp(keys[i].rotation, keys[i + 1].rotation, factor, out);
 }
 
-void interpolate_scale(ScaleKey* keys, size_t count, float time, vec3 out) {
+static void _sample_scale(ScaleKey* keys, size_t count, float time, size_t* cursor,
+                          bool forward, vec3 out) {
     if (!keys || count == 0) {
         glm_vec3_one(out);
         return;
@@ -610,7 +762,8 @@ void interpolate_scale(ScaleKey* keys, size_t count, float time, vec3 out) {
         return;
     }
 
-    size_t i = find_scale_keyframe_index(keys, count, time);
+    size_t i = cursor ? _seek_keyframe_index(keys, sizeof(ScaleKey), count, time, cursor, forward)
+                      : _find_keyframe_index(keys, sizeof(ScaleKey), count, time);
 
     // Interpolate between keys[i] and keys[i+1]
     float t1 = keys[i].time;
@@ -624,10 +777,43 @@ void interpolate_scale(ScaleKey* keys, size_t count, float time, vec3 out) {
     glm_vec3_lerp(keys[i].scale, keys[i + 1].scale, factor, out);
 }
 
+void interpolate_position(PositionKey* keys, size_t count, float time, vec3 out) {
+    _sample_position(keys, count, time, NULL, false, out);
+}
+
+void interpolate_rotation(RotationKey* keys, size_t count, float time, versor out) {
+    _sample_rotation(keys, count, time, NULL, false, out);
+}
+
+void interpolate_scale(ScaleKey* keys, size_t count, float time, vec3 out) {
+    _sample_scale(keys, count, time, NULL, false, out);
+}
+
 // ============================================================================
 // Bone Matrix Computation
 // ============================================================================
 
+void sample_channel_trs(const Animation* animation, size_t channel_index, float time,
+                        KeyframeCursor* cursor, bool forward, vec3 position, versor rotation,
+                        vec3 scale) {
+    if (!animation || channel_index >= animation->channel_count)
+        return;
+
+    if (animation->compressed) {
+        sample_compressed_channel(animation->compressed, channel_index, time, cursor, forward,
+                                  position, rotation, scale);
+        return;
+    }
+
+    AnimationChannel* channel = &animation->channels[channel_index];
+    _sample_position(channel->position_keys, channel->position_key_count, time,
+                     cursor ? &cursor->position : NULL, forward, position);
+    _sample_rotation(channel->rotation_keys, channel->rotation_key_count, time,
+                     cursor ? &cursor->rotation : NULL, forward, rotation);
+    _sample_scale(channel->scale_keys, channel->scale_key_count, time,
+                  cursor ? &cursor->scale : NULL, forward, scale);
+}
+
 void compute_bone_matrices(AnimationState* state) {
     if (!state || !state->skeleton)
         return;
@@ -636,19 +822,28 @@ void compute_bone_matrices(AnimationState* state) {
     const Animation* anim = state->current_animation;
     float time = state->current_time;
 
-    // Step 1: Compute local transforms from keyframes (or use bind pose)
+    // Cursors are only trusted while time moves forward; loops and seeks re-search
+    bool forward = time >= state->sample_time;
+    state->sample_time = time;
+
+    // Step 1: Compute local transforms from keyframes (or use bind pose). Bones reduced
+    // away at the current LOD hold their bind pose relative to their parent.
+    size_t evaluated = 0;
     for (size_t i = 0; i < skeleton->bone_count; i++) {
         Bone* bone = &skeleton->bones[i];
-        AnimationChannel* channel = anim ? get_channel_for_bone(anim, (int)i) : NULL;
+        int channel_index = anim ? state->bone_channels[i] : -1;
+        const AnimationChannel* channel = NULL;
+        if (channel_index >= 0 && (size_t)channel_index < anim->channel_count &&
+            !skeleton_bone_reduced(skeleton, i, state->lod))
+            channel = &anim->channels[channel_index];
 
         if (channel) {
+            evaluated++;
             vec3 pos = {0.0f, 0.0f, 0.0f};
             vec3 scale = {1.0f, 1.0f, 1.0f};
             versor rot = {0.0f, 0.0f, 0.0f, 1.0f};
-
-            interpolate_position(channel->position_keys, channel->position_key_count, time, pos);
-            interpolate_rotation(channel->rotation_keys, channel->rotation_key_count, time, rot);
-            interpolate_scale(channel->scale_keys, channel->scale_key_count, time, scale);
+            sample_channel_trs(anim, (size_t)channel_index, time, &state->cursors[i], forward,
+                               pos, rot, scale);
 
             // Build local transform: T * R * S
             mat4 trans, rotation, scaling;
@@ -665,6 +860,16 @@ void compute_bone_matrices(AnimationState* state) {
             glm_mat4_copy(bone->local_transform, state->local_transforms[i]);
         }
     }
+    state->evaluated_bones = evaluated;
+
+    compute_bone_matrices_from_locals(state);
+}
+
+void compute_bone_matrices_from_locals(AnimationState* state) {
+    if (!state || !state->skeleton)
+        return;
+
+    Skeleton* skeleton = state->skeleton;
 
     // Step 2: Compute global transforms (parent-first iteration)
     for (size_t i = 0; i < skeleton->bone_count; i++) {
@@ -755,11 +960,26 @@ void print_animation(const Animation* animation) {
            animation->ticks_per_second, animation->duration / animation->ticks_per_second);
     printf("  Channels: %zu\n", animation->channel_count);
 
+    const CompressedAnimation* compressed = animation->compressed;
+    if (compressed) {
+        printf("  Compressed: %zu -> %zu bytes (%.1fx), %zu -> %zu keys\n",
+               compressed->stats.source_bytes, compressed->stats.compressed_bytes,
+               compressed->stats.ratio, compressed->stats.source_keys,
+               compressed->stats.kept_keys);
+    }
+
     for (size_t i = 0; i < animation->channel_count; i++) {
         const AnimationChannel* ch = &animation->channels[i];
+        size_t pos_keys = ch->position_key_count;
+        size_t rot_keys = ch->rotation_key_count;
+        size_t scale_keys = ch->scale_key_count;
+        if (compressed) {
+            pos_keys = compressed->channels[i].position.key_count;
+            rot_keys = compressed->channels[i].rotation.key_count;
+            scale_keys = compressed->channels[i].scale.key_count;
+        }
         printf("    [%zu] Bone %d (%s): %zu pos, %zu rot, %zu scale keys\n", i, ch->bone_index,
-               ch->bone_name ? ch->bone_name : "(unnamed)", ch->position_key_count,
-               ch->rotation_key_count, ch->scale_key_count);
+               ch->bone_name ? ch->bone_name : "(unnamed)", pos_keys, rot_keys, scale_keys);
     }
 }
 
@@ -4,15 +4,22 @@
 #include <cglm/cglm.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #include "ext/uthash.h"
 
 #define MAX_BONES        128
 #define BONES_PER_VERTEX 4
 
+// Keys a cursor may step forward before falling back to a binary search
+#define KEYFRAME_CURSOR_MAX_STEPS 4
+
 // Forward declarations
 struct Mesh;
 struct Scene;
+struct AnimationStreams;
+struct CompressedAnimation;
+struct AnimationBlend;
 
 // --- Bone ---
 
@@ -32,12 +39,19 @@ typedef struct BoneIndexEntry {
 
 // --- Skeleton ---
 
+#define ANIMATION_LOD_LEVELS 4 // LOD 0 is full detail
+
 typedef struct Skeleton {
     char* name;
     Bone* bones; // Flat array, ordered parent-first
     size_t bone_count;
     BoneIndexEntry* bone_map; // Name-to-index hash map
-    UT_hash_handle hh;        // For skeleton caching by name
+
+    // Per bone: coarsest LOD that still samples it; coarser LODs hold its bind pose
+    // relative to the parent. NULL samples every bone at every LOD.
+    uint8_t* bone_lod;
+
+    UT_hash_handle hh; // For skeleton caching by name
 } Skeleton;
 
 // Skeleton functions
@@ -49,6 +63,17 @@ int get_bone_index_by_name(Skeleton* skeleton, const char* name);
 Bone* get_bone_by_name(Skeleton* skeleton, const char* name);
 Bone* get_bone_by_index(Skeleton* skeleton, int index);
 
+// Derive LOD masks from bone height above the leaves: leaf bones (fingertips, face)
+// drop out first, each further LOD drops one more level of the hierarchy. Root bones
+// are sampled at every LOD.
+int build_skeleton_lod(Skeleton* skeleton);
+
+// Limit root_bone and its descendants to LODs up to max_lod
+int set_skeleton_bone_lod(Skeleton* skeleton, const char* root_bone, int max_lod);
+
+// True when bone is not sampled at lod
+bool skeleton_bone_reduced(const Skeleton* skeleton, size_t bone, int lod);
+
 // --- Keyframes ---
 
 typedef struct PositionKey {
@@ -101,6 +126,9 @@ typedef struct Animation {
 
     Skeleton* skeleton; // Associated skeleton (pointer, not owned)
 
+    struct AnimationStreams* streams;        // Optional SoA resampling, owned
+    struct CompressedAnimation* compressed; // Replaces the channel keys when set, owned
+
     UT_hash_handle hh; // For animation caching by name
 } Animation;
 
@@ -111,8 +139,20 @@ int add_channel_to_animation(Animation* animation, AnimationChannel* channel);
 AnimationChannel* get_channel_for_bone(const Animation* animation, int bone_index);
 AnimationChannel* get_channel_for_bone_name(Animation* animation, const char* bone_name);
 
+// Advance time (ticks) by delta_ticks, wrapping or clamping to the clip.
+// Returns false once a non-looping clip has run off either end.
+bool advance_animation_time(const Animation* animation, float* time, float delta_ticks,
+                            bool looping);
+
 // --- Animation State ---
 
+// Last keyframe pair used per channel, so forward playback only steps ahead
+typedef struct KeyframeCursor {
+    size_t position;
+    size_t rotation;
+    size_t scale;
+} KeyframeCursor;
+
 typedef struct AnimationState {
     Animation* current_animation;
     Skeleton* skeleton;
@@ -129,6 +169,22 @@ typedef struct AnimationState {
     // Scratch space for transform computation
     mat4* local_transforms;  // Per-bone local transforms (interpolated)
     mat4* global_transforms; // Per-bone global transforms (accumulated)
+
+    // Per-bone channel index into current_animation->channels (-1 = bind pose),
+    // built by set_animation
+    int* bone_channels;
+    KeyframeCursor* cursors; // Per bone
+    float sample_time;       // Time of the last compute_bone_matrices, for seek detection
+
+    // Layered playback; replaces current_animation while set (owned)
+    struct AnimationBlend* blend;
+
+    int lod;                // Detail level, selects bones through skeleton->bone_lod
+    size_t evaluated_bones; // Bones sampled by the last pose computation
+
+    // Placement in the renderer's bone palette, valid while palette_frame matches it
+    int palette_offset;
+    unsigned int palette_frame;
 } AnimationState;
 
 // Animation state functions
@@ -147,11 +203,22 @@ void interpolate_position(PositionKey* keys, size_t count, float time, vec3 out)
 void interpolate_rotation(RotationKey* keys, size_t count, float time, versor out);
 void interpolate_scale(ScaleKey* keys, size_t count, float time, vec3 out);
 
+// Fill bone_channels (bone_count entries) with each bone's channel index, -1 for none
+void build_bone_channel_table(const Animation* animation, size_t bone_count, int* bone_channels);
+
+// Sample one channel's TRS, decoding compressed clips inline. cursor may be NULL.
+void sample_channel_trs(const Animation* animation, size_t channel_index, float time,
+                        KeyframeCursor* cursor, bool forward, vec3 position, versor rotation,
+                        vec3 scale);
+
 // --- Bone Matrix Computation ---
 
 void compute_bone_matrices(AnimationState* state);
 void compute_bind_pose_matrices(AnimationState* state);
 
+// Accumulate state->local_transforms through the hierarchy into the final palette
+void compute_bone_matrices_from_locals(AnimationState* state);
+
 // --- Debug ---
 
 void print_skeleton(const Skeleton* skeleton);
@@ -0,0 +1,402 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cglm/cglm.h>
+
+#include "animation_blend.h"
+#include "ext/log.h"
+
+AnimationBlend* create_animation_blend(Skeleton* skeleton) {
+    if (!skeleton) {
+        log_error("Cannot create AnimationBlend without skeleton");
+        return NULL;
+    }
+
+    AnimationBlend* blend = calloc(1, sizeof(AnimationBlend));
+    if (!blend) {
+        log_error("Failed to allocate memory for AnimationBlend");
+        return NULL;
+    }
+    blend->skeleton = skeleton;
+
+    size_t alloc_count = skeleton->bone_count ? skeleton->bone_count : 1;
+    blend->bind_pose = malloc(alloc_count * sizeof(BonePose));
+    if (!blend->bind_pose) {
+        log_error("Failed to allocate bind pose for AnimationBlend");
+        free(blend);
+        return NULL;
+    }
+
+    // Bind pose in TRS form, for bones a clip leaves alone
+    for (size_t i = 0; i < skeleton->bone_count; i++) {
+        BonePose* pose = &blend->bind_pose[i];
+        vec4 translation;
+        mat4 rotation;
+        glm_decompose(skeleton->bones[i].local_transform, translation, rotation, pose->scale);
+        glm_mat4_quat(rotation, pose->rotation);
+        glm_vec3_copy(translation, pose->position);
+    }
+
+    return blend;
+}
+
+static void _free_layer(AnimationLayer* layer) {
+    free(layer->bone_mask);
+    free(layer->reference);
+    free(layer->bone_channels);
+    free(layer->cursors);
+}
+
+void free_animation_blend(AnimationBlend* blend) {
+    if (!blend)
+        return;
+
+    for (size_t i = 0; i < blend->layer_count; i++) {
+        _free_layer(&blend->layers[i]);
+    }
+    free(blend->bind_pose);
+    free(blend);
+}
+
+int set_animation_blend(AnimationState* state, AnimationBlend* blend) {
+    if (!state)
+        return -1;
+
+    if (blend && blend->skeleton != state->skeleton) {
+        log_error("AnimationBlend skeleton does not match the AnimationState");
+        return -1;
+    }
+
+    if (state->blend != blend)
+        free_animation_blend(state->blend);
+    state->blend = blend;
+    return 0;
+}
+
+/*
+ * Layers
+ */
+
+static AnimationLayer* _get_layer(AnimationBlend* blend, size_t layer) {
+    if (!blend || layer >= blend->layer_count)
+        return NULL;
+    return &blend->layers[layer];
+}
+
+static void _sample_layer_bone(const AnimationBlend* blend, AnimationLayer* layer, size_t bone,
+                               float time, KeyframeCursor* cursor, bool forward, BonePose* out) {
+    int channel = layer->bone_channels[bone];
+    if (channel < 0) {
+        *out = blend->bind_pose[bone];
+        return;
+    }
+    sample_channel_trs(layer->animation, (size_t)channel, time, cursor, forward, out->position,
+                       out->rotation, out->scale);
+    glm_quat_normalize(out->rotation);
+}
+
+static void _update_reference(AnimationBlend* blend, AnimationLayer* layer) {
+    if (!layer->reference)
+        return;
+    for (size_t b = 0; b < blend->skeleton->bone_count; b++) {
+        _sample_layer_bone(blend, layer, b, layer->reference_time, NULL, false,
+                           &layer->reference[b]);
+    }
+}
+
+int add_animation_layer(AnimationBlend* blend, Animation* animation, AnimationLayerMode mode,
+                        float weight) {
+    if (!blend || !animation)
+        return -1;
+
+    if (blend->layer_count >= ANIMATION_BLEND_MAX_LAYERS) {
+        log_warn("AnimationBlend layer limit (%d) reached", ANIMATION_BLEND_MAX_LAYERS);
+        return -1;
+    }
+
+    size_t bone_count = blend->skeleton->bone_count;
+    size_t alloc_count = bone_count ? bone_count : 1;
+
+    AnimationLayer* layer = &blend->layers[blend->layer_count];
+    memset(layer, 0, sizeof(AnimationLayer));
+    layer->bone_channels = malloc(alloc_count * sizeof(int));
+    layer->cursors = calloc(alloc_count, sizeof(KeyframeCursor));
+    if (mode == ANIMATION_LAYER_ADDITIVE)
+        layer->reference = malloc(alloc_count * sizeof(BonePose));
+
+    if (!layer->bone_channels || !layer->cursors ||
+        (mode == ANIMATION_LAYER_ADDITIVE && !layer->reference)) {
+        log_error("Failed to allocate animation layer");
+        _free_layer(layer);
+        return -1;
+    }
+
+    layer->animation = animation;
+    layer->mode = mode;
+    layer->weight = weight;
+    layer->target_weight = weight;
+    layer->speed = 1.0f;
+    layer->looping = true;
+    layer->playing = true;
+    build_bone_channel_table(animation, bone_count, layer->bone_channels);
+    _update_reference(blend, layer);
+
+    return (int)blend->layer_count++;
+}
+
+void remove_animation_layer(AnimationBlend* blend, size_t layer) {
+    AnimationLayer* l = _get_layer(blend, layer);
+    if (!l)
+        return;
+
+    _free_layer(l);
+    memmove(l, l + 1, (blend->layer_count - layer - 1) * sizeof(AnimationLayer));
+    blend->layer_count--;
+}
+
+int set_animation_layer_mask(AnimationBlend* blend, size_t layer, const char* root_bone) {
+    AnimationLayer* l = _get_layer(blend, layer);
+    if (!l || !root_bone)
+        return -1;
+
+    Skeleton* skeleton = blend->skeleton;
+    int root = get_bone_index_by_name(skeleton, root_bone);
+    if (root < 0) {
+        log_warn("Mask root bone '%s' not found in skeleton", root_bone);
+        return -1;
+    }
+
+    if (!l->bone_mask) {
+        l->bone_mask = malloc(skeleton->bone_count * sizeof(float));
+        if (!l->bone_mask) {
+            log_error("Failed to allocate animation layer mask");
+            return -1;
+        }
+    }
+
+    // Bones are ordered parent-first, so a single pass marks the whole subtree
+    for (size_t b = 0; b < skeleton->bone_count; b++) {
+        int parent = skeleton->bones[b].parent_index;
+        bool inside = (int)b == root;
+        if (parent >= 0 && (size_t)parent < b && l->bone_mask[parent] > 0.0f)
+            inside = true;
+        l->bone_mask[b] = inside ? 1.0f : 0.0f;
+    }
+    return 0;
+}
+
+void clear_animation_layer_mask(AnimationBlend* blend, size_t layer) {
+    AnimationLayer* l = _get_layer(blend, layer);
+    if (!l)
+        return;
+    free(l->bone_mask);
+    l->bone_mask = NULL;
+}
+
+void set_animation_layer_reference(AnimationBlend* blend, size_t layer, float reference_time) {
+    AnimationLayer* l = _get_layer(blend, layer);
+    if (!l)
+        return;
+    l->reference_time = reference_time;
+    _update_reference(blend, l);
+}
+
+void fade_animation_layer(AnimationBlend* blend, size_t layer, float target_weight,
+                          float seconds) {
+    AnimationLayer* l = _get_layer(blend, layer);
+    if (!l)
+        return;
+
+    l->target_weight = target_weight;
+    if (seconds <= 0.0f) {
+        l->weight = target_weight;
+        l->fade_rate = 0.0f;
+    } else {
+        l->fade_rate = fabsf(target_weight - l->weight) / seconds;
+    }
+}
+
+int crossfade_animation_blend(AnimationBlend* blend, Animation* animation, bool looping,
+                              float seconds) {
+    if (!blend || !animation)
+        return -1;
+
+    // Drop base layers left over from earlier crossfades
+    for (size_t i = blend->layer_count; i-- > 0;) {
+        AnimationLayer* l = &blend->layers[i];
+        if (l->mode == ANIMATION_LAYER_BLEND && l->weight <= 0.0f && l->target_weight <= 0.0f)
+            remove_animation_layer(blend, i);
+    }
+
+    bool has_base = false;
+    for (size_t i = 0; i < blend->layer_count; i++) {
+        if (blend->layers[i].mode == ANIMATION_LAYER_BLEND) {
+            fade_animation_layer(blend, i, 0.0f, seconds);
+            has_base = true;
+        }
+    }
+
+    // With nothing to fade from, start at full weight
+    float start_weight = has_base ? 0.0f : 1.0f;
+    int layer = add_animation_layer(blend, animation, ANIMATION_LAYER_BLEND, start_weight);
+    if (layer < 0)
+        return -1;
+
+    blend->layers[layer].looping = looping;
+    fade_animation_layer(blend, (size_t)layer, 1.0f, seconds);
+    return layer;
+}
+
+/*
+ * Evaluation
+ */
+
+void advance_animation_blend(AnimationBlend* blend, float delta_time) {
+    if (!blend)
+        return;
+
+    for (size_t i = 0; i < blend->layer_count; i++) {
+        AnimationLayer* l = &blend->layers[i];
+
+        if (l->fade_rate > 0.0f) {
+            float step = l->fade_rate * fabsf(delta_time);
+            if (fabsf(l->target_weight - l->weight) <= step) {
+                l->weight = l->target_weight;
+                l->fade_rate = 0.0f;
+            } else {
+                l->weight += l->target_weight > l->weight ? step : -step;
+            }
+        }
+
+        if (l->playing) {
+            float ticks = delta_time * l->animation->ticks_per_second * l->speed;
+            if (!advance_animation_time(l->animation, &l->time, ticks, l->looping))
+                l->playing = false;
+        }
+    }
+}
+
+static float _bone_weight(const AnimationLayer* layer, size_t bone) {
+    return layer->bone_mask ? layer->weight * layer->bone_mask[bone] : layer->weight;
+}
+
+// Sign-aligned nlerp from a towards b, written to a
+static void _nlerp_into(versor a, const versor b, float t) {
+    float s = glm_vec4_dot(a, (float*)b) < 0.0f ? -t : t;
+    for (int i = 0; i < 4; i++) {
+        a[i] = a[i] * (1.0f - t) + b[i] * s;
+    }
+    glm_quat_normalize(a);
+}
+
+static void _apply_override(BonePose* pose, const BonePose* layer, float w) {
+    glm_vec3_lerp(pose->position, (float*)layer->position, w, pose->position);
+    glm_vec3_lerp(pose->scale, (float*)layer->scale, w, pose->scale);
+    _nlerp_into(pose->rotation, layer->rotation, w);
+}
+
+// Add (layer - reference) scaled by w: translation offset, rotation delta applied in the
+// bone's local frame, and scale ratio
+static void _apply_additive(BonePose* pose, const BonePose* layer, const BonePose* reference,
+                            float w) {
+    for (int i = 0; i < 3; i++) {
+        pose->position[i] += (layer->position[i] - reference->position[i]) * w;
+        if (reference->scale[i] != 0.0f)
+            pose->scale[i] *= 1.0f + (layer->scale[i] / reference->scale[i] - 1.0f) * w;
+    }
+
+    versor inverse_ref, delta;
+    glm_quat_conjugate((float*)reference->rotation, inverse_ref);
+    glm_quat_mul(inverse_ref, (float*)layer->rotation, delta);
+
+    versor scaled, rotation;
+    glm_quat_identity(scaled);
+    _nlerp_into(scaled, delta, w);
+    glm_quat_mul(pose->rotation, scaled, rotation);
+    glm_quat_copy(rotation, pose->rotation);
+}
+
+// local = T * R * S, written directly
+static void _compose_pose(const BonePose* pose, mat4 out) {
+    glm_quat_mat4((float*)pose->rotation, out);
+    glm_vec3_scale(out[0], pose->scale[0], out[0]);
+    glm_vec3_scale(out[1], pose->scale[1], out[1]);
+    glm_vec3_scale(out[2], pose->scale[2], out[2]);
+    glm_vec3_copy((float*)pose->position, out[3]);
+}
+
+void evaluate_animation_blend(AnimationBlend* blend, AnimationState* state) {
+    if (!blend || !state || state->skeleton != blend->skeleton)
+        return;
+
+    // Cursors only step forward while each layer's clock does
+    bool forward[ANIMATION_BLEND_MAX_LAYERS];
+    for (size_t i = 0; i < blend->layer_count; i++) {
+        AnimationLayer* l = &blend->layers[i];
+        forward[i] = l->time >= l->sample_time;
+        l->sample_time = l->time;
+    }
+
+    size_t evaluated = 0;
+    for (size_t b = 0; b < blend->skeleton->bone_count; b++) {
+        BonePose pose, sample;
+
+        // Bones reduced away at this LOD skip every layer
+        if (skeleton_bone_reduced(blend->skeleton, b, state->lod)) {
+            _compose_pose(&blend->bind_pose[b], state->local_transforms[b]);
+            continue;
+        }
+        evaluated++;
+
+        // Base pose: weighted average of BLEND layers
+        vec3 position_sum = {0.0f, 0.0f, 0.0f};
+        vec3 scale_sum = {0.0f, 0.0f, 0.0f};
+        versor rotation_sum = {0.0f, 0.0f, 0.0f, 0.0f};
+        float total = 0.0f;
+
+        for (size_t i = 0; i < blend->layer_count; i++) {
+            AnimationLayer* l = &blend->layers[i];
+            float w = l->mode == ANIMATION_LAYER_BLEND ? _bone_weight(l, b) : 0.0f;
+            if (w <= 0.0f)
+                continue;
+
+            _sample_layer_bone(blend, l, b, l->time, &l->cursors[b], forward[i], &sample);
+            glm_vec3_muladds(sample.position, w, position_sum);
+            glm_vec3_muladds(sample.scale, w, scale_sum);
+            float rw = glm_vec4_dot(rotation_sum, sample.rotation) < 0.0f ? -w : w;
+            for (int k = 0; k < 4; k++) {
+                rotation_sum[k] += sample.rotation[k] * rw;
+            }
+            total += w;
+        }
+
+        if (total > 0.0f) {
+            glm_vec3_scale(position_sum, 1.0f / total, pose.position);
+            glm_vec3_scale(scale_sum, 1.0f / total, pose.scale);
+            glm_vec4_copy(rotation_sum, pose.rotation);
+            glm_quat_normalize(pose.rotation);
+        } else {
+            pose = blend->bind_pose[b];
+        }
+
+        // Override and additive layers, in order
+        for (size_t i = 0; i < blend->layer_count; i++) {
+            AnimationLayer* l = &blend->layers[i];
+            float w = l->mode != ANIMATION_LAYER_BLEND ? _bone_weight(l, b) : 0.0f;
+            if (w <= 0.0f)
+                continue;
+
+            _sample_layer_bone(blend, l, b, l->time, &l->cursors[b], forward[i], &sample);
+            if (l->mode == ANIMATION_LAYER_OVERRIDE)
+                _apply_override(&pose, &sample, fminf(w, 1.0f));
+            else
+                _apply_additive(&pose, &sample, &l->reference[b], w);
+        }
+
+        _compose_pose(&pose, state->local_transforms[b]);
+    }
+    state->evaluated_bones = evaluated;
+
+    compute_bone_matrices_from_locals(state);
+}
@@ -0,0 +1,118 @@
+#ifndef _ANIMATION_BLEND_H_
+#define _ANIMATION_BLEND_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "animation.h"
+
+#define ANIMATION_BLEND_MAX_LAYERS 8
+
+typedef enum AnimationLayerMode {
+    ANIMATION_LAYER_BLEND,    // Weighted average with the other BLEND layers (base pose)
+    ANIMATION_LAYER_OVERRIDE, // Replaces the pose below by its weight
+    ANIMATION_LAYER_ADDITIVE, // Adds its difference from reference_time on top
+} AnimationLayerMode;
+
+// Local bone transform in TRS form
+typedef struct BonePose {
+    versor rotation;
+    vec3 position;
+    vec3 scale;
+} BonePose;
+
+typedef struct AnimationLayer {
+    Animation* animation;
+    AnimationLayerMode mode;
+
+    float weight;
+    float target_weight; // Weight approached by fade_animation_layer
+    float fade_rate;     // Weight change per second, 0 when not fading
+
+    float time; // In ticks
+    float speed;
+    bool looping;
+    bool playing;
+
+    float* bone_mask;    // Per-bone weight multiplier, NULL for the whole skeleton (owned)
+    BonePose* reference; // Additive layers: clip pose at reference_time (owned)
+    float reference_time;
+
+    // Sampling caches, as in AnimationState
+    int* bone_channels;
+    KeyframeCursor* cursors;
+    float sample_time;
+} AnimationLayer;
+
+/*
+ * Animation Blend
+ *
+ * A flat blend tree evaluated in one pass per bone. BLEND layers are averaged by
+ * weight into the base pose (N-way blends and crossfades), then OVERRIDE and
+ * ADDITIVE layers are applied in layer order. Every layer weight can be scaled
+ * per bone by a mask, e.g. to drive only the upper body.
+ *
+ * Layers are sampled straight into local TRS and blended there: positions and
+ * scales by lerp, rotations by sign-aligned nlerp. The result is composed into
+ * local matrices once, followed by the usual global and palette pass, so cost
+ * grows with bones times layers rather than with palettes per clip.
+ *
+ * Attach with set_animation_blend; update_animation then drives the blend
+ * instead of current_animation.
+ */
+typedef struct AnimationBlend {
+    Skeleton* skeleton;
+    BonePose* bind_pose; // Used by bones a layer's clip does not animate
+
+    AnimationLayer layers[ANIMATION_BLEND_MAX_LAYERS];
+    size_t layer_count;
+} AnimationBlend;
+
+/*
+ * Lifecycle
+ */
+AnimationBlend* create_animation_blend(Skeleton* skeleton);
+void free_animation_blend(AnimationBlend* blend);
+
+// Hand blend to state (freeing any previous one); NULL returns to single-clip playback.
+// The blend must be built for state's skeleton.
+int set_animation_blend(AnimationState* state, AnimationBlend* blend);
+
+/*
+ * Layers
+ */
+
+// Add a playing, looping layer. Returns its index or -1.
+int add_animation_layer(AnimationBlend* blend, Animation* animation, AnimationLayerMode mode,
+                        float weight);
+
+// Remove a layer; later layers move down one index
+void remove_animation_layer(AnimationBlend* blend, size_t layer);
+
+// Restrict a layer to the bone named root_bone and its descendants
+int set_animation_layer_mask(AnimationBlend* blend, size_t layer, const char* root_bone);
+void clear_animation_layer_mask(AnimationBlend* blend, size_t layer);
+
+// Additive layers: choose the clip time whose pose counts as "no change"
+void set_animation_layer_reference(AnimationBlend* blend, size_t layer, float reference_time);
+
+// Move a layer's weight linearly to target_weight over seconds
+void fade_animation_layer(AnimationBlend* blend, size_t layer, float target_weight,
+                          float seconds);
+
+// Fade in animation as a new BLEND layer while fading out the current ones.
+// BLEND layers that have already faded out are dropped first.
+int crossfade_animation_blend(AnimationBlend* blend, Animation* animation, bool looping,
+                              float seconds);
+
+/*
+ * Evaluation
+ */
+
+// Advance layer clocks and fades by delta_time seconds
+void advance_animation_blend(AnimationBlend* blend, float delta_time);
+
+// Blend all layers into state's local transforms and bone matrices
+void evaluate_animation_blend(AnimationBlend* blend, AnimationState* state);
+
+#endif // _ANIMATION_BLEND_H_
@@ -0,0 +1,592 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cglm/cglm.h>
+
+#include "animation_compress.h"
+#include "ext/log.h"
+
+#define QUAT_COMPONENT_BITS  15
+#define QUAT_COMPONENT_MAX   ((1u << QUAT_COMPONENT_BITS) - 1)
+#define QUAT_COMPONENT_RANGE 0.70710678f // Only the largest component can exceed 1/sqrt(2)
+#define VALUE_QUANT_MAX      65535.0f
+#define MAX_SEGMENT_KEYS     256 // Bounds the quadratic search for removable keys
+
+typedef enum { TRACK_POSITION, TRACK_ROTATION, TRACK_SCALE } TrackType;
+
+#define TRACK_TIME(c, track, i) ((c)->times[(c)->time_indices[(track)->time_offset + (i)]])
+
+AnimationCompressionConfig animation_compression_default_config(void) {
+    return (AnimationCompressionConfig){
+        .position_tolerance = ANIM_COMPRESS_DEFAULT_POSITION_TOLERANCE,
+        .rotation_tolerance = ANIM_COMPRESS_DEFAULT_ROTATION_TOLERANCE,
+        .scale_tolerance = ANIM_COMPRESS_DEFAULT_SCALE_TOLERANCE,
+    };
+}
+
+/*
+ * Quantization
+ */
+
+// Smallest-three: 2 bits for the index of the largest component, 15 bits for each
+// of the others. The largest is made positive (q and -q are the same rotation) and
+// rebuilt from unit length when decoding.
+static void _pack_quat(const float* q, uint16_t out[3]) {
+    int largest = 0;
+    for (int i = 1; i < 4; i++) {
+        if (fabsf(q[i]) > fabsf(q[largest]))
+            largest = i;
+    }
+    float sign = q[largest] < 0.0f ? -1.0f : 1.0f;
+
+    uint64_t bits = (uint64_t)largest;
+    for (int i = 0; i < 4; i++) {
+        if (i == largest)
+            continue;
+        float n = (q[i] * sign / QUAT_COMPONENT_RANGE) * 0.5f + 0.5f;
+        n = fminf(fmaxf(n, 0.0f), 1.0f);
+        bits = (bits << QUAT_COMPONENT_BITS) | (uint64_t)lrintf(n * QUAT_COMPONENT_MAX);
+    }
+
+    out[0] = (uint16_t)(bits >> 32);
+    out[1] = (uint16_t)(bits >> 16);
+    out[2] = (uint16_t)bits;
+}
+
+static void _unpack_quat(const uint16_t in[3], float* q) {
+    uint64_t bits = ((uint64_t)in[0] << 32) | ((uint64_t)in[1] << 16) | (uint64_t)in[2];
+    int largest = (int)(bits >> (3 * QUAT_COMPONENT_BITS)) & 3;
+
+    // Components were shifted in ascending order, so the last one is in the low bits
+    float sum = 0.0f;
+    for (int i = 3; i >= 0; i--) {
+        if (i == largest)
+            continue;
+        float n = (float)(bits & QUAT_COMPONENT_MAX) / (float)QUAT_COMPONENT_MAX;
+        bits >>= QUAT_COMPONENT_BITS;
+        q[i] = (n * 2.0f - 1.0f) * QUAT_COMPONENT_RANGE;
+        sum += q[i] * q[i];
+    }
+    q[largest] = sqrtf(fmaxf(1.0f - sum, 0.0f));
+}
+
+static uint16_t _quantize(float v, float min, float extent) {
+    if (extent <= 0.0f)
+        return 0;
+    float n = fminf(fmaxf((v - min) / extent, 0.0f), 1.0f);
+    return (uint16_t)lrintf(n * VALUE_QUANT_MAX);
+}
+
+static float _dequantize(uint16_t q, float min, float extent) {
+    return min + (float)q * (extent / VALUE_QUANT_MAX);
+}
+
+/*
+ * Track values
+ */
+
+static void _slerp_short(const float* a, const float* b, float t, float* out) {
+    versor qa, qb;
+    glm_vec4_copy((float*)a, qa);
+    glm_vec4_copy((float*)b, qb);
+    if (glm_vec4_dot(qa, qb) < 0.0f)
+        glm_vec4_negate(qb);
+    glm_quat_slerp(qa, qb, t, out);
+}
+
+static void _interpolate_value(TrackType type, const float* a, const float* b, float t,
+                               float* out) {
+    if (type == TRACK_ROTATION) {
+        _slerp_short(a, b, t, out);
+        return;
+    }
+    for (int i = 0; i < 3; i++) {
+        out[i] = a[i] + (b[i] - a[i]) * t;
+    }
+}
+
+// Distance between two values: length for vectors, angle for rotations
+static float _value_error(TrackType type, const float* a, const float* b) {
+    if (type == TRACK_ROTATION) {
+        // From the chord |a - b| = 2 sin(angle / 4); acos of the dot product has no
+        // precision left for small angles in float
+        float diff = 0.0f, sum = 0.0f;
+        for (int i = 0; i < 4; i++) {
+            diff += (a[i] - b[i]) * (a[i] - b[i]);
+            sum += (a[i] + b[i]) * (a[i] + b[i]);
+        }
+        float chord = sqrtf(fminf(diff, sum));
+        return 4.0f * asinf(fminf(chord * 0.5f, 1.0f));
+    }
+    float dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+    return sqrtf(dx * dx + dy * dy + dz * dz);
+}
+
+static float _tolerance(const AnimationCompressionConfig* config, TrackType type) {
+    switch (type) {
+    case TRACK_POSITION:
+        return config->position_tolerance;
+    case TRACK_ROTATION:
+        return config->rotation_tolerance;
+    default:
+        return config->scale_tolerance;
+    }
+}
+
+// Gather a channel track as times plus 4-float values. Rotations are normalized.
+static size_t _gather_track(const AnimationChannel* ch, TrackType type, float* times,
+                            float* values) {
+    size_t count = 0;
+    switch (type) {
+    case TRACK_POSITION:
+        count = ch->position_key_count;
+        for (size_t i = 0; i < count; i++) {
+            times[i] = ch->position_keys[i].time;
+            glm_vec3_copy(ch->position_keys[i].position, &values[i * 4]);
+        }
+        break;
+    case TRACK_ROTATION:
+        count = ch->rotation_key_count;
+        for (size_t i = 0; i < count; i++) {
+            times[i] = ch->rotation_keys[i].time;
+            glm_vec4_copy(ch->rotation_keys[i].rotation, &values[i * 4]);
+            glm_vec4_normalize(&values[i * 4]);
+        }
+        break;
+    case TRACK_SCALE:
+        count = ch->scale_key_count;
+        for (size_t i = 0; i < count; i++) {
+            times[i] = ch->scale_keys[i].time;
+            glm_vec3_copy(ch->scale_keys[i].scale, &values[i * 4]);
+        }
+        break;
+    }
+    return count;
+}
+
+/*
+ * Key reduction
+ */
+
+static bool _segment_fits(TrackType type, const float* times, const float* values, size_t first,
+                          size_t last, float tolerance) {
+    float span = times[last] - times[first];
+    if (span <= 0.0f)
+        return false;
+
+    for (size_t i = first + 1; i < last; i++) {
+        float approx[4];
+        _interpolate_value(type, &values[first * 4], &values[last * 4],
+                           (times[i] - times[first]) / span, approx);
+        if (_value_error(type, approx, &values[i * 4]) > tolerance)
+            return false;
+    }
+    return true;
+}
+
+// Mark the keys to keep. Each segment is extended as long as every key it skips stays
+// within tolerance of the interpolated value.
+static size_t _reduce_keys(TrackType type, const float* times, const float* values, size_t count,
+                           float tolerance, bool* keep) {
+    memset(keep, 0, count * sizeof(bool));
+    if (count == 0)
+        return 0;
+    keep[0] = true;
+
+    // Constant tracks need only one key
+    bool constant = true;
+    for (size_t i = 1; i < count && constant; i++) {
+        constant = _value_error(type, &values[0], &values[i * 4]) <= tolerance;
+    }
+    if (constant)
+        return 1;
+
+    size_t kept = 1;
+    size_t anchor = 0;
+    while (anchor < count - 1) {
+        size_t end = anchor + 1;
+        while (end + 1 < count && end + 1 - anchor <= MAX_SEGMENT_KEYS &&
+               _segment_fits(type, times, values, anchor, end + 1, tolerance)) {
+            end++;
+        }
+        keep[end] = true;
+        kept++;
+        anchor = end;
+    }
+    return kept;
+}
+
+/*
+ * Sampling
+ */
+
+static size_t _find_track_key(const CompressedAnimation* c, const CompressedTrack* track,
+                              float time) {
+    size_t lo = 0;
+    size_t hi = track->key_count - 1;
+
+    while (hi - lo > 1) {
+        size_t mid = (lo + hi) / 2;
+        if (TRACK_TIME(c, track, mid) <= time)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// Same stepping rules as the float key cursor in animation.c
+static size_t _seek_track_key(const CompressedAnimation* c, const CompressedTrack* track,
+                              float time, size_t* cursor, bool forward) {
+    size_t count = track->key_count;
+    size_t idx = *cursor;
+
+    if (forward && idx + 1 < count && TRACK_TIME(c, track, idx) <= time) {
+        int steps = 0;
+        while (idx + 2 < count && TRACK_TIME(c, track, idx + 1) <= time &&
+               steps < KEYFRAME_CURSOR_MAX_STEPS) {
+            idx++;
+            steps++;
+        }
+        if (idx + 2 >= count || TRACK_TIME(c, track, idx + 1) > time) {
+            *cursor = idx;
+            return idx;
+        }
+    }
+
+    idx = _find_track_key(c, track, time);
+    *cursor = idx;
+    return idx;
+}
+
+static void _decode_key(const CompressedAnimation* c, const CompressedTrack* track,
+                        TrackType type, size_t key, float* out) {
+    const uint16_t* v = &c->values[track->value_offset + key * 3];
+    if (type == TRACK_ROTATION) {
+        _unpack_quat(v, out);
+        return;
+    }
+    for (int i = 0; i < 3; i++) {
+        out[i] = _dequantize(v[i], track->range_min[i], track->range_extent[i]);
+    }
+}
+
+static void _sample_track(const CompressedAnimation* c, const CompressedTrack* track,
+                          TrackType type, float time, size_t* cursor, bool forward, float* out) {
+    size_t count = track->key_count;
+    if (count == 0) {
+        if (type == TRACK_ROTATION)
+            glm_quat_identity(out);
+        else if (type == TRACK_SCALE)
+            glm_vec3_one(out);
+        else
+            glm_vec3_zero(out);
+        return;
+    }
+
+    if (count == 1 || time <= TRACK_TIME(c, track, 0)) {
+        _decode_key(c, track, type, 0, out);
+        return;
+    }
+    if (time >= TRACK_TIME(c, track, count - 1)) {
+        _decode_key(c, track, type, count - 1, out);
+        return;
+    }
+
+    size_t i = cursor ? _seek_track_key(c, track, time, cursor, forward)
+                      : _find_track_key(c, track, time);
+
+    float t1 = TRACK_TIME(c, track, i);
+    float t2 = TRACK_TIME(c, track, i + 1);
+    float a[4], b[4];
+    _decode_key(c, track, type, i, a);
+    if (t2 <= t1) {
+        memcpy(out, a, (type == TRACK_ROTATION ? 4 : 3) * sizeof(float));
+        return;
+    }
+    _decode_key(c, track, type, i + 1, b);
+    _interpolate_value(type, a, b, (time - t1) / (t2 - t1), out);
+}
+
+void sample_compressed_channel(const CompressedAnimation* compressed, size_t channel, float time,
+                               KeyframeCursor* cursor, bool forward, vec3 position,
+                               versor rotation, vec3 scale) {
+    if (!compressed || channel >= compressed->channel_count)
+        return;
+
+    const CompressedChannel* ch = &compressed->channels[channel];
+    _sample_track(compressed, &ch->position, TRACK_POSITION, time,
+                  cursor ? &cursor->position : NULL, forward, position);
+    _sample_track(compressed, &ch->rotation, TRACK_ROTATION, time,
+                  cursor ? &cursor->rotation : NULL, forward, rotation);
+    _sample_track(compressed, &ch->scale, TRACK_SCALE, time, cursor ? &cursor->scale : NULL,
+                  forward, scale);
+}
+
+/*
+ * Compression
+ */
+
+static int _compare_floats(const void* a, const void* b) {
+    float fa = *(const float*)a, fb = *(const float*)b;
+    return (fa > fb) - (fa < fb);
+}
+
+static uint16_t _time_index(const CompressedAnimation* c, float time) {
+    size_t lo = 0;
+    size_t hi = c->time_count;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (c->times[mid] < time)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return (uint16_t)lo;
+}
+
+static CompressedTrack* _channel_track(CompressedChannel* ch, TrackType type) {
+    switch (type) {
+    case TRACK_POSITION:
+        return &ch->position;
+    case TRACK_ROTATION:
+        return &ch->rotation;
+    default:
+        return &ch->scale;
+    }
+}
+
+// Append the key times of a track, reusing an identical index array from one of the
+// first stored_count tracks (three per channel, in TrackType order)
+static uint32_t _store_time_indices(CompressedAnimation* c, const uint16_t* indices, size_t count,
+                                    size_t stored_count) {
+    for (size_t n = 0; n < stored_count; n++) {
+        const CompressedTrack* track = _channel_track(&c->channels[n / 3], (TrackType)(n % 3));
+        if (track->key_count == count &&
+            memcmp(&c->time_indices[track->time_offset], indices, count * sizeof(uint16_t)) == 0)
+            return track->time_offset;
+    }
+
+    uint32_t offset = (uint32_t)c->time_index_count;
+    memcpy(&c->time_indices[offset], indices, count * sizeof(uint16_t));
+    c->time_index_count += count;
+    return offset;
+}
+
+static void _encode_track(CompressedAnimation* c, CompressedTrack* track, TrackType type,
+                          const float* times, const float* values, const bool* keep,
+                          size_t count, uint16_t* scratch, size_t stored_count) {
+    memset(track, 0, sizeof(CompressedTrack));
+
+    // Quantization range over the kept keys
+    if (type != TRACK_ROTATION) {
+        vec3 lo = {INFINITY, INFINITY, INFINITY};
+        vec3 hi = {-INFINITY, -INFINITY, -INFINITY};
+        for (size_t i = 0; i < count; i++) {
+            if (!keep[i])
+                continue;
+            for (int k = 0; k < 3; k++) {
+                lo[k] = fminf(lo[k], values[i * 4 + k]);
+                hi[k] = fmaxf(hi[k], values[i * 4 + k]);
+            }
+        }
+        for (int k = 0; k < 3 && count > 0; k++) {
+            track->range_min[k] = lo[k];
+            track->range_extent[k] = hi[k] - lo[k];
+        }
+    }
+
+    track->value_offset = (uint32_t)c->value_count;
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (!keep[i])
+            continue;
+
+        uint16_t* v = &c->values[c->value_count];
+        if (type == TRACK_ROTATION) {
+            _pack_quat(&values[i * 4], v);
+        } else {
+            for (int k = 0; k < 3; k++) {
+                v[k] = _quantize(values[i * 4 + k], track->range_min[k], track->range_extent[k]);
+            }
+        }
+        c->value_count += 3;
+        scratch[kept++] = _time_index(c, times[i]);
+    }
+
+    track->key_count = (uint32_t)kept;
+    track->time_offset = _store_time_indices(c, scratch, kept, stored_count);
+}
+
+static float _track_error(const CompressedAnimation* c, const CompressedTrack* track,
+                          TrackType type, const float* times, const float* values, size_t count) {
+    float max_error = 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        float decoded[4];
+        _sample_track(c, track, type, times[i], NULL, false, decoded);
+        max_error = fmaxf(max_error, _value_error(type, decoded, &values[i * 4]));
+    }
+    return max_error;
+}
+
+int compress_animation(Animation* animation, const AnimationCompressionConfig* config) {
+    if (!animation || animation->channel_count == 0)
+        return -1;
+
+    if (animation->compressed) {
+        log_warn("Animation '%s' is already compressed",
+                 animation->name ? animation->name : "(unnamed)");
+        return -1;
+    }
+
+    AnimationCompressionConfig defaults = animation_compression_default_config();
+    if (!config)
+        config = &defaults;
+
+    // Size everything for the worst case: no key removed
+    size_t total_keys = 0;
+    size_t longest_track = 1;
+    size_t source_bytes = 0;
+    for (size_t i = 0; i < animation->channel_count; i++) {
+        const AnimationChannel* ch = &animation->channels[i];
+        total_keys += ch->position_key_count + ch->rotation_key_count + ch->scale_key_count;
+        source_bytes += ch->position_key_count * sizeof(PositionKey) +
+                        ch->rotation_key_count * sizeof(RotationKey) +
+                        ch->scale_key_count * sizeof(ScaleKey);
+        size_t longest = ch->position_key_count;
+        if (ch->rotation_key_count > longest)
+            longest = ch->rotation_key_count;
+        if (ch->scale_key_count > longest)
+            longest = ch->scale_key_count;
+        if (longest > longest_track)
+            longest_track = longest;
+    }
+
+    CompressedAnimation* c = calloc(1, sizeof(CompressedAnimation));
+    float* times = malloc(longest_track * sizeof(float));
+    float* values = malloc(longest_track * 4 * sizeof(float));
+    bool* keep = malloc(longest_track * sizeof(bool));
+    uint16_t* scratch = malloc(longest_track * sizeof(uint16_t));
+    if (c) {
+        c->times = malloc((total_keys ? total_keys : 1) * sizeof(float));
+        c->time_indices = malloc((total_keys ? total_keys : 1) * sizeof(uint16_t));
+        c->values = malloc((total_keys ? total_keys : 1) * 3 * sizeof(uint16_t));
+        c->channels = calloc(animation->channel_count, sizeof(CompressedChannel));
+        c->channel_count = animation->channel_count;
+    }
+    if (!c || !times || !values || !keep || !scratch || !c->times || !c->time_indices ||
+        !c->values || !c->channels) {
+        log_error("Failed to allocate animation compression buffers");
+        goto fail;
+    }
+
+    // Clip-wide table of distinct key times
+    for (size_t i = 0; i < animation->channel_count; i++) {
+        const AnimationChannel* ch = &animation->channels[i];
+        for (size_t k = 0; k < ch->position_key_count; k++)
+            c->times[c->time_count++] = ch->position_keys[k].time;
+        for (size_t k = 0; k < ch->rotation_key_count; k++)
+            c->times[c->time_count++] = ch->rotation_keys[k].time;
+        for (size_t k = 0; k < ch->scale_key_count; k++)
+            c->times[c->time_count++] = ch->scale_keys[k].time;
+    }
+    qsort(c->times, c->time_count, sizeof(float), _compare_floats);
+    size_t unique = 0;
+    for (size_t i = 0; i < c->time_count; i++) {
+        if (unique == 0 || c->times[i] != c->times[unique - 1])
+            c->times[unique++] = c->times[i];
+    }
+    c->time_count = unique;
+
+    if (c->time_count > ANIM_COMPRESS_MAX_TIMES) {
+        log_warn("Animation '%s' has %zu distinct key times, too many to compress",
+                 animation->name ? animation->name : "(unnamed)", c->time_count);
+        goto fail;
+    }
+
+    AnimationCompressionStats* stats = &c->stats;
+    stats->source_keys = total_keys;
+    stats->source_bytes = source_bytes;
+
+    for (size_t i = 0; i < animation->channel_count; i++) {
+        const AnimationChannel* ch = &animation->channels[i];
+
+        for (int t = 0; t < 3; t++) {
+            TrackType type = (TrackType)t;
+            CompressedTrack* track = _channel_track(&c->channels[i], type);
+
+            size_t count = _gather_track(ch, type, times, values);
+            _reduce_keys(type, times, values, count, _tolerance(config, type), keep);
+            _encode_track(c, track, type, times, values, keep, count, scratch, i * 3 + (size_t)t);
+            stats->kept_keys += track->key_count;
+
+            float error = _track_error(c, track, type, times, values, count);
+            if (type == TRACK_POSITION)
+                stats->max_position_error = fmaxf(stats->max_position_error, error);
+            else if (type == TRACK_ROTATION)
+                stats->max_rotation_error = fmaxf(stats->max_rotation_error, error);
+            else
+                stats->max_scale_error = fmaxf(stats->max_scale_error, error);
+        }
+    }
+
+    // Trim the worst-case allocations
+    float* trimmed_times = realloc(c->times, (c->time_count ? c->time_count : 1) * sizeof(float));
+    if (trimmed_times)
+        c->times = trimmed_times;
+    uint16_t* trimmed_indices = realloc(
+        c->time_indices, (c->time_index_count ? c->time_index_count : 1) * sizeof(uint16_t));
+    if (trimmed_indices)
+        c->time_indices = trimmed_indices;
+    uint16_t* trimmed_values =
+        realloc(c->values, (c->value_count ? c->value_count : 1) * sizeof(uint16_t));
+    if (trimmed_values)
+        c->values = trimmed_values;
+
+    stats->compressed_bytes = c->time_count * sizeof(float) +
+                              c->time_index_count * sizeof(uint16_t) +
+                              c->value_count * sizeof(uint16_t) +
+                              c->channel_count * sizeof(CompressedChannel);
+    if (stats->compressed_bytes > 0)
+        stats->ratio = (float)stats->source_bytes / (float)stats->compressed_bytes;
+
+    // The float keys are no longer needed
+    for (size_t i = 0; i < animation->channel_count; i++) {
+        AnimationChannel* ch = &animation->channels[i];
+        free(ch->position_keys);
+        free(ch->rotation_keys);
+        free(ch->scale_keys);
+        ch->position_keys = NULL;
+        ch->rotation_keys = NULL;
+        ch->scale_keys = NULL;
+        ch->position_key_count = 0;
+        ch->rotation_key_count = 0;
+        ch->scale_key_count = 0;
+    }
+    animation->compressed = c;
+
+    free(times);
+    free(values);
+    free(keep);
+    free(scratch);
+    return 0;
+
+fail:
+    free_compressed_animation(c);
+    free(times);
+    free(values);
+    free(keep);
+    free(scratch);
+    return -1;
+}
+
+void free_compressed_animation(CompressedAnimation* compressed) {
+    if (!compressed)
+        return;
+    free(compressed->times);
+    free(compressed->time_indices);
+    free(compressed->values);
+    free(compressed->channels);
+    free(compressed);
+}
@@ -0,0 +1,100 @@
+#ifndef _ANIMATION_COMPRESS_H_
+#define _ANIMATION_COMPRESS_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "animation.h"
+
+#define ANIM_COMPRESS_DEFAULT_POSITION_TOLERANCE 0.0005f // Model units
+#define ANIM_COMPRESS_DEFAULT_ROTATION_TOLERANCE 0.0010f // Radians
+#define ANIM_COMPRESS_DEFAULT_SCALE_TOLERANCE    0.0005f
+#define ANIM_COMPRESS_MAX_TIMES                  65536 // Time indices are 16-bit
+
+/*
+ * Animation Compression
+ *
+ * Replaces a clip's float keys with a compact encoding that is decoded inline while
+ * sampling:
+ *
+ *  - keys that linear (or slerp) interpolation of their neighbours reproduces within
+ *    tolerance are removed, and constant tracks collapse to a single key
+ *  - rotations are packed as 48-bit smallest-three quaternions
+ *  - translations and scales are quantized to 16 bits against per-track ranges
+ *  - key times are 16-bit indices into one clip-wide time table, and tracks whose
+ *    key times match share a single index array
+ *
+ * Every key is three uint16 values regardless of track type.
+ */
+typedef struct AnimationCompressionConfig {
+    float position_tolerance;
+    float rotation_tolerance;
+    float scale_tolerance;
+} AnimationCompressionConfig;
+
+typedef struct AnimationCompressionStats {
+    size_t source_keys;
+    size_t kept_keys;
+    size_t source_bytes;
+    size_t compressed_bytes;
+    float ratio;
+
+    // Largest difference from the source keys after decoding
+    float max_position_error;
+    float max_rotation_error; // Radians
+    float max_scale_error;
+} AnimationCompressionStats;
+
+typedef struct CompressedTrack {
+    uint32_t key_count;
+    uint32_t time_offset;  // Into CompressedAnimation.time_indices
+    uint32_t value_offset; // Into CompressedAnimation.values, 3 per key
+    vec3 range_min;        // Dequantization range (positions and scales)
+    vec3 range_extent;
+} CompressedTrack;
+
+typedef struct CompressedChannel {
+    CompressedTrack position;
+    CompressedTrack rotation;
+    CompressedTrack scale;
+} CompressedChannel;
+
+typedef struct CompressedAnimation {
+    float* times; // Clip-wide table of distinct key times, ascending
+    size_t time_count;
+
+    uint16_t* time_indices; // Per-track key times as indices into times
+    size_t time_index_count;
+
+    uint16_t* values;
+    size_t value_count;
+
+    CompressedChannel* channels; // Parallel to Animation.channels
+    size_t channel_count;
+
+    AnimationCompressionStats stats;
+} CompressedAnimation;
+
+/*
+ * Compression
+ */
+AnimationCompressionConfig animation_compression_default_config(void);
+
+// Compress animation's keys in place. On success the float keys are freed (channels
+// keep their bone bindings) and the encoding is attached as animation->compressed.
+// config may be NULL for the defaults.
+int compress_animation(Animation* animation, const AnimationCompressionConfig* config);
+
+void free_compressed_animation(CompressedAnimation* compressed);
+
+/*
+ * Sampling
+ */
+
+// Decode channel's TRS at time (ticks). cursor may be NULL for a stateless lookup.
+void sample_compressed_channel(const CompressedAnimation* compressed, size_t channel, float time,
+                               KeyframeCursor* cursor, bool forward, vec3 position,
+                               versor rotation, vec3 scale);
+
+#endif // _ANIMATION_COMPRESS_H_
@@ -0,0 +1,353 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cglm/cglm.h>
+
+#include "animation_compress.h"
+#include "animation_stream.h"
+#include "ext/log.h"
+
+// GCC/Clang vector extensions: SSE on x86, NEON on ARM, scalar fallback elsewhere
+typedef float AnimVec __attribute__((vector_size(ANIM_STREAM_LANES * sizeof(float))));
+typedef int32_t AnimVecI __attribute__((vector_size(ANIM_STREAM_LANES * sizeof(int32_t))));
+
+static inline AnimVec _vload(const float* p) {
+    AnimVec v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline void _vstore(float* p, AnimVec v) {
+    memcpy(p, &v, sizeof(v));
+}
+
+AnimationStreams* create_animation_streams(const Animation* animation, const Skeleton* skeleton,
+                                           float frames_per_second) {
+    if (!animation || !skeleton || skeleton->bone_count == 0 || frames_per_second <= 0.0f)
+        return NULL;
+
+    AnimationStreams* streams = calloc(1, sizeof(AnimationStreams));
+    if (!streams) {
+        log_error("Failed to allocate memory for AnimationStreams");
+        return NULL;
+    }
+
+    size_t bone_count = skeleton->bone_count;
+    size_t padded = (bone_count + ANIM_STREAM_LANES - 1) / ANIM_STREAM_LANES * ANIM_STREAM_LANES;
+    float duration = animation->duration > 0.0f ? animation->duration : 0.0f;
+    float ticks_per_frame = animation->ticks_per_second / frames_per_second;
+    size_t frame_count = duration > 0.0f ? (size_t)ceilf(duration / ticks_per_frame) + 1 : 1;
+    size_t stride = ANIM_STREAM_COMPONENTS * padded;
+
+    streams->bone_count = bone_count;
+    streams->padded_bone_count = padded;
+    streams->frame_count = frame_count;
+    streams->ticks_per_frame = ticks_per_frame;
+    streams->duration = duration;
+    streams->frames = malloc(frame_count * stride * sizeof(float));
+    streams->animated = calloc(bone_count, sizeof(bool));
+
+    const AnimationChannel** bone_channels = calloc(bone_count, sizeof(AnimationChannel*));
+    if (!streams->frames || !streams->animated || !bone_channels) {
+        log_error("Failed to allocate %zu animation stream frames", frame_count);
+        free(bone_channels);
+        free_animation_streams(streams);
+        return NULL;
+    }
+
+    // First channel targeting a bone wins, as in get_channel_for_bone
+    for (size_t i = 0; i < animation->channel_count; i++) {
+        int bone = animation->channels[i].bone_index;
+        if (bone >= 0 && (size_t)bone < bone_count && !bone_channels[bone]) {
+            bone_channels[bone] = &animation->channels[i];
+            streams->animated[bone] = true;
+        }
+    }
+
+    for (size_t f = 0; f < frame_count; f++) {
+        float time = fminf((float)f * ticks_per_frame, duration);
+        float* frame = streams->frames + f * stride;
+
+        for (size_t b = 0; b < padded; b++) {
+            vec3 pos = {0.0f, 0.0f, 0.0f};
+            vec3 scale = {1.0f, 1.0f, 1.0f};
+            versor rot = {0.0f, 0.0f, 0.0f, 1.0f};
+
+            const AnimationChannel* ch = b < bone_count ? bone_channels[b] : NULL;
+            if (ch && animation->compressed) {
+                sample_compressed_channel(animation->compressed,
+                                          (size_t)(ch - animation->channels), time, NULL, false,
+                                          pos, rot, scale);
+            } else if (ch) {
+                interpolate_position(ch->position_keys, ch->position_key_count, time, pos);
+                interpolate_rotation(ch->rotation_keys, ch->rotation_key_count, time, rot);
+                interpolate_scale(ch->scale_keys, ch->scale_key_count, time, scale);
+                glm_quat_normalize(rot);
+            }
+
+            // Keep consecutive rotations in one hemisphere so nlerp takes the short arc
+            if (f > 0) {
+                const float* prev = frame - stride + ANIM_STREAM_QX * padded + b;
+                float dot = prev[0] * rot[0] + prev[padded] * rot[1] + prev[2 * padded] * rot[2] +
+                            prev[3 * padded] * rot[3];
+                if (dot < 0.0f)
+                    glm_vec4_negate(rot);
+            }
+
+            for (int c = 0; c < 3; c++) {
+                frame[(ANIM_STREAM_TX + c) * padded + b] = pos[c];
+                frame[(ANIM_STREAM_SX + c) * padded + b] = scale[c];
+            }
+            for (int c = 0; c < 4; c++) {
+                frame[(ANIM_STREAM_QX + c) * padded + b] = rot[c];
+            }
+        }
+    }
+
+    free(bone_channels);
+    return streams;
+}
+
+void free_animation_streams(AnimationStreams* streams) {
+    if (!streams)
+        return;
+    free(streams->frames);
+    free(streams->animated);
+    free(streams);
+}
+
+int build_animation_streams(Animation* animation, float frames_per_second) {
+    if (!animation)
+        return -1;
+
+    if (!animation->skeleton) {
+        log_error("Animation '%s' has no skeleton to build streams for",
+                  animation->name ? animation->name : "(unnamed)");
+        return -1;
+    }
+
+    AnimationStreams* streams =
+        create_animation_streams(animation, animation->skeleton, frames_per_second);
+    if (!streams)
+        return -1;
+
+    free_animation_streams(animation->streams);
+    animation->streams = streams;
+    return 0;
+}
+
+// Lane groups (ANIM_STREAM_LANES bones each) with group_live[g] == false are left
+// unwritten; a NULL group_live samples everything
+static void _sample_streams(const AnimationStreams* streams, float time, float* out_pose,
+                            const bool* group_live) {
+    size_t padded = streams->padded_bone_count;
+    size_t stride = ANIM_STREAM_COMPONENTS * padded;
+
+    // Locate the frame pair; the last frame may be closer than ticks_per_frame
+    if (time < 0.0f)
+        time = 0.0f;
+    if (time > streams->duration)
+        time = streams->duration;
+
+    size_t f0 = (size_t)(time / streams->ticks_per_frame);
+    if (f0 >= streams->frame_count - 1)
+        f0 = streams->frame_count - 1;
+    size_t f1 = f0 + 1 < streams->frame_count ? f0 + 1 : f0;
+
+    float t0 = (float)f0 * streams->ticks_per_frame;
+    float t1 = fminf((float)f1 * streams->ticks_per_frame, streams->duration);
+    float alpha = t1 > t0 ? (time - t0) / (t1 - t0) : 0.0f;
+    alpha = fminf(fmaxf(alpha, 0.0f), 1.0f);
+
+    const float* a = streams->frames + f0 * stride;
+    const float* b = streams->frames + f1 * stride;
+    AnimVec va = (AnimVec){0} + alpha;
+
+    // Translation and scale rows: straight lerp
+    for (size_t i = 0; i < padded; i += ANIM_STREAM_LANES) {
+        if (group_live && !group_live[i / ANIM_STREAM_LANES])
+            continue;
+
+        for (size_t row = 0; row < 3; row++) {
+            size_t t = ANIM_STREAM_TX * padded + row * padded + i;
+            size_t s = ANIM_STREAM_SX * padded + row * padded + i;
+            AnimVec at = _vload(a + t), as = _vload(a + s);
+            _vstore(out_pose + t, at + (_vload(b + t) - at) * va);
+            _vstore(out_pose + s, as + (_vload(b + s) - as) * va);
+        }
+    }
+
+    // Rotation rows: nlerp, taking the short arc per lane
+    const float* aq = a + ANIM_STREAM_QX * padded;
+    const float* bq = b + ANIM_STREAM_QX * padded;
+    float* oq = out_pose + ANIM_STREAM_QX * padded;
+
+    for (size_t i = 0; i < padded; i += ANIM_STREAM_LANES) {
+        if (group_live && !group_live[i / ANIM_STREAM_LANES])
+            continue;
+
+        AnimVec ax = _vload(aq + i), ay = _vload(aq + padded + i);
+        AnimVec az = _vload(aq + 2 * padded + i), aw = _vload(aq + 3 * padded + i);
+        AnimVec bx = _vload(bq + i), by = _vload(bq + padded + i);
+        AnimVec bz = _vload(bq + 2 * padded + i), bw = _vload(bq + 3 * padded + i);
+
+        AnimVec dot = ax * bx + ay * by + az * bz + aw * bw;
+
+        // Flip b where dot < 0 by xoring the sign bit
+        AnimVecI flip = (AnimVecI)dot & INT32_MIN;
+        bx = (AnimVec)((AnimVecI)bx ^ flip);
+        by = (AnimVec)((AnimVecI)by ^ flip);
+        bz = (AnimVec)((AnimVecI)bz ^ flip);
+        bw = (AnimVec)((AnimVecI)bw ^ flip);
+
+        AnimVec t = va;
+        if (streams->slerp_correction) {
+            // Adjust t so nlerp tracks slerp's constant angular velocity
+            AnimVec d = (AnimVec)((AnimVecI)dot & INT32_MAX);
+            AnimVec ka = 1.0904f + d * (-3.2452f + d * (3.55645f - d * 1.43519f));
+            AnimVec kb = 0.848013f + d * (-1.06021f + d * 0.215638f);
+            AnimVec k = ka * (t - 0.5f) * (t - 0.5f) + kb;
+            t = t + t * (t - 0.5f) * (t - 1.0f) * k;
+        }
+
+        AnimVec qx = ax + (bx - ax) * t;
+        AnimVec qy = ay + (by - ay) * t;
+        AnimVec qz = az + (bz - az) * t;
+        AnimVec qw = aw + (bw - aw) * t;
+
+        AnimVec len2 = qx * qx + qy * qy + qz * qz + qw * qw;
+        AnimVec inv;
+        for (int l = 0; l < ANIM_STREAM_LANES; l++) {
+            inv[l] = len2[l] > 0.0f ? 1.0f / sqrtf(len2[l]) : 0.0f;
+        }
+
+        _vstore(oq + i, qx * inv);
+        _vstore(oq + padded + i, qy * inv);
+        _vstore(oq + 2 * padded + i, qz * inv);
+        _vstore(oq + 3 * padded + i, qw * inv);
+    }
+}
+
+void sample_animation_streams(const AnimationStreams* streams, float time, float* out_pose) {
+    if (!streams || !out_pose)
+        return;
+
+    _sample_streams(streams, time, out_pose, NULL);
+}
+
+static void _compose_locals(const AnimationStreams* streams, const Skeleton* skeleton,
+                            const float* pose, mat4* out_local, const bool* group_live) {
+    size_t padded = streams->padded_bone_count;
+    const float* tx = pose + ANIM_STREAM_TX * padded;
+    const float* qx = pose + ANIM_STREAM_QX * padded;
+    const float* sx = pose + ANIM_STREAM_SX * padded;
+
+    for (size_t i = 0; i < padded; i += ANIM_STREAM_LANES) {
+        if (group_live && !group_live[i / ANIM_STREAM_LANES])
+            continue;
+
+        AnimVec x = _vload(qx + i), y = _vload(qx + padded + i);
+        AnimVec z = _vload(qx + 2 * padded + i), w = _vload(qx + 3 * padded + i);
+        AnimVec s0 = _vload(sx + i), s1 = _vload(sx + padded + i), s2 = _vload(sx + 2 * padded + i);
+
+        // Rotation matrix of a unit quaternion, columns scaled by S: M = T * R * S
+        AnimVec xx = x * x, yy = y * y, zz = z * z;
+        AnimVec xy = x * y, xz = x * z, yz = y * z;
+        AnimVec wx = w * x, wy = w * y, wz = w * z;
+
+        AnimVec m00 = (1.0f - 2.0f * (yy + zz)) * s0;
+        AnimVec m01 = 2.0f * (xy + wz) * s0;
+        AnimVec m02 = 2.0f * (xz - wy) * s0;
+        AnimVec m10 = 2.0f * (xy - wz) * s1;
+        AnimVec m11 = (1.0f - 2.0f * (xx + zz)) * s1;
+        AnimVec m12 = 2.0f * (yz + wx) * s1;
+        AnimVec m20 = 2.0f * (xz + wy) * s2;
+        AnimVec m21 = 2.0f * (yz - wx) * s2;
+        AnimVec m22 = (1.0f - 2.0f * (xx + yy)) * s2;
+
+        for (int l = 0; l < ANIM_STREAM_LANES; l++) {
+            size_t b = i + (size_t)l;
+            if (b >= skeleton->bone_count)
+                break;
+
+            vec4* m = out_local[b];
+            if (!streams->animated[b]) {
+                glm_mat4_copy(skeleton->bones[b].local_transform, m);
+                continue;
+            }
+
+            m[0][0] = m00[l];
+            m[0][1] = m01[l];
+            m[0][2] = m02[l];
+            m[0][3] = 0.0f;
+            m[1][0] = m10[l];
+            m[1][1] = m11[l];
+            m[1][2] = m12[l];
+            m[1][3] = 0.0f;
+            m[2][0] = m20[l];
+            m[2][1] = m21[l];
+            m[2][2] = m22[l];
+            m[2][3] = 0.0f;
+            m[3][0] = tx[b];
+            m[3][1] = tx[padded + b];
+            m[3][2] = tx[2 * padded + b];
+            m[3][3] = 1.0f;
+        }
+    }
+}
+
+void compose_pose_local_transforms(const AnimationStreams* streams, const Skeleton* skeleton,
+                                   const float* pose, mat4* out_local) {
+    if (!streams || !skeleton || !pose || !out_local)
+        return;
+
+    _compose_locals(streams, skeleton, pose, out_local, NULL);
+}
+
+void compute_bone_matrices_streams(AnimationState* state) {
+    if (!state || !state->skeleton)
+        return;
+
+    const Animation* anim = state->current_animation;
+    const AnimationStreams* streams = anim ? anim->streams : NULL;
+    if (!streams || streams->bone_count != state->skeleton->bone_count) {
+        compute_bone_matrices(state);
+        return;
+    }
+
+    // Bone LOD: lane groups whose bones are all reduced are neither sampled nor composed.
+    // Reduced bones sharing a group with a live one are sampled, then pinned to bind pose
+    // so the pose matches the scalar path.
+    const Skeleton* skeleton = state->skeleton;
+    bool group_live[MAX_BONES / ANIM_STREAM_LANES];
+    bool any_reduced = false;
+    memset(group_live, 0, sizeof(group_live));
+    for (size_t i = 0; i < skeleton->bone_count; i++) {
+        if (skeleton_bone_reduced(skeleton, i, state->lod)) {
+            any_reduced = true;
+        } else {
+            group_live[i / ANIM_STREAM_LANES] = true;
+        }
+    }
+    const bool* live = any_reduced ? group_live : NULL;
+
+    // padded_bone_count <= MAX_BONES since MAX_BONES is a multiple of the lane count
+    float pose[ANIM_STREAM_COMPONENTS * MAX_BONES] __attribute__((aligned(16)));
+
+    _sample_streams(streams, state->current_time, pose, live);
+    _compose_locals(streams, skeleton, pose, state->local_transforms, live);
+
+    // Report the bones actually sampled: every real bone of each live group
+    size_t evaluated = 0;
+    for (size_t i = 0; i < skeleton->bone_count; i++) {
+        if (!live || live[i / ANIM_STREAM_LANES])
+            evaluated++;
+        if (live && skeleton_bone_reduced(skeleton, i, state->lod))
+            glm_mat4_copy(skeleton->bones[i].local_transform, state->local_transforms[i]);
+    }
+    state->evaluated_bones = evaluated;
+
+    compute_bone_matrices_from_locals(state);
+}
@@ -0,0 +1,67 @@
+#ifndef _ANIMATION_STREAM_H_
+#define _ANIMATION_STREAM_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "animation.h"
+
+#define ANIM_STREAM_LANES        4     // Bones interpolated per SIMD step
+#define ANIM_STREAM_COMPONENTS   10    // tx ty tz, qx qy qz qw, sx sy sz
+#define ANIM_STREAM_DEFAULT_RATE 30.0f // Resample rate in frames per second
+
+// Offsets of each component row inside a frame or pose, in units of padded_bone_count
+#define ANIM_STREAM_TX 0
+#define ANIM_STREAM_QX 3
+#define ANIM_STREAM_SX 7
+
+/*
+ * Animation Streams
+ *
+ * A clip resampled at a fixed rate into structure-of-arrays frames. Every frame
+ * holds ten rows (one per TRS component) of padded_bone_count floats, so all bones
+ * share one interpolation factor and neighbouring bones are interpolated together
+ * in SIMD lanes. Rotations use nlerp, optionally with a polynomial correction that
+ * brings the result close to slerp. Poses are composed straight into affine
+ * matrices without building separate T, R and S matrices.
+ */
+typedef struct AnimationStreams {
+    size_t bone_count;
+    size_t padded_bone_count; // Multiple of ANIM_STREAM_LANES
+    size_t frame_count;
+    float ticks_per_frame;
+    float duration; // In ticks
+
+    float* frames;  // frame_count * ANIM_STREAM_COMPONENTS * padded_bone_count
+    bool* animated; // Per bone; bones without a channel keep their bind pose
+
+    bool slerp_correction;
+} AnimationStreams;
+
+/*
+ * Lifecycle
+ */
+AnimationStreams* create_animation_streams(const Animation* animation, const Skeleton* skeleton,
+                                           float frames_per_second);
+void free_animation_streams(AnimationStreams* streams);
+
+// Build streams for animation->skeleton and attach them to the animation, which then
+// plays through compute_bone_matrices_streams
+int build_animation_streams(Animation* animation, float frames_per_second);
+
+/*
+ * Sampling
+ */
+
+// Write the SoA pose at time (ticks) into out_pose
+// (ANIM_STREAM_COMPONENTS * padded_bone_count floats)
+void sample_animation_streams(const AnimationStreams* streams, float time, float* out_pose);
+
+// Compose local transforms from a SoA pose
+void compose_pose_local_transforms(const AnimationStreams* streams, const Skeleton* skeleton,
+                                   const float* pose, mat4* out_local);
+
+// Streams counterpart of compute_bone_matrices
+void compute_bone_matrices_streams(AnimationState* state);
+
+#endif // _ANIMATION_STREAM_H_
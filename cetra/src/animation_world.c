@@ -0,0 +1,338 @@
+#include <math.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "animation_world.h"
+#include "scene.h"
+#include "worker_pool.h"
+#include "ext/log.h"
+
+typedef struct {
+    const AnimationWorld* world;
+    AnimationInstance* instances;
+    size_t instance_count;
+    float delta_time;
+    atomic_size_t next_instance;
+    atomic_size_t updated_count;
+    atomic_size_t skipped_count;
+    atomic_size_t frozen_count;
+    atomic_size_t evaluated_bones;
+    atomic_size_t lod_counts[ANIMATION_LOD_LEVELS];
+} AnimationBatch;
+
+AnimationLodConfig animation_lod_default_config(void) {
+    return (AnimationLodConfig){
+        .screen_sizes = {0.25f, 0.1f, 0.04f},
+        .update_intervals = {1, 2, 4, 8},
+        .freeze_offscreen = true,
+    };
+}
+
+AnimationWorld* create_animation_world(int thread_count) {
+    AnimationWorld* world = calloc(1, sizeof(AnimationWorld));
+    if (!world) {
+        log_error("Failed to allocate memory for AnimationWorld");
+        return NULL;
+    }
+
+    if (thread_count <= 0)
+        thread_count = ANIMATION_WORLD_DEFAULT_THREADS;
+    if (thread_count > ANIMATION_WORLD_MAX_THREADS)
+        thread_count = ANIMATION_WORLD_MAX_THREADS;
+    world->thread_count = thread_count;
+
+    world->lod_config = animation_lod_default_config();
+    world->lod_enabled = true;
+
+    return world;
+}
+
+void free_animation_world(AnimationWorld* world) {
+    if (!world)
+        return;
+
+    for (size_t i = 0; i < world->instance_count; i++) {
+        AnimationInstance* inst = &world->instances[i];
+        if (inst->node && inst->node->animation_state == inst->state)
+            inst->node->animation_state = NULL;
+        free_animation_state(inst->state);
+    }
+    free(world->instances);
+    free(world);
+}
+
+static AnimationInstance* _find_instance(AnimationWorld* world, const AnimationState* state) {
+    for (size_t i = 0; i < world->instance_count; i++) {
+        if (world->instances[i].state == state)
+            return &world->instances[i];
+    }
+    return NULL;
+}
+
+AnimationState* add_animation_instance(AnimationWorld* world, Skeleton* skeleton,
+                                       SceneNode* node) {
+    if (!world || !skeleton)
+        return NULL;
+
+    if (world->instance_count >= world->instance_capacity) {
+        size_t new_capacity = world->instance_capacity ? world->instance_capacity * 2 : 16;
+        AnimationInstance* instances =
+            realloc(world->instances, new_capacity * sizeof(AnimationInstance));
+        if (!instances) {
+            log_error("Failed to grow animation instance array");
+            return NULL;
+        }
+        world->instances = instances;
+        world->instance_capacity = new_capacity;
+    }
+
+    AnimationState* state = create_animation_state(skeleton);
+    if (!state)
+        return NULL;
+
+    AnimationInstance* inst = &world->instances[world->instance_count++];
+    inst->state = state;
+    inst->node = NULL;
+    inst->pending_time = 0.0f;
+    inst->phase = world->next_phase++;
+    inst->lod = 0;
+    inst->visible = true;
+    inst->posed = false;
+    bind_animation_instance(world, state, node);
+
+    return state;
+}
+
+void remove_animation_instance(AnimationWorld* world, AnimationState* state) {
+    if (!world || !state)
+        return;
+
+    AnimationInstance* inst = _find_instance(world, state);
+    if (!inst) {
+        log_warn("AnimationState %p is not owned by this world", (void*)state);
+        return;
+    }
+
+    if (inst->node && inst->node->animation_state == state)
+        inst->node->animation_state = NULL;
+    free_animation_state(state);
+
+    // Swap-remove; update order does not matter
+    *inst = world->instances[--world->instance_count];
+}
+
+void bind_animation_instance(AnimationWorld* world, AnimationState* state, SceneNode* node) {
+    if (!world || !state)
+        return;
+
+    AnimationInstance* inst = _find_instance(world, state);
+    if (!inst)
+        return;
+
+    if (inst->node && inst->node->animation_state == state)
+        inst->node->animation_state = NULL;
+
+    inst->node = node;
+    if (node)
+        node->animation_state = state;
+}
+
+void set_animation_world_lod(AnimationWorld* world, const AnimationLodConfig* config) {
+    if (!world)
+        return;
+
+    world->lod_enabled = config != NULL;
+    if (config)
+        world->lod_config = *config;
+}
+
+void set_animation_world_view(AnimationWorld* world, mat4 view, mat4 projection) {
+    if (!world)
+        return;
+
+    glm_mat4_copy(view, world->view);
+    glm_mat4_copy(projection, world->projection);
+
+    mat4 vp;
+    glm_mat4_mul(projection, view, vp);
+    frustum_extract_from_vp(vp, &world->frustum);
+    world->has_view = true;
+}
+
+// Pick inst's LOD from the projected size of its node's bounds
+static void _select_lod(const AnimationWorld* world, AnimationInstance* inst) {
+    inst->lod = 0;
+    inst->visible = true;
+
+    const SceneNode* node = inst->node;
+    if (!world->lod_enabled || !world->has_view || !node || !node->has_bounds)
+        return;
+
+    vec3 bmin, bmax;
+    glm_vec3_copy((float*)node->world_bounds.min, bmin);
+    glm_vec3_copy((float*)node->world_bounds.max, bmax);
+    inst->visible = frustum_test_aabb(&world->frustum, bmin, bmax);
+
+    vec3 center, view_center;
+    glm_vec3_center(bmin, bmax, center);
+    float radius = 0.5f * glm_vec3_distance(bmin, bmax);
+    glm_mat4_mulv3((vec4*)world->view, center, 1.0f, view_center);
+
+    // Diameter over viewport height; projection[2][3] is 0 for orthographic cameras
+    float size;
+    if (world->projection[2][3] == 0.0f) {
+        size = radius * world->projection[1][1];
+    } else {
+        float depth = -view_center[2];
+        if (depth <= radius)
+            return; // Camera inside or touching the bounds
+        size = radius * fabsf(world->projection[1][1]) / depth;
+    }
+
+    while (inst->lod < ANIMATION_LOD_LEVELS - 1 &&
+           size < world->lod_config.screen_sizes[inst->lod])
+        inst->lod++;
+}
+
+// Skinned meshes below node that take their pose from state get new bounds. Stops at
+// nodes bound to another state.
+static void _mark_posed_bounds_dirty(SceneNode* node, const AnimationState* state) {
+    if (node->animation_state && node->animation_state != state)
+        return;
+
+    for (size_t i = 0; i < node->mesh_count; i++) {
+        if (node->meshes[i] && node->meshes[i]->is_skinned) {
+            mark_node_bounds_dirty(node);
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < node->children_count; i++) {
+        _mark_posed_bounds_dirty(node->children[i], state);
+    }
+}
+
+static void* _animation_worker_func(void* arg) {
+    AnimationBatch* batch = (AnimationBatch*)arg;
+    const AnimationWorld* world = batch->world;
+    const AnimationLodConfig* config = &world->lod_config;
+    size_t updated = 0, skipped = 0, frozen = 0, bones = 0;
+    size_t lod_counts[ANIMATION_LOD_LEVELS] = {0};
+
+    for (;;) {
+        size_t start = atomic_fetch_add(&batch->next_instance, ANIMATION_WORLD_CHUNK_SIZE);
+        if (start >= batch->instance_count)
+            break;
+        size_t end = start + ANIMATION_WORLD_CHUNK_SIZE;
+        if (end > batch->instance_count)
+            end = batch->instance_count;
+
+        for (size_t i = start; i < end; i++) {
+            AnimationInstance* inst = &batch->instances[i];
+            AnimationState* state = inst->state;
+            inst->posed = false;
+            if (!state->playing || (!state->current_animation && !state->blend)) {
+                inst->pending_time = 0.0f;
+                continue;
+            }
+            inst->pending_time += batch->delta_time;
+
+            _select_lod(world, inst);
+            if (!inst->visible && world->lod_enabled && config->freeze_offscreen) {
+                frozen++;
+                continue;
+            }
+
+            int interval = world->lod_enabled ? config->update_intervals[inst->lod] : 1;
+            if (interval > 1 && (world->frame_index + inst->phase) % (unsigned int)interval) {
+                skipped++;
+                continue;
+            }
+
+            // Catch up on the time skipped since the last update in one step
+            state->lod = inst->lod;
+            update_animation(state, inst->pending_time);
+            inst->pending_time = 0.0f;
+            inst->posed = true;
+
+            updated++;
+            bones += state->evaluated_bones;
+            lod_counts[inst->lod]++;
+        }
+    }
+
+    atomic_fetch_add(&batch->updated_count, updated);
+    atomic_fetch_add(&batch->skipped_count, skipped);
+    atomic_fetch_add(&batch->frozen_count, frozen);
+    atomic_fetch_add(&batch->evaluated_bones, bones);
+    for (int i = 0; i < ANIMATION_LOD_LEVELS; i++) {
+        atomic_fetch_add(&batch->lod_counts[i], lod_counts[i]);
+    }
+    return NULL;
+}
+
+void update_animation_world(AnimationWorld* world, float delta_time) {
+    if (!world)
+        return;
+
+    world->updated_count = 0;
+    world->skipped_count = 0;
+    world->frozen_count = 0;
+    world->evaluated_bones = 0;
+    memset(world->lod_counts, 0, sizeof(world->lod_counts));
+    if (world->instance_count == 0)
+        return;
+
+    AnimationBatch batch = {
+        .world = world,
+        .instances = world->instances,
+        .instance_count = world->instance_count,
+        .delta_time = delta_time,
+    };
+    atomic_init(&batch.next_instance, 0);
+    atomic_init(&batch.updated_count, 0);
+    atomic_init(&batch.skipped_count, 0);
+    atomic_init(&batch.frozen_count, 0);
+    atomic_init(&batch.evaluated_bones, 0);
+    for (int i = 0; i < ANIMATION_LOD_LEVELS; i++) {
+        atomic_init(&batch.lod_counts[i], 0);
+    }
+
+    // No point waking threads for less than a chunk each
+    int thread_count = world->thread_count;
+    size_t chunks =
+        (world->instance_count + ANIMATION_WORLD_CHUNK_SIZE - 1) / ANIMATION_WORLD_CHUNK_SIZE;
+    if ((size_t)thread_count > chunks)
+        thread_count = (int)chunks;
+
+    // The calling thread works as well; the shared pool, started on the first update that
+    // needs it, lends at most thread_count - 1 others
+    WorkerPool* pool = thread_count > 1 ? get_shared_worker_pool() : NULL;
+    run_worker_pool(pool, _animation_worker_func, &batch, thread_count);
+
+    world->updated_count = atomic_load(&batch.updated_count);
+    world->skipped_count = atomic_load(&batch.skipped_count);
+    world->frozen_count = atomic_load(&batch.frozen_count);
+    world->evaluated_bones = atomic_load(&batch.evaluated_bones);
+    for (int i = 0; i < ANIMATION_LOD_LEVELS; i++) {
+        world->lod_counts[i] = atomic_load(&batch.lod_counts[i]);
+    }
+
+    // Bounds follow the pose; marked here since node flags are not safe to touch from
+    // the workers
+    for (size_t i = 0; i < world->instance_count; i++) {
+        AnimationInstance* inst = &world->instances[i];
+        if (inst->posed && inst->node)
+            _mark_posed_bounds_dirty(inst->node, inst->state);
+    }
+    world->frame_index++;
+}
+
+AnimationState* get_node_animation_state(const SceneNode* node) {
+    for (; node; node = node->parent) {
+        if (node->animation_state)
+            return node->animation_state;
+    }
+    return NULL;
+}
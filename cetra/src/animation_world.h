@@ -0,0 +1,117 @@
+#ifndef _ANIMATION_WORLD_H_
+#define _ANIMATION_WORLD_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "animation.h"
+#include "intersect.h"
+
+struct SceneNode;
+
+#define ANIMATION_WORLD_CHUNK_SIZE      16 // States claimed by a worker at a time
+#define ANIMATION_WORLD_DEFAULT_THREADS 4
+#define ANIMATION_WORLD_MAX_THREADS     16
+
+/*
+ * Animation LOD
+ *
+ * With a view set, each bound instance picks a detail level from the projected size of
+ * its node's world bounds. Coarser levels update less often (instances are staggered
+ * so the work spreads evenly over frames, and skipped time is caught up on the next
+ * update) and sample fewer bones through skeleton->bone_lod. Instances outside the
+ * frustum can be frozen entirely. Unbound instances, and all instances before a view
+ * is set, run at LOD 0 every frame.
+ */
+typedef struct AnimationLodConfig {
+    // Bounding sphere diameter over viewport height below which LOD i + 1 applies
+    float screen_sizes[ANIMATION_LOD_LEVELS - 1];
+    int update_intervals[ANIMATION_LOD_LEVELS]; // Frames between pose updates
+    bool freeze_offscreen;
+} AnimationLodConfig;
+
+/*
+ * Animation World
+ *
+ * Owns one AnimationState per animated instance and binds each to a scene node.
+ * Skinned meshes draw with the palette of the nearest bound ancestor, so every
+ * character gets its own pose. update_animation_world advances all instances in
+ * one pass split across worker threads; states only share read-only skeleton and
+ * clip data, so no locking is needed.
+ *
+ * Remove an instance before freeing the node it is bound to.
+ */
+typedef struct AnimationInstance {
+    AnimationState* state;  // Owned
+    struct SceneNode* node; // Bound node, may be NULL
+
+    float pending_time; // Seconds not yet applied to state (skipped frames)
+    unsigned int phase; // Staggers reduced-rate updates across frames
+    int lod;
+    bool visible;
+    bool posed; // Pose recomputed by the last update
+} AnimationInstance;
+
+typedef struct AnimationWorld {
+    AnimationInstance* instances;
+    size_t instance_count;
+    size_t instance_capacity;
+
+    int thread_count;
+
+    AnimationLodConfig lod_config;
+    bool lod_enabled;
+    bool has_view;
+    mat4 view;
+    mat4 projection;
+    Frustum frustum;
+    unsigned int frame_index;
+    unsigned int next_phase;
+
+    // Stats from the last update_animation_world
+    size_t updated_count;   // Instances whose pose was recomputed
+    size_t skipped_count;   // Playing instances waiting for their update frame
+    size_t frozen_count;    // Playing instances frozen off-screen
+    size_t evaluated_bones; // Bones sampled across all updated instances
+    size_t lod_counts[ANIMATION_LOD_LEVELS]; // Updated instances per LOD
+} AnimationWorld;
+
+/*
+ * Lifecycle
+ */
+AnimationWorld* create_animation_world(int thread_count);
+void free_animation_world(AnimationWorld* world);
+
+/*
+ * Instances
+ */
+
+// Create a state for skeleton and bind it to node (if any). The world owns the state.
+AnimationState* add_animation_instance(AnimationWorld* world, Skeleton* skeleton,
+                                       struct SceneNode* node);
+void remove_animation_instance(AnimationWorld* world, AnimationState* state);
+
+// Rebind an existing instance to another node (or NULL)
+void bind_animation_instance(AnimationWorld* world, AnimationState* state,
+                             struct SceneNode* node);
+
+/*
+ * LOD
+ */
+AnimationLodConfig animation_lod_default_config(void);
+
+// Replace the LOD config; NULL disables LOD (every instance at LOD 0, every frame)
+void set_animation_world_lod(AnimationWorld* world, const AnimationLodConfig* config);
+
+// Camera used for LOD selection, normally the matrices of the frame being drawn
+void set_animation_world_view(AnimationWorld* world, mat4 view, mat4 projection);
+
+/*
+ * Update
+ */
+void update_animation_world(AnimationWorld* world, float delta_time);
+
+// Palette used to draw skinned meshes on node: its own binding or the nearest ancestor's
+AnimationState* get_node_animation_state(const struct SceneNode* node);
+
+#endif // _ANIMATION_WORLD_H_
@@ -0,0 +1,229 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <GL/glew.h>
+#include <cglm/cglm.h>
+
+#include "bone_palette.h"
+#include "uniform.h"
+#include "ext/log.h"
+
+BonePalette* create_bone_palette(void) {
+    BonePalette* palette = calloc(1, sizeof(BonePalette));
+    if (!palette) {
+        log_error("Failed to allocate bone palette");
+        return NULL;
+    }
+
+    palette->texels = malloc(BONE_PALETTE_INITIAL_TEXELS * sizeof(vec4));
+    if (!palette->texels) {
+        log_error("Failed to allocate bone palette staging");
+        free(palette);
+        return NULL;
+    }
+    palette->texel_capacity = BONE_PALETTE_INITIAL_TEXELS;
+
+    // State palette_frame starts at 0, so real frames start at 1
+    palette->frame = 1;
+
+    return palette;
+}
+
+void free_bone_palette(BonePalette* palette) {
+    if (!palette)
+        return;
+
+    if (palette->texture)
+        glDeleteTextures(1, &palette->texture);
+    if (palette->buffer)
+        glDeleteBuffers(1, &palette->buffer);
+
+    free(palette->texels);
+    free(palette->instances);
+    free(palette);
+}
+
+void begin_bone_palette_frame(BonePalette* palette) {
+    if (!palette)
+        return;
+
+    palette->texel_count = 0;
+    palette->record_start = 0;
+    palette->uploaded_count = 0;
+    palette->instance_count = 0;
+    palette->frame++;
+    if (palette->frame == 0)
+        palette->frame = 1;
+}
+
+// Reserve count texels, returning the first or -1
+static int _reserve_texels(BonePalette* palette, size_t count) {
+    size_t required = palette->texel_count + count;
+    if (palette->max_texels && required > palette->max_texels) {
+        log_warn("Bone palette full (%zu texels)", palette->max_texels);
+        return -1;
+    }
+
+    if (required > palette->texel_capacity) {
+        size_t new_capacity = palette->texel_capacity * 2;
+        while (new_capacity < required)
+            new_capacity *= 2;
+
+        vec4* texels = realloc(palette->texels, new_capacity * sizeof(vec4));
+        if (!texels) {
+            log_error("Failed to grow bone palette staging");
+            return -1;
+        }
+        palette->texels = texels;
+        palette->texel_capacity = new_capacity;
+    }
+
+    int offset = (int)palette->texel_count;
+    palette->texel_count = required;
+    return offset;
+}
+
+// Store the top three rows of m (column-major) as three texels
+static void _write_rows(vec4* out, mat4 m) {
+    for (int r = 0; r < 3; r++) {
+        out[r][0] = m[0][r];
+        out[r][1] = m[1][r];
+        out[r][2] = m[2][r];
+        out[r][3] = m[3][r];
+    }
+}
+
+int write_bone_palette(BonePalette* palette, AnimationState* state) {
+    if (!palette || !state || state->active_bone_count == 0)
+        return -1;
+
+    if (state->palette_frame == palette->frame)
+        return state->palette_offset;
+
+    int offset =
+        _reserve_texels(palette, state->active_bone_count * BONE_PALETTE_TEXELS_PER_BONE);
+    if (offset < 0)
+        return -1;
+
+    vec4* out = &palette->texels[offset];
+    for (size_t i = 0; i < state->active_bone_count; i++) {
+        _write_rows(out + i * BONE_PALETTE_TEXELS_PER_BONE, state->bone_matrices[i]);
+    }
+
+    state->palette_offset = offset;
+    state->palette_frame = palette->frame;
+    palette->record_start = palette->texel_count;
+    return offset;
+}
+
+void begin_skinned_instances(BonePalette* palette) {
+    if (!palette)
+        return;
+
+    palette->texel_count = palette->record_start;
+    if (palette->uploaded_count > palette->record_start)
+        palette->uploaded_count = palette->record_start;
+    palette->instance_count = 0;
+}
+
+int queue_skinned_instance(BonePalette* palette, struct Mesh* mesh, struct SceneNode* node,
+                           int vertex_base) {
+    if (!palette || !mesh || !node || vertex_base < 0)
+        return -1;
+
+    if (palette->instance_count >= palette->instance_capacity) {
+        size_t new_capacity = palette->instance_capacity ? palette->instance_capacity * 2 : 64;
+        SkinnedInstance* instances =
+            realloc(palette->instances, new_capacity * sizeof(SkinnedInstance));
+        if (!instances) {
+            log_error("Failed to grow skinned instance queue");
+            return -1;
+        }
+        palette->instances = instances;
+        palette->instance_capacity = new_capacity;
+    }
+
+    SkinnedInstance* inst = &palette->instances[palette->instance_count++];
+    inst->mesh = mesh;
+    inst->node = node;
+    inst->vertex_base = vertex_base;
+    return 0;
+}
+
+int write_palette_instance(BonePalette* palette, mat4 model, int vertex_base) {
+    if (!palette)
+        return -1;
+
+    int offset = _reserve_texels(palette, BONE_PALETTE_TEXELS_PER_INSTANCE);
+    if (offset < 0)
+        return -1;
+
+    vec4* out = &palette->texels[offset];
+    _write_rows(out, model);
+
+    // Offsets stay well below 2^24, so they are exact as floats
+    out[3][0] = (float)vertex_base;
+    out[3][1] = 0.0f;
+    out[3][2] = 0.0f;
+    out[3][3] = 0.0f;
+    return offset;
+}
+
+static int _init_palette_buffer(BonePalette* palette) {
+    GLint max_texels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texels);
+    palette->max_texels = max_texels > 0 ? (size_t)max_texels : 65536;
+
+    glGenBuffers(1, &palette->buffer);
+    glGenTextures(1, &palette->texture);
+    if (!palette->buffer || !palette->texture) {
+        log_error("Failed to create bone palette buffer");
+        return -1;
+    }
+
+    glBindTexture(GL_TEXTURE_BUFFER, palette->texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, palette->buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    return 0;
+}
+
+int upload_bone_palette(BonePalette* palette) {
+    if (!palette)
+        return -1;
+
+    if (!palette->buffer && _init_palette_buffer(palette) != 0)
+        return -1;
+
+    if (palette->texel_count <= palette->uploaded_count)
+        return 0;
+
+    glBindBuffer(GL_TEXTURE_BUFFER, palette->buffer);
+
+    // The first upload of a frame orphans last frame's storage so the driver need not
+    // wait on draws still reading it. Later uploads append, unless the buffer must grow.
+    size_t start = palette->uploaded_count;
+    if (start == 0 || palette->texel_count > palette->buffer_capacity) {
+        if (palette->texel_count > palette->buffer_capacity)
+            palette->buffer_capacity = palette->texel_capacity;
+        glBufferData(GL_TEXTURE_BUFFER, palette->buffer_capacity * sizeof(vec4), NULL,
+                     GL_STREAM_DRAW);
+        start = 0;
+    }
+    glBufferSubData(GL_TEXTURE_BUFFER, start * sizeof(vec4),
+                    (palette->texel_count - start) * sizeof(vec4), palette->texels + start);
+    palette->uploaded_count = palette->texel_count;
+
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    return 0;
+}
+
+void bind_bone_palette(BonePalette* palette, ShaderProgram* program) {
+    if (!program || !program->uniforms)
+        return;
+
+    // Always point the sampler at its own unit, so it never shares one with a sampler2D
+    glActiveTexture(GL_TEXTURE0 + BONE_PALETTE_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, palette ? palette->texture : 0);
+    glActiveTexture(GL_TEXTURE0);
+    uniform_set_int(program->uniforms, "bonePalette", BONE_PALETTE_TEXTURE_UNIT);
+}
@@ -0,0 +1,93 @@
+#ifndef _BONE_PALETTE_H_
+#define _BONE_PALETTE_H_
+
+#include <GL/glew.h>
+#include <cglm/cglm.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "animation.h"
+#include "program.h"
+
+#define BONE_PALETTE_TEXTURE_UNIT        18
+#define BONE_PALETTE_TEXELS_PER_BONE     3 // Rows of a 3x4 matrix
+#define BONE_PALETTE_TEXELS_PER_INSTANCE 4 // 3x4 model matrix, then the skinned vertex base
+#define BONE_PALETTE_INITIAL_TEXELS      4096
+
+struct Mesh;
+struct SceneNode;
+
+// A skinned mesh draw deferred until the frame's instance records are uploaded
+typedef struct SkinnedInstance {
+    struct Mesh* mesh;
+    struct SceneNode* node;
+    int vertex_base; // First vertex of the mesh's pre-skinned output in the skin cache
+} SkinnedInstance;
+
+/*
+ * Bone Palette
+ *
+ * One RGBA32F texture buffer per frame holding every posed character's bone matrices
+ * as 3x4 rows, read by the skinning pre-pass (see skin_cache.h). A character's palette
+ * is written once per frame however many meshes use it.
+ *
+ * The main pass appends instance records after the palettes: skinned draws are queued
+ * during traversal, then queued instances sharing a mesh are drawn with one instanced
+ * call, each reading its model matrix and skinned vertex base from its record.
+ * Records are rewritten on every main pass; palettes only when poses change.
+ *
+ * GL objects are created on the first upload.
+ */
+typedef struct BonePalette {
+    vec4* texels; // CPU staging for the current frame
+    size_t texel_count;
+    size_t texel_capacity;
+
+    SkinnedInstance* instances; // Queued draws for the current frame
+    size_t instance_count;
+    size_t instance_capacity;
+
+    size_t record_start;   // First texel after the palettes
+    size_t uploaded_count; // Texels already in the buffer this frame
+
+    GLuint buffer;  // GL_TEXTURE_BUFFER storage
+    GLuint texture; // samplerBuffer view of buffer
+    size_t buffer_capacity; // In texels
+    size_t max_texels;      // GL_MAX_TEXTURE_BUFFER_SIZE
+
+    unsigned int frame; // Matched against AnimationState.palette_frame
+} BonePalette;
+
+/*
+ * Lifecycle
+ */
+BonePalette* create_bone_palette(void);
+void free_bone_palette(BonePalette* palette);
+
+/*
+ * Frame
+ */
+
+// Drop last frame's palettes, records and queued draws
+void begin_bone_palette_frame(BonePalette* palette);
+
+// Texel offset of state's palette, written on first use this frame. -1 when full.
+int write_bone_palette(BonePalette* palette, AnimationState* state);
+
+// Drop the records and queued draws of a previous main pass, keeping the palettes
+void begin_skinned_instances(BonePalette* palette);
+
+// Queue mesh on node for instanced drawing from its pre-skinned vertices
+int queue_skinned_instance(BonePalette* palette, struct Mesh* mesh, struct SceneNode* node,
+                           int vertex_base);
+
+// Append an instance record (model matrix and vertex base). Returns its texel offset.
+int write_palette_instance(BonePalette* palette, mat4 model, int vertex_base);
+
+// Upload texels written since the last upload to the texture buffer
+int upload_bone_palette(BonePalette* palette);
+
+// Bind the texture buffer to BONE_PALETTE_TEXTURE_UNIT and point program's sampler at it
+void bind_bone_palette(BonePalette* palette, ShaderProgram* program);
+
+#endif // _BONE_PALETTE_H_
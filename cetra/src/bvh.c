@@ -0,0 +1,276 @@
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cglm/cglm.h>
+
+#include "bvh.h"
+#include "mesh.h"
+#include "ext/log.h"
+
+// Leaves above this size are split even when the SAH says a leaf is cheaper
+#define BVH_MAX_SAH_LEAF_TRIANGLES 16
+
+typedef struct {
+    vec3 min;
+    vec3 max;
+    size_t count;
+} BVHBin;
+
+typedef struct {
+    MeshBVH* bvh;
+    const float* tri_min;   // 3 floats per triangle
+    const float* tri_max;   // 3 floats per triangle
+    const float* centroids; // 3 floats per triangle
+    uint32_t* order;        // triangle order, partitioned in place
+} BVHBuildContext;
+
+static size_t _mesh_triangle_count(const Mesh* mesh) {
+    if (mesh->indices && mesh->index_count > 0)
+        return mesh->index_count / 3;
+    return mesh->vertex_count / 3;
+}
+
+static void _mesh_triangle(const Mesh* mesh, size_t tri, const float** v0, const float** v1,
+                           const float** v2) {
+    if (mesh->indices && mesh->index_count > 0) {
+        *v0 = mesh->vertices + mesh->indices[tri * 3 + 0] * 3;
+        *v1 = mesh->vertices + mesh->indices[tri * 3 + 1] * 3;
+        *v2 = mesh->vertices + mesh->indices[tri * 3 + 2] * 3;
+    } else {
+        *v0 = mesh->vertices + (tri * 3 + 0) * 3;
+        *v1 = mesh->vertices + (tri * 3 + 1) * 3;
+        *v2 = mesh->vertices + (tri * 3 + 2) * 3;
+    }
+}
+
+static float _surface_area(const vec3 min, const vec3 max) {
+    float dx = max[0] - min[0];
+    float dy = max[1] - min[1];
+    float dz = max[2] - min[2];
+    if (dx < 0.0f || dy < 0.0f || dz < 0.0f)
+        return 0.0f;
+    return 2.0f * (dx * dy + dy * dz + dz * dx);
+}
+
+static void _grow(vec3 min, vec3 max, const float* pmin, const float* pmax) {
+    for (int a = 0; a < 3; a++) {
+        if (pmin[a] < min[a])
+            min[a] = pmin[a];
+        if (pmax[a] > max[a])
+            max[a] = pmax[a];
+    }
+}
+
+static void _build_node(BVHBuildContext* ctx, uint32_t node_index, uint32_t first, uint32_t count,
+                        int depth) {
+    BVHNode* node = &ctx->bvh->nodes[node_index];
+
+    // Node bounds and centroid bounds
+    vec3 cmin = {FLT_MAX, FLT_MAX, FLT_MAX};
+    vec3 cmax = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    glm_vec3_copy(cmin, node->min);
+    glm_vec3_copy(cmax, node->max);
+    for (uint32_t i = first; i < first + count; i++) {
+        uint32_t tri = ctx->order[i];
+        _grow(node->min, node->max, ctx->tri_min + tri * 3, ctx->tri_max + tri * 3);
+        _grow(cmin, cmax, ctx->centroids + tri * 3, ctx->centroids + tri * 3);
+    }
+
+    node->axis = 0;
+    if (count <= BVH_MAX_LEAF_TRIANGLES || depth >= BVH_MAX_DEPTH) {
+        node->left_first = first;
+        node->tri_count = (uint16_t)count;
+        return;
+    }
+
+    // Binned SAH over all three axes
+    int best_axis = -1;
+    int best_split = 0;
+    float best_cost = FLT_MAX;
+
+    for (int axis = 0; axis < 3; axis++) {
+        float extent = cmax[axis] - cmin[axis];
+        if (extent <= 0.0f)
+            continue;
+
+        BVHBin bins[BVH_SAH_BINS];
+        for (int b = 0; b < BVH_SAH_BINS; b++) {
+            glm_vec3_copy((vec3){FLT_MAX, FLT_MAX, FLT_MAX}, bins[b].min);
+            glm_vec3_copy((vec3){-FLT_MAX, -FLT_MAX, -FLT_MAX}, bins[b].max);
+            bins[b].count = 0;
+        }
+
+        float scale = (float)BVH_SAH_BINS / extent;
+        for (uint32_t i = first; i < first + count; i++) {
+            uint32_t tri = ctx->order[i];
+            int b = (int)((ctx->centroids[tri * 3 + axis] - cmin[axis]) * scale);
+            if (b >= BVH_SAH_BINS)
+                b = BVH_SAH_BINS - 1;
+            bins[b].count++;
+            _grow(bins[b].min, bins[b].max, ctx->tri_min + tri * 3, ctx->tri_max + tri * 3);
+        }
+
+        // Sweep from the left and right to get the cost of each split plane
+        float left_area[BVH_SAH_BINS - 1], right_area[BVH_SAH_BINS - 1];
+        size_t left_count[BVH_SAH_BINS - 1], right_count[BVH_SAH_BINS - 1];
+        vec3 lmin = {FLT_MAX, FLT_MAX, FLT_MAX}, lmax = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+        vec3 rmin = {FLT_MAX, FLT_MAX, FLT_MAX}, rmax = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+        size_t lsum = 0, rsum = 0;
+        for (int b = 0; b < BVH_SAH_BINS - 1; b++) {
+            lsum += bins[b].count;
+            if (bins[b].count)
+                _grow(lmin, lmax, bins[b].min, bins[b].max);
+            left_count[b] = lsum;
+            left_area[b] = _surface_area(lmin, lmax);
+
+            int r = BVH_SAH_BINS - 1 - b;
+            rsum += bins[r].count;
+            if (bins[r].count)
+                _grow(rmin, rmax, bins[r].min, bins[r].max);
+            right_count[r - 1] = rsum;
+            right_area[r - 1] = _surface_area(rmin, rmax);
+        }
+
+        for (int b = 0; b < BVH_SAH_BINS - 1; b++) {
+            if (left_count[b] == 0 || right_count[b] == 0)
+                continue;
+            float cost = left_area[b] * left_count[b] + right_area[b] * right_count[b];
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_axis = axis;
+                best_split = b;
+            }
+        }
+    }
+
+    uint32_t mid;
+    if (best_axis < 0) {
+        // All centroids coincide; split the range in half
+        best_axis = 0;
+        mid = first + count / 2;
+    } else {
+        float leaf_cost = _surface_area(node->min, node->max) * count;
+        if (best_cost >= leaf_cost && count <= BVH_MAX_SAH_LEAF_TRIANGLES) {
+            node->left_first = first;
+            node->tri_count = (uint16_t)count;
+            return;
+        }
+
+        // Partition triangles around the chosen bin boundary
+        float scale = (float)BVH_SAH_BINS / (cmax[best_axis] - cmin[best_axis]);
+        uint32_t i = first;
+        uint32_t j = first + count;
+        while (i < j) {
+            uint32_t tri = ctx->order[i];
+            int b = (int)((ctx->centroids[tri * 3 + best_axis] - cmin[best_axis]) * scale);
+            if (b >= BVH_SAH_BINS)
+                b = BVH_SAH_BINS - 1;
+            if (b <= best_split) {
+                i++;
+            } else {
+                j--;
+                ctx->order[i] = ctx->order[j];
+                ctx->order[j] = tri;
+            }
+        }
+        mid = i;
+        if (mid == first || mid == first + count)
+            mid = first + count / 2;
+    }
+
+    uint32_t left = (uint32_t)ctx->bvh->node_count;
+    ctx->bvh->node_count += 2;
+
+    node->left_first = left;
+    node->tri_count = 0;
+    node->axis = (uint16_t)best_axis;
+
+    _build_node(ctx, left, first, mid - first, depth + 1);
+    _build_node(ctx, left + 1, mid, first + count - mid, depth + 1);
+}
+
+MeshBVH* create_mesh_bvh(const Mesh* mesh) {
+    if (!mesh || !mesh->vertices || mesh->draw_mode != TRIANGLES)
+        return NULL;
+
+    size_t tri_count = _mesh_triangle_count(mesh);
+    if (tri_count == 0)
+        return NULL;
+
+    MeshBVH* bvh = calloc(1, sizeof(MeshBVH));
+    if (!bvh) {
+        log_error("Failed to allocate memory for MeshBVH");
+        return NULL;
+    }
+
+    float* tri_min = malloc(tri_count * 3 * sizeof(float));
+    float* tri_max = malloc(tri_count * 3 * sizeof(float));
+    float* centroids = malloc(tri_count * 3 * sizeof(float));
+    uint32_t* order = malloc(tri_count * sizeof(uint32_t));
+    bvh->nodes = malloc((2 * tri_count - 1) * sizeof(BVHNode));
+    bvh->tri_verts = malloc(tri_count * 9 * sizeof(float));
+    bvh->tri_ids = malloc(tri_count * sizeof(uint32_t));
+
+    if (!tri_min || !tri_max || !centroids || !order || !bvh->nodes || !bvh->tri_verts ||
+        !bvh->tri_ids) {
+        log_error("Failed to allocate BVH build buffers for %zu triangles", tri_count);
+        free(tri_min);
+        free(tri_max);
+        free(centroids);
+        free(order);
+        free_mesh_bvh(bvh);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < tri_count; i++) {
+        const float *v0, *v1, *v2;
+        _mesh_triangle(mesh, i, &v0, &v1, &v2);
+        for (int a = 0; a < 3; a++) {
+            tri_min[i * 3 + a] = fminf(v0[a], fminf(v1[a], v2[a]));
+            tri_max[i * 3 + a] = fmaxf(v0[a], fmaxf(v1[a], v2[a]));
+            centroids[i * 3 + a] = (v0[a] + v1[a] + v2[a]) * (1.0f / 3.0f);
+        }
+        order[i] = (uint32_t)i;
+    }
+
+    BVHBuildContext ctx = {
+        .bvh = bvh, .tri_min = tri_min, .tri_max = tri_max, .centroids = centroids, .order = order};
+    bvh->node_count = 1;
+    bvh->tri_count = tri_count;
+    _build_node(&ctx, 0, 0, (uint32_t)tri_count, 0);
+
+    // Store triangles in leaf order so traversal reads them sequentially
+    for (size_t i = 0; i < tri_count; i++) {
+        const float *v0, *v1, *v2;
+        _mesh_triangle(mesh, order[i], &v0, &v1, &v2);
+        memcpy(bvh->tri_verts + i * 9 + 0, v0, 3 * sizeof(float));
+        memcpy(bvh->tri_verts + i * 9 + 3, v1, 3 * sizeof(float));
+        memcpy(bvh->tri_verts + i * 9 + 6, v2, 3 * sizeof(float));
+        bvh->tri_ids[i] = order[i];
+    }
+
+    free(tri_min);
+    free(tri_max);
+    free(centroids);
+    free(order);
+
+    return bvh;
+}
+
+void free_mesh_bvh(MeshBVH* bvh) {
+    if (!bvh)
+        return;
+    free(bvh->nodes);
+    free(bvh->tri_verts);
+    free(bvh->tri_ids);
+    free(bvh);
+}
+
+MeshBVH* ensure_mesh_bvh(Mesh* mesh) {
+    if (!mesh)
+        return NULL;
+    if (!mesh->bvh)
+        mesh->bvh = create_mesh_bvh(mesh);
+    return mesh->bvh;
+}
@@ -0,0 +1,50 @@
+#ifndef _BVH_H_
+#define _BVH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <cglm/cglm.h>
+
+struct Mesh;
+
+#define BVH_MAX_LEAF_TRIANGLES 4
+#define BVH_SAH_BINS           12
+#define BVH_MAX_DEPTH          64
+
+/*
+ * Mesh BVH
+ *
+ * Flattened bounding volume hierarchy over a triangle mesh in mesh-local space.
+ * Interior nodes store the index of their left child; the right child always
+ * follows it. Leaves reference a contiguous run of triangles in BVH order.
+ */
+typedef struct BVHNode {
+    vec3 min;
+    uint32_t left_first; // interior: left child index, leaf: first triangle
+    vec3 max;
+    uint16_t tri_count; // 0 for interior nodes
+    uint16_t axis;      // split axis, used for front-to-back child ordering
+} BVHNode;
+
+typedef struct MeshBVH {
+    BVHNode* nodes;
+    size_t node_count;
+
+    // Triangles reordered into leaf order: 9 floats (v0, v1, v2) per triangle
+    float* tri_verts;
+    // Original triangle index (position in mesh->indices / 3) per reordered triangle
+    uint32_t* tri_ids;
+    size_t tri_count;
+} MeshBVH;
+
+/*
+ * Lifecycle
+ */
+MeshBVH* create_mesh_bvh(const struct Mesh* mesh);
+void free_mesh_bvh(MeshBVH* bvh);
+
+// Build the mesh BVH if it does not exist yet. Not thread-safe; call before
+// sharing the mesh with worker threads. Returns NULL for non-triangle meshes.
+MeshBVH* ensure_mesh_bvh(struct Mesh* mesh);
+
+#endif // _BVH_H_
@@ -0,0 +1,233 @@
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <GL/glew.h>
+#include <cglm/cglm.h>
+
+#include "crowd.h"
+#include "intersect.h"
+#include "mesh.h"
+#include "scene.h"
+#include "uniform.h"
+#include "ext/log.h"
+
+Crowd* create_crowd(Mesh* mesh, VertexAnimation* vat) {
+    if (!mesh || !vat) {
+        log_error("Invalid input to create_crowd");
+        return NULL;
+    }
+    if (mesh->vertex_count != vat->vertex_count) {
+        log_error("Vertex animation has %zu vertices, mesh has %zu", vat->vertex_count,
+                  mesh->vertex_count);
+        return NULL;
+    }
+
+    Crowd* crowd = calloc(1, sizeof(Crowd));
+    if (!crowd) {
+        log_error("Failed to allocate crowd");
+        return NULL;
+    }
+
+    crowd->mesh = mesh;
+    crowd->vat = vat;
+    glm_vec3_zero(crowd->bounds_min);
+    glm_vec3_zero(crowd->bounds_max);
+    return crowd;
+}
+
+void free_crowd(Crowd* crowd) {
+    if (!crowd)
+        return;
+
+    if (crowd->texture)
+        glDeleteTextures(1, &crowd->texture);
+    if (crowd->buffer)
+        glDeleteBuffers(1, &crowd->buffer);
+
+    free(crowd->instances);
+    free(crowd);
+}
+
+// Rebuild the union of all instance bounds
+static void _update_crowd_bounds(Crowd* crowd) {
+    if (crowd->instance_count == 0) {
+        glm_vec3_zero(crowd->bounds_min);
+        glm_vec3_zero(crowd->bounds_max);
+        return;
+    }
+
+    glm_vec3_fill(crowd->bounds_min, FLT_MAX);
+    glm_vec3_fill(crowd->bounds_max, -FLT_MAX);
+    for (size_t i = 0; i < crowd->instance_count; i++) {
+        vec3 lo, hi;
+        aabb_transform(crowd->vat->bounds_min, crowd->vat->bounds_max,
+                       crowd->instances[i].transform, lo, hi);
+        glm_vec3_minv(crowd->bounds_min, lo, crowd->bounds_min);
+        glm_vec3_maxv(crowd->bounds_max, hi, crowd->bounds_max);
+    }
+}
+
+static int _check_clip(const Crowd* crowd, int clip) {
+    if (clip < 0 || (size_t)clip >= crowd->vat->clip_count) {
+        log_error("Crowd clip %d out of range (%zu clips)", clip, crowd->vat->clip_count);
+        return -1;
+    }
+    return 0;
+}
+
+int add_crowd_instance(Crowd* crowd, mat4 transform, int clip, float time_offset, float rate) {
+    if (!crowd || _check_clip(crowd, clip) != 0)
+        return -1;
+
+    if (crowd->instance_count >= crowd->instance_capacity) {
+        size_t new_capacity = crowd->instance_capacity ? crowd->instance_capacity * 2 : 64;
+        CrowdInstance* instances =
+            realloc(crowd->instances, new_capacity * sizeof(CrowdInstance));
+        if (!instances) {
+            log_error("Failed to grow crowd instances");
+            return -1;
+        }
+        crowd->instances = instances;
+        crowd->instance_capacity = new_capacity;
+    }
+
+    CrowdInstance* inst = &crowd->instances[crowd->instance_count];
+    glm_mat4_copy(transform, inst->transform);
+    inst->clip = clip;
+    inst->time_offset = time_offset;
+    inst->rate = rate;
+
+    // Grow the bounds in place rather than rebuilding them per add
+    vec3 lo, hi;
+    aabb_transform(crowd->vat->bounds_min, crowd->vat->bounds_max, inst->transform, lo, hi);
+    if (crowd->instance_count == 0) {
+        glm_vec3_copy(lo, crowd->bounds_min);
+        glm_vec3_copy(hi, crowd->bounds_max);
+    } else {
+        glm_vec3_minv(crowd->bounds_min, lo, crowd->bounds_min);
+        glm_vec3_maxv(crowd->bounds_max, hi, crowd->bounds_max);
+    }
+
+    crowd->dirty = true;
+    return (int)crowd->instance_count++;
+}
+
+int set_crowd_instance_transform(Crowd* crowd, size_t index, mat4 transform) {
+    if (!crowd || index >= crowd->instance_count)
+        return -1;
+
+    glm_mat4_copy(transform, crowd->instances[index].transform);
+    _update_crowd_bounds(crowd);
+    crowd->dirty = true;
+    return 0;
+}
+
+int set_crowd_instance_clip(Crowd* crowd, size_t index, int clip, float time_offset,
+                            float rate) {
+    if (!crowd || index >= crowd->instance_count || _check_clip(crowd, clip) != 0)
+        return -1;
+
+    CrowdInstance* inst = &crowd->instances[index];
+    inst->clip = clip;
+    inst->time_offset = time_offset;
+    inst->rate = rate;
+    crowd->dirty = true;
+    return 0;
+}
+
+void clear_crowd_instances(Crowd* crowd) {
+    if (!crowd)
+        return;
+
+    crowd->instance_count = 0;
+    _update_crowd_bounds(crowd);
+    crowd->dirty = true;
+}
+
+void get_crowd_world_bounds(const Crowd* crowd, vec3 out_min, vec3 out_max) {
+    if (!crowd->node) {
+        glm_vec3_copy((float*)crowd->bounds_min, out_min);
+        glm_vec3_copy((float*)crowd->bounds_max, out_max);
+        return;
+    }
+    aabb_transform((float*)crowd->bounds_min, (float*)crowd->bounds_max,
+                   crowd->node->global_transform, out_min, out_max);
+}
+
+/*
+ * GPU
+ */
+
+int upload_crowd(Crowd* crowd) {
+    if (!crowd)
+        return -1;
+
+    if (upload_vertex_animation(crowd->vat) != 0)
+        return -1;
+
+    if (!crowd->buffer) {
+        glGenBuffers(1, &crowd->buffer);
+        glGenTextures(1, &crowd->texture);
+        if (!crowd->buffer || !crowd->texture) {
+            log_error("Failed to create crowd instance buffer");
+            return -1;
+        }
+        glBindTexture(GL_TEXTURE_BUFFER, crowd->texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, crowd->buffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        crowd->dirty = true;
+    }
+
+    if (!crowd->dirty || crowd->instance_count == 0)
+        return 0;
+
+    size_t texel_count = crowd->instance_count * CROWD_TEXELS_PER_INSTANCE;
+    vec4* texels = malloc(texel_count * sizeof(vec4));
+    if (!texels) {
+        log_error("Failed to allocate crowd upload staging");
+        return -1;
+    }
+
+    // Same record layout as the bone palette: top three rows, then per-instance data
+    for (size_t i = 0; i < crowd->instance_count; i++) {
+        const CrowdInstance* inst = &crowd->instances[i];
+        vec4* out = &texels[i * CROWD_TEXELS_PER_INSTANCE];
+        for (int r = 0; r < 3; r++) {
+            out[r][0] = inst->transform[0][r];
+            out[r][1] = inst->transform[1][r];
+            out[r][2] = inst->transform[2][r];
+            out[r][3] = inst->transform[3][r];
+        }
+        out[3][0] = (float)inst->clip;
+        out[3][1] = inst->time_offset;
+        out[3][2] = inst->rate;
+        out[3][3] = 0.0f;
+    }
+
+    glBindBuffer(GL_TEXTURE_BUFFER, crowd->buffer);
+    if (crowd->instance_count > crowd->buffer_capacity) {
+        crowd->buffer_capacity = crowd->instance_capacity;
+        glBufferData(GL_TEXTURE_BUFFER,
+                     crowd->buffer_capacity * CROWD_TEXELS_PER_INSTANCE * sizeof(vec4), NULL,
+                     GL_STATIC_DRAW);
+    }
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, texel_count * sizeof(vec4), texels);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    free(texels);
+
+    crowd->dirty = false;
+    return 0;
+}
+
+void bind_crowd(Crowd* crowd, ShaderProgram* program) {
+    if (!crowd || !program || !program->uniforms)
+        return;
+
+    glActiveTexture(GL_TEXTURE0 + CROWD_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, crowd->texture);
+    glActiveTexture(GL_TEXTURE0);
+    uniform_set_int(program->uniforms, "crowdInstances", CROWD_TEXTURE_UNIT);
+
+    bind_vertex_animation(crowd->vat, program);
+}
@@ -0,0 +1,85 @@
+#ifndef _CROWD_H_
+#define _CROWD_H_
+
+#include <GL/glew.h>
+#include <cglm/cglm.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "program.h"
+#include "vat.h"
+
+#define CROWD_TEXTURE_UNIT        22
+#define CROWD_TEXELS_PER_INSTANCE 4 // 3x4 transform, then clip, time offset and rate
+
+struct Mesh;
+struct SceneNode;
+
+typedef struct CrowdInstance {
+    mat4 transform;    // Relative to the crowd's node
+    int clip;          // Index into the vertex animation's clips
+    float time_offset; // Seconds added to the clip clock, to desynchronize instances
+    float rate;        // Playback rate multiplier
+} CrowdInstance;
+
+/*
+ * Crowd
+ *
+ * Many copies of one mesh played back from a baked vertex animation, drawn with one
+ * instanced call through the engine's "pbr_vat" program. Instance records live in a
+ * texture buffer uploaded only when instances change; clip time is derived in the
+ * vertex shader from the frame time, so animated crowds cost no CPU per frame.
+ *
+ * The crowd is culled as a whole against its world bounds and lit by the lights
+ * closest to its node. It does not cast shadows.
+ */
+typedef struct Crowd {
+    struct Mesh* mesh;      // Not owned; its material shades the crowd
+    VertexAnimation* vat;   // Not owned
+    struct SceneNode* node; // Placement and lighting; NULL for the scene root
+
+    CrowdInstance* instances;
+    size_t instance_count;
+    size_t instance_capacity;
+
+    // Union of every instance's baked bounds, relative to node
+    vec3 bounds_min;
+    vec3 bounds_max;
+
+    GLuint buffer;          // GL_TEXTURE_BUFFER of instance records
+    GLuint texture;         // samplerBuffer view of buffer
+    size_t buffer_capacity; // In instances
+    bool dirty;             // Instances changed since the last upload
+} Crowd;
+
+/*
+ * Lifecycle
+ */
+Crowd* create_crowd(struct Mesh* mesh, VertexAnimation* vat);
+void free_crowd(Crowd* crowd);
+
+/*
+ * Instances
+ */
+
+// Returns the instance index, or -1
+int add_crowd_instance(Crowd* crowd, mat4 transform, int clip, float time_offset, float rate);
+int set_crowd_instance_transform(Crowd* crowd, size_t index, mat4 transform);
+int set_crowd_instance_clip(Crowd* crowd, size_t index, int clip, float time_offset,
+                            float rate);
+void clear_crowd_instances(Crowd* crowd);
+
+// World-space bounds of every instance through the whole animation
+void get_crowd_world_bounds(const Crowd* crowd, vec3 out_min, vec3 out_max);
+
+/*
+ * GPU
+ */
+
+// Upload instance records if they changed, and the vertex animation on first use
+int upload_crowd(Crowd* crowd);
+
+// Bind records and vertex animation to program
+void bind_crowd(Crowd* crowd, ShaderProgram* program);
+
+#endif // _CROWD_H_
@@ -117,6 +117,9 @@ Engine* create_engine(const char* window_title, int width, int height) {
 
     engine->async_loader = NULL;
 
+    engine->occlusion = NULL;
+    memset(&engine->render_stats, 0, sizeof(engine->render_stats));
+
     return engine;
 }
 
@@ -130,6 +133,11 @@ void free_engine(Engine* engine) {
         engine->text_renderer = NULL;
     }
 
+    if (engine->occlusion) {
+        free_occlusion_buffer(engine->occlusion);
+        engine->occlusion = NULL;
+    }
+
     // Free async loader before scenes (may have pending work)
     if (engine->async_loader) {
         free_async_loader(engine->async_loader);
@@ -648,6 +656,24 @@ static int _create_default_shaders_for_engine(Engine* engine) {
 
     add_shader_program_to_engine(engine, shadow_depth_program);
 
+    // Single-pass shadows into every cascade layer; without it each layer is its own pass
+    ShaderProgram* shadow_layered_program = create_shadow_layered_program();
+    if (shadow_layered_program) {
+        add_shader_program_to_engine(engine, shadow_layered_program);
+    }
+
+    // Crowds of baked vertex animations; without it they are not drawn
+    ShaderProgram* pbr_vat_program = create_pbr_vat_program();
+    if (pbr_vat_program) {
+        add_shader_program_to_engine(engine, pbr_vat_program);
+    }
+
+    // Skinning pre-pass; without it skinned meshes draw in bind pose
+    ShaderProgram* skinning_program = create_skinning_program();
+    if (skinning_program) {
+        add_shader_program_to_engine(engine, skinning_program);
+    }
+
     // IBL Programs
     ShaderProgram* skybox_program = create_skybox_program();
     if (skybox_program) {
@@ -659,11 +685,6 @@ static int _create_default_shaders_for_engine(Engine* engine) {
         add_shader_program_to_engine(engine, ibl_equirect_program);
     }
 
-    ShaderProgram* ibl_irradiance_program = create_ibl_irradiance_program();
-    if (ibl_irradiance_program) {
-        add_shader_program_to_engine(engine, ibl_irradiance_program);
-    }
-
     ShaderProgram* ibl_prefilter_program = create_ibl_prefilter_program();
     if (ibl_prefilter_program) {
         add_shader_program_to_engine(engine, ibl_prefilter_program);
@@ -839,6 +860,24 @@ void render_nuklear_gui(Engine* engine) {
                         }
                     }
                 }
+
+                // Shadow filter quality, to trade softness against fill rate
+                ShadowSystem* shadows = current_scene->shadow_system;
+                if (shadows) {
+                    nk_layout_row_dynamic(engine->nk_ctx, 25, 1);
+                    if (nk_combo_begin_label(engine->nk_ctx, shadow_filter_name(shadows->filter),
+                                             nk_vec2(nk_widget_width(engine->nk_ctx), 120))) {
+                        nk_layout_row_dynamic(engine->nk_ctx, 25, 1);
+                        for (int i = 0; i < SHADOW_FILTER_COUNT; i++) {
+                            if (nk_combo_item_label(engine->nk_ctx,
+                                                    shadow_filter_name((ShadowFilter)i),
+                                                    NK_TEXT_ALIGN_LEFT)) {
+                                shadows->filter = (ShadowFilter)i;
+                            }
+                        }
+                        nk_combo_end(engine->nk_ctx);
+                    }
+                }
             }
 
             // bot margin
@@ -897,8 +936,17 @@ void render_nuklear_gui(Engine* engine) {
         nk_style_push_style_item(engine->nk_ctx, &engine->nk_ctx->style.window.fixed_background,
                                  nk_style_item_color(transparent));
 
-        // Position in top-right, using window coords
+        // Position in top-right, using window coords. Culling stats go below when enabled.
+        const RenderStats* stats = &engine->render_stats;
+        bool show_culling = engine->occlusion != NULL;
+        bool show_cells = stats->cells_total > 0;
+        bool show_anim = stats->animated_instances > 0 || stats->crowd_instances > 0;
+        bool show_shadow = stats->shadow_layers > 0 || stats->shadow_tiles > 0;
+        int stat_lines = (show_culling ? 1 : 0) + (show_cells ? 1 : 0) + (show_anim ? 1 : 0) +
+                         (show_shadow ? 1 : 0);
         struct nk_rect fps_rect = nk_rect(engine->win_width - 100, 10, 90, 25);
+        if (stat_lines > 0)
+            fps_rect = nk_rect(engine->win_width - 220, 10, 210, 25 + 25 * stat_lines);
 
         if (nk_begin(engine->nk_ctx, "##fps", fps_rect,
                      NK_WINDOW_NO_SCROLLBAR | NK_WINDOW_NO_INPUT)) {
@@ -907,6 +955,52 @@ void render_nuklear_gui(Engine* engine) {
             nk_layout_row_dynamic(engine->nk_ctx, 20, 1);
             nk_text_colored(engine->nk_ctx, fps_text, strlen(fps_text), NK_TEXT_RIGHT,
                             nk_rgb(255, 255, 255));
+
+            if (show_culling) {
+                char cull_text[64];
+                snprintf(cull_text, sizeof(cull_text), "Draws %zu  Occluded %zu", stats->draws,
+                         stats->occlusion_culled);
+                nk_text_colored(engine->nk_ctx, cull_text, strlen(cull_text), NK_TEXT_RIGHT,
+                                nk_rgb(255, 255, 255));
+            }
+
+            if (show_cells) {
+                char cell_text[96];
+                snprintf(cell_text, sizeof(cell_text),
+                         "Cells %zu/%zu  Portals %zu/%zu  Culled %zu", stats->cells_visible,
+                         stats->cells_total, stats->portals_passed, stats->portals_tested,
+                         stats->cells_culled);
+                nk_text_colored(engine->nk_ctx, cell_text, strlen(cell_text), NK_TEXT_RIGHT,
+                                nk_rgb(255, 255, 255));
+            }
+
+            if (show_anim) {
+                char anim_text[64];
+                snprintf(anim_text, sizeof(anim_text), "Anim %zu  Bones %zu  Crowd %zu",
+                         stats->animated_instances, stats->bones_evaluated,
+                         stats->crowd_instances);
+                nk_text_colored(engine->nk_ctx, anim_text, strlen(anim_text), NK_TEXT_RIGHT,
+                                nk_rgb(255, 255, 255));
+            }
+
+            if (show_shadow) {
+                // Casters per cascade layer, e.g. "Casters 12/40/88  Tiles 7  Culled 310"
+                char shadow_text[64];
+                int len = snprintf(shadow_text, sizeof(shadow_text), "Casters");
+                for (size_t i = 0; i < stats->shadow_layers && len < (int)sizeof(shadow_text);
+                     i++) {
+                    len += snprintf(shadow_text + len, sizeof(shadow_text) - len, "%c%zu",
+                                    i == 0 ? ' ' : '/', stats->shadow_casters[i]);
+                }
+                if (stats->shadow_tiles > 0 && len < (int)sizeof(shadow_text))
+                    len += snprintf(shadow_text + len, sizeof(shadow_text) - len, "  Tiles %zu",
+                                    stats->shadow_tiles);
+                if (len < (int)sizeof(shadow_text))
+                    snprintf(shadow_text + len, sizeof(shadow_text) - len, "  Culled %zu",
+                             stats->shadow_culled);
+                nk_text_colored(engine->nk_ctx, shadow_text, strlen(shadow_text), NK_TEXT_RIGHT,
+                                nk_rgb(255, 255, 255));
+            }
         }
         nk_end(engine->nk_ctx);
 
@@ -933,6 +1027,19 @@ void render_nuklear_gui(Engine* engine) {
 /*
  * Render
  */
+void set_engine_occlusion_culling(Engine* engine, bool enabled) {
+    if (!engine)
+        return;
+
+    if (enabled && !engine->occlusion) {
+        engine->occlusion =
+            create_occlusion_buffer(OCCLUSION_BUFFER_WIDTH, OCCLUSION_BUFFER_HEIGHT);
+    } else if (!enabled && engine->occlusion) {
+        free_occlusion_buffer(engine->occlusion);
+        engine->occlusion = NULL;
+    }
+}
+
 void set_engine_show_wireframe(Engine* engine, bool show_wireframe) {
     if (!engine)
         return;
@@ -993,6 +1100,12 @@ void run_engine_render_loop(Engine* engine, RenderSceneFunc render_func) {
             engine->fps_update_timer = 0.0f;
         }
 
+        // Refine a progressively precomputed environment, before wireframe mode applies
+        Scene* ibl_scene = get_current_scene(engine);
+        if (ibl_scene && ibl_scene->ibl && ibl_scene->ibl->progress.active) {
+            update_progressive_ibl(ibl_scene->ibl);
+        }
+
         // Wireframe mode: use albedo-only rendering for performance
         RenderMode saved_render_mode = engine->current_render_mode;
         if (engine->show_wireframe) {
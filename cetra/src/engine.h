@@ -15,6 +15,7 @@
 #include "input.h"
 #include "async_loader.h"
 #include "text.h"
+#include "occlusion.h"
 
 #define NK_INCLUDE_FIXED_TYPES
 #define NK_INCLUDE_STANDARD_IO
@@ -34,6 +35,34 @@ typedef enum CameraMode {
 
 struct Engine;
 
+// Per-frame culling counters, reset by render_current_scene
+typedef struct RenderStats {
+    size_t meshes_considered;
+    size_t frustum_culled;
+    size_t occlusion_culled;
+    size_t draws;
+    size_t skinned_instances; // Skinned meshes drawn through instanced calls
+    size_t crowd_instances;   // Vertex-animated crowd members drawn
+
+    // Cell/portal visibility
+    size_t cells_total;
+    size_t cells_visible;
+    size_t cells_culled; // Cell subtrees skipped by the renderer
+    size_t portals_tested;
+    size_t portals_passed;
+
+    // Animation world, from its last update
+    size_t animated_instances; // Poses recomputed
+    size_t bones_evaluated;
+
+    // Shadow pass, which runs before the main pass
+    size_t shadow_layers;
+    size_t shadow_casters[MAX_SHADOW_LAYERS]; // Meshes drawn into each cascade layer
+    size_t shadow_tiles;                      // Point and spot light atlas tiles
+    size_t shadow_culled;                     // Culled caster tests, summed over layers and tiles
+    size_t shadow_rebuilds;                   // Layers redrawn into the static cache
+} RenderStats;
+
 typedef void (*CursorPositionCallback)(struct Engine* engine, double xpos, double ypos);
 typedef void (*MouseButtonCallback)(struct Engine* engine, int button, int action, int mods);
 typedef void (*KeyCallback)(struct Engine* engine, int key, int scancode, int action, int mods);
@@ -101,6 +130,10 @@ typedef struct Engine {
 
     // Text rendering
     TextRenderer* text_renderer;
+
+    // Culling
+    OcclusionBuffer* occlusion; // NULL unless occlusion culling is enabled
+    RenderStats render_stats;
 } Engine;
 
 typedef void (*RenderSceneFunc)(Engine*, Scene*);
@@ -140,6 +173,7 @@ void render_nuklear_gui(Engine* engine);
 
 // Render
 void set_engine_show_wireframe(Engine* engine, bool show_wireframe);
+void set_engine_occlusion_culling(Engine* engine, bool enabled);
 void set_engine_show_xyz(Engine* engine, bool show_xyz);
 void run_engine_render_loop(Engine* engine, RenderSceneFunc render_func);
 
@@ -0,0 +1,91 @@
+#include "animator.h"
+#include "entity.h"
+#include "component.h"
+#include "../animation_blend.h"
+#include "../animation_world.h"
+
+#include <stdlib.h>
+
+static void free_animator(void* data) {
+    Animator* animator = (Animator*)data;
+    if (!animator)
+        return;
+
+    remove_animation_instance(animator->world, animator->state);
+    free(animator);
+}
+
+Animator* entity_add_animator(Entity* entity, AnimationWorld* world, Skeleton* skeleton) {
+    if (!entity || !world || !skeleton)
+        return NULL;
+
+    if (entity_has_component(entity, COMPONENT_ANIMATOR))
+        return NULL;
+
+    Animator* animator = calloc(1, sizeof(Animator));
+    if (!animator)
+        return NULL;
+
+    animator->state = add_animation_instance(world, skeleton, entity->node);
+    if (!animator->state) {
+        free(animator);
+        return NULL;
+    }
+    animator->entity = entity;
+    animator->world = world;
+
+    // Register component
+    entity_add_component(entity, COMPONENT_ANIMATOR, animator);
+    entity_set_component_free(entity, COMPONENT_ANIMATOR, free_animator);
+
+    return animator;
+}
+
+Animator* entity_get_animator(Entity* entity) {
+    if (!entity)
+        return NULL;
+    return (Animator*)entity_get_component(entity, COMPONENT_ANIMATOR);
+}
+
+void entity_remove_animator(Entity* entity) {
+    if (!entity)
+        return;
+    entity_remove_component(entity, COMPONENT_ANIMATOR);
+}
+
+void animator_play(Animator* animator, Animation* animation, bool looping) {
+    if (!animator || !animator->state)
+        return;
+
+    set_animation_blend(animator->state, NULL);
+    set_animation(animator->state, animation);
+    animator->state->looping = looping;
+    play_animation(animator->state);
+}
+
+void animator_crossfade(Animator* animator, Animation* animation, bool looping, float seconds) {
+    if (!animator || !animator->state || !animation)
+        return;
+
+    AnimationState* state = animator->state;
+    if (!state->blend) {
+        AnimationBlend* blend = create_animation_blend(state->skeleton);
+        if (!blend)
+            return;
+
+        // Carry the single clip over as the layer to fade out from
+        if (state->current_animation) {
+            int layer =
+                add_animation_layer(blend, state->current_animation, ANIMATION_LAYER_BLEND, 1.0f);
+            if (layer >= 0) {
+                blend->layers[layer].time = state->current_time;
+                blend->layers[layer].looping = state->looping;
+                blend->layers[layer].playing = state->playing;
+            }
+        }
+        set_animation_blend(state, blend);
+    }
+
+    crossfade_animation_blend(state->blend, animation, looping, seconds);
+    play_animation(state);
+}
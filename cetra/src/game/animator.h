@@ -0,0 +1,38 @@
+#ifndef _ANIMATOR_H_
+#define _ANIMATOR_H_
+
+#include <stdbool.h>
+
+#include "../animation.h"
+
+// Forward declarations
+struct Entity;
+struct AnimationWorld;
+
+/// Animator component: an animation world instance bound to the entity's scene node
+typedef struct Animator {
+    // Owner references
+    struct Entity* entity;
+    struct AnimationWorld* world;
+
+    // Per-entity pose, owned by the world
+    AnimationState* state;
+} Animator;
+
+/// Add animator to entity, creating an instance for skeleton in world
+Animator* entity_add_animator(struct Entity* entity, struct AnimationWorld* world,
+                              Skeleton* skeleton);
+
+/// Get animator from entity
+Animator* entity_get_animator(struct Entity* entity);
+
+/// Remove animator from entity (also removes its world instance)
+void entity_remove_animator(struct Entity* entity);
+
+/// Start looping or one-shot playback of animation
+void animator_play(Animator* animator, Animation* animation, bool looping);
+
+/// Blend from the current pose to animation over seconds (switches to layered playback)
+void animator_crossfade(Animator* animator, Animation* animation, bool looping, float seconds);
+
+#endif // _ANIMATOR_H_
@@ -19,6 +19,9 @@ EntityManager* create_entity_manager(struct Game* game) {
         return NULL;
     }
 
+    em->id_map = NULL;
+    em->name_map = NULL;
+
     em->capacity = ENTITY_INITIAL_CAPACITY;
     em->count = 0;
     em->next_id = 1;
@@ -32,7 +35,7 @@ void free_entity_manager(EntityManager* em) {
         return;
     }
 
-    // Destroy all entities
+    // Destroy all entities (id_map only links them, cleared below)
     for (size_t i = 0; i < em->count; i++) {
         if (em->entities[i]) {
             // Free components
@@ -51,10 +54,61 @@ void free_entity_manager(EntityManager* em) {
         }
     }
 
+    EntityNameEntry* entry;
+    EntityNameEntry* tmp;
+    HASH_ITER(hh, em->name_map, entry, tmp) {
+        HASH_DEL(em->name_map, entry);
+        free(entry);
+    }
+
+    HASH_CLEAR(id_hh, em->id_map);
     free(em->entities);
     free(em);
 }
 
+static void _register_entity_name(EntityManager* em, Entity* entity) {
+    EntityNameEntry* entry = NULL;
+    HASH_FIND_STR(em->name_map, entity->name, entry);
+    if (entry) {
+        entry->count++;
+        return;
+    }
+
+    entry = calloc(1, sizeof(EntityNameEntry));
+    if (!entry) {
+        return;
+    }
+    memcpy(entry->name, entity->name, sizeof(entry->name));
+    entry->entity = entity;
+    entry->count = 1;
+    HASH_ADD_STR(em->name_map, name, entry);
+}
+
+static void _unregister_entity_name(EntityManager* em, Entity* entity) {
+    EntityNameEntry* entry = NULL;
+    HASH_FIND_STR(em->name_map, entity->name, entry);
+    if (!entry) {
+        return;
+    }
+
+    if (--entry->count == 0) {
+        HASH_DEL(em->name_map, entry);
+        free(entry);
+        return;
+    }
+
+    // Another entity shares the name; hand the entry over to it
+    if (entry->entity == entity) {
+        for (size_t i = 0; i < em->count; i++) {
+            Entity* other = em->entities[i];
+            if (other && other != entity && strcmp(other->name, entity->name) == 0) {
+                entry->entity = other;
+                break;
+            }
+        }
+    }
+}
+
 Entity* create_entity(EntityManager* em, const char* name) {
     if (!em) {
         return NULL;
@@ -93,7 +147,11 @@ Entity* create_entity(EntityManager* em, const char* name) {
     entity->component_mask = 0;
     entity->node = NULL;
 
+    HASH_ADD(id_hh, em->id_map, id, sizeof(entity->id), entity);
+
+    entity->slot = em->count;
     em->entities[em->count++] = entity;
+    _register_entity_name(em, entity);
 
     return entity;
 }
@@ -103,31 +161,34 @@ void destroy_entity(EntityManager* em, Entity* entity) {
         return;
     }
 
-    // Find and remove from array
-    for (size_t i = 0; i < em->count; i++) {
-        if (em->entities[i] == entity) {
-            // Free components
-            for (int c = 0; c < COMPONENT_MAX; c++) {
-                if (entity->components[c]) {
-                    Component* comp = entity->components[c];
-                    if (comp->free_func && comp->data) {
-                        comp->free_func(comp->data);
-                    } else if (comp->data) {
-                        free(comp->data);
-                    }
-                    free(comp);
-                }
-            }
-
-            // Remove from array (swap with last)
-            em->entities[i] = em->entities[em->count - 1];
-            em->entities[em->count - 1] = NULL;
-            em->count--;
+    size_t i = entity->slot;
+    if (i >= em->count || em->entities[i] != entity) {
+        return;
+    }
 
-            free(entity);
-            return;
+    // Free components
+    for (int c = 0; c < COMPONENT_MAX; c++) {
+        if (entity->components[c]) {
+            Component* comp = entity->components[c];
+            if (comp->free_func && comp->data) {
+                comp->free_func(comp->data);
+            } else if (comp->data) {
+                free(comp->data);
+            }
+            free(comp);
         }
     }
+
+    // Remove from array (swap with last)
+    em->entities[i] = em->entities[em->count - 1];
+    em->entities[i]->slot = i;
+    em->entities[em->count - 1] = NULL;
+    em->count--;
+
+    HASH_DELETE(id_hh, em->id_map, entity);
+    _unregister_entity_name(em, entity);
+
+    free(entity);
 }
 
 Entity* find_entity_by_name(EntityManager* em, const char* name) {
@@ -135,13 +196,9 @@ Entity* find_entity_by_name(EntityManager* em, const char* name) {
         return NULL;
     }
 
-    for (size_t i = 0; i < em->count; i++) {
-        if (em->entities[i] && strcmp(em->entities[i]->name, name) == 0) {
-            return em->entities[i];
-        }
-    }
-
-    return NULL;
+    EntityNameEntry* entry = NULL;
+    HASH_FIND_STR(em->name_map, name, entry);
+    return entry ? entry->entity : NULL;
 }
 
 Entity* find_entity_by_id(EntityManager* em, uint32_t id) {
@@ -149,13 +206,9 @@ Entity* find_entity_by_id(EntityManager* em, uint32_t id) {
         return NULL;
     }
 
-    for (size_t i = 0; i < em->count; i++) {
-        if (em->entities[i] && em->entities[i]->id == id) {
-            return em->entities[i];
-        }
-    }
-
-    return NULL;
+    Entity* entity = NULL;
+    HASH_FIND(id_hh, em->id_map, &id, sizeof(id), entity);
+    return entity;
 }
 
 void* entity_add_component(Entity* entity, ComponentType type, void* data) {
@@ -8,6 +8,7 @@
 
 #include "component.h"
 #include "../scene.h"
+#include "../ext/uthash.h"
 
 // Forward declarations
 struct Game;
@@ -33,8 +34,19 @@ typedef struct Entity {
 
     // Parent entity manager
     struct EntityManager* manager;
+    size_t slot; // Position in manager->entities
+
+    UT_hash_handle id_hh; // Membership in manager->id_map
 } Entity;
 
+// Hash entry for entity name lookup
+typedef struct EntityNameEntry {
+    char name[64];
+    Entity* entity; // Entity returned by find_entity_by_name
+    size_t count;   // Live entities sharing this name
+    UT_hash_handle hh;
+} EntityNameEntry;
+
 // Entity manager - owns and updates all entities
 typedef struct EntityManager {
     Entity** entities;
@@ -42,6 +54,10 @@ typedef struct EntityManager {
     size_t capacity;
     uint32_t next_id;
 
+    // Lookup tables
+    Entity* id_map; // Live entities keyed by id
+    EntityNameEntry* name_map;
+
     // Back-reference to game
     struct Game* game;
 } EntityManager;
@@ -283,6 +283,13 @@ void run_game(Game* game) {
         // Calculate interpolation alpha for smooth rendering
         double alpha = game->accumulator / game->fixed_timestep;
 
+        // Advance every animation instance once per rendered frame
+        if (!game->paused && game->scene) {
+            set_animation_world_view(game->scene->animation_world, engine->view_matrix,
+                                     engine->projection_matrix);
+            update_animation_world(game->scene->animation_world, (float)frame_time);
+        }
+
         // Shadow pass (if applicable)
         if (game->scene && game->scene->shadow_system) {
             render_shadow_depth_pass(engine, game->scene);
@@ -1,6 +1,13 @@
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <GL/glew.h>
 #include <cglm/cglm.h>
@@ -9,11 +16,24 @@
 #include "uniform.h"
 #include "engine.h"
 #include "shader_strings.h"
+#include "worker_pool.h"
 #include "ext/log.h"
 
 #define STB_IMAGE_IMPLEMENTATION_ALREADY_DONE
 #include "ext/stb_image.h"
 
+typedef struct IBLTier {
+    int cubemap_size;
+    int prefilter_size;
+    int prefilter_mips; // Down to 4x4 at every tier
+} IBLTier;
+
+static const IBLTier ibl_tiers[IBL_QUALITY_COUNT] = {
+    [IBL_QUALITY_LOW] = {512, 128, 6},
+    [IBL_QUALITY_MEDIUM] = {1024, 256, 7},
+    [IBL_QUALITY_HIGH] = {IBL_CUBEMAP_SIZE, IBL_PREFILTER_SIZE, IBL_PREFILTER_MIP_LEVELS},
+};
+
 // Unit cube vertices for skybox and cubemap face rendering
 static const float cube_vertices[] = {
     // positions
@@ -111,6 +131,480 @@ static void render_quad(IBLResources* ibl) {
     glBindVertexArray(0);
 }
 
+static void create_cubemap_texture(GLuint* texture, int size, bool mipmap) {
+    glGenTextures(1, texture);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, *texture);
+
+    for (int i = 0; i < 6; ++i) {
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, size, size, 0, GL_RGB,
+                     GL_FLOAT, NULL);
+    }
+
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+    if (mipmap) {
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        // Don't call glGenerateMipmap here - we'll render to each mip level manually
+    } else {
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+// Create prefilter cubemap with manually allocated mip levels
+static void create_prefilter_cubemap(GLuint* texture, int size, int num_mip_levels) {
+    glGenTextures(1, texture);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, *texture);
+
+    // Allocate storage for each mip level and face
+    for (int mip = 0; mip < num_mip_levels; ++mip) {
+        int mip_size = size >> mip;
+        for (int face = 0; face < 6; ++face) {
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, mip, GL_RGB16F, mip_size, mip_size,
+                         0, GL_RGB, GL_FLOAT, NULL);
+        }
+    }
+
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+/*
+ * Disk cache
+ *
+ * Header, then every face of every mip level as RGB half floats, the format the maps live
+ * in on the GPU. Native byte order; the cache is not meant to travel.
+ */
+typedef struct IblCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t prefilter_size;
+    uint32_t prefilter_mips;
+    uint32_t brdf_lut_size;
+    uint32_t reserved; // always 0; fills what would be padding, so the header is all written
+} IblCacheHeader;
+
+// Headers are written whole and compared with memcmp, so no byte may be left uninitialized
+_Static_assert(sizeof(IblCacheHeader) == 32, "IblCacheHeader must have no padding");
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ull
+#define FNV_PRIME        0x100000001b3ull
+
+static uint64_t fnv1a(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+// The tier's sizes, or only the BRDF LUT's when tier is NULL
+static uint64_t sizes_cache_key(const IBLTier* tier) {
+    const int sizes[] = {IBL_BRDF_LUT_SIZE, tier ? tier->cubemap_size : 0,
+                         tier ? tier->prefilter_size : 0, tier ? tier->prefilter_mips : 0};
+    return fnv1a(FNV_OFFSET_BASIS, sizes, sizeof(sizes));
+}
+
+// Path, file size and modification time of the HDR, so editing it in place invalidates
+static uint64_t environment_cache_key(const IBLResources* ibl, const IBLTier* tier) {
+    uint64_t key = fnv1a(sizes_cache_key(tier), ibl->hdr_filepath, strlen(ibl->hdr_filepath));
+
+    struct stat st;
+    if (stat(ibl->hdr_filepath, &st) == 0) {
+        int64_t stamp[2] = {(int64_t)st.st_size, (int64_t)st.st_mtime};
+        key = fnv1a(key, stamp, sizeof(stamp));
+    }
+    return key;
+}
+
+static IblCacheHeader make_cache_header(uint64_t key, const IBLTier* tier) {
+    IblCacheHeader header = {
+        .magic = IBL_CACHE_MAGIC,
+        .version = IBL_CACHE_VERSION,
+        .key = key,
+        .prefilter_size = tier ? tier->prefilter_size : 0,
+        .prefilter_mips = tier ? tier->prefilter_mips : 0,
+        .brdf_lut_size = IBL_BRDF_LUT_SIZE,
+        .reserved = 0,
+    };
+    return header;
+}
+
+// Create dir and any missing parents
+static int make_cache_dir(const char* dir) {
+    char path[1024];
+    if (snprintf(path, sizeof(path), "%s", dir) >= (int)sizeof(path))
+        return -1;
+
+    for (char* p = path + 1; *p; p++) {
+        if (*p != '/')
+            continue;
+        *p = '\0';
+        if (mkdir(path, 0755) != 0 && errno != EEXIST)
+            return -1;
+        *p = '/';
+    }
+    if (mkdir(path, 0755) != 0 && errno != EEXIST)
+        return -1;
+    return 0;
+}
+
+static FILE* open_cache_file(const IBLResources* ibl, const char* name, const char* mode,
+                             char* path, size_t path_size) {
+    if (!ibl->cache_dir)
+        return NULL;
+    if (mode[0] == 'w' && make_cache_dir(ibl->cache_dir) != 0) {
+        log_error("Failed to create IBL cache directory %s", ibl->cache_dir);
+        return NULL;
+    }
+    snprintf(path, path_size, "%s/%s", ibl->cache_dir, name);
+    return fopen(path, mode);
+}
+
+static size_t rgb16f_bytes(int size) {
+    return (size_t)size * (size_t)size * 3 * sizeof(uint16_t);
+}
+
+static bool write_cubemap(FILE* file, GLuint texture, int size, int mips, void* buffer) {
+    glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+    for (int mip = 0; mip < mips; ++mip) {
+        int mip_size = size >> mip;
+        for (int face = 0; face < 6; ++face) {
+            glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, mip, GL_RGB, GL_HALF_FLOAT,
+                          buffer);
+            if (fwrite(buffer, rgb16f_bytes(mip_size), 1, file) != 1)
+                return false;
+        }
+    }
+    return true;
+}
+
+// Into storage already allocated for size and mips
+static bool read_cubemap(FILE* file, GLuint texture, int size, int mips, void* buffer) {
+    glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+    for (int mip = 0; mip < mips; ++mip) {
+        int mip_size = size >> mip;
+        for (int face = 0; face < 6; ++face) {
+            if (fread(buffer, rgb16f_bytes(mip_size), 1, file) != 1)
+                return false;
+            glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, mip, 0, 0, mip_size, mip_size,
+                            GL_RGB, GL_HALF_FLOAT, buffer);
+        }
+    }
+    return true;
+}
+
+static void environment_cache_name(const IBLResources* ibl, const IBLTier* tier, char* name,
+                                   size_t size) {
+    snprintf(name, size, "env_%016llx.ibl", (unsigned long long)environment_cache_key(ibl, tier));
+}
+
+static void save_environment_cache(IBLResources* ibl, const IBLTier* tier, GLuint prefilter_map) {
+    char name[64], path[1024];
+    environment_cache_name(ibl, tier, name, sizeof(name));
+    FILE* file = open_cache_file(ibl, name, "wb", path, sizeof(path));
+    if (!file)
+        return;
+
+    void* buffer = malloc(rgb16f_bytes(tier->prefilter_size));
+    IblCacheHeader header = make_cache_header(environment_cache_key(ibl, tier), tier);
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    bool ok = buffer && fwrite(&header, sizeof(header), 1, file) == 1 &&
+              write_cubemap(file, prefilter_map, tier->prefilter_size, tier->prefilter_mips,
+                            buffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+    free(buffer);
+    if (fclose(file) != 0)
+        ok = false;
+    if (!ok) {
+        log_error("Failed to write IBL cache %s", path);
+        remove(path);
+    }
+}
+
+// Prefiltered map from a previous run into a new texture, if its key matches
+static GLuint load_environment_cache(IBLResources* ibl, const IBLTier* tier) {
+    char name[64], path[1024];
+    environment_cache_name(ibl, tier, name, sizeof(name));
+    FILE* file = open_cache_file(ibl, name, "rb", path, sizeof(path));
+    if (!file)
+        return 0;
+
+    IblCacheHeader expected = make_cache_header(environment_cache_key(ibl, tier), tier);
+    IblCacheHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(&header, &expected, sizeof(header)) != 0) {
+        fclose(file);
+        return 0;
+    }
+
+    void* buffer = malloc(rgb16f_bytes(tier->prefilter_size));
+    GLuint prefilter_map;
+    create_prefilter_cubemap(&prefilter_map, tier->prefilter_size, tier->prefilter_mips);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    bool ok = buffer && read_cubemap(file, prefilter_map, tier->prefilter_size,
+                                     tier->prefilter_mips, buffer);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    free(buffer);
+    fclose(file);
+
+    if (!ok) {
+        log_error("Truncated IBL cache %s", path);
+        glDeleteTextures(1, &prefilter_map);
+        return 0;
+    }
+    return prefilter_map;
+}
+
+/*
+ * BRDF LUT
+ *
+ * Depends on nothing but the BRDF, so every IBLResources in the process shares one texture
+ * and every run shares one cache file.
+ */
+static GLuint shared_brdf_lut = 0;
+static int shared_brdf_lut_refs = 0;
+
+static void brdf_cache_name(char* name, size_t size) {
+    snprintf(name, size, "brdf_lut_%d.ibl", IBL_BRDF_LUT_SIZE);
+}
+
+static GLuint create_brdf_lut_texture(const void* data) {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, IBL_BRDF_LUT_SIZE, IBL_BRDF_LUT_SIZE, 0, GL_RG,
+                 data ? GL_HALF_FLOAT : GL_FLOAT, data);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return texture;
+}
+
+static void save_brdf_cache(IBLResources* ibl) {
+    char name[64], path[1024];
+    brdf_cache_name(name, sizeof(name));
+    FILE* file = open_cache_file(ibl, name, "wb", path, sizeof(path));
+    if (!file)
+        return;
+
+    size_t bytes = (size_t)IBL_BRDF_LUT_SIZE * IBL_BRDF_LUT_SIZE * 2 * sizeof(uint16_t);
+    void* buffer = malloc(bytes);
+    IblCacheHeader header = make_cache_header(sizes_cache_key(NULL), NULL);
+
+    bool ok = buffer != NULL;
+    if (ok) {
+        glBindTexture(GL_TEXTURE_2D, ibl->brdf_lut);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RG, GL_HALF_FLOAT, buffer);
+        ok = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(buffer, bytes, 1, file) == 1;
+    }
+
+    free(buffer);
+    if (fclose(file) != 0)
+        ok = false;
+    if (!ok) {
+        log_error("Failed to write IBL cache %s", path);
+        remove(path);
+    }
+}
+
+static int load_brdf_cache(IBLResources* ibl) {
+    char name[64], path[1024];
+    brdf_cache_name(name, sizeof(name));
+    FILE* file = open_cache_file(ibl, name, "rb", path, sizeof(path));
+    if (!file)
+        return -1;
+
+    size_t bytes = (size_t)IBL_BRDF_LUT_SIZE * IBL_BRDF_LUT_SIZE * 2 * sizeof(uint16_t);
+    void* buffer = malloc(bytes);
+    IblCacheHeader expected = make_cache_header(sizes_cache_key(NULL), NULL);
+    IblCacheHeader header;
+
+    bool ok = buffer && fread(&header, sizeof(header), 1, file) == 1 &&
+              memcmp(&header, &expected, sizeof(header)) == 0 &&
+              fread(buffer, bytes, 1, file) == 1;
+    fclose(file);
+
+    if (ok)
+        ibl->brdf_lut = create_brdf_lut_texture(buffer);
+    free(buffer);
+    return ok ? 0 : -1;
+}
+
+static void release_brdf_lut(IBLResources* ibl) {
+    if (!ibl->brdf_lut)
+        return;
+
+    if (ibl->brdf_lut == shared_brdf_lut && --shared_brdf_lut_refs > 0) {
+        ibl->brdf_lut = 0;
+        return;
+    }
+    if (ibl->brdf_lut == shared_brdf_lut)
+        shared_brdf_lut = 0;
+    glDeleteTextures(1, &ibl->brdf_lut);
+    ibl->brdf_lut = 0;
+}
+
+/*
+ * Spherical harmonics
+ *
+ * Diffuse irradiance is smooth enough for the first three SH bands. Workers from the shared
+ * pool claim bands of rows through an atomic cursor and project them, accumulating a row at a time in single precision with cglm's vec4 ops
+ * (SIMD where cglm has it) and the rows into doubles.
+ */
+typedef struct SHProjectJob {
+    const float* rgb;
+    const float* cos_phi; // Per column
+    const float* sin_phi;
+    int width;
+    int height;
+    int first_row;
+    int end_row;
+    double sums[IBL_SH_COEFFICIENTS][3];
+} SHProjectJob;
+
+typedef struct SHProjectBatch {
+    SHProjectJob* jobs;
+    int job_count;
+    atomic_int next_job;
+} SHProjectBatch;
+
+// Real SH basis, bands 0-2
+static void sh9_basis(const vec3 d, float out[IBL_SH_COEFFICIENTS]) {
+    out[0] = 0.282095f;
+    out[1] = 0.488603f * d[1];
+    out[2] = 0.488603f * d[2];
+    out[3] = 0.488603f * d[0];
+    out[4] = 1.092548f * d[0] * d[1];
+    out[5] = 1.092548f * d[1] * d[2];
+    out[6] = 0.315392f * (3.0f * d[2] * d[2] - 1.0f);
+    out[7] = 1.092548f * d[0] * d[2];
+    out[8] = 0.546274f * (d[0] * d[0] - d[1] * d[1]);
+}
+
+static void sh_project_rows(SHProjectJob* job) {
+    float texel_angle = (2.0f * GLM_PIf / (float)job->width) * (GLM_PIf / (float)job->height);
+
+    for (int y = job->first_row; y < job->end_row; y++) {
+        // Latitude of the row, matching the equirect shader's asin(dir.y)
+        float lat = (((float)y + 0.5f) / (float)job->height - 0.5f) * GLM_PIf;
+        float cos_lat = cosf(lat);
+        float sin_lat = sinf(lat);
+
+        vec4 row[IBL_SH_COEFFICIENTS];
+        for (int k = 0; k < IBL_SH_COEFFICIENTS; k++)
+            glm_vec4_zero(row[k]);
+
+        const float* texel = job->rgb + (size_t)y * (size_t)job->width * 3;
+        for (int x = 0; x < job->width; x++, texel += 3) {
+            vec3 dir = {cos_lat * job->cos_phi[x], sin_lat, cos_lat * job->sin_phi[x]};
+            float basis[IBL_SH_COEFFICIENTS];
+            sh9_basis(dir, basis);
+
+            vec4 color = {texel[0], texel[1], texel[2], 0.0f};
+            for (int k = 0; k < IBL_SH_COEFFICIENTS; k++)
+                glm_vec4_muladds(color, basis[k], row[k]);
+        }
+
+        // Texels shrink toward the poles
+        double weight = (double)(cos_lat * texel_angle);
+        for (int k = 0; k < IBL_SH_COEFFICIENTS; k++) {
+            for (int c = 0; c < 3; c++)
+                job->sums[k][c] += (double)row[k][c] * weight;
+        }
+    }
+}
+
+// Each band keeps its own sums, so the total doesn't depend on which thread ran which band
+static void* sh_project_worker(void* arg) {
+    SHProjectBatch* batch = arg;
+    for (;;) {
+        int i = atomic_fetch_add(&batch->next_job, 1);
+        if (i >= batch->job_count)
+            break;
+        sh_project_rows(&batch->jobs[i]);
+    }
+    return NULL;
+}
+
+void project_sh9_irradiance(const float* rgb, int width, int height, int thread_count,
+                            vec3 out[IBL_SH_COEFFICIENTS]) {
+    for (int k = 0; k < IBL_SH_COEFFICIENTS; k++)
+        glm_vec3_zero(out[k]);
+    if (!rgb || width <= 0 || height <= 0)
+        return;
+
+    float* cos_phi = malloc(sizeof(float) * (size_t)width * 2);
+    if (!cos_phi) {
+        log_error("Failed to allocate SH projection tables");
+        return;
+    }
+    float* sin_phi = cos_phi + width;
+    for (int x = 0; x < width; x++) {
+        // Longitude, matching the equirect shader's atan(dir.z, dir.x)
+        float phi = (((float)x + 0.5f) / (float)width - 0.5f) * 2.0f * GLM_PIf;
+        cos_phi[x] = cosf(phi);
+        sin_phi[x] = sinf(phi);
+    }
+
+    if (thread_count > IBL_SH_MAX_THREADS)
+        thread_count = IBL_SH_MAX_THREADS;
+    if (thread_count > height)
+        thread_count = height;
+    if (thread_count < 1)
+        thread_count = 1;
+
+    SHProjectJob jobs[IBL_SH_MAX_THREADS];
+    for (int i = 0; i < thread_count; i++) {
+        jobs[i] = (SHProjectJob){
+            .rgb = rgb,
+            .cos_phi = cos_phi,
+            .sin_phi = sin_phi,
+            .width = width,
+            .height = height,
+            .first_row = (int)((long long)height * i / thread_count),
+            .end_row = (int)((long long)height * (i + 1) / thread_count),
+        };
+    }
+
+    // The calling thread works as well, and picks up any bands the pool can't
+    SHProjectBatch batch = {.jobs = jobs, .job_count = thread_count};
+    atomic_init(&batch.next_job, 0);
+    WorkerPool* pool = thread_count > 1 ? get_shared_worker_pool() : NULL;
+    run_worker_pool(pool, sh_project_worker, &batch, thread_count);
+
+    double sums[IBL_SH_COEFFICIENTS][3] = {{0.0}};
+    for (int i = 0; i < thread_count; i++) {
+        for (int k = 0; k < IBL_SH_COEFFICIENTS; k++) {
+            for (int c = 0; c < 3; c++)
+                sums[k][c] += jobs[i].sums[k][c];
+        }
+    }
+    free(cos_phi);
+
+    // Convolve with the clamped cosine lobe (pi, 2pi/3, pi/4 per band) and divide by pi,
+    // the scale the diffuse term expects
+    static const float band_scale[IBL_SH_COEFFICIENTS] = {
+        1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f,
+    };
+    for (int k = 0; k < IBL_SH_COEFFICIENTS; k++) {
+        for (int c = 0; c < 3; c++)
+            out[k][c] = (float)sums[k][c] * band_scale[k];
+    }
+}
+
 IBLResources* create_ibl_resources(void) {
     IBLResources* ibl = malloc(sizeof(IBLResources));
     if (!ibl) {
@@ -121,26 +615,56 @@ IBLResources* create_ibl_resources(void) {
 
     ibl->intensity = 1.0f;
     ibl->max_reflection_lod = (float)(IBL_PREFILTER_MIP_LEVELS - 1);
+    ibl->quality = IBL_QUALITY_HIGH;
+    ibl->cache_dir = strdup(IBL_DEFAULT_CACHE_DIR);
+
+    // Guesses for a mid-range GPU, on the slow side; measurements replace them
+    ibl->progress.budget_ms = IBL_PROGRESSIVE_BUDGET_MS;
+    ibl->progress.ms_per_texel[IBL_STAGE_ENVIRONMENT] = 1e-6;
+    ibl->progress.ms_per_texel[IBL_STAGE_PREFILTER] = 1e-4;
     ibl->initialized = false;
     ibl->precomputed = false;
 
     return ibl;
 }
 
+static void cancel_cache_readback(IBLCacheReadback* readback) {
+    if (readback->fence)
+        glDeleteSync(readback->fence);
+    if (readback->pbo)
+        glDeleteBuffers(1, &readback->pbo);
+    free(readback->data);
+    memset(readback, 0, sizeof(*readback));
+}
+
+// Drop a progressive run's pending textures and cache readback; the live maps are untouched
+static void cancel_progressive_ibl(IBLResources* ibl) {
+    IBLProgress* progress = &ibl->progress;
+    cancel_cache_readback(&progress->readback);
+    if (progress->environment_cubemap)
+        glDeleteTextures(1, &progress->environment_cubemap);
+    if (progress->prefilter_map)
+        glDeleteTextures(1, &progress->prefilter_map);
+    progress->environment_cubemap = 0;
+    progress->prefilter_map = 0;
+    progress->active = false;
+}
+
 void free_ibl_resources(IBLResources* ibl) {
     if (!ibl)
         return;
 
+    cancel_progressive_ibl(ibl);
+    if (ibl->progress.queries[0])
+        glDeleteQueries(2, ibl->progress.queries);
+
     if (ibl->hdr_texture)
         glDeleteTextures(1, &ibl->hdr_texture);
     if (ibl->environment_cubemap)
         glDeleteTextures(1, &ibl->environment_cubemap);
-    if (ibl->irradiance_map)
-        glDeleteTextures(1, &ibl->irradiance_map);
     if (ibl->prefilter_map)
         glDeleteTextures(1, &ibl->prefilter_map);
-    if (ibl->brdf_lut)
-        glDeleteTextures(1, &ibl->brdf_lut);
+    release_brdf_lut(ibl);
 
     if (ibl->capture_fbo)
         glDeleteFramebuffers(1, &ibl->capture_fbo);
@@ -158,10 +682,39 @@ void free_ibl_resources(IBLResources* ibl) {
 
     if (ibl->hdr_filepath)
         free(ibl->hdr_filepath);
+    free(ibl->cache_dir);
 
     free(ibl);
 }
 
+void set_ibl_quality(IBLResources* ibl, IBLQuality quality) {
+    if (!ibl || quality < 0 || quality >= IBL_QUALITY_COUNT)
+        return;
+
+    ibl->quality = quality;
+}
+
+const char* ibl_quality_name(IBLQuality quality) {
+    switch (quality) {
+        case IBL_QUALITY_LOW:
+            return "Low";
+        case IBL_QUALITY_MEDIUM:
+            return "Medium";
+        case IBL_QUALITY_HIGH:
+            return "High";
+        default:
+            return "Unknown";
+    }
+}
+
+void set_ibl_cache_dir(IBLResources* ibl, const char* dir) {
+    if (!ibl)
+        return;
+
+    free(ibl->cache_dir);
+    ibl->cache_dir = dir ? strdup(dir) : NULL;
+}
+
 int load_hdr_environment(IBLResources* ibl, const char* hdr_path) {
     if (!ibl || !hdr_path)
         return -1;
@@ -179,6 +732,11 @@ int load_hdr_environment(IBLResources* ibl, const char* hdr_path) {
 
     log_info("Loaded HDR: %s (%dx%d, requested 3 channels)", hdr_path, width, height);
 
+    // Replacing an environment: maps refined from the old one are of no use
+    cancel_progressive_ibl(ibl);
+    if (ibl->hdr_texture)
+        glDeleteTextures(1, &ibl->hdr_texture);
+
     glGenTextures(1, &ibl->hdr_texture);
     glBindTexture(GL_TEXTURE_2D, ibl->hdr_texture);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, data);
@@ -187,81 +745,113 @@ int load_hdr_environment(IBLResources* ibl, const char* hdr_path) {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    project_sh9_irradiance(data, width, height, cpus > 0 ? (int)cpus : 1, ibl->sh_irradiance);
+
     stbi_image_free(data);
 
     ibl->hdr_width = width;
     ibl->hdr_height = height;
+    free(ibl->hdr_filepath);
     ibl->hdr_filepath = strdup(hdr_path);
     ibl->initialized = true;
 
     return 0;
 }
 
-static int setup_capture_fbo(IBLResources* ibl, int size) {
+static void setup_capture_fbo(IBLResources* ibl) {
     if (ibl->capture_fbo == 0) {
         glGenFramebuffers(1, &ibl->capture_fbo);
     }
     if (ibl->capture_rbo == 0) {
         glGenRenderbuffers(1, &ibl->capture_rbo);
     }
+}
+
+// Depth for captures up to size texels square. Attachments may be larger than the face
+// being drawn, so storage only grows.
+static void size_capture_rbo(IBLResources* ibl, int size) {
+    if (size <= ibl->capture_rbo_size)
+        return;
 
     glBindFramebuffer(GL_FRAMEBUFFER, ibl->capture_fbo);
     glBindRenderbuffer(GL_RENDERBUFFER, ibl->capture_rbo);
     glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, size, size);
     glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER,
                               ibl->capture_rbo);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    return 0;
+    ibl->capture_rbo_size = size;
 }
 
-static void create_cubemap_texture(GLuint* texture, int size, bool mipmap) {
-    glGenTextures(1, texture);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, *texture);
-
-    for (int i = 0; i < 6; ++i) {
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, size, size, 0, GL_RGB,
-                     GL_FLOAT, NULL);
-    }
+// GL state a capture changes, put back by end_capture
+typedef struct CaptureState {
+    GLint viewport[4];
+    GLint scissor_box[4];
+    GLint framebuffer;
+    GLboolean cull_face;
+    GLboolean scissor_test;
+} CaptureState;
+
+static void begin_capture(IBLResources* ibl, CaptureState* saved) {
+    glGetIntegerv(GL_VIEWPORT, saved->viewport);
+    glGetIntegerv(GL_SCISSOR_BOX, saved->scissor_box);
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &saved->framebuffer);
+    saved->cull_face = glIsEnabled(GL_CULL_FACE);
+    saved->scissor_test = glIsEnabled(GL_SCISSOR_TEST);
+
+    setup_capture_fbo(ibl);
+    init_cube_vao(ibl);
+    init_quad_vao(ibl);
 
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    // Enable seamless cubemap sampling to avoid artifacts at face edges
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
 
-    if (mipmap) {
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        // Don't call glGenerateMipmap here - we'll render to each mip level manually
-    } else {
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // Inside-cube rendering, one strip of a face at a time
+    glDisable(GL_CULL_FACE);
+    glEnable(GL_SCISSOR_TEST);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
 }
 
-// Create prefilter cubemap with manually allocated mip levels
-static void create_prefilter_cubemap(GLuint* texture, int size, int num_mip_levels) {
-    glGenTextures(1, texture);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, *texture);
+static void end_capture(const CaptureState* saved) {
+    glBindFramebuffer(GL_FRAMEBUFFER, saved->framebuffer);
+    glViewport(saved->viewport[0], saved->viewport[1], saved->viewport[2], saved->viewport[3]);
+    glScissor(saved->scissor_box[0], saved->scissor_box[1], saved->scissor_box[2],
+              saved->scissor_box[3]);
+    if (saved->cull_face)
+        glEnable(GL_CULL_FACE);
+    if (!saved->scissor_test)
+        glDisable(GL_SCISSOR_TEST);
 
-    // Allocate storage for each mip level and face
-    for (int mip = 0; mip < num_mip_levels; ++mip) {
-        int mip_size = size >> mip;
-        for (int face = 0; face < 6; ++face) {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, mip, GL_RGB16F, mip_size, mip_size,
-                         0, GL_RGB, GL_FLOAT, NULL);
-        }
-    }
+    // Reset GL state to avoid polluting subsequent rendering
+    glUseProgram(0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+}
 
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+// Rows [y, y + rows) of one face of a size x size level of target, with the program bound
+static void draw_capture_strip(IBLResources* ibl, ShaderProgram* program, GLuint target, int mip,
+                               int size, int face, int y, int rows) {
+    mat4 views[6];
+    get_cubemap_view_matrices(views);
+    uniform_set_mat4(program->uniforms, "view", (float*)views[face]);
+
+    size_capture_rbo(ibl, size);
+    glBindFramebuffer(GL_FRAMEBUFFER, ibl->capture_fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                           GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, target, mip);
+    glViewport(0, 0, size, size);
+    glScissor(0, y, size, rows);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    render_cube(ibl);
 }
 
-static void render_equirect_to_cubemap(IBLResources* ibl, mat4 projection, const mat4 views[6]) {
+static void render_equirect_strip(IBLResources* ibl, GLuint target, int size, int face, int y,
+                                  int rows) {
     ShaderProgram* program = ibl->equirect_to_cubemap_program;
-    if (!program)
-        return;
+    mat4 projection = {{0}};
+    get_cubemap_projection(projection);
 
     glUseProgram(program->id);
 
@@ -270,82 +860,40 @@ static void render_equirect_to_cubemap(IBLResources* ibl, mat4 projection, const
     uniform_set_int(program->uniforms, "equirectangularMap", 0);
     uniform_set_mat4(program->uniforms, "projection", (float*)projection);
 
-    glViewport(0, 0, IBL_CUBEMAP_SIZE, IBL_CUBEMAP_SIZE);
-    glBindFramebuffer(GL_FRAMEBUFFER, ibl->capture_fbo);
-
-    for (int i = 0; i < 6; ++i) {
-        uniform_set_mat4(program->uniforms, "view", (float*)views[i]);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
-                               GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, ibl->environment_cubemap, 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        render_cube(ibl);
-    }
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    draw_capture_strip(ibl, program, target, 0, size, face, y, rows);
 }
 
-static void render_irradiance_convolution(IBLResources* ibl, mat4 projection, const mat4 views[6]) {
-    ShaderProgram* program = ibl->irradiance_program;
-    if (!program)
-        return;
+static void render_prefilter_strip(IBLResources* ibl, GLuint environment, GLuint target,
+                                   const IBLTier* tier, int mip, int face, int y, int rows) {
+    ShaderProgram* program = ibl->prefilter_program;
+    mat4 projection = {{0}};
+    get_cubemap_projection(projection);
 
     glUseProgram(program->id);
 
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, ibl->environment_cubemap);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, environment);
     uniform_set_int(program->uniforms, "environmentMap", 0);
     uniform_set_mat4(program->uniforms, "projection", (float*)projection);
 
-    glViewport(0, 0, IBL_IRRADIANCE_SIZE, IBL_IRRADIANCE_SIZE);
-    glBindFramebuffer(GL_FRAMEBUFFER, ibl->capture_fbo);
-    glBindRenderbuffer(GL_RENDERBUFFER, ibl->capture_rbo);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, IBL_IRRADIANCE_SIZE,
-                          IBL_IRRADIANCE_SIZE);
+    float roughness = (float)mip / (float)(tier->prefilter_mips - 1);
+    uniform_set_float(program->uniforms, "roughness", roughness);
 
-    for (int i = 0; i < 6; ++i) {
-        uniform_set_mat4(program->uniforms, "view", (float*)views[i]);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
-                               GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, ibl->irradiance_map, 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        render_cube(ibl);
-    }
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    draw_capture_strip(ibl, program, target, mip, tier->prefilter_size >> mip, face, y, rows);
 }
 
-static void render_prefilter_convolution(IBLResources* ibl, mat4 projection, const mat4 views[6]) {
-    ShaderProgram* program = ibl->prefilter_program;
-    if (!program)
-        return;
-
-    glUseProgram(program->id);
-
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, ibl->environment_cubemap);
-    uniform_set_int(program->uniforms, "environmentMap", 0);
-    uniform_set_mat4(program->uniforms, "projection", (float*)projection);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, ibl->capture_fbo);
+static void render_equirect_to_cubemap(IBLResources* ibl, GLuint target, int size) {
+    for (int i = 0; i < 6; ++i)
+        render_equirect_strip(ibl, target, size, i, 0, size);
+}
 
-    for (int mip = 0; mip < IBL_PREFILTER_MIP_LEVELS; ++mip) {
-        int mip_size = IBL_PREFILTER_SIZE >> mip;
-        glBindRenderbuffer(GL_RENDERBUFFER, ibl->capture_rbo);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, mip_size, mip_size);
-        glViewport(0, 0, mip_size, mip_size);
-
-        float roughness = (float)mip / (float)(IBL_PREFILTER_MIP_LEVELS - 1);
-        uniform_set_float(program->uniforms, "roughness", roughness);
-
-        for (int i = 0; i < 6; ++i) {
-            uniform_set_mat4(program->uniforms, "view", (float*)views[i]);
-            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
-                                   GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, ibl->prefilter_map, mip);
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-            render_cube(ibl);
-        }
+static void render_prefilter_convolution(IBLResources* ibl, GLuint environment, GLuint target,
+                                         const IBLTier* tier) {
+    for (int mip = 0; mip < tier->prefilter_mips; ++mip) {
+        int mip_size = tier->prefilter_size >> mip;
+        for (int i = 0; i < 6; ++i)
+            render_prefilter_strip(ibl, environment, target, tier, mip, i, 0, mip_size);
     }
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
 static void render_brdf_lut(IBLResources* ibl) {
@@ -354,14 +902,7 @@ static void render_brdf_lut(IBLResources* ibl) {
         return;
 
     // Create BRDF LUT texture
-    glGenTextures(1, &ibl->brdf_lut);
-    glBindTexture(GL_TEXTURE_2D, ibl->brdf_lut);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, IBL_BRDF_LUT_SIZE, IBL_BRDF_LUT_SIZE, 0, GL_RG,
-                 GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    ibl->brdf_lut = create_brdf_lut_texture(NULL);
 
     // Setup FBO for BRDF rendering
     GLuint brdf_fbo;
@@ -370,6 +911,7 @@ static void render_brdf_lut(IBLResources* ibl) {
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ibl->brdf_lut, 0);
 
     glViewport(0, 0, IBL_BRDF_LUT_SIZE, IBL_BRDF_LUT_SIZE);
+    glScissor(0, 0, IBL_BRDF_LUT_SIZE, IBL_BRDF_LUT_SIZE);
     glUseProgram(program->id);
     glClear(GL_COLOR_BUFFER_BIT);
 
@@ -379,92 +921,424 @@ static void render_brdf_lut(IBLResources* ibl) {
     glDeleteFramebuffers(1, &brdf_fbo);
 }
 
-int precompute_ibl(IBLResources* ibl, Engine* engine) {
-    if (!ibl || !engine || ibl->hdr_texture == 0) {
-        log_error("Invalid IBL state for precomputation");
-        return -1;
+// The process-wide LUT, from the cache or rendered and cached on first use
+static void acquire_brdf_lut(IBLResources* ibl) {
+    if (ibl->brdf_lut && ibl->brdf_lut == shared_brdf_lut)
+        return;
+
+    if (shared_brdf_lut == 0) {
+        if (load_brdf_cache(ibl) == 0) {
+            log_info("  Loaded BRDF LUT from cache");
+        } else {
+            log_info("  Generating BRDF LUT...");
+            render_brdf_lut(ibl);
+            save_brdf_cache(ibl);
+        }
+        shared_brdf_lut = ibl->brdf_lut;
     }
 
-    log_info("Starting IBL precomputation...");
+    ibl->brdf_lut = shared_brdf_lut;
+    shared_brdf_lut_refs++;
+}
 
-    // Get or create shader programs
+static int get_ibl_programs(IBLResources* ibl, Engine* engine) {
     ibl->equirect_to_cubemap_program =
         get_engine_shader_program_by_name(engine, "ibl_equirect_to_cube");
-    ibl->irradiance_program = get_engine_shader_program_by_name(engine, "ibl_irradiance");
     ibl->prefilter_program = get_engine_shader_program_by_name(engine, "ibl_prefilter");
     ibl->brdf_program = get_engine_shader_program_by_name(engine, "ibl_brdf");
     ibl->skybox_program = get_engine_shader_program_by_name(engine, "skybox");
 
-    if (!ibl->equirect_to_cubemap_program || !ibl->irradiance_program || !ibl->prefilter_program ||
-        !ibl->brdf_program || !ibl->skybox_program) {
+    if (!ibl->equirect_to_cubemap_program || !ibl->prefilter_program || !ibl->brdf_program ||
+        !ibl->skybox_program) {
         log_error("Failed to get IBL shader programs");
         return -1;
     }
+    return 0;
+}
 
-    // Enable seamless cubemap sampling to avoid artifacts at face edges
-    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+// Make environment and prefilter_map, both at tier, the live maps
+static void install_ibl_maps(IBLResources* ibl, GLuint environment, GLuint prefilter_map,
+                             const IBLTier* tier) {
+    if (ibl->environment_cubemap)
+        glDeleteTextures(1, &ibl->environment_cubemap);
+    if (ibl->prefilter_map)
+        glDeleteTextures(1, &ibl->prefilter_map);
 
-    // Setup FBO and VAOs
-    setup_capture_fbo(ibl, IBL_CUBEMAP_SIZE);
-    init_cube_vao(ibl);
-    init_quad_vao(ibl);
+    ibl->environment_cubemap = environment;
+    ibl->prefilter_map = prefilter_map;
+    ibl->max_reflection_lod = (float)(tier->prefilter_mips - 1);
+    ibl->precomputed = true;
+}
 
-    // Get view matrices
-    mat4 capture_views[6];
-    mat4 capture_projection = {{0}};
-    get_cubemap_view_matrices(capture_views);
-    get_cubemap_projection(capture_projection);
+int precompute_ibl(IBLResources* ibl, Engine* engine) {
+    if (!ibl || !engine || ibl->hdr_texture == 0) {
+        log_error("Invalid IBL state for precomputation");
+        return -1;
+    }
 
-    // Save current viewport and framebuffer
-    GLint prev_viewport[4];
-    GLint prev_framebuffer;
-    glGetIntegerv(GL_VIEWPORT, prev_viewport);
-    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prev_framebuffer);
+    if (get_ibl_programs(ibl, engine) != 0)
+        return -1;
 
-    // Disable face culling for inside-cube rendering
-    glDisable(GL_CULL_FACE);
+    // A blocking result supersedes any run in progress
+    cancel_progressive_ibl(ibl);
+
+    const IBLTier* tier = &ibl_tiers[ibl->quality];
+    log_info("Starting IBL precomputation (%s quality)...", ibl_quality_name(ibl->quality));
+
+    CaptureState saved;
+    begin_capture(ibl, &saved);
 
     // Step 1: Convert equirectangular to cubemap
     log_info("  Converting equirectangular to cubemap...");
-    create_cubemap_texture(&ibl->environment_cubemap, IBL_CUBEMAP_SIZE, false);
-    render_equirect_to_cubemap(ibl, capture_projection, capture_views);
+    GLuint environment;
+    create_cubemap_texture(&environment, tier->cubemap_size, false);
+    render_equirect_to_cubemap(ibl, environment, tier->cubemap_size);
 
-    // Step 2: Generate irradiance map
-    log_info("  Generating irradiance map...");
-    create_cubemap_texture(&ibl->irradiance_map, IBL_IRRADIANCE_SIZE, false);
-    render_irradiance_convolution(ibl, capture_projection, capture_views);
+    // Diffuse irradiance is already in SH from load_hdr_environment
 
-    // Step 3: Generate prefiltered map with mipmaps
-    log_info("  Generating prefiltered environment map...");
-    create_prefilter_cubemap(&ibl->prefilter_map, IBL_PREFILTER_SIZE, IBL_PREFILTER_MIP_LEVELS);
-    render_prefilter_convolution(ibl, capture_projection, capture_views);
+    // Step 2 only depends on the environment, so a previous run may have cached it
+    GLuint prefilter_map = load_environment_cache(ibl, tier);
+    if (prefilter_map) {
+        log_info("  Loaded prefiltered map from cache");
+    } else {
+        // Step 2: Generate prefiltered map with mipmaps
+        log_info("  Generating prefiltered environment map...");
+        create_prefilter_cubemap(&prefilter_map, tier->prefilter_size, tier->prefilter_mips);
+        render_prefilter_convolution(ibl, environment, prefilter_map, tier);
 
-    // Step 4: Generate BRDF LUT
-    log_info("  Generating BRDF LUT...");
-    render_brdf_lut(ibl);
+        save_environment_cache(ibl, tier, prefilter_map);
+    }
 
-    // Re-enable face culling
-    glEnable(GL_CULL_FACE);
+    // Step 3: BRDF LUT, shared by every environment
+    acquire_brdf_lut(ibl);
 
-    // Restore viewport and framebuffer
-    glViewport(prev_viewport[0], prev_viewport[1], prev_viewport[2], prev_viewport[3]);
-    glBindFramebuffer(GL_FRAMEBUFFER, prev_framebuffer);
+    end_capture(&saved);
 
-    // Reset GL state to avoid polluting subsequent rendering
-    glUseProgram(0);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    install_ibl_maps(ibl, environment, prefilter_map, tier);
+    log_info("IBL precomputation complete!");
+
+    return 0;
+}
+
+/*
+ * Progressive precomputation
+ */
+
+int begin_progressive_ibl(IBLResources* ibl, Engine* engine) {
+    if (!ibl || !engine || ibl->hdr_texture == 0) {
+        log_error("Invalid IBL state for precomputation");
+        return -1;
+    }
+
+    // Something to show right away; also cancels a previous run
+    IBLQuality target = ibl->quality;
+    ibl->quality = IBL_QUALITY_LOW;
+    int result = precompute_ibl(ibl, engine);
+    ibl->quality = target;
+    if (result != 0 || target == IBL_QUALITY_LOW)
+        return result;
+
+    IBLProgress* progress = &ibl->progress;
+    const IBLTier* tier = &ibl_tiers[target];
+
+    progress->quality = target;
+    progress->stage = IBL_STAGE_ENVIRONMENT;
+    progress->mip = 0;
+    progress->face = 0;
+    progress->row = 0;
+
+    create_cubemap_texture(&progress->environment_cubemap, tier->cubemap_size, false);
+    progress->prefilter_map = load_environment_cache(ibl, tier);
+    progress->prefilter_cached = progress->prefilter_map != 0;
+    if (!progress->prefilter_cached) {
+        create_prefilter_cubemap(&progress->prefilter_map, tier->prefilter_size,
+                                 tier->prefilter_mips);
+    }
     glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
-    glDepthFunc(GL_LESS);
-    glDepthMask(GL_TRUE);
-    glEnable(GL_DEPTH_TEST);
 
-    ibl->precomputed = true;
-    log_info("IBL precomputation complete!");
+    if (progress->queries[0] == 0)
+        glGenQueries(2, progress->queries);
 
+    progress->active = true;
+    log_info("Refining IBL to %s quality over the next frames", ibl_quality_name(target));
     return 0;
 }
 
+// Fold finished timer queries into the per-texel estimates, without waiting on the GPU
+static void read_progress_queries(IBLProgress* progress) {
+    for (int i = 0; i < 2; i++) {
+        if (!progress->query_pending[i])
+            continue;
+
+        GLint available = 0;
+        glGetQueryObjectiv(progress->queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            continue;
+
+        GLuint64 elapsed_ns = 0;
+        glGetQueryObjectui64v(progress->queries[i], GL_QUERY_RESULT, &elapsed_ns);
+        progress->query_pending[i] = false;
+
+        double measured = (double)elapsed_ns * 1e-6 / (double)progress->query_texels[i];
+        double* estimate = &progress->ms_per_texel[progress->query_stage[i]];
+        *estimate = 0.5 * (*estimate + measured);
+    }
+}
+
+static int progress_level_size(const IBLProgress* progress, const IBLTier* tier) {
+    if (progress->stage == IBL_STAGE_ENVIRONMENT)
+        return tier->cubemap_size;
+    return tier->prefilter_size >> progress->mip;
+}
+
+// Step past rows just rendered, moving on to the next face, mip and stage as they finish
+static void advance_progress(IBLProgress* progress, const IBLTier* tier, int size, int rows) {
+    progress->row += rows;
+    if (progress->row < size)
+        return;
+
+    progress->row = 0;
+    if (++progress->face < 6)
+        return;
+
+    progress->face = 0;
+    if (progress->stage == IBL_STAGE_ENVIRONMENT) {
+        progress->stage = progress->prefilter_cached ? IBL_STAGE_DONE : IBL_STAGE_PREFILTER;
+    } else if (++progress->mip == tier->prefilter_mips) {
+        progress->stage = IBL_STAGE_DONE;
+    }
+}
+
+typedef struct CacheWriteJob {
+    char path[1024];
+    unsigned char* data;
+    size_t size;
+} CacheWriteJob;
+
+// Written beside the final path and renamed, so readers never see a partial file
+static void* write_cache_file(void* arg) {
+    CacheWriteJob* job = arg;
+    char temp_path[1040];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", job->path);
+
+    FILE* file = fopen(temp_path, "wb");
+    bool ok = file && fwrite(job->data, job->size, 1, file) == 1;
+    if (file && fclose(file) != 0)
+        ok = false;
+    if (ok && rename(temp_path, job->path) != 0)
+        ok = false;
+    if (!ok) {
+        log_error("Failed to write IBL cache %s", job->path);
+        remove(temp_path);
+    }
+
+    free(job->data);
+    free(job);
+    return NULL;
+}
+
+// Start reading texture, the installed prefilter map at tier, back for the cache
+static void begin_cache_readback(IBLResources* ibl, const IBLTier* tier, GLuint texture) {
+    IBLCacheReadback* readback = &ibl->progress.readback;
+    cancel_cache_readback(readback);
+
+    if (!ibl->cache_dir)
+        return;
+    if (make_cache_dir(ibl->cache_dir) != 0) {
+        log_error("Failed to create IBL cache directory %s", ibl->cache_dir);
+        return;
+    }
+
+    size_t data_size = sizeof(IblCacheHeader);
+    for (int mip = 0; mip < tier->prefilter_mips; ++mip)
+        data_size += 6 * rgb16f_bytes(tier->prefilter_size >> mip);
+
+    readback->data = malloc(data_size);
+    if (!readback->data) {
+        log_error("Failed to allocate IBL cache readback");
+        return;
+    }
+
+    char name[64];
+    environment_cache_name(ibl, tier, name, sizeof(name));
+    snprintf(readback->path, sizeof(readback->path), "%s/%s", ibl->cache_dir, name);
+
+    IblCacheHeader header = make_cache_header(environment_cache_key(ibl, tier), tier);
+    memcpy(readback->data, &header, sizeof(header));
+    readback->offset = sizeof(header);
+    readback->data_size = data_size;
+
+    glGenBuffers(1, &readback->pbo);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback->pbo);
+    glBufferData(GL_PIXEL_PACK_BUFFER, rgb16f_bytes(tier->prefilter_size), NULL, GL_STREAM_READ);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    readback->texture = texture;
+    readback->size = tier->prefilter_size;
+    readback->mips = tier->prefilter_mips;
+    readback->active = true;
+}
+
+// Hand the collected file to a detached writer thread, or write it here if none starts
+static void submit_cache_write(IBLCacheReadback* readback) {
+    CacheWriteJob* job = malloc(sizeof(CacheWriteJob));
+    if (!job) {
+        cancel_cache_readback(readback);
+        return;
+    }
+    memcpy(job->path, readback->path, sizeof(job->path));
+    job->data = readback->data;
+    job->size = readback->data_size;
+    readback->data = NULL;
+    cancel_cache_readback(readback);
+
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&thread, &attr, write_cache_file, job) != 0)
+        write_cache_file(job);
+    pthread_attr_destroy(&attr);
+}
+
+// Collect the face in flight once the GPU is done with it, then start the next one
+static void step_cache_readback(IBLCacheReadback* readback) {
+    if (readback->fence) {
+        GLenum status = glClientWaitSync(readback->fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED)
+            return;
+
+        glDeleteSync(readback->fence);
+        readback->fence = NULL;
+
+        size_t bytes = rgb16f_bytes(readback->size >> readback->mip);
+        void* mapped = NULL;
+        if (status != GL_WAIT_FAILED) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, readback->pbo);
+            mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+            if (mapped) {
+                memcpy(readback->data + readback->offset, mapped, bytes);
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+        if (!mapped) {
+            log_error("Failed to read back IBL cache face");
+            cancel_cache_readback(readback);
+            return;
+        }
+
+        readback->offset += bytes;
+        if (++readback->face == 6) {
+            readback->face = 0;
+            if (++readback->mip == readback->mips) {
+                submit_cache_write(readback);
+                return;
+            }
+        }
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback->pbo);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, readback->texture);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + readback->face, readback->mip, GL_RGB,
+                  GL_HALF_FLOAT, NULL);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readback->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+static void finish_progressive_ibl(IBLResources* ibl, const IBLTier* tier) {
+    IBLProgress* progress = &ibl->progress;
+
+    GLuint prefilter_map = progress->prefilter_map;
+    install_ibl_maps(ibl, progress->environment_cubemap, prefilter_map, tier);
+    progress->environment_cubemap = 0;
+    progress->prefilter_map = 0;
+
+    // The run stays active while the new map is read back for the cache
+    if (!progress->prefilter_cached)
+        begin_cache_readback(ibl, tier, prefilter_map);
+    progress->active = progress->readback.active;
+
+    log_info("IBL refined to %s quality", ibl_quality_name(progress->quality));
+}
+
+bool update_progressive_ibl(IBLResources* ibl) {
+    if (!ibl || !ibl->progress.active)
+        return false;
+
+    IBLProgress* progress = &ibl->progress;
+    const IBLTier* tier = &ibl_tiers[progress->quality];
+
+    if (progress->readback.active) {
+        step_cache_readback(&progress->readback);
+        progress->active = progress->readback.active;
+        return progress->active;
+    }
+
+    read_progress_queries(progress);
+
+    CaptureState saved;
+    begin_capture(ibl, &saved);
+
+    // Time the frame's strips unless this slot's query from two frames ago is still out
+    int slot = progress->query_next;
+    bool timed = !progress->query_pending[slot];
+    if (timed)
+        glBeginQuery(GL_TIME_ELAPSED, progress->queries[slot]);
+
+    // Strips fill what is left of the budget at the measured cost, with at least one row per
+    // frame; stop at a stage boundary so a query times one stage
+    IBLProgressStage stage = progress->stage;
+    double spent_ms = 0.0;
+    long texels = 0;
+    while (progress->stage == stage) {
+        int size = progress_level_size(progress, tier);
+        int remaining = size - progress->row;
+        double row_ms = (double)size * progress->ms_per_texel[stage];
+        double affordable =
+            row_ms > 0.0 ? (progress->budget_ms - spent_ms) / row_ms : (double)remaining;
+
+        int rows = (int)fmin(affordable, (double)remaining);
+        if (rows < 1) {
+            if (texels > 0)
+                break;
+            rows = 1;
+        }
+
+        double cost_ms = row_ms * rows;
+
+        if (stage == IBL_STAGE_ENVIRONMENT) {
+            render_equirect_strip(ibl, progress->environment_cubemap, size, progress->face,
+                                  progress->row, rows);
+        } else {
+            render_prefilter_strip(ibl, progress->environment_cubemap, progress->prefilter_map,
+                                   tier, progress->mip, progress->face, progress->row, rows);
+        }
+
+        spent_ms += cost_ms;
+        texels += (long)size * rows;
+        advance_progress(progress, tier, size, rows);
+    }
+
+    if (timed) {
+        glEndQuery(GL_TIME_ELAPSED);
+        progress->query_stage[slot] = stage;
+        progress->query_texels[slot] = texels;
+        progress->query_pending[slot] = true;
+        progress->query_next = slot ^ 1;
+    }
+
+    end_capture(&saved);
+
+    if (progress->stage == IBL_STAGE_DONE)
+        finish_progressive_ibl(ibl, tier);
+
+    return progress->active;
+}
+
 void render_skybox(IBLResources* ibl, mat4 view, mat4 projection, float exposure) {
     if (!ibl || !ibl->precomputed || !ibl->skybox_program)
         return;
@@ -500,10 +1374,10 @@ void bind_ibl_textures(IBLResources* ibl, ShaderProgram* program) {
 
     UniformManager* u = program->uniforms;
 
-    // Bind irradiance map
-    glActiveTexture(GL_TEXTURE0 + IBL_IRRADIANCE_TEXTURE_UNIT);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, ibl->irradiance_map);
-    uniform_set_int(u, "irradianceMap", IBL_IRRADIANCE_TEXTURE_UNIT);
+    // Diffuse irradiance
+    GLint loc = uniform_location(u, "shIrradiance");
+    if (loc >= 0)
+        glUniform3fv(loc, IBL_SH_COEFFICIENTS, (const GLfloat*)ibl->sh_irradiance);
 
     // Bind prefiltered environment map
     glActiveTexture(GL_TEXTURE0 + IBL_PREFILTER_TEXTURE_UNIT);
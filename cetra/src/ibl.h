@@ -7,13 +7,21 @@
 
 #include "program.h"
 
+// Sizes of IBL_QUALITY_HIGH; the other tiers are in ibl.c
 #define IBL_CUBEMAP_SIZE         2048
-#define IBL_IRRADIANCE_SIZE      32
 #define IBL_PREFILTER_SIZE       1024
 #define IBL_PREFILTER_MIP_LEVELS 9
 #define IBL_BRDF_LUT_SIZE        512
 
-#define IBL_IRRADIANCE_TEXTURE_UNIT 14
+#define IBL_DEFAULT_CACHE_DIR ".cache/ibl"
+#define IBL_CACHE_MAGIC       0x4C424943u // "CIBL"
+#define IBL_CACHE_VERSION     4
+
+#define IBL_PROGRESSIVE_BUDGET_MS 2.0f
+
+#define IBL_SH_COEFFICIENTS 9 // Bands 0-2
+#define IBL_SH_MAX_THREADS  16
+
 #define IBL_PREFILTER_TEXTURE_UNIT  15
 #define IBL_BRDF_LUT_TEXTURE_UNIT   16
 #define IBL_SKYBOX_TEXTURE_UNIT     17
@@ -21,6 +29,72 @@
 // Forward declarations
 struct Engine;
 
+typedef enum IBLQuality {
+    IBL_QUALITY_LOW,
+    IBL_QUALITY_MEDIUM,
+    IBL_QUALITY_HIGH,
+    IBL_QUALITY_COUNT
+} IBLQuality;
+
+typedef enum IBLProgressStage {
+    IBL_STAGE_ENVIRONMENT, // Equirect to cubemap
+    IBL_STAGE_PREFILTER,   // Specular convolution, mip by mip
+    IBL_STAGE_DONE
+} IBLProgressStage;
+
+/*
+ * Progressive precomputation
+ *
+ * Work is cut into horizontal strips of one cubemap face, each as many rows as what is
+ * left of the frame's budget pays for (at least one row per frame). The cost per texel of
+ * each stage starts from a conservative guess and follows GL_TIME_ELAPSED queries, read
+ * back a frame or two later so the CPU never waits on them. The pending textures are at
+ * the target quality and replace the live ones when done.
+ *
+ * A freshly prefiltered map is then written to the cache without stalling: one cube face
+ * per frame is read into a pixel pack buffer, copied out once its fence has signalled, and
+ * the file is written on a detached thread.
+ */
+typedef struct IBLCacheReadback {
+    bool active;
+    GLuint texture; // Live prefilter map being read, owned by IBLResources
+    int size;       // Mip 0 size and mip count of texture
+    int mips;
+    int mip; // Face in flight, or next to read
+    int face;
+    GLuint pbo;
+    GLsync fence; // Set while a face is in flight
+
+    unsigned char* data; // Cache header, then each face as read; handed to the writer
+    size_t data_size;
+    size_t offset;
+    char path[1024];
+} IBLCacheReadback;
+
+typedef struct IBLProgress {
+    bool active;
+    IBLProgressStage stage;
+    int mip; // Next strip: prefilter mip, cube face and first row
+    int face;
+    int row;
+
+    IBLQuality quality;
+    GLuint environment_cubemap; // Pending, swapped in when complete
+    GLuint prefilter_map;
+    bool prefilter_cached;      // Prefilter map came from the cache, only the env is rendered
+
+    float budget_ms;
+    double ms_per_texel[IBL_STAGE_DONE];
+
+    GLuint queries[2]; // Ring of timer queries over each frame's strips
+    IBLProgressStage query_stage[2];
+    long query_texels[2];
+    bool query_pending[2];
+    int query_next;
+
+    IBLCacheReadback readback;
+} IBLProgress;
+
 typedef struct IBLResources {
     // Source HDR environment
     GLuint hdr_texture;
@@ -28,9 +102,12 @@ typedef struct IBLResources {
     int hdr_height;
     char* hdr_filepath;
 
+    // Diffuse irradiance over pi as SH9 coefficients, cosine lobe folded in; projected from
+    // the HDR on load
+    vec3 sh_irradiance[IBL_SH_COEFFICIENTS];
+
     // Precomputed IBL textures
     GLuint environment_cubemap; // GL_TEXTURE_CUBE_MAP (HDR converted)
-    GLuint irradiance_map;      // GL_TEXTURE_CUBE_MAP (diffuse convolution)
     GLuint prefilter_map;       // GL_TEXTURE_CUBE_MAP with mipmaps (specular)
     GLuint brdf_lut;            // GL_TEXTURE_2D (BRDF integration LUT)
 
@@ -48,7 +125,6 @@ typedef struct IBLResources {
 
     // Precomputation shader programs
     ShaderProgram* equirect_to_cubemap_program;
-    ShaderProgram* irradiance_program;
     ShaderProgram* prefilter_program;
     ShaderProgram* brdf_program;
     ShaderProgram* skybox_program;
@@ -56,6 +132,17 @@ typedef struct IBLResources {
     // Parameters
     float intensity;
     float max_reflection_lod;
+    IBLQuality quality; // Sizes used by precompute_ibl and the target of progressive runs
+
+    // Where precomputed maps are kept between runs, NULL to always recompute. Prefiltered
+    // maps are keyed by a hash of the HDR path, its size and modification time, and the
+    // quality tier's sizes; one BRDF LUT is shared by every environment.
+    char* cache_dir;
+
+    // Capture depth buffer size, reallocated only when it changes
+    int capture_rbo_size;
+
+    IBLProgress progress;
 
     // State
     bool initialized;
@@ -66,12 +153,33 @@ typedef struct IBLResources {
 IBLResources* create_ibl_resources(void);
 void free_ibl_resources(IBLResources* ibl);
 
-// HDR loading
+// HDR loading, which also projects the environment's irradiance onto SH
 int load_hdr_environment(IBLResources* ibl, const char* hdr_path);
 
-// Precomputation (run once after HDR load)
+// Project an equirect RGB float image, rows bottom to top as uploaded to GL, onto SH9
+// irradiance over pi. Rows are split across up to thread_count threads from the shared
+// worker pool.
+void project_sh9_irradiance(const float* rgb, int width, int height, int thread_count,
+                            vec3 out[IBL_SH_COEFFICIENTS]);
+
+// Cache directory for precomputed maps; NULL disables the cache
+void set_ibl_cache_dir(IBLResources* ibl, const char* dir);
+
+// Quality tier for the next precomputation; defaults to IBL_QUALITY_HIGH
+void set_ibl_quality(IBLResources* ibl, IBLQuality quality);
+const char* ibl_quality_name(IBLQuality quality);
+
+// Precomputation (run once after HDR load), blocking until done at ibl->quality
 int precompute_ibl(IBLResources* ibl, struct Engine* engine);
 
+// Precompute at IBL_QUALITY_LOW now, so the environment is usable this frame, then refine
+// to ibl->quality from update_progressive_ibl. Loading another HDR cancels the run.
+int begin_progressive_ibl(IBLResources* ibl, struct Engine* engine);
+
+// Render this frame's share of a progressive run within progress.budget_ms of GPU time, or
+// read back a face for the cache once it is installed. Returns true while work remains.
+bool update_progressive_ibl(IBLResources* ibl);
+
 // Skybox rendering
 void render_skybox(IBLResources* ibl, mat4 view, mat4 projection, float exposure);
 
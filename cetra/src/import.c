@@ -1,3 +1,4 @@
+#include <math.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -17,6 +18,7 @@
 #include "ext/log.h"
 
 #include "animation.h"
+#include "animation_compress.h"
 #include "scene.h"
 #include "mesh.h"
 #include "light.h"
@@ -507,6 +509,9 @@ Skeleton* process_ai_skeleton(const struct aiScene* ai_scene, const struct aiMes
         }
     }
 
+    // Default bone reduction masks for animation LOD
+    build_skeleton_lod(skeleton);
+
     log_info("Extracted skeleton '%s' with %zu bones", skeleton->name, skeleton->bone_count);
     return skeleton;
 }
@@ -599,6 +604,15 @@ void process_ai_mesh_bones(Mesh* mesh, const struct aiMesh* ai_mesh, Skeleton* s
     log_info("Processed %u bones for mesh with %zu vertices", ai_mesh->mNumBones, vert_count);
 }
 
+static AnimationCompressionConfig import_compression;
+static bool import_compression_enabled = false;
+
+void set_import_animation_compression(const AnimationCompressionConfig* config) {
+    import_compression_enabled = config != NULL;
+    if (config)
+        import_compression = *config;
+}
+
 /*
  * Extract animations from aiScene
  */
@@ -665,6 +679,15 @@ void process_ai_animations(const struct aiScene* ai_scene, Scene* scene, Skeleto
             }
         }
 
+        if (import_compression_enabled && compress_animation(animation, &import_compression) == 0) {
+            const AnimationCompressionStats* stats = &animation->compressed->stats;
+            log_info("Compressed animation '%s': %zu -> %zu bytes (%.1fx), %zu -> %zu keys, "
+                     "max error %.5f pos / %.5f rad / %.5f scale",
+                     animation->name, stats->source_bytes, stats->compressed_bytes, stats->ratio,
+                     stats->source_keys, stats->kept_keys, stats->max_position_error,
+                     stats->max_rotation_error, stats->max_scale_error);
+        }
+
         add_animation_to_scene(scene, animation);
         log_info("Extracted animation '%s': %.2f ticks @ %.2f tps (%zu channels)", animation->name,
                  animation->duration, animation->ticks_per_second, animation->channel_count);
@@ -747,16 +770,17 @@ void process_ai_lights(const struct aiScene* scene, Light*** lights, size_t* num
                 light->constant = ai_light->mAttenuationConstant;
                 light->linear = ai_light->mAttenuationLinear;
                 light->quadratic = ai_light->mAttenuationQuadratic;
-                light->cutOff = ai_light->mAngleInnerCone;
-                light->outerCutOff = ai_light->mAngleOuterCone;
+                // Assimp gives cone angles in radians; lights store their cosines
+                light->cutOff = cosf(ai_light->mAngleInnerCone);
+                light->outerCutOff = cosf(ai_light->mAngleOuterCone);
                 break;
             default:
                 light->type = LIGHT_AREA;
                 light->constant = ai_light->mAttenuationConstant;
                 light->linear = ai_light->mAttenuationLinear;
                 light->quadratic = ai_light->mAttenuationQuadratic;
-                light->cutOff = ai_light->mAngleInnerCone;
-                light->outerCutOff = ai_light->mAngleOuterCone;
+                light->cutOff = cosf(ai_light->mAngleInnerCone);
+                light->outerCutOff = cosf(ai_light->mAngleOuterCone);
                 break;
         }
 
@@ -829,6 +853,26 @@ static void copy_aiMatrix_to_mat4(const struct aiMatrix4x4* from, mat4 to) {
     to[3][3] = from->d4;
 }
 
+// Cell/portal role from the node's CELL_ROLE_METADATA user property, else from its name
+static CellRole _ai_node_cell_role(const struct aiNode* ai_node) {
+    const struct aiMetadata* meta = ai_node->mMetaData;
+    if (meta) {
+        for (unsigned int i = 0; i < meta->mNumProperties; i++) {
+            if (strcmp(meta->mKeys[i].data, CELL_ROLE_METADATA) != 0)
+                continue;
+            if (meta->mValues[i].mType != AI_AISTRING || !meta->mValues[i].mData)
+                break;
+            const struct aiString* value = (const struct aiString*)meta->mValues[i].mData;
+            if (strcmp(value->data, "cell") == 0)
+                return CELL_ROLE_CELL;
+            if (strcmp(value->data, "portal") == 0)
+                return CELL_ROLE_PORTAL;
+            break;
+        }
+    }
+    return cell_role_from_name(ai_node->mName.data);
+}
+
 SceneNode* process_ai_node(Scene* scene, struct aiNode* ai_node, const struct aiScene* ai_scene,
                            TexturePool* tex_pool) {
     if (!scene || !ai_node || !ai_scene || !tex_pool)
@@ -892,7 +936,11 @@ SceneNode* process_ai_node(Scene* scene, struct aiNode* ai_node, const struct ai
         }
     }
 
-    node->name = safe_strdup(ai_node->mName.data);
+    set_node_name(node, ai_node->mName.data);
+
+    CellRole cell_role = _ai_node_cell_role(ai_node);
+    if (cell_role != CELL_ROLE_NONE)
+        set_node_cell_role(scene, node, cell_role);
 
     struct aiMatrix4x4 ai_mat = ai_node->mTransformation;
     copy_aiMatrix_to_mat4(&ai_mat, node->original_transform);
@@ -924,11 +972,17 @@ Scene* create_scene_from_model_path(const char* path, const char* texture_direct
     set_texture_pool_directory(tex_pool, texture_directory);
 
     // Process lights and cameras
-    process_ai_lights(ai_scene, &scene->lights, &scene->light_count);
-    process_ai_cameras(ai_scene, &scene->cameras, &scene->camera_count);
+    Light** lights = NULL;
+    size_t light_count = 0;
+    Camera** cameras = NULL;
+    size_t camera_count = 0;
+    process_ai_lights(ai_scene, &lights, &light_count);
+    process_ai_cameras(ai_scene, &cameras, &camera_count);
+    set_scene_lights(scene, lights, light_count);
+    set_scene_cameras(scene, cameras, camera_count);
 
     // Process the root node (this also extracts skeletons and bone weights)
-    scene->root_node = process_ai_node(scene, ai_scene->mRootNode, ai_scene, tex_pool);
+    set_scene_root_node(scene, process_ai_node(scene, ai_scene->mRootNode, ai_scene, tex_pool));
 
     associate_cameras_and_lights_with_nodes(scene->root_node, scene);
 
@@ -1007,7 +1061,11 @@ static SceneNode* process_ai_node_async(Scene* scene, struct aiNode* ai_node,
         }
     }
 
-    node->name = safe_strdup(ai_node->mName.data);
+    set_node_name(node, ai_node->mName.data);
+
+    CellRole cell_role = _ai_node_cell_role(ai_node);
+    if (cell_role != CELL_ROLE_NONE)
+        set_node_cell_role(scene, node, cell_role);
 
     struct aiMatrix4x4 ai_mat = ai_node->mTransformation;
     copy_aiMatrix_to_mat4(&ai_mat, node->original_transform);
@@ -1045,12 +1103,18 @@ Scene* create_scene_from_model_path_async(const char* path, const char* texture_
     set_texture_pool_directory(tex_pool, texture_directory);
 
     // Process lights and cameras
-    process_ai_lights(ai_scene, &scene->lights, &scene->light_count);
-    process_ai_cameras(ai_scene, &scene->cameras, &scene->camera_count);
+    Light** lights = NULL;
+    size_t light_count = 0;
+    Camera** cameras = NULL;
+    size_t camera_count = 0;
+    process_ai_lights(ai_scene, &lights, &light_count);
+    process_ai_cameras(ai_scene, &cameras, &camera_count);
+    set_scene_lights(scene, lights, light_count);
+    set_scene_cameras(scene, cameras, camera_count);
 
     // Process the root node with async texture loading
-    scene->root_node =
-        process_ai_node_async(scene, ai_scene->mRootNode, ai_scene, tex_pool, loader);
+    set_scene_root_node(
+        scene, process_ai_node_async(scene, ai_scene->mRootNode, ai_scene, tex_pool, loader));
 
     associate_cameras_and_lights_with_nodes(scene->root_node, scene);
 
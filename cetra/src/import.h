@@ -13,6 +13,7 @@
 #include "scene.h"
 #include "texture.h"
 #include "animation.h"
+#include "animation_compress.h"
 
 // Forward declaration
 struct AsyncLoader;
@@ -41,4 +42,7 @@ Scene* create_scene_from_model_path_async(const char* path, const char* texture_
 // Returns number of animations loaded, or -1 on error
 int load_animations_from_file(Scene* scene, Skeleton* skeleton, const char* filepath);
 
+// Compress animations extracted by subsequent imports; NULL turns compression off (default)
+void set_import_animation_compression(const AnimationCompressionConfig* config);
+
 #endif // IMPORT_H
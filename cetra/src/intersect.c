@@ -1,6 +1,9 @@
 
 #include <float.h>
 #include <math.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
 
 #include <GL/glew.h>
 #include <cglm/cglm.h>
@@ -8,6 +11,8 @@
 #include "intersect.h"
 #include "scene.h"
 #include "mesh.h"
+#include "bvh.h"
+#include "worker_pool.h"
 #include "ext/log.h"
 
 void compute_ray_from_screen(float screen_x, float screen_y, int fb_width, int fb_height,
@@ -49,6 +54,23 @@ bool ray_aabb_intersection(vec3 ray_origin, vec3 ray_dir, vec3 bbox_min, vec3 bb
     return (*t_near <= *t_far) && (*t_far >= 0.0f);
 }
 
+// Vertices of an animated skinned mesh skinned on the CPU, or NULL to use the bind pose
+static float* _pose_mesh_vertices(const SceneNode* node, const Mesh* mesh) {
+    AnimationState* state = mesh->is_skinned ? get_node_animation_state(node) : NULL;
+    if (!state || state->active_bone_count == 0 || !mesh->bone_ids || !mesh->bone_weights)
+        return NULL;
+
+    float* posed = malloc(mesh->vertex_count * 3 * sizeof(float));
+    if (!posed)
+        return NULL;
+
+    for (size_t v = 0; v < mesh->vertex_count; v++) {
+        skin_mesh_vertex(mesh, state->bone_matrices, state->active_bone_count, v, &posed[v * 3],
+                         NULL);
+    }
+    return posed;
+}
+
 static void traverse_and_pick(SceneNode* node, vec3 ray_origin, vec3 ray_dir, float* min_distance,
                               SceneNode** picked_node) {
     if (!node)
@@ -66,15 +88,21 @@ static void traverse_and_pick(SceneNode* node, vec3 ray_origin, vec3 ray_dir, fl
         Mesh* mesh = node->meshes[i];
         float t_near, t_far;
 
-        if (ray_aabb_intersection(local_ray_origin, local_ray_dir, mesh->aabb.min, mesh->aabb.max,
-                                  &t_near, &t_far)) {
+        // Animated skinned meshes are tested in their current pose
+        vec3 box_min, box_max;
+        get_node_mesh_aabb(node, mesh, box_min, box_max);
+        if (ray_aabb_intersection(local_ray_origin, local_ray_dir, box_min, box_max, &t_near,
+                                  &t_far)) {
             if (t_near < *min_distance && t_near > 0) {
+                float* posed = _pose_mesh_vertices(node, mesh);
+                const float* vertices = posed ? posed : mesh->vertices;
+
                 // Test individual triangles for precise hit
                 for (size_t j = 0; j < mesh->index_count; j += 3) {
                     vec3 v0, v1, v2;
-                    glm_vec3_copy(mesh->vertices + mesh->indices[j] * 3, v0);
-                    glm_vec3_copy(mesh->vertices + mesh->indices[j + 1] * 3, v1);
-                    glm_vec3_copy(mesh->vertices + mesh->indices[j + 2] * 3, v2);
+                    glm_vec3_copy((float*)vertices + mesh->indices[j] * 3, v0);
+                    glm_vec3_copy((float*)vertices + mesh->indices[j + 1] * 3, v1);
+                    glm_vec3_copy((float*)vertices + mesh->indices[j + 2] * 3, v2);
 
                     float t;
                     if (glm_ray_triangle(local_ray_origin, local_ray_dir, v0, v1, v2, &t) &&
@@ -83,6 +111,7 @@ static void traverse_and_pick(SceneNode* node, vec3 ray_origin, vec3 ray_dir, fl
                         *picked_node = node;
                     }
                 }
+                free(posed);
             }
         }
     }
@@ -119,6 +148,297 @@ RayPickResult pick_scene_node(SceneNode* root_node, vec3 ray_origin, vec3 ray_di
     return result;
 }
 
+/*
+ * Batched ray queries
+ */
+
+typedef struct {
+    SceneNode* node;
+    Mesh* mesh;
+    const MeshBVH* bvh;
+    mat4 inv_transform;
+    vec3 world_min;
+    vec3 world_max;
+} RayInstance;
+
+typedef struct {
+    RayInstance* items;
+    size_t count;
+    size_t capacity;
+} RayInstanceList;
+
+// Structure-of-arrays ray packet; lane loops are written branch-free so they vectorize
+typedef struct {
+    float ox[RAY_PACKET_SIZE], oy[RAY_PACKET_SIZE], oz[RAY_PACKET_SIZE];
+    float dx[RAY_PACKET_SIZE], dy[RAY_PACKET_SIZE], dz[RAY_PACKET_SIZE];
+    float ix[RAY_PACKET_SIZE], iy[RAY_PACKET_SIZE], iz[RAY_PACKET_SIZE];
+    float t[RAY_PACKET_SIZE]; // Closest hit so far (shared across instances)
+    float u[RAY_PACKET_SIZE], v[RAY_PACKET_SIZE];
+    int32_t tri[RAY_PACKET_SIZE]; // BVH-order triangle hit within the current instance
+} RayPacket;
+
+typedef struct {
+    const RayInstance* instances;
+    size_t instance_count;
+    const Ray* rays;
+    RayHit* hits;
+    size_t ray_count;
+    atomic_size_t next_ray;
+    atomic_size_t hit_count;
+} RayBatch;
+
+static int _collect_ray_instances(SceneNode* node, RayInstanceList* list) {
+    if (!node)
+        return 0;
+
+    for (size_t i = 0; i < node->mesh_count; i++) {
+        Mesh* mesh = node->meshes[i];
+        MeshBVH* bvh = ensure_mesh_bvh(mesh);
+        if (!bvh)
+            continue;
+
+        if (list->count >= list->capacity) {
+            size_t new_capacity = list->capacity ? list->capacity * 2 : 64;
+            RayInstance* items = realloc(list->items, new_capacity * sizeof(RayInstance));
+            if (!items) {
+                log_error("Failed to grow ray instance list");
+                return -1;
+            }
+            list->items = items;
+            list->capacity = new_capacity;
+        }
+
+        RayInstance* inst = &list->items[list->count++];
+        inst->node = node;
+        inst->mesh = mesh;
+        inst->bvh = bvh;
+        glm_mat4_inv(node->global_transform, inst->inv_transform);
+        aabb_transform(bvh->nodes[0].min, bvh->nodes[0].max, node->global_transform,
+                       inst->world_min, inst->world_max);
+    }
+
+    for (size_t i = 0; i < node->children_count; i++) {
+        if (_collect_ray_instances(node->children[i], list) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+// Returns a lane mask of rays entering [bmin, bmax] before their current closest hit
+static unsigned _packet_slab_test(const RayPacket* p, const float* bmin, const float* bmax) {
+    unsigned mask = 0;
+    for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+        float tx0 = (bmin[0] - p->ox[i]) * p->ix[i];
+        float tx1 = (bmax[0] - p->ox[i]) * p->ix[i];
+        float ty0 = (bmin[1] - p->oy[i]) * p->iy[i];
+        float ty1 = (bmax[1] - p->oy[i]) * p->iy[i];
+        float tz0 = (bmin[2] - p->oz[i]) * p->iz[i];
+        float tz1 = (bmax[2] - p->oz[i]) * p->iz[i];
+        float tmin = fmaxf(fmaxf(fminf(tx0, tx1), fminf(ty0, ty1)), fmaxf(fminf(tz0, tz1), 0.0f));
+        float tmax = fminf(fminf(fmaxf(tx0, tx1), fmaxf(ty0, ty1)), fminf(fmaxf(tz0, tz1), p->t[i]));
+        mask |= (unsigned)(tmin <= tmax) << i;
+    }
+    return mask;
+}
+
+// Moller-Trumbore against one triangle for every lane in the packet
+static void _packet_triangle_test(RayPacket* p, const float* tri, int32_t tri_index) {
+    const float e1x = tri[3] - tri[0], e1y = tri[4] - tri[1], e1z = tri[5] - tri[2];
+    const float e2x = tri[6] - tri[0], e2y = tri[7] - tri[1], e2z = tri[8] - tri[2];
+
+    for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+        float px = p->dy[i] * e2z - p->dz[i] * e2y;
+        float py = p->dz[i] * e2x - p->dx[i] * e2z;
+        float pz = p->dx[i] * e2y - p->dy[i] * e2x;
+        float det = e1x * px + e1y * py + e1z * pz;
+        float inv_det = 1.0f / det;
+
+        float tx = p->ox[i] - tri[0], ty = p->oy[i] - tri[1], tz = p->oz[i] - tri[2];
+        float u = (tx * px + ty * py + tz * pz) * inv_det;
+
+        float qx = ty * e1z - tz * e1y;
+        float qy = tz * e1x - tx * e1z;
+        float qz = tx * e1y - ty * e1x;
+        float v = (p->dx[i] * qx + p->dy[i] * qy + p->dz[i] * qz) * inv_det;
+        float t = (e2x * qx + e2y * qy + e2z * qz) * inv_det;
+
+        bool hit = fabsf(det) > 1e-12f && u >= 0.0f && v >= 0.0f && u + v <= 1.0f &&
+                   t > 1e-6f && t < p->t[i];
+        p->t[i] = hit ? t : p->t[i];
+        p->u[i] = hit ? u : p->u[i];
+        p->v[i] = hit ? v : p->v[i];
+        p->tri[i] = hit ? tri_index : p->tri[i];
+    }
+}
+
+static void _trace_packet_instance(RayPacket* p, const RayInstance* inst) {
+    const MeshBVH* bvh = inst->bvh;
+    uint32_t stack[2 * BVH_MAX_DEPTH + 2];
+    int stack_size = 0;
+
+    if (!_packet_slab_test(p, bvh->nodes[0].min, bvh->nodes[0].max))
+        return;
+    stack[stack_size++] = 0;
+
+    while (stack_size > 0) {
+        const BVHNode* node = &bvh->nodes[stack[--stack_size]];
+
+        if (node->tri_count > 0) {
+            for (uint32_t i = 0; i < node->tri_count; i++) {
+                uint32_t tri = node->left_first + i;
+                _packet_triangle_test(p, bvh->tri_verts + tri * 9, (int32_t)tri);
+            }
+            continue;
+        }
+
+        uint32_t left = node->left_first;
+        bool hit_left = _packet_slab_test(p, bvh->nodes[left].min, bvh->nodes[left].max) != 0;
+        bool hit_right =
+            _packet_slab_test(p, bvh->nodes[left + 1].min, bvh->nodes[left + 1].max) != 0;
+
+        // Visit the near child first, judged by the first lane's direction on the split axis
+        const float* dir = node->axis == 0 ? p->dx : (node->axis == 1 ? p->dy : p->dz);
+        uint32_t near_child = dir[0] >= 0.0f ? left : left + 1;
+        uint32_t far_child = dir[0] >= 0.0f ? left + 1 : left;
+        bool hit_near = near_child == left ? hit_left : hit_right;
+        bool hit_far = near_child == left ? hit_right : hit_left;
+
+        if (hit_far)
+            stack[stack_size++] = far_child;
+        if (hit_near)
+            stack[stack_size++] = near_child;
+    }
+}
+
+static void _trace_packet(RayBatch* batch, size_t first, size_t count) {
+    RayPacket world, local;
+
+    for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+        // Pad unused lanes with rays that can never hit
+        const Ray* ray = &batch->rays[first + ((size_t)i < count ? (size_t)i : 0)];
+        float t_max = ray->t_max > 0.0f ? ray->t_max : FLT_MAX;
+        world.ox[i] = ray->origin[0];
+        world.oy[i] = ray->origin[1];
+        world.oz[i] = ray->origin[2];
+        world.dx[i] = ray->dir[0];
+        world.dy[i] = ray->dir[1];
+        world.dz[i] = ray->dir[2];
+        world.ix[i] = 1.0f / ray->dir[0];
+        world.iy[i] = 1.0f / ray->dir[1];
+        world.iz[i] = 1.0f / ray->dir[2];
+        world.t[i] = (size_t)i < count ? t_max : -1.0f;
+    }
+
+    for (size_t n = 0; n < batch->instance_count; n++) {
+        const RayInstance* inst = &batch->instances[n];
+        if (!_packet_slab_test(&world, inst->world_min, inst->world_max))
+            continue;
+
+        // Rays are moved into mesh space without renormalizing, so t stays comparable
+        for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+            vec3 o = {world.ox[i], world.oy[i], world.oz[i]};
+            vec3 d = {world.dx[i], world.dy[i], world.dz[i]};
+            glm_mat4_mulv3((vec4*)inst->inv_transform, o, 1.0f, o);
+            glm_mat4_mulv3((vec4*)inst->inv_transform, d, 0.0f, d);
+            local.ox[i] = o[0];
+            local.oy[i] = o[1];
+            local.oz[i] = o[2];
+            local.dx[i] = d[0];
+            local.dy[i] = d[1];
+            local.dz[i] = d[2];
+            local.ix[i] = 1.0f / d[0];
+            local.iy[i] = 1.0f / d[1];
+            local.iz[i] = 1.0f / d[2];
+            local.t[i] = world.t[i];
+            local.tri[i] = -1;
+        }
+
+        _trace_packet_instance(&local, inst);
+
+        for (size_t i = 0; i < count; i++) {
+            if (local.tri[i] < 0)
+                continue;
+            RayHit* hit = &batch->hits[first + i];
+            world.t[i] = local.t[i];
+            hit->node = inst->node;
+            hit->mesh = inst->mesh;
+            hit->distance = local.t[i];
+            hit->triangle = (int)inst->bvh->tri_ids[local.tri[i]];
+            hit->u = local.u[i];
+            hit->v = local.v[i];
+            hit->hit = true;
+        }
+    }
+}
+
+static void* _ray_worker_func(void* arg) {
+    RayBatch* batch = (RayBatch*)arg;
+    size_t hit_count = 0;
+
+    for (;;) {
+        size_t start = atomic_fetch_add(&batch->next_ray, RAY_QUERY_CHUNK_SIZE);
+        if (start >= batch->ray_count)
+            break;
+        size_t end = start + RAY_QUERY_CHUNK_SIZE;
+        if (end > batch->ray_count)
+            end = batch->ray_count;
+
+        for (size_t first = start; first < end; first += RAY_PACKET_SIZE) {
+            size_t count = end - first < RAY_PACKET_SIZE ? end - first : RAY_PACKET_SIZE;
+            _trace_packet(batch, first, count);
+            for (size_t i = 0; i < count; i++)
+                hit_count += batch->hits[first + i].hit;
+        }
+    }
+
+    atomic_fetch_add(&batch->hit_count, hit_count);
+    return NULL;
+}
+
+size_t intersect_rays(SceneNode* root_node, const Ray* rays, RayHit* out_hits, size_t ray_count,
+                      int thread_count) {
+    if (!rays || !out_hits || ray_count == 0)
+        return 0;
+
+    for (size_t i = 0; i < ray_count; i++) {
+        out_hits[i] = (RayHit){.distance = FLT_MAX, .triangle = -1};
+    }
+
+    // BVHs are built here on the calling thread so workers only read shared data
+    RayInstanceList list = {0};
+    if (_collect_ray_instances(root_node, &list) != 0 || list.count == 0) {
+        free(list.items);
+        return 0;
+    }
+
+    RayBatch batch = {
+        .instances = list.items,
+        .instance_count = list.count,
+        .rays = rays,
+        .hits = out_hits,
+        .ray_count = ray_count,
+    };
+    atomic_init(&batch.next_ray, 0);
+    atomic_init(&batch.hit_count, 0);
+
+    if (thread_count <= 0)
+        thread_count = RAY_QUERY_DEFAULT_THREADS;
+    if (thread_count > RAY_QUERY_MAX_THREADS)
+        thread_count = RAY_QUERY_MAX_THREADS;
+
+    // No point waking threads for less than a chunk each
+    size_t chunks = (ray_count + RAY_QUERY_CHUNK_SIZE - 1) / RAY_QUERY_CHUNK_SIZE;
+    if ((size_t)thread_count > chunks)
+        thread_count = (int)chunks;
+
+    // The calling thread works as well
+    WorkerPool* pool = thread_count > 1 ? get_shared_worker_pool() : NULL;
+    run_worker_pool(pool, _ray_worker_func, &batch, thread_count);
+
+    free(list.items);
+    return atomic_load(&batch.hit_count);
+}
+
 void ray_point_at_distance(vec3 ray_origin, vec3 ray_dir, float distance, vec3 out_point) {
     glm_vec3_scale(ray_dir, distance, out_point);
     glm_vec3_add(ray_origin, out_point, out_point);
@@ -217,12 +537,7 @@ void aabb_transform(vec3 aabb_min, vec3 aabb_max, mat4 transform, vec3 out_min,
     out_max[2] = new_center4[2] + new_extents[2];
 }
 
-bool frustum_test_aabb_transformed(const Frustum* frustum, vec3 aabb_min, vec3 aabb_max,
-                                   mat4 model) {
-    // Transform AABB to world space
-    vec3 world_min = {0}, world_max = {0};
-    aabb_transform(aabb_min, aabb_max, model, world_min, world_max);
-
+bool frustum_test_aabb(const Frustum* frustum, vec3 world_min, vec3 world_max) {
     // Test against each frustum plane using the p-vertex method
     // For each plane, find the vertex most in the direction of the plane normal (p-vertex)
     // If p-vertex is behind the plane, the AABB is completely outside
@@ -246,3 +561,12 @@ bool frustum_test_aabb_transformed(const Frustum* frustum, vec3 aabb_min, vec3 a
 
     return true; // AABB is inside or intersects the frustum
 }
+
+bool frustum_test_aabb_transformed(const Frustum* frustum, vec3 aabb_min, vec3 aabb_max,
+                                   mat4 model) {
+    // Transform AABB to world space
+    vec3 world_min = {0}, world_max = {0};
+    aabb_transform(aabb_min, aabb_max, model, world_min, world_max);
+
+    return frustum_test_aabb(frustum, world_min, world_max);
+}
@@ -2,10 +2,18 @@
 #define INTERSECT_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <cglm/cglm.h>
 
 // Forward declarations to avoid header dependency issues
 struct SceneNode;
+struct Mesh;
+
+// Batched ray queries
+#define RAY_PACKET_SIZE           8  // Rays traced together through each BVH
+#define RAY_QUERY_CHUNK_SIZE      64 // Rays claimed by a worker at a time
+#define RAY_QUERY_DEFAULT_THREADS 4
+#define RAY_QUERY_MAX_THREADS     16
 
 // Frustum with 6 planes (left, right, bottom, top, near, far)
 // Each plane stored as vec4: (a, b, c, d) where ax + by + cz + d = 0
@@ -28,6 +36,22 @@ typedef struct {
     bool hit;
 } RayPickResult;
 
+// World-space ray for batched queries. t_max <= 0 means unbounded.
+typedef struct {
+    vec3 origin;
+    vec3 dir;
+    float t_max;
+} Ray;
+
+typedef struct {
+    struct SceneNode* node;
+    struct Mesh* mesh;
+    float distance; // Ray parameter t (world distance when dir is unit length)
+    int triangle;   // Triangle index into mesh->indices / 3, -1 on miss
+    float u, v;     // Barycentrics: p = (1 - u - v) * v0 + u * v1 + v * v2
+    bool hit;
+} RayHit;
+
 // Compute ray direction from screen coordinates
 void compute_ray_from_screen(float screen_x, float screen_y, int fb_width, int fb_height,
                              mat4 projection, mat4 view, vec3 ray_origin, vec3 out_ray_dir);
@@ -36,15 +60,27 @@ void compute_ray_from_screen(float screen_x, float screen_y, int fb_width, int f
 bool ray_aabb_intersection(vec3 ray_origin, vec3 ray_dir, vec3 bbox_min, vec3 bbox_max,
                            float* t_near, float* t_far);
 
-// Pick scene node under ray (traverses scene graph, tests AABB then triangles)
+// Pick scene node under ray (traverses scene graph, tests AABB then triangles).
+// Animated skinned meshes are tested in their current pose.
 RayPickResult pick_scene_node(struct SceneNode* root_node, vec3 ray_origin, vec3 ray_dir);
 
+// Intersect a batch of rays against every triangle mesh under root_node.
+// Rays are traced in packets through per-mesh BVHs and split across worker threads
+// (thread_count <= 0 uses RAY_QUERY_DEFAULT_THREADS), which are started by the first
+// multi-threaded call and reused after. Skinned meshes are tested in bind pose.
+// Returns the number of rays that hit.
+size_t intersect_rays(struct SceneNode* root_node, const Ray* rays, RayHit* out_hits,
+                      size_t ray_count, int thread_count);
+
 // Project ray to plane at given distance (for drag operations)
 void ray_point_at_distance(vec3 ray_origin, vec3 ray_dir, float distance, vec3 out_point);
 
 // Extract frustum planes from view-projection matrix (Griggs-Hartmann method)
 void frustum_extract_from_vp(mat4 vp, Frustum* frustum);
 
+// Test if a world-space AABB is visible in frustum
+bool frustum_test_aabb(const Frustum* frustum, vec3 world_min, vec3 world_max);
+
 // Test if AABB (in local space) transformed by model matrix is visible in frustum
 // Returns true if AABB is inside or intersects frustum, false if completely outside
 bool frustum_test_aabb_transformed(const Frustum* frustum, vec3 aabb_min, vec3 aabb_max,
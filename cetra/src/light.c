@@ -132,11 +132,10 @@ void set_light_attenuation(Light* light, float constant, float linear, float qua
  * Sets the cutoff angles for a spotlight.
  *
  * @param light A pointer to the Light structure.
- * @param cutOff The inner cutoff angle, inside of which the light is at full
- *               intensity. This is typically expressed in radians or as a
- *               cosine of the angle for efficiency.
- * @param outerCutOff The outer cutoff angle, beyond which the light intensity
- *                    falls off to zero. Also typically in radians or as a cosine.
+ * @param cutOff Cosine of the inner cone half-angle, inside of which the light
+ *               is at full intensity.
+ * @param outerCutOff Cosine of the outer cone half-angle, beyond which the light
+ *                    intensity falls off to zero.
  */
 void set_light_cutoff(Light* light, float cutOff, float outerCutOff) {
     if (!light)
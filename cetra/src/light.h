@@ -27,8 +27,8 @@ typedef struct Light {
     float quadratic;
 
     // Spot light specific properties
-    float cutOff;      // Cut-off angle
-    float outerCutOff; // Outer cut-off angle
+    float cutOff;      // Cosine of the inner cone half-angle
+    float outerCutOff; // Cosine of the outer cone half-angle
 
     // Area
     vec2 size;
@@ -10,10 +10,13 @@
 #include <assimp/postprocess.h>
 
 #include "animation.h"
+#include "bvh.h"
 #include "common.h"
+#include "intersect.h"
 #include "ext/log.h"
 #include "material.h"
 #include "mesh.h"
+#include "scene.h"
 #include "util.h"
 
 Mesh* create_mesh() {
@@ -68,6 +71,10 @@ Mesh* create_mesh() {
     mesh->aabb.max[0] = 0.0f;
     mesh->aabb.max[1] = 0.0f;
     mesh->aabb.max[2] = 0.0f;
+    mesh->owner = NULL;
+    mesh->bvh = NULL;
+    mesh->is_occluder = false;
+    mesh->occluder_proxy = NULL;
 
     // Initialize skinning data
     mesh->bone_ids = NULL;
@@ -76,6 +83,10 @@ Mesh* create_mesh() {
     mesh->bone_weight_vbo = 0;
     mesh->skeleton = NULL;
     mesh->is_skinned = false;
+    mesh->bone_bounds = NULL;
+    mesh->bone_has_bounds = NULL;
+    mesh->bone_bounds_count = 0;
+    mesh->has_rigid_bounds = false;
 
     return mesh;
 }
@@ -113,6 +124,8 @@ void free_mesh(Mesh* mesh) {
     if (mesh->indices)
         free(mesh->indices);
 
+    free_mesh_bvh(mesh->bvh);
+
     // Free skinning data
     if (mesh->bone_ids)
         free(mesh->bone_ids);
@@ -122,6 +135,8 @@ void free_mesh(Mesh* mesh) {
         glDeleteBuffers(1, &mesh->bone_id_vbo);
     if (mesh->bone_weight_vbo)
         glDeleteBuffers(1, &mesh->bone_weight_vbo);
+    free(mesh->bone_bounds);
+    free(mesh->bone_has_bounds);
     // Do not free skeleton - it's shared and managed by Scene
 
     // Do not free material. Same material can be shared by multiple meshes.
@@ -136,9 +151,22 @@ void set_mesh_draw_mode(Mesh* mesh, MeshDrawMode draw_mode) {
     mesh->draw_mode = draw_mode;
 }
 
+void set_mesh_occluder(Mesh* mesh, bool is_occluder, Mesh* proxy) {
+    if (!mesh)
+        return;
+    mesh->is_occluder = is_occluder;
+    mesh->occluder_proxy = proxy;
+}
+
 void calculate_aabb(Mesh* mesh) {
     AABB* aabb = &mesh->aabb;
 
+    // Geometry changed; the next ray query rebuilds the BVH and the next bounds update
+    // picks up the new box
+    free_mesh_bvh(mesh->bvh);
+    mesh->bvh = NULL;
+    mark_node_bounds_dirty(mesh->owner);
+
     if (mesh->vertex_count == 0) {
         glm_vec3_zero(aabb->min);
         glm_vec3_zero(aabb->max);
@@ -157,6 +185,151 @@ void calculate_aabb(Mesh* mesh) {
         glm_vec3_minv(aabb->min, vertex, aabb->min);
         glm_vec3_maxv(aabb->max, vertex, aabb->max);
     }
+
+    if (mesh->is_skinned)
+        calculate_bone_bounds(mesh);
+}
+
+/*
+ * Skinning
+ */
+
+static void _grow_box(AABB* box, bool* has, const float* point) {
+    if (!*has) {
+        glm_vec3_copy((float*)point, box->min);
+        glm_vec3_copy((float*)point, box->max);
+        *has = true;
+        return;
+    }
+    glm_vec3_minv(box->min, (float*)point, box->min);
+    glm_vec3_maxv(box->max, (float*)point, box->max);
+}
+
+void calculate_bone_bounds(Mesh* mesh) {
+    if (!mesh)
+        return;
+
+    free(mesh->bone_bounds);
+    free(mesh->bone_has_bounds);
+    mesh->bone_bounds = NULL;
+    mesh->bone_has_bounds = NULL;
+    mesh->bone_bounds_count = 0;
+    mesh->has_rigid_bounds = false;
+
+    if (!mesh->bone_ids || !mesh->bone_weights || mesh->vertex_count == 0)
+        return;
+
+    // Size by the highest bone referenced
+    int max_bone = -1;
+    for (size_t i = 0; i < mesh->vertex_count * BONES_PER_VERTEX; i++) {
+        if (mesh->bone_ids[i] > max_bone)
+            max_bone = mesh->bone_ids[i];
+    }
+    if (max_bone < 0)
+        return;
+
+    size_t count = (size_t)max_bone + 1;
+    mesh->bone_bounds = malloc(count * sizeof(AABB));
+    mesh->bone_has_bounds = calloc(count, sizeof(bool));
+    if (!mesh->bone_bounds || !mesh->bone_has_bounds) {
+        log_error("Failed to allocate bone bounds");
+        free(mesh->bone_bounds);
+        free(mesh->bone_has_bounds);
+        mesh->bone_bounds = NULL;
+        mesh->bone_has_bounds = NULL;
+        return;
+    }
+    mesh->bone_bounds_count = count;
+
+    // A skinned vertex is a weighted average of its bones' transforms of it, so it lies
+    // within the bounds of those transformed points: add it to every bone it uses
+    for (size_t v = 0; v < mesh->vertex_count; v++) {
+        const float* position = &mesh->vertices[v * 3];
+        float total = 0.0f;
+
+        for (int i = 0; i < BONES_PER_VERTEX; i++) {
+            int bone = mesh->bone_ids[v * BONES_PER_VERTEX + i];
+            float weight = mesh->bone_weights[v * BONES_PER_VERTEX + i];
+            if (bone < 0)
+                continue;
+            total += weight;
+            if (weight > 0.0f)
+                _grow_box(&mesh->bone_bounds[bone], &mesh->bone_has_bounds[bone], position);
+        }
+
+        if (total < 0.001f)
+            _grow_box(&mesh->rigid_bounds, &mesh->has_rigid_bounds, position);
+    }
+}
+
+void calculate_posed_aabb(const Mesh* mesh, mat4* bone_matrices, size_t bone_count,
+                          vec3 out_min, vec3 out_max) {
+    bool has = false;
+    AABB posed;
+
+    if (mesh->bone_bounds && bone_matrices) {
+        size_t count = mesh->bone_bounds_count < bone_count ? mesh->bone_bounds_count
+                                                            : bone_count;
+        for (size_t b = 0; b < count; b++) {
+            if (!mesh->bone_has_bounds[b])
+                continue;
+
+            AABB box;
+            aabb_transform((float*)mesh->bone_bounds[b].min, (float*)mesh->bone_bounds[b].max,
+                           bone_matrices[b], box.min, box.max);
+            _grow_box(&posed, &has, box.min);
+            _grow_box(&posed, &has, box.max);
+        }
+
+        if (mesh->has_rigid_bounds) {
+            _grow_box(&posed, &has, mesh->rigid_bounds.min);
+            _grow_box(&posed, &has, mesh->rigid_bounds.max);
+        }
+    }
+
+    if (!has) {
+        glm_vec3_copy((float*)mesh->aabb.min, out_min);
+        glm_vec3_copy((float*)mesh->aabb.max, out_max);
+        return;
+    }
+    glm_vec3_copy(posed.min, out_min);
+    glm_vec3_copy(posed.max, out_max);
+}
+
+void skin_mesh_vertex(const Mesh* mesh, mat4* bone_matrices, size_t bone_count, size_t v,
+                      vec3 out_position, vec3 out_normal) {
+    mat4 skin;
+    glm_mat4_zero(skin);
+    float total = 0.0f;
+
+    for (int i = 0; i < BONES_PER_VERTEX; i++) {
+        int bone = mesh->bone_ids[v * BONES_PER_VERTEX + i];
+        float weight = mesh->bone_weights[v * BONES_PER_VERTEX + i];
+        if (bone < 0 || (size_t)bone >= bone_count)
+            continue;
+
+        for (int c = 0; c < 4; c++) {
+            for (int r = 0; r < 4; r++) {
+                skin[c][r] += bone_matrices[bone][c][r] * weight;
+            }
+        }
+        total += weight;
+    }
+
+    // Fallback to identity if no valid bones
+    if (total < 0.001f)
+        glm_mat4_identity(skin);
+
+    glm_mat4_mulv3(skin, &mesh->vertices[v * 3], 1.0f, out_position);
+
+    if (out_normal) {
+        if (mesh->normals) {
+            glm_mat4_mulv3(skin, &mesh->normals[v * 3], 0.0f, out_normal);
+            glm_vec3_normalize(out_normal);
+        } else {
+            glm_vec3_copy((vec3){0.0f, 1.0f, 0.0f}, out_normal);
+        }
+    }
 }
 
 void upload_mesh_buffers_to_gpu(Mesh* mesh) {
@@ -11,6 +11,8 @@
 
 // Forward declaration
 struct Skeleton;
+struct MeshBVH;
+struct SceneNode;
 
 // Axis-Aligned Bounding Box
 typedef struct {
@@ -59,6 +61,12 @@ typedef struct Mesh {
     GLuint bitangent_vbo; // Bitangent Buffer Object
 
     AABB aabb;
+    struct SceneNode* owner; // Node the mesh was added to, whose bounds follow the AABB
+    struct MeshBVH* bvh; // Lazily built for ray queries (NULL until first use)
+
+    // Occlusion culling
+    bool is_occluder;             // Rasterized into the CPU occlusion buffer
+    struct Mesh* occluder_proxy;  // Simplified stand-in to rasterize instead (not owned)
 
     // Skinning data (NULL if not skinned)
     int* bone_ids;             // BONES_PER_VERTEX ints per vertex (ivec4)
@@ -68,6 +76,14 @@ typedef struct Mesh {
     struct Skeleton* skeleton; // Shared skeleton pointer (not owned)
     bool is_skinned;
 
+    // Bind-pose boxes of the vertices weighted to each bone, posed with the bone
+    // matrices to bound the animated mesh. Built by calculate_aabb.
+    AABB* bone_bounds;
+    bool* bone_has_bounds; // Bones with no vertices have no box
+    size_t bone_bounds_count;
+    AABB rigid_bounds; // Vertices without usable weights, which skinning leaves in place
+    bool has_rigid_bounds;
+
 } Mesh;
 
 /*
@@ -77,8 +93,25 @@ Mesh* create_mesh();
 void free_mesh(Mesh* mesh);
 
 void set_mesh_draw_mode(Mesh* mesh, MeshDrawMode draw_mode);
+void set_mesh_occluder(Mesh* mesh, bool is_occluder, Mesh* proxy);
 void calculate_aabb(Mesh* mesh);
 
+/*
+ * Skinning
+ */
+
+// Rebuild bone_bounds from the bind-pose vertices and their bone weights
+void calculate_bone_bounds(Mesh* mesh);
+
+// Bounds of the mesh posed by bone_matrices, in mesh space. Falls back to the bind-pose
+// AABB for meshes without bone bounds.
+void calculate_posed_aabb(const Mesh* mesh, mat4* bone_matrices, size_t bone_count,
+                          vec3 out_min, vec3 out_max);
+
+// Skin vertex v on the CPU, matching the skinning shader. out_normal may be NULL.
+void skin_mesh_vertex(const Mesh* mesh, mat4* bone_matrices, size_t bone_count, size_t v,
+                      vec3 out_position, vec3 out_normal);
+
 /*
  * Mesh buffers
  */
@@ -0,0 +1,373 @@
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cglm/cglm.h>
+
+#include "occlusion.h"
+#include "mesh.h"
+#include "ext/log.h"
+
+// GCC/Clang vector extensions: one rasterizer step covers OCCLUSION_LANES pixels of a span
+#define OCCLUSION_LANES 4
+typedef float OccVec __attribute__((vector_size(OCCLUSION_LANES * sizeof(float))));
+typedef int32_t OccVecI __attribute__((vector_size(OCCLUSION_LANES * sizeof(int32_t))));
+
+// Clip-space vertex: x, y, z, w
+typedef struct {
+    float v[4];
+} ClipVert;
+
+// Screen-space vertex: pixel x, pixel y, depth [0, 1]
+typedef struct {
+    float x, y, z;
+} ScreenVert;
+
+OcclusionBuffer* create_occlusion_buffer(int width, int height) {
+    if (width <= 0 || height <= 0) {
+        log_error("Invalid occlusion buffer size %dx%d", width, height);
+        return NULL;
+    }
+
+    OcclusionBuffer* buf = calloc(1, sizeof(OcclusionBuffer));
+    if (!buf) {
+        log_error("Failed to allocate memory for OcclusionBuffer");
+        return NULL;
+    }
+
+    buf->width = width;
+    buf->height = height;
+
+    // Each level halves the previous one, rounding up so edge texels are kept
+    int w = width, h = height;
+    for (int i = 0; i < OCCLUSION_MAX_LEVELS; i++) {
+        buf->levels[i] = malloc((size_t)w * h * sizeof(float));
+        if (!buf->levels[i]) {
+            log_error("Failed to allocate occlusion level %d", i);
+            free_occlusion_buffer(buf);
+            return NULL;
+        }
+        buf->level_width[i] = w;
+        buf->level_height[i] = h;
+        buf->level_count = i + 1;
+
+        if (w == 1 && h == 1)
+            break;
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+    }
+
+    glm_mat4_identity(buf->view_proj);
+    return buf;
+}
+
+void free_occlusion_buffer(OcclusionBuffer* buf) {
+    if (!buf)
+        return;
+
+    for (int i = 0; i < buf->level_count; i++) {
+        free(buf->levels[i]);
+    }
+    free(buf->clip_verts);
+    free(buf);
+}
+
+void occlusion_begin_frame(OcclusionBuffer* buf, mat4 view_proj) {
+    if (!buf)
+        return;
+
+    glm_mat4_copy(view_proj, buf->view_proj);
+
+    float* depth = buf->levels[0];
+    size_t count = (size_t)buf->width * buf->height;
+    for (size_t i = 0; i < count; i++) {
+        depth[i] = 1.0f;
+    }
+
+    buf->occluder_triangles = 0;
+    buf->tested = 0;
+    buf->rejected = 0;
+}
+
+static void _to_screen(const OcclusionBuffer* buf, const ClipVert* c, ScreenVert* out) {
+    float inv_w = 1.0f / c->v[3];
+    out->x = (c->v[0] * inv_w * 0.5f + 0.5f) * buf->width;
+    out->y = (c->v[1] * inv_w * 0.5f + 0.5f) * buf->height;
+    out->z = c->v[2] * inv_w * 0.5f + 0.5f;
+}
+
+// Half-space rasterizer writing the nearest depth. A texel is covered when its centre is
+// inside and takes the farthest depth the triangle reaches over the texel, so a sloped
+// occluder never stands nearer than it is. Spans are processed OCCLUSION_LANES pixels at a
+// time with a masked select; the remainder of each span runs scalar.
+static void _rasterize_triangle(OcclusionBuffer* buf, const ScreenVert* a, const ScreenVert* b,
+                                const ScreenVert* c) {
+    float area = (b->x - a->x) * (c->y - a->y) - (b->y - a->y) * (c->x - a->x);
+    if (fabsf(area) < 1e-8f)
+        return;
+
+    // Orient counter-clockwise so inside means all edges >= 0
+    if (area < 0.0f) {
+        const ScreenVert* tmp = b;
+        b = c;
+        c = tmp;
+        area = -area;
+    }
+
+    int min_x = (int)floorf(fminf(a->x, fminf(b->x, c->x)));
+    int max_x = (int)ceilf(fmaxf(a->x, fmaxf(b->x, c->x)));
+    int min_y = (int)floorf(fminf(a->y, fminf(b->y, c->y)));
+    int max_y = (int)ceilf(fmaxf(a->y, fmaxf(b->y, c->y)));
+    if (min_x < 0)
+        min_x = 0;
+    if (min_y < 0)
+        min_y = 0;
+    if (max_x > buf->width - 1)
+        max_x = buf->width - 1;
+    if (max_y > buf->height - 1)
+        max_y = buf->height - 1;
+    if (min_x > max_x || min_y > max_y)
+        return;
+
+    // Edge function coefficients: e(x, y) = A * x + B * y + C
+    float a0 = b->y - c->y, b0 = c->x - b->x, c0 = b->x * c->y - b->y * c->x;
+    float a1 = c->y - a->y, b1 = a->x - c->x, c1 = c->x * a->y - c->y * a->x;
+    float a2 = a->y - b->y, b2 = b->x - a->x, c2 = a->x * b->y - a->y * b->x;
+
+    // Depth is affine in screen space: z = z_a + w1 * (z_b - z_a) + w2 * (z_c - z_a)
+    float inv_area = 1.0f / area;
+    float dz1 = (b->z - a->z) * inv_area;
+    float dz2 = (c->z - a->z) * inv_area;
+
+    // Depth varies by up to half of each screen-space slope over a texel
+    float z_far = a->z + 0.5f * (fabsf(a1 * dz1 + a2 * dz2) + fabsf(b1 * dz1 + b2 * dz2));
+
+    const OccVec lane_offset = {0.5f, 1.5f, 2.5f, 3.5f};
+
+    for (int y = min_y; y <= max_y; y++) {
+        float py = y + 0.5f;
+        float* row = buf->levels[0] + (size_t)y * buf->width;
+
+        // Edge values at x = 0 for this row
+        float r0 = b0 * py + c0;
+        float r1 = b1 * py + c1;
+        float r2 = b2 * py + c2;
+
+        int x = min_x;
+        for (; x + OCCLUSION_LANES - 1 <= max_x; x += OCCLUSION_LANES) {
+            OccVec px = (float)x + lane_offset;
+            OccVec e0 = a0 * px + r0;
+            OccVec e1 = a1 * px + r1;
+            OccVec e2 = a2 * px + r2;
+            OccVec z = z_far + e1 * dz1 + e2 * dz2;
+
+            OccVec current;
+            memcpy(&current, row + x, sizeof(current));
+
+            OccVecI keep = (e0 >= 0.0f) & (e1 >= 0.0f) & (e2 >= 0.0f) & (z < current);
+            OccVecI merged = ((OccVecI)z & keep) | ((OccVecI)current & ~keep);
+            memcpy(row + x, &merged, sizeof(merged));
+        }
+
+        for (; x <= max_x; x++) {
+            float px = x + 0.5f;
+            float e0 = a0 * px + r0;
+            float e1 = a1 * px + r1;
+            float e2 = a2 * px + r2;
+            float z = z_far + e1 * dz1 + e2 * dz2;
+
+            bool inside = e0 >= 0.0f && e1 >= 0.0f && e2 >= 0.0f;
+            if (inside && z < row[x])
+                row[x] = z;
+        }
+    }
+}
+
+// Clip against the near plane (z >= -w) and rasterize the resulting fan
+static void _clip_and_rasterize(OcclusionBuffer* buf, const ClipVert* tri) {
+    ClipVert poly[4];
+    int count = 0;
+
+    for (int i = 0; i < 3; i++) {
+        const ClipVert* cur = &tri[i];
+        const ClipVert* next = &tri[(i + 1) % 3];
+        float d_cur = cur->v[2] + cur->v[3];
+        float d_next = next->v[2] + next->v[3];
+
+        if (d_cur >= 0.0f)
+            poly[count++] = *cur;
+        if ((d_cur >= 0.0f) != (d_next >= 0.0f)) {
+            float t = d_cur / (d_cur - d_next);
+            for (int k = 0; k < 4; k++) {
+                poly[count].v[k] = cur->v[k] + t * (next->v[k] - cur->v[k]);
+            }
+            count++;
+        }
+    }
+
+    if (count < 3)
+        return;
+
+    ScreenVert screen[4];
+    for (int i = 0; i < count; i++) {
+        if (poly[i].v[3] <= 1e-6f)
+            return;
+        _to_screen(buf, &poly[i], &screen[i]);
+    }
+
+    for (int i = 1; i + 1 < count; i++) {
+        _rasterize_triangle(buf, &screen[0], &screen[i], &screen[i + 1]);
+    }
+}
+
+void occlusion_rasterize_mesh(OcclusionBuffer* buf, const Mesh* mesh, mat4 model) {
+    if (!buf || !mesh || !mesh->vertices || mesh->draw_mode != TRIANGLES)
+        return;
+
+    if (mesh->vertex_count > buf->clip_capacity) {
+        float* verts = realloc(buf->clip_verts, mesh->vertex_count * 4 * sizeof(float));
+        if (!verts) {
+            log_error("Failed to grow occlusion vertex buffer");
+            return;
+        }
+        buf->clip_verts = verts;
+        buf->clip_capacity = mesh->vertex_count;
+    }
+
+    mat4 mvp;
+    glm_mat4_mul(buf->view_proj, model, mvp);
+
+    for (size_t i = 0; i < mesh->vertex_count; i++) {
+        vec4 p = {mesh->vertices[i * 3 + 0], mesh->vertices[i * 3 + 1], mesh->vertices[i * 3 + 2],
+                  1.0f};
+        glm_mat4_mulv(mvp, p, buf->clip_verts + i * 4);
+    }
+
+    size_t tri_count = mesh->indices ? mesh->index_count / 3 : mesh->vertex_count / 3;
+    const ClipVert* clip = (const ClipVert*)buf->clip_verts;
+
+    for (size_t t = 0; t < tri_count; t++) {
+        ClipVert tri[3];
+        for (int k = 0; k < 3; k++) {
+            size_t idx = mesh->indices ? mesh->indices[t * 3 + k] : t * 3 + k;
+            tri[k] = clip[idx];
+        }
+
+        // Trivially reject triangles outside one of the side or far planes
+        bool outside = false;
+        for (int axis = 0; axis < 3 && !outside; axis++) {
+            outside = (tri[0].v[axis] > tri[0].v[3] && tri[1].v[axis] > tri[1].v[3] &&
+                       tri[2].v[axis] > tri[2].v[3]) ||
+                      (axis < 2 && tri[0].v[axis] < -tri[0].v[3] &&
+                       tri[1].v[axis] < -tri[1].v[3] && tri[2].v[axis] < -tri[2].v[3]);
+        }
+        if (outside)
+            continue;
+
+        _clip_and_rasterize(buf, tri);
+        buf->occluder_triangles++;
+    }
+}
+
+void occlusion_build_pyramid(OcclusionBuffer* buf) {
+    if (!buf)
+        return;
+
+    for (int l = 1; l < buf->level_count; l++) {
+        const float* src = buf->levels[l - 1];
+        float* dst = buf->levels[l];
+        int sw = buf->level_width[l - 1];
+        int sh = buf->level_height[l - 1];
+        int dw = buf->level_width[l];
+        int dh = buf->level_height[l];
+
+        for (int y = 0; y < dh; y++) {
+            int y0 = y * 2;
+            int y1 = y0 + 1 < sh ? y0 + 1 : y0;
+            for (int x = 0; x < dw; x++) {
+                int x0 = x * 2;
+                int x1 = x0 + 1 < sw ? x0 + 1 : x0;
+                float m0 = fmaxf(src[y0 * sw + x0], src[y0 * sw + x1]);
+                float m1 = fmaxf(src[y1 * sw + x0], src[y1 * sw + x1]);
+                dst[y * dw + x] = fmaxf(m0, m1);
+            }
+        }
+    }
+}
+
+bool occlusion_test_aabb(OcclusionBuffer* buf, vec3 world_min, vec3 world_max) {
+    if (!buf)
+        return true;
+
+    buf->tested++;
+
+    float min_x = FLT_MAX, min_y = FLT_MAX, max_x = -FLT_MAX, max_y = -FLT_MAX;
+    float min_z = FLT_MAX;
+
+    for (int c = 0; c < 8; c++) {
+        vec4 corner = {(c & 1) ? world_max[0] : world_min[0], (c & 2) ? world_max[1] : world_min[1],
+                       (c & 4) ? world_max[2] : world_min[2], 1.0f};
+        vec4 clip;
+        glm_mat4_mulv(buf->view_proj, corner, clip);
+
+        // Box reaches the near plane; treat as visible
+        if (clip[3] <= 1e-6f || clip[2] < -clip[3])
+            return true;
+
+        ClipVert cv = {{clip[0], clip[1], clip[2], clip[3]}};
+        ScreenVert sv;
+        _to_screen(buf, &cv, &sv);
+        min_x = fminf(min_x, sv.x);
+        max_x = fmaxf(max_x, sv.x);
+        min_y = fminf(min_y, sv.y);
+        max_y = fmaxf(max_y, sv.y);
+        min_z = fminf(min_z, sv.z);
+    }
+
+    int x0 = (int)floorf(min_x), x1 = (int)floorf(max_x);
+    int y0 = (int)floorf(min_y), y1 = (int)floorf(max_y);
+    if (x1 < 0 || y1 < 0 || x0 >= buf->width || y0 >= buf->height)
+        return true; // Off screen; frustum culling owns this case
+
+    // Occluders cover a texel once its centre is inside, which can reach up to half a texel
+    // past their silhouette. One texel of margin keeps a box peeking out there visible.
+    x0--;
+    y0--;
+    x1++;
+    y1++;
+    if (x0 < 0)
+        x0 = 0;
+    if (y0 < 0)
+        y0 = 0;
+    if (x1 > buf->width - 1)
+        x1 = buf->width - 1;
+    if (y1 > buf->height - 1)
+        y1 = buf->height - 1;
+
+    // Pick the level where the rectangle spans at most about 2x2 texels
+    int level = 0;
+    int extent = (x1 - x0 > y1 - y0 ? x1 - x0 : y1 - y0) + 1;
+    while (extent > 2 && level < buf->level_count - 1) {
+        extent = (extent + 1) / 2;
+        level++;
+    }
+
+    x0 >>= level;
+    x1 >>= level;
+    y0 >>= level;
+    y1 >>= level;
+
+    const float* depth = buf->levels[level];
+    int lw = buf->level_width[level];
+    for (int y = y0; y <= y1; y++) {
+        for (int x = x0; x <= x1; x++) {
+            if (min_z <= depth[y * lw + x])
+                return true;
+        }
+    }
+
+    buf->rejected++;
+    return false;
+}
@@ -0,0 +1,65 @@
+#ifndef _OCCLUSION_H_
+#define _OCCLUSION_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <cglm/cglm.h>
+
+struct Mesh;
+
+#define OCCLUSION_BUFFER_WIDTH  256
+#define OCCLUSION_BUFFER_HEIGHT 128
+#define OCCLUSION_MAX_LEVELS    8
+
+/*
+ * Occlusion Buffer
+ *
+ * Low resolution CPU depth buffer. Occluder meshes are rasterized into level 0,
+ * then a max-depth pyramid is built so candidate boxes can be rejected with a
+ * handful of texel reads. Depth is NDC z remapped to [0, 1], cleared to 1 (far).
+ * No GL calls are made, so it works headless.
+ */
+typedef struct OcclusionBuffer {
+    int width;
+    int height;
+
+    float* levels[OCCLUSION_MAX_LEVELS]; // levels[0] is the full resolution depth
+    int level_width[OCCLUSION_MAX_LEVELS];
+    int level_height[OCCLUSION_MAX_LEVELS];
+    int level_count;
+
+    mat4 view_proj;
+
+    // Scratch space for clip-space occluder vertices
+    float* clip_verts;
+    size_t clip_capacity;
+
+    // Per-frame statistics
+    size_t occluder_triangles;
+    size_t tested;
+    size_t rejected;
+} OcclusionBuffer;
+
+/*
+ * Lifecycle
+ */
+OcclusionBuffer* create_occlusion_buffer(int width, int height);
+void free_occlusion_buffer(OcclusionBuffer* buf);
+
+/*
+ * Per frame
+ */
+
+// Clear depth and statistics for a new view
+void occlusion_begin_frame(OcclusionBuffer* buf, mat4 view_proj);
+
+// Rasterize a triangle mesh (local space) into level 0
+void occlusion_rasterize_mesh(OcclusionBuffer* buf, const struct Mesh* mesh, mat4 model);
+
+// Build the max-depth pyramid; call after all occluders are rasterized
+void occlusion_build_pyramid(OcclusionBuffer* buf);
+
+// Returns false only if the world-space box is fully hidden behind occluders
+bool occlusion_test_aabb(OcclusionBuffer* buf, vec3 world_min, vec3 world_max);
+
+#endif // _OCCLUSION_H_
@@ -0,0 +1,383 @@
+#include <ctype.h>
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cglm/cglm.h>
+
+#include "portal.h"
+#include "scene.h"
+#include "ext/log.h"
+
+// Portals within this fraction of their size from a cell are linked to it
+#define PORTAL_LINK_MARGIN 0.05f
+
+CellGraph* create_cell_graph() {
+    CellGraph* graph = calloc(1, sizeof(CellGraph));
+    if (!graph) {
+        log_error("Failed to allocate memory for CellGraph");
+        return NULL;
+    }
+    graph->needs_build = true;
+    graph->camera_cell = -1;
+    return graph;
+}
+
+static void _clear_cell_graph(CellGraph* graph) {
+    for (size_t i = 0; i < graph->cell_count; i++) {
+        free(graph->cells[i].portals);
+    }
+    free(graph->cells);
+    free(graph->portals);
+    graph->cells = NULL;
+    graph->cell_count = 0;
+    graph->portals = NULL;
+    graph->portal_count = 0;
+}
+
+void free_cell_graph(CellGraph* graph) {
+    if (!graph)
+        return;
+    _clear_cell_graph(graph);
+    free(graph);
+}
+
+/*
+ * Tagging
+ */
+
+static bool _has_prefix_nocase(const char* str, const char* prefix) {
+    for (; *prefix; str++, prefix++) {
+        if (tolower((unsigned char)*str) != tolower((unsigned char)*prefix))
+            return false;
+    }
+    return true;
+}
+
+CellRole cell_role_from_name(const char* name) {
+    if (!name)
+        return CELL_ROLE_NONE;
+    if (_has_prefix_nocase(name, CELL_NAME_PREFIX))
+        return CELL_ROLE_CELL;
+    if (_has_prefix_nocase(name, PORTAL_NAME_PREFIX))
+        return CELL_ROLE_PORTAL;
+    return CELL_ROLE_NONE;
+}
+
+void set_node_cell_role(Scene* scene, SceneNode* node, CellRole role) {
+    if (!node)
+        return;
+
+    node->cell_role = role;
+    node->cell_index = -1;
+
+    if (!scene)
+        return;
+    if (!scene->cell_graph && role != CELL_ROLE_NONE)
+        scene->cell_graph = create_cell_graph();
+    invalidate_cell_graph(scene->cell_graph);
+}
+
+/*
+ * Build
+ */
+
+static void _count_tagged_nodes(SceneNode* node, size_t* cell_count, size_t* portal_count) {
+    if (node->cell_role == CELL_ROLE_CELL)
+        (*cell_count)++;
+    else if (node->cell_role == CELL_ROLE_PORTAL)
+        (*portal_count)++;
+
+    for (size_t i = 0; i < node->children_count; i++) {
+        if (node->children[i])
+            _count_tagged_nodes(node->children[i], cell_count, portal_count);
+    }
+}
+
+static void _collect_tagged_nodes(CellGraph* graph, SceneNode* node) {
+    node->cell_index = -1;
+
+    if (node->cell_role == CELL_ROLE_CELL || node->cell_role == CELL_ROLE_PORTAL) {
+        if (!node->has_bounds) {
+            log_warn("Ignoring %s '%s' without geometry",
+                     node->cell_role == CELL_ROLE_CELL ? "cell" : "portal",
+                     node->name ? node->name : "");
+        } else if (node->cell_role == CELL_ROLE_CELL) {
+            Cell* cell = &graph->cells[graph->cell_count];
+            memset(cell, 0, sizeof(Cell));
+            cell->bounds = node->world_bounds;
+            node->cell_index = (int)graph->cell_count++;
+        } else {
+            Portal* portal = &graph->portals[graph->portal_count];
+            portal->bounds = node->world_bounds;
+            portal->cells[0] = -1;
+            portal->cells[1] = -1;
+            node->cell_index = (int)graph->portal_count++;
+        }
+    }
+
+    for (size_t i = 0; i < node->children_count; i++) {
+        if (node->children[i])
+            _collect_tagged_nodes(graph, node->children[i]);
+    }
+}
+
+// Overlap volume of two boxes after growing a by margin, or -1 if they do not touch
+static float _overlap_volume(const AABB* a, const AABB* b, float margin) {
+    float volume = 1.0f;
+    for (int axis = 0; axis < 3; axis++) {
+        float lo = fmaxf(a->min[axis] - margin, b->min[axis]);
+        float hi = fminf(a->max[axis] + margin, b->max[axis]);
+        if (hi < lo)
+            return -1.0f;
+        volume *= hi - lo;
+    }
+    return volume;
+}
+
+static int _add_portal_to_cell(Cell* cell, size_t portal_index) {
+    size_t* portals = realloc(cell->portals, (cell->portal_count + 1) * sizeof(size_t));
+    if (!portals) {
+        log_error("Failed to grow cell portal list");
+        return -1;
+    }
+    cell->portals = portals;
+    cell->portals[cell->portal_count++] = portal_index;
+    return 0;
+}
+
+int build_cell_graph(CellGraph* graph, SceneNode* root) {
+    if (!graph)
+        return -1;
+
+    _clear_cell_graph(graph);
+    graph->needs_build = false;
+    graph->camera_cell = -1;
+
+    if (!root)
+        return 0;
+
+    update_node_bounds(root);
+
+    size_t cell_count = 0, portal_count = 0;
+    _count_tagged_nodes(root, &cell_count, &portal_count);
+    if (cell_count == 0)
+        return 0;
+
+    graph->cells = calloc(cell_count, sizeof(Cell));
+    graph->portals = portal_count > 0 ? calloc(portal_count, sizeof(Portal)) : NULL;
+    if (!graph->cells || (portal_count > 0 && !graph->portals)) {
+        log_error("Failed to allocate cell graph (%zu cells, %zu portals)", cell_count,
+                  portal_count);
+        _clear_cell_graph(graph);
+        return -1;
+    }
+
+    _collect_tagged_nodes(graph, root);
+
+    // Link each portal to the two cells it overlaps the most
+    for (size_t p = 0; p < graph->portal_count; p++) {
+        Portal* portal = &graph->portals[p];
+        vec3 extent;
+        glm_vec3_sub(portal->bounds.max, portal->bounds.min, extent);
+        float margin = glm_vec3_max(extent) * PORTAL_LINK_MARGIN + 1e-3f;
+
+        float best[2] = {-1.0f, -1.0f};
+        for (size_t c = 0; c < graph->cell_count; c++) {
+            float overlap = _overlap_volume(&portal->bounds, &graph->cells[c].bounds, margin);
+            if (overlap < 0.0f)
+                continue;
+            if (overlap > best[0]) {
+                best[1] = best[0];
+                portal->cells[1] = portal->cells[0];
+                best[0] = overlap;
+                portal->cells[0] = (int)c;
+            } else if (overlap > best[1]) {
+                best[1] = overlap;
+                portal->cells[1] = (int)c;
+            }
+        }
+
+        if (portal->cells[1] < 0) {
+            log_warn("Portal %zu does not join two cells", p);
+            continue;
+        }
+        if (_add_portal_to_cell(&graph->cells[portal->cells[0]], p) != 0 ||
+            _add_portal_to_cell(&graph->cells[portal->cells[1]], p) != 0) {
+            _clear_cell_graph(graph);
+            return -1;
+        }
+    }
+
+    log_info("Built cell graph: %zu cells, %zu portals", graph->cell_count, graph->portal_count);
+    return 0;
+}
+
+void invalidate_cell_graph(CellGraph* graph) {
+    if (graph)
+        graph->needs_build = true;
+}
+
+/*
+ * Visibility
+ */
+
+static const CellRect FULL_SCREEN_RECT = {{-1.0f, -1.0f}, {1.0f, 1.0f}};
+
+// Screen rectangle covered by a box. Returns false if the box is behind the camera.
+static bool _project_bounds(const AABB* bounds, mat4 view_proj, CellRect* out) {
+    float min_x = FLT_MAX, min_y = FLT_MAX, max_x = -FLT_MAX, max_y = -FLT_MAX;
+    int behind = 0;
+
+    for (int c = 0; c < 8; c++) {
+        vec4 corner = {(c & 1) ? bounds->max[0] : bounds->min[0],
+                       (c & 2) ? bounds->max[1] : bounds->min[1],
+                       (c & 4) ? bounds->max[2] : bounds->min[2], 1.0f};
+        vec4 clip;
+        glm_mat4_mulv(view_proj, corner, clip);
+
+        if (clip[3] <= 1e-6f) {
+            behind++;
+            continue;
+        }
+        min_x = fminf(min_x, clip[0] / clip[3]);
+        max_x = fmaxf(max_x, clip[0] / clip[3]);
+        min_y = fminf(min_y, clip[1] / clip[3]);
+        max_y = fmaxf(max_y, clip[1] / clip[3]);
+    }
+
+    if (behind == 8)
+        return false;
+
+    // Box straddles the camera plane; its projection is unbounded
+    if (behind > 0) {
+        *out = FULL_SCREEN_RECT;
+        return true;
+    }
+
+    out->min[0] = min_x;
+    out->min[1] = min_y;
+    out->max[0] = max_x;
+    out->max[1] = max_y;
+    return true;
+}
+
+static bool _rect_intersect(const CellRect* a, const CellRect* b, CellRect* out) {
+    for (int i = 0; i < 2; i++) {
+        out->min[i] = fmaxf(a->min[i], b->min[i]);
+        out->max[i] = fminf(a->max[i], b->max[i]);
+        if (out->min[i] > out->max[i])
+            return false;
+    }
+    return true;
+}
+
+static bool _rect_contains(const CellRect* outer, const CellRect* inner) {
+    return inner->min[0] >= outer->min[0] && inner->min[1] >= outer->min[1] &&
+           inner->max[0] <= outer->max[0] && inner->max[1] <= outer->max[1];
+}
+
+static void _visit_cell(CellGraph* graph, int cell_index, const CellRect* rect, int from_portal,
+                        int depth, mat4 view_proj) {
+    Cell* cell = &graph->cells[cell_index];
+
+    // Already explored through a wider opening
+    if (cell->visible && _rect_contains(&cell->visible_rect, rect))
+        return;
+
+    if (!cell->visible) {
+        cell->visible = true;
+        cell->visible_rect = *rect;
+        graph->cells_visible++;
+    } else {
+        for (int i = 0; i < 2; i++) {
+            cell->visible_rect.min[i] = fminf(cell->visible_rect.min[i], rect->min[i]);
+            cell->visible_rect.max[i] = fmaxf(cell->visible_rect.max[i], rect->max[i]);
+        }
+    }
+
+    // Re-explore with the union so any later opening inside it is pruned
+    CellRect opening = cell->visible_rect;
+
+    if (depth >= CELL_MAX_PORTAL_DEPTH)
+        return;
+
+    for (size_t i = 0; i < cell->portal_count; i++) {
+        size_t portal_index = cell->portals[i];
+        if ((int)portal_index == from_portal)
+            continue;
+
+        const Portal* portal = &graph->portals[portal_index];
+        int next = portal->cells[0] == cell_index ? portal->cells[1] : portal->cells[0];
+
+        graph->portals_tested++;
+
+        // Clip the current opening by the portal's screen footprint
+        CellRect portal_rect, clipped;
+        if (!_project_bounds(&portal->bounds, view_proj, &portal_rect) ||
+            !_rect_intersect(&opening, &portal_rect, &clipped)) {
+            continue;
+        }
+
+        graph->portals_passed++;
+        _visit_cell(graph, next, &clipped, (int)portal_index, depth + 1, view_proj);
+    }
+}
+
+static int _find_camera_cell(const CellGraph* graph, vec3 eye) {
+    int best = -1;
+    float best_volume = FLT_MAX;
+
+    // Nested or overlapping cells resolve to the smallest one
+    for (size_t i = 0; i < graph->cell_count; i++) {
+        const AABB* b = &graph->cells[i].bounds;
+        if (eye[0] < b->min[0] || eye[0] > b->max[0] || eye[1] < b->min[1] ||
+            eye[1] > b->max[1] || eye[2] < b->min[2] || eye[2] > b->max[2]) {
+            continue;
+        }
+        float volume = (b->max[0] - b->min[0]) * (b->max[1] - b->min[1]) * (b->max[2] - b->min[2]);
+        if (volume < best_volume) {
+            best_volume = volume;
+            best = (int)i;
+        }
+    }
+    return best;
+}
+
+void update_scene_cell_visibility(Scene* scene, vec3 eye, mat4 view_proj) {
+    if (!scene || !scene->cell_graph)
+        return;
+
+    CellGraph* graph = scene->cell_graph;
+    if (graph->needs_build)
+        build_cell_graph(graph, scene->root_node);
+
+    graph->cells_visible = 0;
+    graph->portals_tested = 0;
+    graph->portals_passed = 0;
+    for (size_t i = 0; i < graph->cell_count; i++) {
+        graph->cells[i].visible = false;
+    }
+
+    graph->camera_cell = _find_camera_cell(graph, eye);
+
+    // Outside every cell: no portal information, so nothing is rejected
+    if (graph->camera_cell < 0) {
+        for (size_t i = 0; i < graph->cell_count; i++) {
+            graph->cells[i].visible = true;
+            graph->cells[i].visible_rect = FULL_SCREEN_RECT;
+        }
+        graph->cells_visible = graph->cell_count;
+        return;
+    }
+
+    _visit_cell(graph, graph->camera_cell, &FULL_SCREEN_RECT, -1, 0, view_proj);
+}
+
+bool is_cell_node_visible(const CellGraph* graph, const SceneNode* node) {
+    if (!graph || !node || node->cell_role != CELL_ROLE_CELL || graph->needs_build)
+        return true;
+    if (node->cell_index < 0 || (size_t)node->cell_index >= graph->cell_count)
+        return true;
+    return graph->cells[node->cell_index].visible;
+}
@@ -0,0 +1,96 @@
+#ifndef _PORTAL_H_
+#define _PORTAL_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <cglm/cglm.h>
+
+#include "mesh.h"
+
+struct Scene;
+struct SceneNode;
+
+#define CELL_MAX_PORTAL_DEPTH 16    // Longest portal chain followed from the camera cell
+#define CELL_NAME_PREFIX      "cell_"
+#define PORTAL_NAME_PREFIX    "portal_"
+#define CELL_ROLE_METADATA    "cetra_role" // FBX user property: "cell" or "portal"
+
+/*
+ * Cells and portals
+ *
+ * Interior scenes can tag nodes as cells (rooms) and portals (doorways, windows).
+ * Each portal joins the two cells its bounds touch. Every frame the graph is walked
+ * from the cell holding the camera, narrowing the visible screen rectangle through
+ * each portal; subtrees of cells that are never reached are skipped by the renderer
+ * and the shadow pass. Portal nodes are markers and their meshes are not drawn.
+ */
+typedef enum { CELL_ROLE_NONE = 0, CELL_ROLE_CELL, CELL_ROLE_PORTAL } CellRole;
+
+// Screen rectangle in NDC
+typedef struct {
+    float min[2];
+    float max[2];
+} CellRect;
+
+typedef struct Cell {
+    AABB bounds; // World space
+    size_t* portals;
+    size_t portal_count;
+
+    bool visible;
+    CellRect visible_rect; // Union of the rectangles the cell was reached through
+} Cell;
+
+typedef struct Portal {
+    AABB bounds; // World space
+    int cells[2];
+} Portal;
+
+typedef struct CellGraph {
+    Cell* cells;
+    size_t cell_count;
+    Portal* portals;
+    size_t portal_count;
+
+    bool needs_build; // Rebuilt from the scene on the next visibility update
+
+    // Results of the last visibility update
+    int camera_cell; // -1 when the camera is outside every cell
+    size_t cells_visible;
+    size_t portals_tested;
+    size_t portals_passed;
+} CellGraph;
+
+/*
+ * Lifecycle
+ */
+CellGraph* create_cell_graph();
+void free_cell_graph(CellGraph* graph);
+
+/*
+ * Tagging
+ */
+
+// Role implied by a node name: "cell_*" or "portal_*", case-insensitive
+CellRole cell_role_from_name(const char* name);
+
+// Tag a node and make sure the scene has a graph to hold it
+void set_node_cell_role(struct Scene* scene, struct SceneNode* node, CellRole role);
+
+/*
+ * Build / query
+ */
+
+// Collect tagged nodes under root and link portals to cells. Needs world bounds.
+int build_cell_graph(CellGraph* graph, struct SceneNode* root);
+
+// Mark the graph for a rebuild, e.g. after cell or portal nodes moved
+void invalidate_cell_graph(CellGraph* graph);
+
+// Walk portals from the camera cell. Rebuilds the graph first if needed.
+void update_scene_cell_visibility(struct Scene* scene, vec3 eye, mat4 view_proj);
+
+// false only for cell nodes that were not reached this frame
+bool is_cell_node_visible(const CellGraph* graph, const struct SceneNode* node);
+
+#endif // _PORTAL_H_
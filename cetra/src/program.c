@@ -4,6 +4,7 @@
 #include "common.h"
 #include "ext/log.h"
 #include "program.h"
+#include "shadow.h"
 #include "util.h"
 
 ShaderProgram* create_program(const char* name) {
@@ -404,7 +405,8 @@ void setup_program_uniforms(ShaderProgram* program) {
 
     uniform_cache_standard(program->uniforms);
     uniform_cache_lights(program->uniforms, get_gl_max_lights());
-    uniform_cache_shadows(program->uniforms, 3);
+    uniform_cache_shadows(program->uniforms, MAX_SHADOW_LIGHTS, MAX_SHADOW_LAYERS,
+                          MAX_SHADOW_CASCADES);
 }
 
 ShaderProgram* create_pbr_program() {
@@ -455,6 +457,18 @@ ShaderProgram* create_xyz_program() {
     return program;
 }
 
+ShaderProgram* create_pbr_vat_program() {
+    ShaderProgram* program = NULL;
+
+    if ((program = create_program_from_source("pbr_vat", pbr_vat_vert_shader_str,
+                                              pbr_frag_shader_str, NULL)) == NULL) {
+        log_error("Failed to initialize PBR vertex animation shader program");
+        return NULL;
+    }
+
+    return program;
+}
+
 ShaderProgram* create_shadow_depth_program() {
     ShaderProgram* program = NULL;
 
@@ -467,36 +481,68 @@ ShaderProgram* create_shadow_depth_program() {
     return program;
 }
 
-ShaderProgram* create_skybox_program() {
+ShaderProgram* create_shadow_layered_program() {
     ShaderProgram* program = NULL;
 
-    if ((program = create_program_from_source("skybox", skybox_vert_shader_str,
-                                              skybox_frag_shader_str, NULL)) == NULL) {
-        log_error("Failed to initialize skybox shader program");
+    if ((program = create_program_from_source("shadow_layered", shadow_depth_vert_shader_str,
+                                              shadow_depth_frag_shader_str,
+                                              shadow_layered_geo_shader_str)) == NULL) {
+        log_error("Failed to initialize layered shadow shader program");
         return NULL;
     }
 
     return program;
 }
 
-ShaderProgram* create_ibl_equirect_to_cube_program() {
+ShaderProgram* create_skinning_program() {
+    ShaderProgram* program = create_program("skinning");
+    if (program == NULL) {
+        log_error("Failed to initialize skinning shader program");
+        return NULL;
+    }
+
+    // Vertex-only: outputs are captured by transform feedback, nothing is rasterized
+    Shader* vertex_shader = create_shader(VERTEX_SHADER, skinning_vert_shader_str);
+    if (!vertex_shader || !compile_shader(vertex_shader)) {
+        log_error("Skinning vertex shader compilation failed");
+        free_program(program);
+        return NULL;
+    }
+    attach_shader_to_program(program, vertex_shader);
+
+    // Interleaved to match SKIN_CACHE_TEXELS_PER_VERTEX texels per vertex
+    const char* varyings[] = {"skinnedPosition", "skinnedNormal", "skinnedTangent",
+                              "skinnedBitangent"};
+    glTransformFeedbackVaryings(program->id, 4, varyings, GL_INTERLEAVED_ATTRIBS);
+
+    if (!link_program(program)) {
+        log_error("Failed to initialize skinning shader program");
+        free_program(program);
+        return NULL;
+    }
+    setup_program_uniforms(program);
+
+    return program;
+}
+
+ShaderProgram* create_skybox_program() {
     ShaderProgram* program = NULL;
 
-    if ((program = create_program_from_source("ibl_equirect_to_cube", ibl_cubemap_vert_shader_str,
-                                              ibl_equirect_frag_shader_str, NULL)) == NULL) {
-        log_error("Failed to initialize IBL equirect-to-cube shader program");
+    if ((program = create_program_from_source("skybox", skybox_vert_shader_str,
+                                              skybox_frag_shader_str, NULL)) == NULL) {
+        log_error("Failed to initialize skybox shader program");
         return NULL;
     }
 
     return program;
 }
 
-ShaderProgram* create_ibl_irradiance_program() {
+ShaderProgram* create_ibl_equirect_to_cube_program() {
     ShaderProgram* program = NULL;
 
-    if ((program = create_program_from_source("ibl_irradiance", ibl_cubemap_vert_shader_str,
-                                              ibl_irradiance_frag_shader_str, NULL)) == NULL) {
-        log_error("Failed to initialize IBL irradiance shader program");
+    if ((program = create_program_from_source("ibl_equirect_to_cube", ibl_cubemap_vert_shader_str,
+                                              ibl_equirect_frag_shader_str, NULL)) == NULL) {
+        log_error("Failed to initialize IBL equirect-to-cube shader program");
         return NULL;
     }
 
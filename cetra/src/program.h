@@ -42,14 +42,16 @@ void setup_program_uniforms(ShaderProgram* program);
  */
 ShaderProgram* create_pbr_program();
 ShaderProgram* create_pbr_skinned_program();
+ShaderProgram* create_pbr_vat_program();
 ShaderProgram* create_shape_program();
 ShaderProgram* create_xyz_program();
 ShaderProgram* create_shadow_depth_program();
+ShaderProgram* create_shadow_layered_program();
+ShaderProgram* create_skinning_program();
 
 // IBL Programs
 ShaderProgram* create_skybox_program();
 ShaderProgram* create_ibl_equirect_to_cube_program();
-ShaderProgram* create_ibl_irradiance_program();
 ShaderProgram* create_ibl_prefilter_program();
 ShaderProgram* create_ibl_brdf_program();
 
@@ -1,4 +1,5 @@
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -20,39 +21,12 @@
 #include "engine.h"
 #include "util.h"
 #include "shadow.h"
+#include "shadow_atlas.h"
 #include "intersect.h"
-
-// Global animation state for skinned mesh rendering (set via set_render_animation_state)
-static AnimationState* g_current_animation_state = NULL;
-
-void set_render_animation_state(AnimationState* state) {
-    g_current_animation_state = state;
-}
-
-AnimationState* get_render_animation_state(void) {
-    return g_current_animation_state;
-}
-
-static void _update_skinning_uniforms(ShaderProgram* program, const Mesh* mesh) {
-    if (!program || !program->uniforms)
-        return;
-
-    UniformManager* u = program->uniforms;
-
-    if (mesh && mesh->is_skinned && g_current_animation_state &&
-        g_current_animation_state->active_bone_count > 0) {
-        uniform_set_int(u, "skinned", 1);
-
-        // Upload bone matrices
-        GLint loc = glGetUniformLocation(program->id, "boneMatrices[0]");
-        if (loc >= 0) {
-            glUniformMatrix4fv(loc, (GLsizei)g_current_animation_state->active_bone_count, GL_FALSE,
-                               (const GLfloat*)g_current_animation_state->bone_matrices);
-        }
-    } else {
-        uniform_set_int(u, "skinned", 0);
-    }
-}
+#include "occlusion.h"
+#include "bone_palette.h"
+#include "skin_cache.h"
+#include "crowd.h"
 
 static void _update_program_light_uniforms(ShaderProgram* program, Light* light, size_t light_count,
                                            size_t index) {
@@ -247,11 +221,56 @@ static void _update_camera_uniforms(ShaderProgram* program, Camera* camera) {
     uniform_set_float(u, "farClip", camera->far_clip);
 }
 
+// Per-program state, set whenever the bound program changes
+static void _setup_program(Scene* scene, ShaderProgram* program, Camera* camera, mat4 view,
+                           mat4 projection, float time_value, RenderMode render_mode,
+                           Light** closest_lights, size_t returned_light_count) {
+    UniformManager* u = program->uniforms;
+
+    // Set view/projection/camera uniforms once per program switch
+    uniform_set_mat4(u, "view", (const float*)view);
+    uniform_set_mat4(u, "projection", (const float*)projection);
+    uniform_set_float(u, "time", time_value);
+    uniform_set_int(u, "renderMode", render_mode);
+    _update_camera_uniforms(program, camera);
+
+    // Lights of the node that triggered the switch
+    for (size_t j = 0; j < returned_light_count; ++j) {
+        _update_program_light_uniforms(program, closest_lights[j], returned_light_count, j);
+    }
+
+    // Bind shadow maps (always bind textures to satisfy the shadow samplers)
+    if (scene && scene->shadow_system)
+        bind_shadow_maps_to_program(scene->shadow_system, program, closest_lights,
+                                    returned_light_count);
+    else
+        bind_no_shadows_to_program(program);
+
+    // Bind IBL textures if available
+    if (scene && scene->ibl && scene->ibl->precomputed) {
+        bind_ibl_textures(scene->ibl, program);
+    } else {
+        // Set IBL sampler uniforms to their designated texture units even when disabled
+        // This prevents type mismatch when samplerCube defaults to unit 0 (which has 2D
+        // textures)
+        uniform_set_int(u, "prefilteredMap", 15);
+        uniform_set_int(u, "brdfLUT", 16);
+        uniform_set_int(u, "iblEnabled", 0);
+    }
+
+    // Skinned programs read instance records from the palette, vertices from the skin cache
+    if (scene) {
+        bind_bone_palette(scene->bone_palette, program);
+        bind_skin_cache(scene->skin_cache, program);
+    }
+}
+
 static void _render_node(Scene* scene, SceneNode* node, Camera* camera, mat4 model, mat4 view,
                          mat4 projection, float time_value, RenderMode render_mode,
                          Light** closest_lights, size_t returned_light_count,
                          GLuint* current_program, Material** current_material,
-                         const Frustum* frustum) {
+                         const Frustum* frustum, OcclusionBuffer* occlusion,
+                         RenderStats* stats) {
 
     if (!node->meshes || node->mesh_count == 0)
         return;
@@ -261,12 +280,37 @@ static void _render_node(Scene* scene, SceneNode* node, Camera* camera, mat4 mod
         if (!mesh || !mesh->material)
             continue;
 
-        // Frustum culling: skip mesh if its AABB is completely outside the view frustum
-        if (frustum && !frustum_test_aabb_transformed(frustum, mesh->aabb.min, mesh->aabb.max,
+        stats->meshes_considered++;
+
+        // Frustum culling: skip mesh if its AABB is completely outside the view frustum.
+        // Animated skinned meshes are tested with their posed bounds.
+        vec3 local_min, local_max;
+        get_node_mesh_aabb(node, mesh, local_min, local_max);
+        if (frustum && !frustum_test_aabb_transformed(frustum, local_min, local_max,
                                                       node->global_transform)) {
+            stats->frustum_culled++;
             continue;
         }
 
+        // Occlusion culling: skip mesh if its box is hidden behind rasterized occluders
+        if (occlusion && !mesh->is_occluder) {
+            vec3 world_min, world_max;
+            aabb_transform(local_min, local_max, node->global_transform, world_min, world_max);
+            if (!occlusion_test_aabb(occlusion, world_min, world_max)) {
+                stats->occlusion_culled++;
+                continue;
+            }
+        }
+
+        // Pre-skinned meshes are drawn instanced once the frame's records are complete
+        if (mesh->is_skinned && scene && scene->bone_palette) {
+            int vertex_base = find_skinned_vertices(scene->skin_cache, mesh,
+                                                    get_node_animation_state(node));
+            if (vertex_base >= 0 &&
+                queue_skinned_instance(scene->bone_palette, mesh, node, vertex_base) == 0)
+                continue;
+        }
+
         Material* mat = mesh->material;
         ShaderProgram* program = mat->shader_program;
         if (!program || !program->uniforms)
@@ -281,49 +325,8 @@ static void _render_node(Scene* scene, SceneNode* node, Camera* camera, mat4 mod
             // Force material update when program changes
             *current_material = NULL;
 
-            // Set view/projection/camera uniforms once per program switch
-            uniform_set_mat4(u, "view", (const float*)view);
-            uniform_set_mat4(u, "projection", (const float*)projection);
-            uniform_set_float(u, "time", time_value);
-            uniform_set_int(u, "renderMode", render_mode);
-            _update_camera_uniforms(program, camera);
-
-            // Update lights once per program switch for this node
-            for (size_t j = 0; j < returned_light_count; ++j) {
-                _update_program_light_uniforms(program, closest_lights[j], returned_light_count, j);
-            }
-
-            // Bind shadow maps (always bind texture to satisfy sampler2DArray)
-            if (scene && scene->shadow_system) {
-                if (scene->shadow_system->active_count > 0) {
-                    int shadow_indices[MAX_SHADOW_LIGHTS] = {-1, -1, -1};
-                    for (size_t k = 0; k < returned_light_count && k < MAX_SHADOW_LIGHTS; ++k) {
-                        shadow_indices[k] = closest_lights[k]->shadow_map_index;
-                    }
-                    bind_shadow_maps_to_program(scene->shadow_system, program, shadow_indices);
-                } else {
-                    // No active shadows, but still bind texture for sampler2DArray
-                    glActiveTexture(GL_TEXTURE0 + SHADOW_MAP_TEXTURE_UNIT);
-                    glBindTexture(GL_TEXTURE_2D_ARRAY, scene->shadow_system->shadow_map_array);
-                    uniform_set_int(u, "shadowMaps", SHADOW_MAP_TEXTURE_UNIT);
-                    uniform_set_int(u, "numShadowLights", 0);
-                }
-            } else {
-                uniform_set_int(u, "numShadowLights", 0);
-            }
-
-            // Bind IBL textures if available
-            if (scene && scene->ibl && scene->ibl->precomputed) {
-                bind_ibl_textures(scene->ibl, program);
-            } else {
-                // Set IBL sampler uniforms to their designated texture units even when disabled
-                // This prevents type mismatch when samplerCube defaults to unit 0 (which has 2D
-                // textures)
-                uniform_set_int(u, "irradianceMap", 14);
-                uniform_set_int(u, "prefilteredMap", 15);
-                uniform_set_int(u, "brdfLUT", 16);
-                uniform_set_int(u, "iblEnabled", 0);
-            }
+            _setup_program(scene, program, camera, view, projection, time_value, render_mode,
+                           closest_lights, returned_light_count);
         }
 
         // Per-mesh uniforms (model matrix is always per-mesh)
@@ -336,8 +339,8 @@ static void _render_node(Scene* scene, SceneNode* node, Camera* camera, mat4 mod
             *current_material = mat;
         }
 
-        // Update skinning uniforms for skinned meshes
-        _update_skinning_uniforms(program, mesh);
+        // Skinned meshes without a pose draw in bind pose
+        uniform_set_int(u, "skinned", 0);
 
         // Set mesh-specific uniforms for vertex colors and UV1
         uniform_set_int(u, "vertexColorExists", mesh->colors ? 1 : 0);
@@ -351,6 +354,7 @@ static void _render_node(Scene* scene, SceneNode* node, Camera* camera, mat4 mod
         glBindVertexArray(mesh->vao);
         glDrawElements(mesh->draw_mode, mesh->index_count, GL_UNSIGNED_INT, 0);
         glBindVertexArray(0);
+        stats->draws++;
 
         if (mat->doubleSided) {
             glEnable(GL_CULL_FACE);
@@ -410,7 +414,8 @@ static int _ensure_traversal_stack_capacity(Scene* scene, size_t required) {
 static void _render_scene_iterative(Scene* scene, SceneNode* root, Camera* camera, mat4 view,
                                     mat4 projection, float time_value, RenderMode render_mode,
                                     GLuint* current_program, Material** current_material,
-                                    const Frustum* frustum) {
+                                    const Frustum* frustum, OcclusionBuffer* occlusion,
+                                    RenderStats* stats) {
     if (!scene) {
         log_error("error: render called with NULL scene");
         return;
@@ -437,14 +442,32 @@ static void _render_scene_iterative(Scene* scene, SceneNode* root, Camera* camer
         // Pop from stack
         SceneNode* node = scene->traversal_stack[--stack_size];
 
-        // Get closest lights for this node
-        size_t returned_light_count;
-        Light** closest_lights = get_closest_lights(scene, node, max_lights, &returned_light_count);
+        // Skip whole subtrees whose cached world bounds are outside the view
+        if (frustum && node->has_bounds && !node->bounds_dirty &&
+            !frustum_test_aabb(frustum, node->world_bounds.min, node->world_bounds.max)) {
+            stats->meshes_considered += node->subtree_mesh_count;
+            stats->frustum_culled += node->subtree_mesh_count;
+            continue;
+        }
+
+        // Skip cells no portal chain reached from the camera
+        if (!is_cell_node_visible(scene->cell_graph, node)) {
+            stats->cells_culled++;
+            continue;
+        }
 
-        // Render this node's meshes
-        _render_node(scene, node, camera, node->global_transform, view, projection, time_value,
-                     render_mode, closest_lights, returned_light_count, current_program,
-                     current_material, frustum);
+        // Portal nodes only mark openings between cells
+        if (node->cell_role != CELL_ROLE_PORTAL) {
+            // Get closest lights for this node
+            size_t returned_light_count;
+            Light** closest_lights =
+                get_closest_lights(scene, node, max_lights, &returned_light_count);
+
+            // Render this node's meshes
+            _render_node(scene, node, camera, node->global_transform, view, projection, time_value,
+                         render_mode, closest_lights, returned_light_count, current_program,
+                         current_material, frustum, occlusion, stats);
+        }
 
         // Render xyz axes if enabled
         if (node->show_xyz && node->xyz_shader_program) {
@@ -469,6 +492,218 @@ static void _render_scene_iterative(Scene* scene, SceneNode* root, Camera* camer
     }
 }
 
+// Group queued skinned draws by program, material and mesh
+static int _compare_skinned_instances(const void* a, const void* b) {
+    const SkinnedInstance* x = a;
+    const SkinnedInstance* y = b;
+    uintptr_t kx[3] = {(uintptr_t)x->mesh->material->shader_program,
+                       (uintptr_t)x->mesh->material, (uintptr_t)x->mesh};
+    uintptr_t ky[3] = {(uintptr_t)y->mesh->material->shader_program,
+                       (uintptr_t)y->mesh->material, (uintptr_t)y->mesh};
+    for (int i = 0; i < 3; i++) {
+        if (kx[i] != ky[i])
+            return kx[i] < ky[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+// Draw the skinned meshes queued by _render_node, one instanced call per shared mesh
+static void _render_skinned_instances(Scene* scene, Camera* camera, mat4 view, mat4 projection,
+                                      float time_value, RenderMode render_mode,
+                                      GLuint* current_program, Material** current_material,
+                                      RenderStats* stats) {
+    BonePalette* palette = scene->bone_palette;
+    if (!palette || palette->instance_count == 0)
+        return;
+
+    size_t count = palette->instance_count;
+    qsort(palette->instances, count, sizeof(SkinnedInstance), _compare_skinned_instances);
+
+    // Instance records follow the palettes, contiguous in sorted order
+    int records = -1;
+    for (size_t i = 0; i < count; i++) {
+        SkinnedInstance* inst = &palette->instances[i];
+        int offset =
+            write_palette_instance(palette, inst->node->global_transform, inst->vertex_base);
+        if (offset < 0) {
+            count = i;
+            break;
+        }
+        if (i == 0)
+            records = offset;
+    }
+    if (count == 0 || upload_bone_palette(palette) != 0)
+        return;
+
+    size_t max_lights = get_gl_max_lights();
+    for (size_t start = 0, end; start < count; start = end) {
+        SkinnedInstance* first = &palette->instances[start];
+        for (end = start + 1; end < count; end++) {
+            if (_compare_skinned_instances(first, &palette->instances[end]) != 0)
+                break;
+        }
+
+        Mesh* mesh = first->mesh;
+        Material* mat = mesh->material;
+        ShaderProgram* program = mat->shader_program;
+        if (!program || !program->uniforms)
+            continue;
+
+        UniformManager* u = program->uniforms;
+
+        if (*current_program != program->id) {
+            glUseProgram(program->id);
+            *current_program = program->id;
+            *current_material = NULL;
+
+            size_t light_count;
+            Light** lights = get_closest_lights(scene, first->node, max_lights, &light_count);
+            _setup_program(scene, program, camera, view, projection, time_value, render_mode,
+                           lights, light_count);
+        }
+
+        if (*current_material != mat) {
+            _update_program_material_uniforms(program, mat);
+            *current_material = mat;
+        }
+
+        uniform_set_float(u, "lineWidth", mesh->line_width);
+        uniform_set_int(u, "skinned", 1);
+        uniform_set_int(u, "instanceOffset",
+                        records + (int)(start * BONE_PALETTE_TEXELS_PER_INSTANCE));
+        uniform_set_int(u, "vertexColorExists", mesh->colors ? 1 : 0);
+        uniform_set_int(u, "texCoords2Exists", mesh->tex_coords2 ? 1 : 0);
+
+        if (mat->doubleSided) {
+            glDisable(GL_CULL_FACE);
+        }
+
+        glBindVertexArray(mesh->vao);
+        glDrawElementsInstanced(mesh->draw_mode, mesh->index_count, GL_UNSIGNED_INT, 0,
+                                (GLsizei)(end - start));
+        glBindVertexArray(0);
+        stats->draws++;
+        stats->skinned_instances += end - start;
+
+        if (mat->doubleSided) {
+            glEnable(GL_CULL_FACE);
+        }
+    }
+}
+
+// Draw each visible crowd with one instanced call; clip playback runs in the shader
+static void _render_crowds(Engine* engine, Scene* scene, Camera* camera, mat4 view,
+                           mat4 projection, float time_value, RenderMode render_mode,
+                           GLuint* current_program, Material** current_material,
+                           const Frustum* frustum, RenderStats* stats) {
+    if (scene->crowd_count == 0)
+        return;
+
+    ShaderProgram* program = get_engine_shader_program_by_name(engine, "pbr_vat");
+    if (!program || !program->uniforms)
+        return;
+
+    UniformManager* u = program->uniforms;
+    size_t max_lights = get_gl_max_lights();
+
+    for (size_t i = 0; i < scene->crowd_count; i++) {
+        Crowd* crowd = scene->crowds[i];
+        Mesh* mesh = crowd->mesh;
+        if (crowd->instance_count == 0 || !mesh || !mesh->material)
+            continue;
+
+        vec3 world_min, world_max;
+        get_crowd_world_bounds(crowd, world_min, world_max);
+        if (frustum && !frustum_test_aabb(frustum, world_min, world_max)) {
+            stats->frustum_culled++;
+            continue;
+        }
+
+        if (upload_crowd(crowd) != 0)
+            continue;
+
+        // Lights differ per crowd, so set up the program for each
+        SceneNode* node = crowd->node ? crowd->node : scene->root_node;
+        if (*current_program != program->id) {
+            glUseProgram(program->id);
+            *current_program = program->id;
+            *current_material = NULL;
+        }
+        size_t light_count;
+        Light** lights = get_closest_lights(scene, node, max_lights, &light_count);
+        _setup_program(scene, program, camera, view, projection, time_value, render_mode,
+                       lights, light_count);
+
+        Material* mat = mesh->material;
+        if (*current_material != mat) {
+            _update_program_material_uniforms(program, mat);
+            *current_material = mat;
+        }
+
+        mat4 model = GLM_MAT4_IDENTITY_INIT;
+        if (crowd->node)
+            glm_mat4_copy(crowd->node->global_transform, model);
+        uniform_set_mat4(u, "model", (const float*)model);
+        uniform_set_float(u, "lineWidth", mesh->line_width);
+        uniform_set_int(u, "vertexColorExists", mesh->colors ? 1 : 0);
+        uniform_set_int(u, "texCoords2Exists", mesh->tex_coords2 ? 1 : 0);
+        bind_crowd(crowd, program);
+
+        if (mat->doubleSided) {
+            glDisable(GL_CULL_FACE);
+        }
+
+        glBindVertexArray(mesh->vao);
+        glDrawElementsInstanced(mesh->draw_mode, mesh->index_count, GL_UNSIGNED_INT, 0,
+                                (GLsizei)crowd->instance_count);
+        glBindVertexArray(0);
+        stats->draws++;
+        stats->crowd_instances += crowd->instance_count;
+
+        if (mat->doubleSided) {
+            glEnable(GL_CULL_FACE);
+        }
+    }
+}
+
+// Rasterize visible occluder meshes into the occlusion buffer and build its pyramid
+static void _rasterize_scene_occluders(Scene* scene, SceneNode* root, const Frustum* frustum,
+                                       OcclusionBuffer* occlusion) {
+    size_t stack_size = 0;
+    scene->traversal_stack[stack_size++] = root;
+
+    while (stack_size > 0) {
+        SceneNode* node = scene->traversal_stack[--stack_size];
+
+        if (node->has_bounds && !node->bounds_dirty &&
+            !frustum_test_aabb(frustum, node->world_bounds.min, node->world_bounds.max)) {
+            continue;
+        }
+        if (!is_cell_node_visible(scene->cell_graph, node))
+            continue;
+
+        for (size_t i = 0; node->cell_role != CELL_ROLE_PORTAL && i < node->mesh_count; i++) {
+            Mesh* mesh = node->meshes[i];
+            if (!mesh || !mesh->is_occluder)
+                continue;
+            occlusion_rasterize_mesh(occlusion, mesh->occluder_proxy ? mesh->occluder_proxy : mesh,
+                                     node->global_transform);
+        }
+
+        for (size_t i = node->children_count; i > 0; i--) {
+            if (!node->children[i - 1])
+                continue;
+            if (stack_size >= scene->traversal_stack_capacity &&
+                _ensure_traversal_stack_capacity(scene, stack_size + 1) != 0) {
+                break;
+            }
+            scene->traversal_stack[stack_size++] = node->children[i - 1];
+        }
+    }
+
+    occlusion_build_pyramid(occlusion);
+}
+
 void render_current_scene(Engine* engine, float time_value) {
     if (!engine) {
         log_error("error: render called with NULL engine");
@@ -504,12 +739,67 @@ void render_current_scene(Engine* engine, float time_value) {
     Frustum frustum;
     frustum_extract_from_vp(vp, &frustum);
 
+    RenderStats* stats = &engine->render_stats;
+    memset(stats, 0, sizeof(*stats));
+
+    if (scene->animation_world) {
+        stats->animated_instances = scene->animation_world->updated_count;
+        stats->bones_evaluated = scene->animation_world->evaluated_bones;
+    }
+
+    if (scene->shadow_system) {
+        const ShadowSystem* ss = scene->shadow_system;
+        stats->shadow_layers = ss->active_count > 0 ? ss->layer_count : 0;
+        stats->shadow_rebuilds = ss->static_rebuilds;
+        for (size_t i = 0; i < stats->shadow_layers; i++) {
+            stats->shadow_casters[i] = ss->casters[i].caster_count;
+            stats->shadow_culled += ss->casters[i].culled_count;
+        }
+        if (ss->active_count > 0 && ss->atlas) {
+            stats->shadow_tiles = ss->atlas->tile_count;
+            for (size_t i = 0; i < ss->atlas->tile_count; i++)
+                stats->shadow_culled += ss->atlas->tiles[i].culled_count;
+        }
+    }
+
+    // Animation updates dirty the bounds of posed skinned meshes; refresh them so subtree
+    // culling below keeps working for characters
+    update_node_bounds(root_node);
+
+    // Cell/portal visibility: walk portals from the camera's cell
+    if (scene->cell_graph) {
+        update_scene_cell_visibility(scene, camera->position, vp);
+        stats->cells_total = scene->cell_graph->cell_count;
+        stats->cells_visible = scene->cell_graph->cells_visible;
+        stats->portals_tested = scene->cell_graph->portals_tested;
+        stats->portals_passed = scene->cell_graph->portals_passed;
+    }
+
+    // Occlusion culling: occluders first, then every candidate is tested in _render_node
+    OcclusionBuffer* occlusion = NULL;
+    if (engine->occlusion && scene->traversal_stack) {
+        occlusion = engine->occlusion;
+        occlusion_begin_frame(occlusion, vp);
+        _rasterize_scene_occluders(scene, root_node, &frustum, occlusion);
+    }
+
     // Track current program and material to avoid redundant state changes
     GLuint current_program = 0;
     Material* current_material = NULL;
 
+    // Skin posed meshes once for every pass, unless the shadow pass already did
+    update_skin_cache(engine, scene);
+    begin_skinned_instances(scene->bone_palette);
+
     _render_scene_iterative(scene, root_node, camera, *view, *projection, time_value, render_mode,
-                            &current_program, &current_material, &frustum);
+                            &current_program, &current_material, &frustum, occlusion, stats);
+
+    // Skinned meshes queued during traversal, now that every palette is known
+    _render_skinned_instances(scene, camera, *view, *projection, time_value, render_mode,
+                              &current_program, &current_material, stats);
+
+    _render_crowds(engine, scene, camera, *view, *projection, time_value, render_mode,
+                   &current_program, &current_material, &frustum, stats);
 
     // Render skybox last (if enabled)
     if (scene->render_skybox && scene->ibl && scene->ibl->precomputed) {
@@ -8,6 +8,7 @@
 
 #include "ext/log.h"
 #include "scene.h"
+#include "intersect.h"
 #include "program.h"
 #include "shader.h"
 #include "mesh.h"
@@ -22,6 +23,162 @@
  */
 static void _set_xyz_program_for_nodes(SceneNode* node, ShaderProgram* program);
 
+/*
+ * Name index
+ */
+
+static NameIndex* _create_name_index(void) {
+    NameIndex* index = calloc(1, sizeof(NameIndex));
+    if (!index) {
+        log_error("Failed to allocate memory for name index");
+        return NULL;
+    }
+    return index;
+}
+
+static void _free_name_index(NameIndex* index) {
+    if (!index)
+        return;
+
+    NameIndexEntry* entry;
+    NameIndexEntry* tmp;
+    HASH_ITER(hh, index->entries, entry, tmp) {
+        HASH_DEL(index->entries, entry);
+        free(entry->name);
+        free(entry->nodes);
+        free(entry);
+    }
+    free(index);
+}
+
+static NameIndexEntry* _name_index_intern(NameIndex* index, const char* name) {
+    NameIndexEntry* entry = NULL;
+    HASH_FIND_STR(index->entries, name, entry);
+    if (entry)
+        return entry;
+
+    entry = calloc(1, sizeof(NameIndexEntry));
+    if (!entry) {
+        log_error("Failed to allocate name index entry");
+        return NULL;
+    }
+    entry->name = safe_strdup(name);
+    if (!entry->name) {
+        free(entry);
+        return NULL;
+    }
+    HASH_ADD_KEYPTR(hh, index->entries, entry->name, strlen(entry->name), entry);
+    return entry;
+}
+
+// Drop entries nothing refers to anymore
+static void _name_index_release(NameIndex* index, NameIndexEntry* entry) {
+    if (entry->node_count > 0 || entry->light || entry->camera)
+        return;
+    HASH_DEL(index->entries, entry);
+    free(entry->name);
+    free(entry->nodes);
+    free(entry);
+}
+
+static void _name_index_add_node(NameIndex* index, SceneNode* node) {
+    if (!node->name)
+        return;
+
+    NameIndexEntry* entry = _name_index_intern(index, node->name);
+    if (!entry)
+        return;
+
+    if (entry->node_count >= entry->node_capacity) {
+        size_t new_capacity = entry->node_capacity ? entry->node_capacity * 2 : 1;
+        SceneNode** new_nodes = realloc(entry->nodes, new_capacity * sizeof(SceneNode*));
+        if (!new_nodes) {
+            log_error("Failed to grow name index entry for '%s'", node->name);
+            return;
+        }
+        entry->nodes = new_nodes;
+        entry->node_capacity = new_capacity;
+    }
+    entry->nodes[entry->node_count++] = node;
+}
+
+static void _name_index_remove_node(NameIndex* index, SceneNode* node) {
+    if (!node->name)
+        return;
+
+    NameIndexEntry* entry = NULL;
+    HASH_FIND_STR(index->entries, node->name, entry);
+    if (!entry)
+        return;
+
+    // Keep registration order so duplicate names resolve consistently
+    for (size_t i = 0; i < entry->node_count; i++) {
+        if (entry->nodes[i] == node) {
+            memmove(&entry->nodes[i], &entry->nodes[i + 1],
+                    (entry->node_count - i - 1) * sizeof(SceneNode*));
+            entry->node_count--;
+            break;
+        }
+    }
+    _name_index_release(index, entry);
+}
+
+static void _register_node_names(SceneNode* node, NameIndex* index) {
+    if (!node)
+        return;
+
+    node->name_index = index;
+    _name_index_add_node(index, node);
+    for (size_t i = 0; i < node->children_count; i++) {
+        _register_node_names(node->children[i], index);
+    }
+}
+
+static void _unregister_node_names(SceneNode* node) {
+    if (!node || !node->name_index)
+        return;
+
+    _name_index_remove_node(node->name_index, node);
+    node->name_index = NULL;
+    for (size_t i = 0; i < node->children_count; i++) {
+        _unregister_node_names(node->children[i]);
+    }
+}
+
+static void _name_index_add_light(NameIndex* index, Light* light) {
+    if (!index || !light || !light->name)
+        return;
+    NameIndexEntry* entry = _name_index_intern(index, light->name);
+    if (entry && !entry->light)
+        entry->light = light;
+}
+
+static void _name_index_add_camera(NameIndex* index, Camera* camera) {
+    if (!index || !camera || !camera->name)
+        return;
+    NameIndexEntry* entry = _name_index_intern(index, camera->name);
+    if (entry && !entry->camera)
+        entry->camera = camera;
+}
+
+static void _name_index_clear_lights(NameIndex* index) {
+    NameIndexEntry* entry;
+    NameIndexEntry* tmp;
+    HASH_ITER(hh, index->entries, entry, tmp) {
+        entry->light = NULL;
+        _name_index_release(index, entry);
+    }
+}
+
+static void _name_index_clear_cameras(NameIndex* index) {
+    NameIndexEntry* entry;
+    NameIndexEntry* tmp;
+    HASH_ITER(hh, index->entries, entry, tmp) {
+        entry->camera = NULL;
+        _name_index_release(index, entry);
+    }
+}
+
 Scene* create_scene() {
     Scene* scene = malloc(sizeof(Scene));
     if (!scene) {
@@ -72,6 +229,15 @@ Scene* create_scene() {
     scene->skeleton_count = 0;
     scene->animations = NULL;
     scene->animation_count = 0;
+    scene->animation_world = create_animation_world(ANIMATION_WORLD_DEFAULT_THREADS);
+    scene->bone_palette = create_bone_palette();
+    scene->skin_cache = create_skin_cache();
+    scene->crowds = NULL;
+    scene->crowd_count = 0;
+
+    scene->name_index = _create_name_index();
+
+    scene->cell_graph = NULL;
 
     return scene;
 }
@@ -118,11 +284,32 @@ void free_scene(Scene* scene) {
         free(scene->materials);
     }
 
+    // Instances unbind from their nodes, so free them while the nodes still exist
+    free_animation_world(scene->animation_world);
+    scene->animation_world = NULL;
+    free_bone_palette(scene->bone_palette);
+    scene->bone_palette = NULL;
+    free_skin_cache(scene->skin_cache);
+    scene->skin_cache = NULL;
+
+    for (size_t i = 0; i < scene->crowd_count; i++) {
+        free_crowd(scene->crowds[i]);
+    }
+    free(scene->crowds);
+    scene->crowds = NULL;
+    scene->crowd_count = 0;
+
     // Free the root node and its subtree
     if (scene->root_node) {
         free_node(scene->root_node);
     }
 
+    _free_name_index(scene->name_index);
+    scene->name_index = NULL;
+
+    free_cell_graph(scene->cell_graph);
+    scene->cell_graph = NULL;
+
     // Free light cache
     if (scene->light_cache_pairs) {
         free(scene->light_cache_pairs);
@@ -182,7 +369,18 @@ void free_scene(Scene* scene) {
 void set_scene_root_node(Scene* scene, SceneNode* root_node) {
     if (!scene)
         return;
+
+    if (scene->root_node && scene->root_node != root_node)
+        _unregister_node_names(scene->root_node);
+
     scene->root_node = root_node;
+
+    if (root_node && scene->name_index && root_node->name_index != scene->name_index) {
+        _unregister_node_names(root_node);
+        _register_node_names(root_node, scene->name_index);
+    }
+
+    invalidate_cell_graph(scene->cell_graph);
 }
 
 /*
@@ -194,6 +392,13 @@ void set_scene_cameras(Scene* scene, Camera** cameras, size_t camera_count) {
         return;
     scene->cameras = cameras;
     scene->camera_count = camera_count;
+
+    if (scene->name_index) {
+        _name_index_clear_cameras(scene->name_index);
+        for (size_t i = 0; i < camera_count; i++) {
+            _name_index_add_camera(scene->name_index, cameras[i]);
+        }
+    }
 }
 
 void set_scene_lights(Scene* scene, Light** lights, size_t light_count) {
@@ -201,6 +406,13 @@ void set_scene_lights(Scene* scene, Light** lights, size_t light_count) {
         return;
     scene->lights = lights;
     scene->light_count = light_count;
+
+    if (scene->name_index) {
+        _name_index_clear_lights(scene->name_index);
+        for (size_t i = 0; i < light_count; i++) {
+            _name_index_add_light(scene->name_index, lights[i]);
+        }
+    }
 }
 
 int add_camera_to_scene(Scene* scene, Camera* camera) {
@@ -217,6 +429,7 @@ int add_camera_to_scene(Scene* scene, Camera* camera) {
     scene->cameras = new_cameras;
     scene->cameras[scene->camera_count] = camera;
     scene->camera_count = new_count;
+    _name_index_add_camera(scene->name_index, camera);
     return 0;
 }
 
@@ -224,6 +437,12 @@ Camera* find_camera_by_name(Scene* scene, const char* name) {
     if (!scene || !name)
         return NULL;
 
+    if (scene->name_index) {
+        NameIndexEntry* entry = NULL;
+        HASH_FIND_STR(scene->name_index->entries, name, entry);
+        return entry ? entry->camera : NULL;
+    }
+
     for (size_t i = 0; i < scene->camera_count; ++i) {
         Camera* cam = scene->cameras[i];
         if (cam && cam->name && strcmp(cam->name, name) == 0) {
@@ -250,6 +469,7 @@ int add_light_to_scene(Scene* scene, Light* light) {
     scene->lights = new_lights;
     scene->lights[scene->light_count] = light;
     scene->light_count = new_count;
+    _name_index_add_light(scene->name_index, light);
     return 0;
 }
 
@@ -257,6 +477,12 @@ Light* find_light_by_name(Scene* scene, const char* name) {
     if (!scene || !name)
         return NULL;
 
+    if (scene->name_index) {
+        NameIndexEntry* entry = NULL;
+        HASH_FIND_STR(scene->name_index->entries, name, entry);
+        return entry ? entry->light : NULL;
+    }
+
     for (size_t i = 0; i < scene->light_count; ++i) {
         Light* light = scene->lights[i];
         if (light && light->name && strcmp(light->name, name) == 0) {
@@ -464,6 +690,32 @@ Animation* find_animation_by_name(Scene* scene, const char* name) {
     return NULL;
 }
 
+int add_crowd_to_scene(Scene* scene, Crowd* crowd, SceneNode* node) {
+    if (!scene || !crowd)
+        return -1;
+
+    // Check if already added
+    for (size_t i = 0; i < scene->crowd_count; i++) {
+        if (scene->crowds[i] == crowd) {
+            crowd->node = node;
+            return 0;
+        }
+    }
+
+    size_t new_count = scene->crowd_count + 1;
+    Crowd** new_crowds = realloc(scene->crowds, new_count * sizeof(Crowd*));
+    if (!new_crowds) {
+        log_error("Failed to allocate memory for new crowd");
+        return -1;
+    }
+
+    crowd->node = node;
+    scene->crowds = new_crowds;
+    scene->crowds[scene->crowd_count] = crowd;
+    scene->crowd_count = new_count;
+    return 0;
+}
+
 GLboolean set_scene_xyz_shader_program(Scene* scene, ShaderProgram* xyz_shader_program) {
     if (!scene || !xyz_shader_program) {
         return GL_FALSE;
@@ -486,6 +738,7 @@ SceneNode* create_node() {
     }
 
     node->name = NULL;
+    node->name_index = NULL;
     node->parent = NULL;
     node->children = NULL;
     node->children_count = 0;
@@ -497,6 +750,23 @@ SceneNode* create_node() {
     node->light = NULL;
     node->camera = NULL;
 
+    glm_vec3_zero(node->mesh_bounds.min);
+    glm_vec3_zero(node->mesh_bounds.max);
+    glm_vec3_zero(node->world_bounds.min);
+    glm_vec3_zero(node->world_bounds.max);
+    node->has_mesh_bounds = false;
+    node->has_bounds = false;
+    node->bounds_dirty = true;
+
+    node->dynamic = false;
+    node->has_dynamic = false;
+    node->static_version = 0;
+
+    node->animation_state = NULL;
+
+    node->cell_role = CELL_ROLE_NONE;
+    node->cell_index = -1;
+
     // xyz
     node->show_xyz = true;
     glGenVertexArrays(1, &node->xyz_vao);
@@ -523,6 +793,10 @@ void free_node(SceneNode* node) {
     }
     free(node->meshes);
 
+    if (node->name_index) {
+        _name_index_remove_node(node->name_index, node);
+    }
+
     if (node->name) {
         free(node->name);
     }
@@ -549,6 +823,13 @@ int add_child_node(SceneNode* node, SceneNode* child) {
     node->children[node->children_count] = child;
     child->parent = node;
     node->children_count++;
+    mark_node_bounds_dirty(node);
+    mark_node_static_changed(node);
+
+    if (node->name_index && child->name_index != node->name_index) {
+        _unregister_node_names(child);
+        _register_node_names(child, node->name_index);
+    }
     return 0;
 }
 
@@ -566,13 +847,27 @@ int add_mesh_to_node(SceneNode* node, Mesh* mesh) {
     node->meshes = new_meshes;
     node->meshes[node->mesh_count] = mesh;
     node->mesh_count = new_count;
+    mesh->owner = node;
+    mark_node_bounds_dirty(node);
+    mark_node_static_changed(node);
     return 0;
 }
 
 void set_node_name(SceneNode* node, const char* name) {
     if (!node || !name)
         return;
-    node->name = safe_strdup(name);
+
+    // Copy first: name may alias node->name
+    char* new_name = safe_strdup(name);
+
+    if (node->name_index)
+        _name_index_remove_node(node->name_index, node);
+    free(node->name);
+
+    node->name = new_name;
+
+    if (node->name_index)
+        _name_index_add_node(node->name_index, node);
 }
 
 void set_node_light(SceneNode* node, Light* light) {
@@ -587,10 +882,31 @@ void set_node_camera(SceneNode* node, Camera* camera) {
     node->camera = camera;
 }
 
+static bool _node_in_subtree(const SceneNode* node, const SceneNode* root) {
+    for (; node; node = node->parent) {
+        if (node == root)
+            return true;
+    }
+    return false;
+}
+
 SceneNode* find_node_by_name(SceneNode* root, const char* name) {
     if (!root || !name)
         return NULL;
 
+    // Indexed trees: hash lookup, then pick the first match under root
+    if (root->name_index) {
+        NameIndexEntry* entry = NULL;
+        HASH_FIND_STR(root->name_index->entries, name, entry);
+        if (!entry)
+            return NULL;
+        for (size_t i = 0; i < entry->node_count; i++) {
+            if (_node_in_subtree(entry->nodes[i], root))
+                return entry->nodes[i];
+        }
+        return NULL;
+    }
+
     if (root->name && strcmp(root->name, name) == 0)
         return root;
 
@@ -716,9 +1032,119 @@ void upload_buffers_to_gpu_for_nodes(SceneNode* node) {
     }
 }
 
+/*
+ * Node bounds
+ */
+
+static void _aabb_union(AABB* dst, bool* has, AABB* src) {
+    if (!*has) {
+        *dst = *src;
+        *has = true;
+        return;
+    }
+    glm_vec3_minv(dst->min, src->min, dst->min);
+    glm_vec3_maxv(dst->max, src->max, dst->max);
+}
+
+void get_node_mesh_aabb(const SceneNode* node, const Mesh* mesh, vec3 out_min, vec3 out_max) {
+    AnimationState* state = mesh->is_skinned ? get_node_animation_state(node) : NULL;
+    if (state && state->active_bone_count > 0) {
+        calculate_posed_aabb(mesh, state->bone_matrices, state->active_bone_count, out_min,
+                             out_max);
+        return;
+    }
+    glm_vec3_copy((float*)mesh->aabb.min, out_min);
+    glm_vec3_copy((float*)mesh->aabb.max, out_max);
+}
+
+// Transform this node's mesh AABBs by its current global transform
+static void _update_node_mesh_bounds(SceneNode* node) {
+    node->has_mesh_bounds = false;
+    for (size_t i = 0; i < node->mesh_count; i++) {
+        Mesh* mesh = node->meshes[i];
+        if (!mesh || mesh->vertex_count == 0)
+            continue;
+
+        vec3 local_min, local_max;
+        get_node_mesh_aabb(node, mesh, local_min, local_max);
+
+        AABB world;
+        aabb_transform(local_min, local_max, node->global_transform, world.min, world.max);
+        _aabb_union(&node->mesh_bounds, &node->has_mesh_bounds, &world);
+    }
+}
+
+// Union of own mesh bounds and children's subtree bounds (children must be up to date)
+static void _refresh_node_bounds(SceneNode* node) {
+    node->has_bounds = false;
+    if (node->has_mesh_bounds)
+        _aabb_union(&node->world_bounds, &node->has_bounds, &node->mesh_bounds);
+
+    node->has_dynamic = node->dynamic;
+    node->subtree_mesh_count = 0;
+    for (size_t i = 0; i < node->mesh_count; i++) {
+        Mesh* mesh = node->meshes[i];
+        if (!mesh)
+            continue;
+        if (mesh->is_skinned)
+            node->has_dynamic = true;
+        if (mesh->material)
+            node->subtree_mesh_count++;
+    }
+
+    for (size_t i = 0; i < node->children_count; i++) {
+        SceneNode* child = node->children[i];
+        if (!child)
+            continue;
+        if (child->has_bounds)
+            _aabb_union(&node->world_bounds, &node->has_bounds, &child->world_bounds);
+        if (child->has_dynamic)
+            node->has_dynamic = true;
+        node->subtree_mesh_count += child->subtree_mesh_count;
+    }
+    node->bounds_dirty = false;
+}
+
+void mark_node_bounds_dirty(SceneNode* node) {
+    // Ancestors of a dirty node are already dirty, so stop early
+    for (; node && !node->bounds_dirty; node = node->parent) {
+        node->bounds_dirty = true;
+    }
+}
+
+void update_node_bounds(SceneNode* node) {
+    if (!node || !node->bounds_dirty)
+        return;
+
+    for (size_t i = 0; i < node->children_count; i++) {
+        update_node_bounds(node->children[i]);
+    }
+    _update_node_mesh_bounds(node);
+    _refresh_node_bounds(node);
+}
+
+void set_node_dynamic(SceneNode* node, bool dynamic) {
+    if (!node || node->dynamic == dynamic)
+        return;
+
+    node->dynamic = dynamic;
+    mark_node_bounds_dirty(node);
+    mark_node_static_changed(node);
+}
+
+void mark_node_static_changed(SceneNode* node) {
+    if (!node)
+        return;
+
+    while (node->parent)
+        node = node->parent;
+    node->static_version++;
+}
+
 typedef struct {
     SceneNode* node;
     mat4 parent_transform;
+    bool dynamic; // Under a dynamic node, so moves do not touch the static shadow cache
 } TransformStackEntry;
 
 void apply_transform_to_nodes(SceneNode* root, mat4 transform) {
@@ -737,17 +1163,31 @@ void apply_transform_to_nodes(SceneNode* root, mat4 transform) {
     // Push root node
     stack[stack_size].node = root;
     glm_mat4_copy(transform, stack[stack_size].parent_transform);
+    stack[stack_size].dynamic = false;
+    for (SceneNode* parent = root->parent; parent; parent = parent->parent)
+        stack[stack_size].dynamic |= parent->dynamic;
     stack_size++;
 
+    bool static_changed = false;
+
     while (stack_size > 0) {
         // Pop from stack
         stack_size--;
         SceneNode* node = stack[stack_size].node;
         mat4 parent_transform;
         glm_mat4_copy(stack[stack_size].parent_transform, parent_transform);
-
-        // Apply transform
-        glm_mat4_mul(parent_transform, node->original_transform, node->global_transform);
+        bool dynamic = stack[stack_size].dynamic || node->dynamic;
+
+        // Apply transform; only nodes whose meshes actually moved need new bounds
+        mat4 global_transform;
+        glm_mat4_mul(parent_transform, node->original_transform, global_transform);
+        if (node->mesh_count > 0 &&
+            memcmp(global_transform, node->global_transform, sizeof(mat4)) != 0) {
+            mark_node_bounds_dirty(node);
+            if (!dynamic)
+                static_changed = true;
+        }
+        glm_mat4_copy(global_transform, node->global_transform);
 
         // Update light position if present
         if (node->light) {
@@ -775,12 +1215,23 @@ void apply_transform_to_nodes(SceneNode* root, mat4 transform) {
 
                 stack[stack_size].node = node->children[i - 1];
                 glm_mat4_copy(node->global_transform, stack[stack_size].parent_transform);
+                stack[stack_size].dynamic = dynamic;
                 stack_size++;
             }
         }
     }
 
     free(stack);
+
+    // Rebuild dirty bounds from the top. Clean subtrees are skipped; a moved node dirtied
+    // all its ancestors, those above root included.
+    SceneNode* top = root;
+    while (top->parent)
+        top = top->parent;
+    update_node_bounds(top);
+
+    if (static_changed)
+        mark_node_static_changed(root);
 }
 
 void print_scene_node(const SceneNode* node, int depth) {
@@ -819,70 +1270,6 @@ void print_scene(const Scene* scene) {
     print_scene_node(scene->root_node, 0);
 }
 
-static void _compute_node_bounds(SceneNode* node, vec3 scene_min, vec3 scene_max,
-                                 bool* initialized) {
-    if (!node)
-        return;
-
-    for (size_t i = 0; i < node->mesh_count; i++) {
-        Mesh* mesh = node->meshes[i];
-        if (!mesh || mesh->vertex_count == 0)
-            continue;
-
-        // Transform mesh AABB corners by node's global transform
-        vec3 corners[8];
-        AABB* aabb = &mesh->aabb;
-
-        corners[0][0] = aabb->min[0];
-        corners[0][1] = aabb->min[1];
-        corners[0][2] = aabb->min[2];
-        corners[1][0] = aabb->max[0];
-        corners[1][1] = aabb->min[1];
-        corners[1][2] = aabb->min[2];
-        corners[2][0] = aabb->min[0];
-        corners[2][1] = aabb->max[1];
-        corners[2][2] = aabb->min[2];
-        corners[3][0] = aabb->max[0];
-        corners[3][1] = aabb->max[1];
-        corners[3][2] = aabb->min[2];
-        corners[4][0] = aabb->min[0];
-        corners[4][1] = aabb->min[1];
-        corners[4][2] = aabb->max[2];
-        corners[5][0] = aabb->max[0];
-        corners[5][1] = aabb->min[1];
-        corners[5][2] = aabb->max[2];
-        corners[6][0] = aabb->min[0];
-        corners[6][1] = aabb->max[1];
-        corners[6][2] = aabb->max[2];
-        corners[7][0] = aabb->max[0];
-        corners[7][1] = aabb->max[1];
-        corners[7][2] = aabb->max[2];
-
-        for (int c = 0; c < 8; c++) {
-            vec4 corner4 = {corners[c][0], corners[c][1], corners[c][2], 1.0f};
-            vec4 world_corner;
-            glm_mat4_mulv(node->global_transform, corner4, world_corner);
-
-            if (!*initialized) {
-                glm_vec3_copy((vec3){world_corner[0], world_corner[1], world_corner[2]}, scene_min);
-                glm_vec3_copy((vec3){world_corner[0], world_corner[1], world_corner[2]}, scene_max);
-                *initialized = true;
-            } else {
-                scene_min[0] = fminf(scene_min[0], world_corner[0]);
-                scene_min[1] = fminf(scene_min[1], world_corner[1]);
-                scene_min[2] = fminf(scene_min[2], world_corner[2]);
-                scene_max[0] = fmaxf(scene_max[0], world_corner[0]);
-                scene_max[1] = fmaxf(scene_max[1], world_corner[1]);
-                scene_max[2] = fmaxf(scene_max[2], world_corner[2]);
-            }
-        }
-    }
-
-    for (size_t i = 0; i < node->children_count; i++) {
-        _compute_node_bounds(node->children[i], scene_min, scene_max, initialized);
-    }
-}
-
 void compute_scene_bounds(Scene* scene, vec3 out_min, vec3 out_max) {
     if (!scene || !scene->root_node) {
         glm_vec3_zero(out_min);
@@ -890,13 +1277,17 @@ void compute_scene_bounds(Scene* scene, vec3 out_min, vec3 out_max) {
         return;
     }
 
-    bool initialized = false;
-    _compute_node_bounds(scene->root_node, out_min, out_max, &initialized);
+    // Normally a no-op: apply_transform_to_nodes keeps the root bounds current
+    update_node_bounds(scene->root_node);
 
-    if (!initialized) {
+    if (!scene->root_node->has_bounds) {
         glm_vec3_zero(out_min);
         glm_vec3_zero(out_max);
+        return;
     }
+
+    glm_vec3_copy(scene->root_node->world_bounds.min, out_min);
+    glm_vec3_copy(scene->root_node->world_bounds.max, out_max);
 }
 
 void compute_scene_center_and_radius(Scene* scene, vec3 out_center, float* out_radius) {
@@ -15,12 +15,40 @@
 #include "shadow.h"
 #include "ibl.h"
 #include "animation.h"
+#include "animation_world.h"
+#include "bone_palette.h"
+#include "skin_cache.h"
+#include "crowd.h"
+#include "portal.h"
+#include "ext/uthash.h"
+
+struct SceneNode;
+
+/*
+ * Name index
+ */
+
+// Hash entry for an interned name -> nodes, light and camera carrying it
+typedef struct NameIndexEntry {
+    char* name;               // Interned key, owned by the entry
+    struct SceneNode** nodes; // In registration order
+    size_t node_count;
+    size_t node_capacity;
+    Light* light;   // First light registered under this name
+    Camera* camera; // First camera registered under this name
+    UT_hash_handle hh;
+} NameIndexEntry;
+
+typedef struct NameIndex {
+    NameIndexEntry* entries;
+} NameIndex;
 
 /*
  * SceneNode
  */
 typedef struct SceneNode {
     char* name;
+    NameIndex* name_index; // Index of the owning scene, NULL while detached
 
     struct SceneNode* parent;
     struct SceneNode** children;
@@ -36,6 +64,26 @@ typedef struct SceneNode {
 
     Camera* camera;
 
+    // Pose for skinned meshes in this subtree, owned by the scene's animation world
+    AnimationState* animation_state;
+
+    // World-space bounds, rebuilt for dirty subtrees by apply_transform_to_nodes
+    AABB mesh_bounds;  // This node's own meshes
+    AABB world_bounds; // Own meshes plus all descendants
+    bool has_mesh_bounds;
+    bool has_bounds;   // false when the subtree has no geometry
+    bool bounds_dirty; // Set on this node and its ancestors when the subtree changes
+    size_t subtree_mesh_count; // Drawable meshes in this subtree, counted with the bounds
+
+    // Shadow caching: static casters are drawn once into cached maps, dynamic ones per frame
+    bool dynamic;            // Subtree moves often, so it never enters the static cache
+    bool has_dynamic;        // Subtree has a dynamic node or a skinned mesh; refreshed with bounds
+    unsigned static_version; // On a root: bumped whenever static casters below it change
+
+    // Cell/portal visibility
+    CellRole cell_role;
+    int cell_index; // Index into the scene's cell graph, -1 when untagged or not built
+
     bool show_xyz;
     GLuint xyz_vao;
     GLuint xyz_vbo;
@@ -71,6 +119,18 @@ void set_shader_programs_for_nodes(SceneNode* node, ShaderProgram* standard,
 // move
 void apply_transform_to_nodes(SceneNode* node, mat4 transform);
 
+// bounds
+void mark_node_bounds_dirty(SceneNode* node);
+void update_node_bounds(SceneNode* node);
+
+// shadow caching
+void set_node_dynamic(SceneNode* node, bool dynamic);
+// Invalidate the cached static shadows of node's graph
+void mark_node_static_changed(SceneNode* node);
+
+// Mesh-space bounds of mesh on node: posed for animated skinned meshes, else mesh->aabb
+void get_node_mesh_aabb(const SceneNode* node, const Mesh* mesh, vec3 out_min, vec3 out_max);
+
 /*
  * Scene
  */
@@ -121,6 +181,19 @@ typedef struct Scene {
     size_t skeleton_count;
     Animation** animations;
     size_t animation_count;
+    AnimationWorld* animation_world; // Per-instance animation states
+    BonePalette* bone_palette;       // Per-frame skinning matrices for all drawn instances
+    SkinCache* skin_cache;           // Pre-skinned vertices shared by every pass
+
+    // Vertex-animated crowds (owned; their vertex animations are not)
+    Crowd** crowds;
+    size_t crowd_count;
+
+    // Name lookup for nodes, lights and cameras
+    NameIndex* name_index;
+
+    // Cell/portal visibility, NULL unless some node is tagged as a cell or portal
+    CellGraph* cell_graph;
 } Scene;
 
 // malloc
@@ -153,6 +226,9 @@ Skeleton* find_skeleton_by_name(Scene* scene, const char* name);
 int add_animation_to_scene(Scene* scene, Animation* animation);
 Animation* find_animation_by_name(Scene* scene, const char* name);
 
+// crowd; node places and lights the crowd, NULL for the scene root
+int add_crowd_to_scene(Scene* scene, Crowd* crowd, SceneNode* node);
+
 // viz
 GLboolean set_scene_xyz_shader_program(Scene* scene, ShaderProgram* xyz_shader_program);
 GLboolean set_scene_outlines_shader_program(Scene* scene, ShaderProgram* outlines_shader_program);
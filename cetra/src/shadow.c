@@ -1,4 +1,5 @@
 
+#include <float.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
@@ -12,7 +13,10 @@
 #include "light.h"
 #include "mesh.h"
 #include "engine.h"
+#include "intersect.h"
 #include "shadow.h"
+#include "shadow_atlas.h"
+#include "skin_cache.h"
 #include "ext/log.h"
 
 ShadowSystem* create_shadow_system(int default_map_size) {
@@ -25,6 +29,16 @@ ShadowSystem* create_shadow_system(int default_map_size) {
 
     system->default_map_size = default_map_size;
     system->active_count = 0;
+    system->layer_count = 0;
+    system->cascade_count = DEFAULT_SHADOW_CASCADES;
+    system->split_lambda = 0.75f;
+    system->shadow_distance = 3000.0f;
+    system->caster_extent = 2000.0f;
+    system->layered = true;
+    system->cache_static = true;
+    system->filter = SHADOW_FILTER_POISSON;
+    system->filter_radius = 1.5f;
+    system->light_size = 8.0f;
     system->ortho_size = 2000.0f;
     system->near_plane = 1.0f;
     system->far_plane = 7500.0f;
@@ -32,7 +46,13 @@ ShadowSystem* create_shadow_system(int default_map_size) {
     system->depth_program = NULL;
     system->initialized = false;
 
-    for (int i = 0; i < MAX_SHADOW_LIGHTS; i++) {
+    system->atlas = create_shadow_atlas();
+    if (!system->atlas) {
+        free(system);
+        return NULL;
+    }
+
+    for (int i = 0; i < MAX_SHADOW_LAYERS; i++) {
         system->casters[i].initialized = false;
         system->casters[i].fbo = 0;
         system->casters[i].depth_texture = 0;
@@ -50,8 +70,9 @@ void free_shadow_system(ShadowSystem* system) {
         return;
 
     free_shadow_map_array(system);
+    free_shadow_atlas(system->atlas);
 
-    for (int i = 0; i < MAX_SHADOW_LIGHTS; i++) {
+    for (int i = 0; i < MAX_SHADOW_LAYERS; i++) {
         free_shadow_caster(&system->casters[i]);
     }
 
@@ -114,26 +135,66 @@ void free_shadow_caster(ShadowCaster* caster) {
     caster->initialized = false;
 }
 
-int init_shadow_map_array(ShadowSystem* system) {
-    if (!system)
+// (Re)allocate a depth array texture with room for layers layers
+static int _alloc_layer_texture(GLuint* texture, int size, int layers) {
+    if (!*texture)
+        glGenTextures(1, texture);
+    if (!*texture) {
+        log_error("Failed to create shadow map array");
         return -1;
+    }
 
-    if (system->shadow_map_array != 0)
-        return 0;
-
-    int size = system->default_map_size;
-
-    glGenTextures(1, &system->shadow_map_array);
-    glBindTexture(GL_TEXTURE_2D_ARRAY, system->shadow_map_array);
-    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, size, size, MAX_SHADOW_LIGHTS, 0,
+    glBindTexture(GL_TEXTURE_2D_ARRAY, *texture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, size, size, layers, 0,
                  GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    // Compared in hardware; linear filtering blends the four nearest comparisons
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
     glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
     glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
     float border_color[] = {1.0f, 1.0f, 1.0f, 1.0f};
     glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border_color);
     glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    return 0;
+}
+
+static int _alloc_shadow_layers(ShadowSystem* system, int layers) {
+    int size = system->default_map_size;
+
+    if (_alloc_layer_texture(&system->shadow_map_array, size, layers) != 0)
+        return -1;
+    if (system->static_map_array &&
+        _alloc_layer_texture(&system->static_map_array, size, layers) != 0)
+        return -1;
+
+    // Reallocation discards contents, cached or not
+    for (int i = 0; i < MAX_SHADOW_LAYERS; i++) {
+        system->casters[i].static_valid = false;
+        system->casters[i].live_is_static = false;
+    }
+
+    system->layer_capacity = layers;
+    return 0;
+}
+
+// Grow the array so this frame's cascades fit; a scene with one sun keeps three layers
+static int _reserve_shadow_layers(ShadowSystem* system, int layers) {
+    if (layers <= system->layer_capacity)
+        return 0;
+    return _alloc_shadow_layers(system, layers);
+}
+
+int init_shadow_map_array(ShadowSystem* system) {
+    if (!system)
+        return -1;
+
+    if (system->shadow_map_array != 0)
+        return 0;
+
+    if (_alloc_shadow_layers(system, DEFAULT_SHADOW_CASCADES) != 0)
+        return -1;
 
     glGenFramebuffers(1, &system->casters[0].fbo);
     glBindFramebuffer(GL_FRAMEBUFFER, system->casters[0].fbo);
@@ -141,6 +202,17 @@ int init_shadow_map_array(ShadowSystem* system) {
     glReadBuffer(GL_NONE);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
+    // Overrides the comparison on the units it is bound to, so the same textures can also
+    // be read as raw depth
+    float border_color[] = {1.0f, 1.0f, 1.0f, 1.0f};
+    glGenSamplers(1, &system->depth_sampler);
+    glSamplerParameteri(system->depth_sampler, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glSamplerParameteri(system->depth_sampler, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glSamplerParameteri(system->depth_sampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glSamplerParameteri(system->depth_sampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    glSamplerParameterfv(system->depth_sampler, GL_TEXTURE_BORDER_COLOR, border_color);
+    glSamplerParameteri(system->depth_sampler, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+
     system->initialized = true;
     return 0;
 }
@@ -153,39 +225,69 @@ void free_shadow_map_array(ShadowSystem* system) {
         glDeleteTextures(1, &system->shadow_map_array);
         system->shadow_map_array = 0;
     }
+    if (system->static_map_array) {
+        glDeleteTextures(1, &system->static_map_array);
+        system->static_map_array = 0;
+    }
+    system->layer_capacity = 0;
 
     if (system->casters[0].fbo) {
         glDeleteFramebuffers(1, &system->casters[0].fbo);
         system->casters[0].fbo = 0;
     }
+    if (system->static_fbo) {
+        glDeleteFramebuffers(1, &system->static_fbo);
+        system->static_fbo = 0;
+    }
+    if (system->depth_sampler) {
+        glDeleteSamplers(1, &system->depth_sampler);
+        system->depth_sampler = 0;
+    }
+    for (int i = 0; i < MAX_SHADOW_LAYERS; i++) {
+        system->casters[i].static_valid = false;
+        system->casters[i].live_is_static = false;
+    }
 
     system->initialized = false;
 }
 
-void begin_shadow_pass(ShadowSystem* system, size_t caster_index) {
-    if (!system || caster_index >= MAX_SHADOW_LIGHTS)
-        return;
-
-    if (!system->initialized) {
-        if (init_shadow_map_array(system) != 0)
-            return;
-    }
-
+// Attach one layer of texture to fbo, or every layer when layer is -1, and set the viewport
+static int _bind_shadow_target(ShadowSystem* system, GLuint fbo, GLuint texture, int layer,
+                               bool clear) {
     int size = system->default_map_size;
 
-    glBindFramebuffer(GL_FRAMEBUFFER, system->casters[0].fbo);
-    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, system->shadow_map_array, 0,
-                              (GLint)caster_index);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    if (layer < 0)
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0);
+    else
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, layer);
 
     GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
     if (status != GL_FRAMEBUFFER_COMPLETE) {
         log_error("Shadow framebuffer incomplete: 0x%x", status);
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        return;
+        return -1;
     }
 
     glViewport(0, 0, size, size);
-    glClear(GL_DEPTH_BUFFER_BIT);
+    if (clear)
+        glClear(GL_DEPTH_BUFFER_BIT);
+    return 0;
+}
+
+void begin_shadow_pass(ShadowSystem* system, size_t caster_index) {
+    if (!system || caster_index >= MAX_SHADOW_LAYERS)
+        return;
+
+    if (!system->initialized) {
+        if (init_shadow_map_array(system) != 0)
+            return;
+    }
+    if ((int)caster_index >= system->layer_capacity)
+        return;
+
+    _bind_shadow_target(system, system->casters[0].fbo, system->shadow_map_array,
+                        (int)caster_index, true);
 }
 
 void end_shadow_pass(ShadowSystem* system) {
@@ -219,8 +321,95 @@ void compute_directional_light_space_matrix(vec3 direction, vec3 scene_center, f
     glm_mat4_mul(light_projection, light_view, dest);
 }
 
-void bind_shadow_maps_to_program(ShadowSystem* system, ShaderProgram* program,
-                                 const int* shadow_light_indices) {
+void compute_cascade_splits(float near_clip, float far_clip, int count, float lambda,
+                            float* out_splits) {
+    for (int i = 0; i < count; i++) {
+        float p = (float)(i + 1) / (float)count;
+        float log_split = near_clip * powf(far_clip / near_clip, p);
+        float uniform_split = near_clip + (far_clip - near_clip) * p;
+        out_splits[i] = lambda * log_split + (1.0f - lambda) * uniform_split;
+    }
+}
+
+void compute_cascade_light_space_matrix(vec3 direction, mat4 view, float fov_radians,
+                                        float aspect_ratio, float slice_near, float slice_far,
+                                        float caster_extent, int map_size, mat4 dest) {
+    // World-space corners of the slice
+    mat4 slice_projection, slice_vp, inv_vp;
+    glm_perspective(fov_radians, aspect_ratio, slice_near, slice_far, slice_projection);
+    glm_mat4_mul(slice_projection, view, slice_vp);
+    glm_mat4_inv(slice_vp, inv_vp);
+
+    vec3 corners[8];
+    vec3 center = {0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 8; i++) {
+        vec4 ndc = {(i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f,
+                    1.0f};
+        vec4 world;
+        glm_mat4_mulv(inv_vp, ndc, world);
+        glm_vec3_scale(world, 1.0f / world[3], corners[i]);
+        glm_vec3_add(center, corners[i], center);
+    }
+    glm_vec3_scale(center, 1.0f / 8.0f, center);
+
+    // A bounding sphere keeps the volume's size fixed as the camera turns, so only
+    // translation has to be snapped
+    float radius = 0.0f;
+    for (int i = 0; i < 8; i++)
+        radius = fmaxf(radius, glm_vec3_distance(corners[i], center));
+    radius = ceilf(radius * 16.0f) / 16.0f;
+
+    vec3 light_dir;
+    glm_vec3_normalize_to(direction, light_dir);
+
+    vec3 up = {0.0f, 1.0f, 0.0f};
+    if (fabsf(glm_vec3_dot(light_dir, up)) > 0.99f) {
+        up[0] = 1.0f;
+        up[1] = 0.0f;
+    }
+
+    // Move the centre in light-space steps of a fraction of the radius, padding the radius by
+    // one step so the slice stays covered. The fit, and with it any cached static layer, then
+    // only changes once the camera has moved a whole step.
+    float step = radius * SHADOW_CASCADE_SNAP_FRACTION;
+    vec3 eye = {0.0f, 0.0f, 0.0f};
+    mat4 light_rotation;
+    glm_lookat(eye, light_dir, up, light_rotation);
+
+    vec3 snapped;
+    glm_mat4_mulv3(light_rotation, center, 1.0f, snapped);
+    for (int i = 0; i < 3; i++)
+        snapped[i] = roundf(snapped[i] / step) * step;
+    glm_mat4_transpose(light_rotation);
+    glm_mat4_mulv3(light_rotation, snapped, 1.0f, center);
+    radius += step;
+
+    vec3 light_pos;
+    glm_vec3_scale(light_dir, -(radius + caster_extent), light_pos);
+    glm_vec3_add(light_pos, center, light_pos);
+
+    mat4 light_view, light_projection;
+    glm_lookat(light_pos, center, up, light_view);
+    glm_ortho(-radius, radius, -radius, radius, 0.0f, 2.0f * radius + caster_extent,
+              light_projection);
+
+    // Snap the world origin to a texel so static edges stay put between frames
+    mat4 light_space;
+    glm_mat4_mul(light_projection, light_view, light_space);
+    vec4 origin = {0.0f, 0.0f, 0.0f, 1.0f};
+    glm_mat4_mulv(light_space, origin, origin);
+
+    float half_size = (float)map_size * 0.5f;
+    float offset_x = (roundf(origin[0] * half_size) - origin[0] * half_size) / half_size;
+    float offset_y = (roundf(origin[1] * half_size) - origin[1] * half_size) / half_size;
+    light_projection[3][0] += offset_x;
+    light_projection[3][1] += offset_y;
+
+    glm_mat4_mul(light_projection, light_view, dest);
+}
+
+void bind_shadow_maps_to_program(ShadowSystem* system, ShaderProgram* program, Light** lights,
+                                 size_t light_count) {
     if (!system || !program || !program->uniforms)
         return;
 
@@ -228,58 +417,685 @@ void bind_shadow_maps_to_program(ShadowSystem* system, ShaderProgram* program,
 
     glActiveTexture(GL_TEXTURE0 + SHADOW_MAP_TEXTURE_UNIT);
     glBindTexture(GL_TEXTURE_2D_ARRAY, system->shadow_map_array);
+    glActiveTexture(GL_TEXTURE0 + SHADOW_DEPTH_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, system->shadow_map_array);
+    glBindSampler(SHADOW_DEPTH_TEXTURE_UNIT, system->depth_sampler);
+    glActiveTexture(GL_TEXTURE0);
     uniform_set_int(u, "shadowMaps", SHADOW_MAP_TEXTURE_UNIT);
+    uniform_set_int(u, "shadowDepthMaps", SHADOW_DEPTH_TEXTURE_UNIT);
+    bind_shadow_atlas(system->atlas, program, system->depth_sampler);
 
-    uniform_set_int(u, "numShadowLights", (int)system->active_count);
+    uniform_set_int(u, "shadowFilter", (int)system->filter);
+    uniform_set_float(u, "shadowFilterRadius", system->filter_radius);
+    uniform_set_float(u, "shadowLightSize", system->light_size);
 
     float texel_size = 1.0f / (float)system->default_map_size;
     GLint loc = uniform_location(u, "shadowTexelSize");
     if (loc >= 0)
         glUniform2f(loc, texel_size, texel_size);
 
-    for (size_t i = 0; i < system->active_count && i < MAX_SHADOW_LIGHTS; i++) {
-        ShadowCaster* caster = &system->casters[i];
-
-        char name[64];
-
+    char name[64];
+    for (size_t i = 0; i < system->layer_count && i < MAX_SHADOW_LAYERS; i++) {
         snprintf(name, sizeof(name), "lightSpaceMatrix[%zu]", i);
         loc = uniform_location(u, name);
         if (loc >= 0)
-            glUniformMatrix4fv(loc, 1, GL_FALSE, (const GLfloat*)caster->light_space_matrix);
+            glUniformMatrix4fv(loc, 1, GL_FALSE,
+                               (const GLfloat*)system->casters[i].light_space_matrix);
+    }
+
+    for (int c = 0; c < system->cascade_count && c < MAX_SHADOW_CASCADES; c++) {
+        snprintf(name, sizeof(name), "cascadeSplits[%d]", c);
+        uniform_set_float(u, name, system->cascade_splits[c]);
+    }
+
+    // Slots go to this draw's shadowed lights in light uniform order
+    int slot = 0;
+    for (size_t k = 0; k < light_count && slot < MAX_SHADOW_LIGHTS; k++) {
+        const Light* light = lights[k];
+        if (!light || light->shadow_map_index < 0 ||
+            (size_t)light->shadow_map_index >= system->active_count)
+            continue;
+
+        const ShadowLight* shadow_light = &system->lights[light->shadow_map_index];
+
+        snprintf(name, sizeof(name), "shadowLightIndex[%d]", slot);
+        uniform_set_int(u, name, (int)k);
+
+        snprintf(name, sizeof(name), "shadowFirstLayer[%d]", slot);
+        uniform_set_int(u, name, shadow_light->first_layer);
+
+        snprintf(name, sizeof(name), "shadowCascadeCount[%d]", slot);
+        uniform_set_int(u, name, shadow_light->cascade_count);
+
+        snprintf(name, sizeof(name), "shadowFirstTile[%d]", slot);
+        uniform_set_int(u, name, shadow_light->first_tile);
+        slot++;
+    }
+    uniform_set_int(u, "numShadowLights", slot);
+
+    uniform_set_float(u, "shadowBias", system->casters[0].bias);
+}
+
+void bind_no_shadows_to_program(ShaderProgram* program) {
+    if (!program || !program->uniforms)
+        return;
+
+    UniformManager* u = program->uniforms;
+
+    glActiveTexture(GL_TEXTURE0 + SHADOW_MAP_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    glActiveTexture(GL_TEXTURE0 + SHADOW_DEPTH_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    glActiveTexture(GL_TEXTURE0);
+    uniform_set_int(u, "shadowMaps", SHADOW_MAP_TEXTURE_UNIT);
+    uniform_set_int(u, "shadowDepthMaps", SHADOW_DEPTH_TEXTURE_UNIT);
+    bind_shadow_atlas(NULL, program, 0);
 
-        snprintf(name, sizeof(name), "shadowLightIndex[%zu]", i);
-        uniform_set_int(u, name, shadow_light_indices ? shadow_light_indices[i] : (int)i);
+    uniform_set_int(u, "numShadowLights", 0);
+}
 
-        uniform_set_float(u, "shadowBias", caster->bias);
+const char* shadow_filter_name(ShadowFilter filter) {
+    switch (filter) {
+    case SHADOW_FILTER_HARD:
+        return "Hard";
+    case SHADOW_FILTER_POISSON:
+        return "Poisson PCF";
+    case SHADOW_FILTER_PCSS:
+        return "PCSS";
+    default:
+        return "Unknown";
     }
 }
 
-static void _render_shadow_node(SceneNode* node, ShaderProgram* program, GLuint* current_program) {
+// Light volume of a caster for culling. The near plane is dropped so occluders between
+// the light and the volume still cast; depth clamping flattens them onto the near plane.
+static void _extract_caster_frustum(const ShadowCaster* caster, Frustum* frustum) {
+    frustum_extract_from_vp((vec4*)caster->light_space_matrix, frustum);
+    glm_vec4_copy((vec4){0.0f, 0.0f, 0.0f, 1.0f}, frustum->planes[FRUSTUM_NEAR]);
+}
+
+static void _draw_shadow_mesh(Scene* scene, SceneNode* node, Mesh* mesh,
+                              ShaderProgram* program) {
+    // Skinned meshes cast from the pose the pre-pass wrote
+    int vertex_base = -1;
+    if (mesh->is_skinned)
+        vertex_base =
+            find_skinned_vertices(scene->skin_cache, mesh, get_node_animation_state(node));
+    uniform_set_int(program->uniforms, "skinned", vertex_base >= 0 ? 1 : 0);
+    uniform_set_int(program->uniforms, "vertexBase", vertex_base >= 0 ? vertex_base : 0);
+
+    glBindVertexArray(mesh->vao);
+    glDrawElements(mesh->draw_mode, mesh->index_count, GL_UNSIGNED_INT, 0);
+    glBindVertexArray(0);
+}
+
+typedef enum ShadowCasterFilter {
+    SHADOW_CASTERS_ALL,
+    SHADOW_CASTERS_STATIC,  // Into the static cache
+    SHADOW_CASTERS_DYNAMIC, // On top of a copied static layer
+} ShadowCasterFilter;
+
+static bool _casts_in_pass(ShadowCasterFilter filter, bool dynamic) {
+    if (filter == SHADOW_CASTERS_STATIC)
+        return !dynamic;
+    if (filter == SHADOW_CASTERS_DYNAMIC)
+        return dynamic;
+    return true;
+}
+
+// Whether node's subtree can contribute to the pass; dynamic is inherited from ancestors.
+// Cells the camera cannot see still cast into the cells it can, through portals and
+// openings, so camera cell visibility plays no part here.
+static bool _visit_shadow_node(const SceneNode* node, ShadowCasterFilter filter, bool dynamic) {
+    if (filter == SHADOW_CASTERS_STATIC)
+        return !dynamic;
+    if (filter == SHADOW_CASTERS_DYNAMIC)
+        return dynamic || node->has_dynamic || node->bounds_dirty;
+    return true;
+}
+
+static void _render_shadow_node(Scene* scene, SceneNode* node, ShaderProgram* program,
+                                const Frustum* frustum, ShadowCaster* caster,
+                                ShadowCasterFilter filter, bool dynamic) {
     if (!node)
         return;
 
-    if (node->meshes && node->mesh_count > 0) {
-        if (*current_program != program->id) {
-            glUseProgram(program->id);
-            *current_program = program->id;
+    dynamic = dynamic || node->dynamic;
+    if (!_visit_shadow_node(node, filter, dynamic))
+        return;
+
+    // Whole subtree outside the light volume, using the bounds the main pass culls with
+    if (node->has_bounds && !node->bounds_dirty &&
+        !frustum_test_aabb(frustum, node->world_bounds.min, node->world_bounds.max)) {
+        caster->culled_count++;
+        return;
+    }
+
+    if (node->meshes && node->mesh_count > 0 && node->cell_role != CELL_ROLE_PORTAL) {
+        bool model_set = false;
+
+        for (size_t i = 0; i < node->mesh_count; ++i) {
+            Mesh* mesh = node->meshes[i];
+            if (!mesh || mesh->vao == 0 || !_casts_in_pass(filter, dynamic || mesh->is_skinned))
+                continue;
+
+            vec3 local_min, local_max;
+            get_node_mesh_aabb(node, mesh, local_min, local_max);
+            if (!frustum_test_aabb_transformed(frustum, local_min, local_max,
+                                               node->global_transform)) {
+                caster->culled_count++;
+                continue;
+            }
+
+            if (!model_set) {
+                uniform_set_mat4(program->uniforms, "model", (const float*)node->global_transform);
+                model_set = true;
+            }
+
+            _draw_shadow_mesh(scene, node, mesh, program);
+            caster->caster_count++;
         }
+    }
+
+    for (size_t i = 0; i < node->children_count; i++) {
+        _render_shadow_node(scene, node->children[i], program, frustum, caster, filter,
+                            dynamic);
+    }
+}
 
-        uniform_set_mat4(program->uniforms, "model", (const float*)node->global_transform);
+/*
+ * Layered pass
+ */
+
+// Layers of mask whose light volume overlaps the world-space box. Layers dropped from
+// mask count the box as culled.
+static unsigned _overlapping_layers(ShadowSystem* ss, const Frustum* frustums, unsigned mask,
+                                    vec3 world_min, vec3 world_max) {
+    unsigned overlap = 0;
+    for (size_t i = 0; i < ss->layer_count; i++) {
+        if (!(mask & (1u << i)))
+            continue;
+        if (frustum_test_aabb(&frustums[i], world_min, world_max))
+            overlap |= 1u << i;
+        else
+            ss->casters[i].culled_count++;
+    }
+    return overlap;
+}
+
+// shadow_layered_geo.glsl takes triangles in; drawing any other primitive with it bound is
+// GL_INVALID_OPERATION
+static bool _is_triangle_mode(MeshDrawMode mode) {
+    return mode == TRIANGLES || mode == TRIANGLE_STRIP || mode == TRIANGLE_FAN;
+}
+
+// Submit each caster once; the geometry shader emits it into every layer in layerMask.
+// Children are only tested against the layers their parent overlaps. Point and line meshes
+// are skipped, as the geometry shader can't take them.
+static void _render_shadow_node_layered(Scene* scene, SceneNode* node, ShaderProgram* program,
+                                        const Frustum* frustums, unsigned parent_mask,
+                                        ShadowCasterFilter filter, bool dynamic) {
+    if (!node)
+        return;
+
+    dynamic = dynamic || node->dynamic;
+    if (!_visit_shadow_node(node, filter, dynamic))
+        return;
+
+    ShadowSystem* ss = scene->shadow_system;
+    unsigned mask = parent_mask;
+    if (node->has_bounds && !node->bounds_dirty) {
+        mask = _overlapping_layers(ss, frustums, parent_mask, node->world_bounds.min,
+                                   node->world_bounds.max);
+        if (!mask)
+            return;
+    }
+
+    if (node->meshes && node->mesh_count > 0 && node->cell_role != CELL_ROLE_PORTAL) {
+        bool model_set = false;
 
         for (size_t i = 0; i < node->mesh_count; ++i) {
             Mesh* mesh = node->meshes[i];
-            if (!mesh || mesh->vao == 0)
+            if (!mesh || mesh->vao == 0 || !_is_triangle_mode(mesh->draw_mode) ||
+                !_casts_in_pass(filter, dynamic || mesh->is_skinned))
+                continue;
+
+            vec3 local_min, local_max, world_min, world_max;
+            get_node_mesh_aabb(node, mesh, local_min, local_max);
+            aabb_transform(local_min, local_max, node->global_transform, world_min, world_max);
+            unsigned mesh_mask = _overlapping_layers(ss, frustums, mask, world_min, world_max);
+            if (!mesh_mask)
                 continue;
 
-            glBindVertexArray(mesh->vao);
-            glDrawElements(mesh->draw_mode, mesh->index_count, GL_UNSIGNED_INT, 0);
-            glBindVertexArray(0);
+            if (!model_set) {
+                uniform_set_mat4(program->uniforms, "model", (const float*)node->global_transform);
+                model_set = true;
+            }
+            uniform_set_int(program->uniforms, "layerMask", (int)mesh_mask);
+
+            _draw_shadow_mesh(scene, node, mesh, program);
+            for (size_t l = 0; l < ss->layer_count; l++) {
+                if (mesh_mask & (1u << l))
+                    ss->casters[l].caster_count++;
+            }
         }
     }
 
     for (size_t i = 0; i < node->children_count; i++) {
-        _render_shadow_node(node->children[i], program, current_program);
+        _render_shadow_node_layered(scene, node->children[i], program, frustums, mask, filter,
+                                    dynamic);
+    }
+}
+
+// Draw into layers of texture (shadow_map_array or static_map_array) through fbo
+static void _render_shadow_layers(Scene* scene, ShaderProgram* program, const Frustum* frustums,
+                                  unsigned layers, ShadowCasterFilter filter, GLuint fbo,
+                                  GLuint texture, bool clear) {
+    ShadowSystem* ss = scene->shadow_system;
+
+    // With the whole array attached one clear covers every layer, so a partial redraw clears
+    // its own layers first
+    unsigned all_layers = (1u << ss->layer_count) - 1;
+    if (clear && layers != all_layers) {
+        for (size_t i = 0; i < ss->layer_count; i++) {
+            if ((layers & (1u << i)) && _bind_shadow_target(ss, fbo, texture, (int)i, true) != 0)
+                return;
+        }
+        clear = false;
+    }
+
+    if (_bind_shadow_target(ss, fbo, texture, -1, clear) != 0)
+        return;
+
+    // Vertices stay in world space until the geometry shader picks a layer's matrix
+    mat4 identity = GLM_MAT4_IDENTITY_INIT;
+    uniform_set_mat4(program->uniforms, "lightSpaceMatrix", (const float*)identity);
+
+    char name[32];
+    for (size_t i = 0; i < ss->layer_count; i++) {
+        snprintf(name, sizeof(name), "layerMatrices[%zu]", i);
+        uniform_set_mat4(program->uniforms, name, (const float*)ss->casters[i].light_space_matrix);
+    }
+
+    _render_shadow_node_layered(scene, scene->root_node, program, frustums, layers, filter,
+                                false);
+
+    end_shadow_pass(ss);
+}
+
+// One traversal per layer in layers
+static void _render_shadow_layer_passes(Scene* scene, ShaderProgram* program,
+                                        const Frustum* frustums, unsigned layers,
+                                        ShadowCasterFilter filter, GLuint fbo, GLuint texture,
+                                        bool clear) {
+    ShadowSystem* ss = scene->shadow_system;
+
+    for (size_t i = 0; i < ss->layer_count; ++i) {
+        if (!(layers & (1u << i)))
+            continue;
+
+        ShadowCaster* caster = &ss->casters[i];
+        if (_bind_shadow_target(ss, fbo, texture, (int)i, clear) != 0)
+            continue;
+
+        uniform_set_mat4(program->uniforms, "lightSpaceMatrix",
+                         (const float*)caster->light_space_matrix);
+        _render_shadow_node(scene, scene->root_node, program, &frustums[i], caster, filter,
+                            false);
+
+        end_shadow_pass(ss);
+    }
+}
+
+/*
+ * Static cache
+ */
+
+static int _init_static_cache(ShadowSystem* ss) {
+    if (ss->static_map_array)
+        return 0;
+
+    if (_alloc_layer_texture(&ss->static_map_array, ss->default_map_size, ss->layer_capacity) !=
+        0)
+        return -1;
+
+    glGenFramebuffers(1, &ss->static_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, ss->static_fbo);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return 0;
+}
+
+// A cached layer is stale once its fit, light or static geometry changed since it was drawn
+static bool _static_layer_stale(const Scene* scene, size_t layer) {
+    const ShadowCaster* caster = &scene->shadow_system->casters[layer];
+
+    return !caster->static_valid || caster->static_version != scene->root_node->static_version ||
+           memcmp(caster->static_matrix, caster->light_space_matrix, sizeof(mat4)) != 0;
+}
+
+static void _mark_static_layer_drawn(const Scene* scene, size_t layer) {
+    ShadowCaster* caster = &scene->shadow_system->casters[layer];
+
+    glm_mat4_copy(caster->light_space_matrix, caster->static_matrix);
+    caster->static_version = scene->root_node->static_version;
+    caster->static_valid = true;
+    caster->live_is_static = false;
+}
+
+static void _copy_static_layer(ShadowSystem* ss, size_t layer) {
+    int size = ss->default_map_size;
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, ss->static_fbo);
+    glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, ss->static_map_array, 0,
+                              (GLint)layer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, ss->casters[0].fbo);
+    glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, ss->shadow_map_array, 0,
+                              (GLint)layer);
+    glBlitFramebuffer(0, 0, size, size, 0, 0, size, size, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+/*
+ * Atlas lights
+ */
+
+// Cube faces in the order the shader picks them by major axis: +X, -X, +Y, -Y, +Z, -Z
+static const float _cube_face_dirs[6][3] = {
+    {1.0f, 0.0f, 0.0f}, {-1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f},
+    {0.0f, -1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, -1.0f},
+};
+static const float _cube_face_ups[6][3] = {
+    {0.0f, -1.0f, 0.0f}, {0.0f, -1.0f, 0.0f}, {0.0f, 0.0f, 1.0f},
+    {0.0f, 0.0f, -1.0f}, {0.0f, -1.0f, 0.0f}, {0.0f, -1.0f, 0.0f},
+};
+
+typedef struct AtlasCandidate {
+    Light* light;
+    float range;
+    float coverage; // Share of the screen height the light's range spans
+} AtlasCandidate;
+
+// Distance at which attenuation leaves 1/256 of the light's intensity, capped at the
+// caster extent; lights without falloff use the cap
+static float _local_light_range(const ShadowSystem* ss, const Light* light) {
+    float c = light->constant - 256.0f * fmaxf(light->intensity, 0.0f);
+    float range = ss->caster_extent;
+
+    if (light->quadratic > 0.0f) {
+        float disc = light->linear * light->linear - 4.0f * light->quadratic * c;
+        range = (-light->linear + sqrtf(fmaxf(disc, 0.0f))) / (2.0f * light->quadratic);
+    } else if (light->linear > 0.0f) {
+        range = -c / light->linear;
+    }
+    return glm_clamp(range, 1.0f, ss->caster_extent);
+}
+
+// Half-angle of a spot cone from the cosine in outerCutOff
+static float _spot_half_angle(const Light* light) {
+    float angle = acosf(glm_clamp(light->outerCutOff, -1.0f, 1.0f));
+    return glm_clamp(angle, glm_rad(1.0f), glm_rad(85.0f));
+}
+
+static int _compare_coverage(const void* a, const void* b) {
+    float ca = ((const AtlasCandidate*)a)->coverage;
+    float cb = ((const AtlasCandidate*)b)->coverage;
+    return (ca < cb) - (ca > cb);
+}
+
+static void _compute_tile_matrix(const Light* light, const float* direction, const float* up,
+                                 float fov, float range, ShadowCaster* tile) {
+    vec3 position, target, dir, view_up;
+    glm_vec3_copy((float*)light->global_position, position);
+    glm_vec3_copy((float*)direction, dir);
+    glm_vec3_copy((float*)up, view_up);
+    glm_vec3_add(position, dir, target);
+
+    mat4 view, projection;
+    glm_lookat(position, target, view_up, view);
+    tile->tile_near = fmaxf(range * 0.01f, 0.05f);
+    tile->tile_far = range;
+    glm_perspective(fov, 1.0f, tile->tile_near, tile->tile_far, projection);
+    glm_mat4_mul(projection, view, tile->light_space_matrix);
+}
+
+// Rank the point and spot lights in view, size and place their atlas tiles, and set up
+// one tile per spot light or cube face
+static void _assign_atlas_lights(Engine* engine, Scene* scene) {
+    ShadowSystem* ss = scene->shadow_system;
+    ShadowAtlas* atlas = ss->atlas;
+    if (!atlas)
+        return;
+    atlas->tile_count = 0;
+
+    Camera* camera = engine->camera;
+    Frustum view_frustum;
+    if (camera) {
+        mat4 vp;
+        glm_mat4_mul(engine->projection_matrix, engine->view_matrix, vp);
+        frustum_extract_from_vp(vp, &view_frustum);
+    }
+
+    // Most important lights, replacing the least important once full
+    AtlasCandidate candidates[MAX_SHADOW_ATLAS_LIGHTS];
+    size_t candidate_count = 0;
+
+    for (size_t i = 0; i < scene->light_count; ++i) {
+        Light* light = scene->lights[i];
+        if (!light || !light->cast_shadows ||
+            (light->type != LIGHT_POINT && light->type != LIGHT_SPOT))
+            continue;
+
+        AtlasCandidate candidate = {light, _local_light_range(ss, light), 0.0f};
+
+        // Without a camera every light gets the smallest tile
+        if (camera) {
+            vec3 lo, hi;
+            glm_vec3_subs(light->global_position, candidate.range, lo);
+            glm_vec3_adds(light->global_position, candidate.range, hi);
+            if (!frustum_test_aabb(&view_frustum, lo, hi))
+                continue;
+
+            float dist = glm_vec3_distance(camera->position, light->global_position);
+            float extent = dist * tanf(camera->fov_radians * 0.5f);
+            candidate.coverage =
+                dist <= candidate.range ? 1.0f : fminf(candidate.range / extent, 1.0f);
+        }
+
+        if (candidate_count < MAX_SHADOW_ATLAS_LIGHTS) {
+            candidates[candidate_count++] = candidate;
+            continue;
+        }
+        size_t weakest = 0;
+        for (size_t c = 1; c < candidate_count; c++) {
+            if (candidates[c].coverage < candidates[weakest].coverage)
+                weakest = c;
+        }
+        if (candidate.coverage > candidates[weakest].coverage)
+            candidates[weakest] = candidate;
+    }
+
+    qsort(candidates, candidate_count, sizeof(AtlasCandidate), _compare_coverage);
+
+    // Requests stop once this frame's tiles would run out
+    ShadowAtlasRequest requests[MAX_SHADOW_ATLAS_LIGHTS];
+    size_t request_count = 0;
+    int tiles_left = MAX_SHADOW_TILES;
+    for (size_t c = 0; c < candidate_count; c++) {
+        int faces = candidates[c].light->type == LIGHT_POINT ? 6 : 1;
+        if (faces > tiles_left)
+            continue;
+        tiles_left -= faces;
+
+        ShadowAtlasRequest* req = &requests[request_count];
+        req->light = candidates[c].light;
+        req->tile_size = shadow_tile_size_for_coverage(candidates[c].coverage);
+        req->face_count = faces;
+        req->entry = NULL;
+        candidates[request_count++] = candidates[c];
+    }
+
+    update_shadow_atlas(atlas, requests, request_count);
+
+    for (size_t r = 0; r < request_count; r++) {
+        const ShadowAtlasEntry* entry = requests[r].entry;
+        if (!entry || ss->active_count >= MAX_SHADOWED_LIGHTS)
+            continue;
+
+        Light* light = requests[r].light;
+        ShadowLight* shadow_light = &ss->lights[ss->active_count];
+        shadow_light->first_layer = 0;
+        shadow_light->cascade_count = 0;
+        shadow_light->first_tile = (int)atlas->tile_count;
+        shadow_light->tile_count = entry->face_count;
+        light->shadow_map_index = (int)ss->active_count++;
+
+        float range = candidates[r].range;
+        for (int f = 0; f < entry->face_count; f++) {
+            ShadowCaster* tile = &atlas->tiles[atlas->tile_count++];
+            tile->tile_x = entry->x[f];
+            tile->tile_y = entry->y[f];
+            tile->tile_size = entry->tile_size;
+            tile->map_size = entry->tile_size;
+
+            if (light->type == LIGHT_POINT) {
+                _compute_tile_matrix(light, _cube_face_dirs[f], _cube_face_ups[f],
+                                     glm_rad(90.0f), range, tile);
+                continue;
+            }
+
+            vec3 dir;
+            glm_vec3_normalize_to(light->direction, dir);
+            const float* up = fabsf(dir[1]) > 0.99f ? _cube_face_dirs[0] : _cube_face_dirs[2];
+            _compute_tile_matrix(light, dir, up, 2.0f * _spot_half_angle(light), range, tile);
+        }
+    }
+}
+
+// Every tile is redrawn each frame, scissored to its rect of the atlas
+static void _render_atlas_tiles(Scene* scene, ShaderProgram* program) {
+    ShadowAtlas* atlas = scene->shadow_system->atlas;
+    if (!atlas || atlas->tile_count == 0 || init_shadow_atlas_textures(atlas) != 0)
+        return;
+
+    glUseProgram(program->id);
+    bind_skin_cache(scene->skin_cache, program);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, atlas->fbo);
+    glEnable(GL_SCISSOR_TEST);
+
+    for (size_t i = 0; i < atlas->tile_count; i++) {
+        ShadowCaster* tile = &atlas->tiles[i];
+        tile->caster_count = 0;
+        tile->culled_count = 0;
+
+        glViewport(tile->tile_x, tile->tile_y, tile->tile_size, tile->tile_size);
+        glScissor(tile->tile_x, tile->tile_y, tile->tile_size, tile->tile_size);
+        glClear(GL_DEPTH_BUFFER_BIT);
+
+        Frustum frustum;
+        frustum_extract_from_vp((vec4*)tile->light_space_matrix, &frustum);
+        uniform_set_mat4(program->uniforms, "lightSpaceMatrix",
+                         (const float*)tile->light_space_matrix);
+        _render_shadow_node(scene, scene->root_node, program, &frustum, tile,
+                            SHADOW_CASTERS_ALL, false);
+    }
+
+    glDisable(GL_SCISSOR_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    upload_shadow_tiles(atlas);
+}
+
+/*
+ * Cascades
+ */
+
+static void _render_cascade_layers(Engine* engine, Scene* scene) {
+    ShadowSystem* ss = scene->shadow_system;
+
+    Frustum frustums[MAX_SHADOW_LAYERS];
+    for (size_t i = 0; i < ss->layer_count; ++i) {
+        ss->casters[i].caster_count = 0;
+        ss->casters[i].culled_count = 0;
+        _extract_caster_frustum(&ss->casters[i], &frustums[i]);
     }
+
+    // With several layers, one traversal through the geometry shader replaces one per layer
+    ShaderProgram* layered_program = NULL;
+    if (ss->layered && ss->layer_count > 1)
+        layered_program = get_engine_shader_program_by_name(engine, "shadow_layered");
+
+    ShaderProgram* pass_program = layered_program ? layered_program : ss->depth_program;
+    unsigned all_layers = (1u << ss->layer_count) - 1;
+    unsigned pass_layers = all_layers;
+    ShadowCasterFilter filter = SHADOW_CASTERS_ALL;
+    bool clear = true;
+
+    glEnable(GL_DEPTH_CLAMP);
+
+    // Static casters come from the cache. Layers that went stale are redrawn together in one
+    // pass, and only dynamic casters are drawn over the copied layers.
+    ss->static_rebuilds = 0;
+    if (ss->cache_static && scene->root_node && _init_static_cache(ss) == 0) {
+        bool any_dynamic = scene->root_node->has_dynamic;
+
+        unsigned stale_layers = 0;
+        for (size_t i = 0; i < ss->layer_count; ++i) {
+            if (_static_layer_stale(scene, i))
+                stale_layers |= 1u << i;
+        }
+
+        if (stale_layers) {
+            glUseProgram(pass_program->id);
+            if (layered_program)
+                _render_shadow_layers(scene, layered_program, frustums, stale_layers,
+                                      SHADOW_CASTERS_STATIC, ss->static_fbo,
+                                      ss->static_map_array, true);
+            else
+                _render_shadow_layer_passes(scene, ss->depth_program, frustums, stale_layers,
+                                            SHADOW_CASTERS_STATIC, ss->static_fbo,
+                                            ss->static_map_array, true);
+
+            for (size_t i = 0; i < ss->layer_count; ++i) {
+                if (stale_layers & (1u << i)) {
+                    _mark_static_layer_drawn(scene, i);
+                    ss->static_rebuilds++;
+                }
+            }
+        }
+
+        pass_layers = 0;
+        for (size_t i = 0; i < ss->layer_count; ++i) {
+            ShadowCaster* caster = &ss->casters[i];
+
+            // Nothing to do when the live layer already holds exactly the cached casters
+            if (caster->live_is_static && !any_dynamic)
+                continue;
+
+            _copy_static_layer(ss, i);
+            caster->live_is_static = !any_dynamic;
+            if (any_dynamic)
+                pass_layers |= 1u << i;
+        }
+
+        filter = SHADOW_CASTERS_DYNAMIC;
+        clear = false;
+    }
+
+    if (pass_layers) {
+        glUseProgram(pass_program->id);
+        bind_skin_cache(scene->skin_cache, pass_program);
+        if (layered_program)
+            _render_shadow_layers(scene, layered_program, frustums, pass_layers, filter,
+                                  ss->casters[0].fbo, ss->shadow_map_array, clear);
+        else
+            _render_shadow_layer_passes(scene, ss->depth_program, frustums, pass_layers, filter,
+                                        ss->casters[0].fbo, ss->shadow_map_array, clear);
+    }
+
+    glDisable(GL_DEPTH_CLAMP);
 }
 
 void render_shadow_depth_pass(Engine* engine, Scene* scene) {
@@ -288,22 +1104,42 @@ void render_shadow_depth_pass(Engine* engine, Scene* scene) {
 
     ShadowSystem* ss = scene->shadow_system;
 
-    // First count shadow-casting lights before doing any GL operations
+    // Hand out array layers to shadow-casting lights before doing any GL operations
+    Camera* camera = engine->camera;
+    int cascade_count = 1;
+    if (camera && ss->cascade_count > 1)
+        cascade_count = ss->cascade_count < MAX_SHADOW_CASCADES ? ss->cascade_count
+                                                                : MAX_SHADOW_CASCADES;
     ss->active_count = 0;
-    vec3 scene_center = {0.0f, 0.0f, 0.0f};
+    ss->layer_count = 0;
 
-    for (size_t i = 0; i < scene->light_count && ss->active_count < MAX_SHADOW_LIGHTS; ++i) {
+    for (size_t i = 0; i < scene->light_count; ++i) {
         Light* light = scene->lights[i];
         if (!light)
             continue;
 
-        if (light->type == LIGHT_DIRECTIONAL && light->cast_shadows) {
-            ss->active_count++;
-        } else {
-            light->shadow_map_index = -1;
-        }
+        light->shadow_map_index = -1;
+        if (light->type != LIGHT_DIRECTIONAL || !light->cast_shadows)
+            continue;
+
+        int layers = MAX_SHADOW_LAYERS - (int)ss->layer_count;
+        if (layers > cascade_count)
+            layers = cascade_count;
+        if (ss->active_count >= MAX_SHADOWED_LIGHTS || layers <= 0)
+            continue;
+
+        ShadowLight* shadow_light = &ss->lights[ss->active_count];
+        shadow_light->first_layer = (int)ss->layer_count;
+        shadow_light->cascade_count = layers;
+        shadow_light->first_tile = 0;
+        shadow_light->tile_count = 0;
+        light->shadow_map_index = (int)ss->active_count++;
+        ss->layer_count += layers;
     }
 
+    // Point and spot lights follow, into the atlas
+    _assign_atlas_lights(engine, scene);
+
     // Always initialize the shadow map array texture (needed for sampler2DArray in shader)
     if (!ss->initialized) {
         if (init_shadow_map_array(ss) != 0)
@@ -314,6 +1150,11 @@ void render_shadow_depth_pass(Engine* engine, Scene* scene) {
     if (ss->active_count == 0)
         return;
 
+    if (_reserve_shadow_layers(ss, (int)ss->layer_count) != 0) {
+        ss->active_count = 0;
+        return;
+    }
+
     // Now get the depth program for shadow rendering
     if (!ss->depth_program) {
         ss->depth_program = get_engine_shader_program_by_name(engine, "shadow_depth");
@@ -322,42 +1163,54 @@ void render_shadow_depth_pass(Engine* engine, Scene* scene) {
         }
     }
 
-    // Compute light space matrices for shadow-casting lights
-    size_t slot = 0;
-    for (size_t i = 0; i < scene->light_count && slot < MAX_SHADOW_LIGHTS; ++i) {
+    // Split the camera frustum; without a camera fall back to one fixed volume
+    if (camera) {
+        float shadow_far = fminf(camera->far_clip, ss->shadow_distance);
+        compute_cascade_splits(camera->near_clip, shadow_far, cascade_count, ss->split_lambda,
+                               ss->cascade_splits);
+    } else {
+        ss->cascade_splits[0] = FLT_MAX;
+    }
+
+    // Compute light space matrices for every cascade of every shadowed directional light
+    for (size_t i = 0; i < scene->light_count; ++i) {
         Light* light = scene->lights[i];
-        if (!light)
+        if (!light || light->shadow_map_index < 0 || light->type != LIGHT_DIRECTIONAL)
             continue;
 
-        if (light->type == LIGHT_DIRECTIONAL && light->cast_shadows) {
-            compute_directional_light_space_matrix(light->direction, scene_center, ss->ortho_size,
-                                                   ss->near_plane, ss->far_plane,
-                                                   ss->casters[slot].light_space_matrix);
+        const ShadowLight* shadow_light = &ss->lights[light->shadow_map_index];
+        for (int c = 0; c < shadow_light->cascade_count; c++) {
+            ShadowCaster* caster = &ss->casters[shadow_light->first_layer + c];
+            if (!camera) {
+                vec3 scene_center = {0.0f, 0.0f, 0.0f};
+                compute_directional_light_space_matrix(light->direction, scene_center,
+                                                       ss->ortho_size, ss->near_plane,
+                                                       ss->far_plane, caster->light_space_matrix);
+                continue;
+            }
 
-            light->shadow_map_index = (int)slot;
-            slot++;
+            float slice_near = c == 0 ? camera->near_clip : ss->cascade_splits[c - 1];
+            compute_cascade_light_space_matrix(
+                light->direction, engine->view_matrix, camera->fov_radians, camera->aspect_ratio,
+                slice_near, ss->cascade_splits[c], ss->caster_extent, ss->default_map_size,
+                caster->light_space_matrix);
         }
     }
 
+    // Casters are culled against subtree bounds, which animation may have dirtied
+    update_node_bounds(scene->root_node);
+
+    // Skin posed meshes once; the main pass reuses the result
+    update_skin_cache(engine, scene);
+
     GLint prev_viewport[4];
     glGetIntegerv(GL_VIEWPORT, prev_viewport);
 
     glCullFace(GL_FRONT);
 
-    GLuint current_program = 0;
-    glUseProgram(ss->depth_program->id);
-    current_program = ss->depth_program->id;
-
-    for (size_t i = 0; i < ss->active_count; ++i) {
-        begin_shadow_pass(ss, i);
-
-        uniform_set_mat4(ss->depth_program->uniforms, "lightSpaceMatrix",
-                         (const float*)ss->casters[i].light_space_matrix);
-
-        _render_shadow_node(scene->root_node, ss->depth_program, &current_program);
-
-        end_shadow_pass(ss);
-    }
+    if (ss->layer_count > 0)
+        _render_cascade_layers(engine, scene);
+    _render_atlas_tiles(scene, ss->depth_program);
 
     glCullFace(GL_BACK);
     glUseProgram(0);
@@ -8,13 +8,21 @@
 
 #include "program.h"
 
-#define MAX_SHADOW_LIGHTS       3
+#define MAX_SHADOW_LIGHTS       4  // Shadowed lights per draw
+#define MAX_SHADOWED_LIGHTS     40 // Per scene: cascaded directional lights plus atlas lights
+#define MAX_SHADOW_CASCADES     4
+#define MAX_SHADOW_LAYERS       8 // Layers of shadow_map_array, shared by every light's cascades
+#define DEFAULT_SHADOW_CASCADES 3
 #define DEFAULT_SHADOW_MAP_SIZE 2048
 #define SHADOW_MAP_TEXTURE_UNIT 13
+#define SHADOW_DEPTH_TEXTURE_UNIT 25 // shadow_map_array again, read without comparison
+#define SHADOW_CASCADE_SNAP_FRACTION 0.125f // Cascade centre step, as a share of its radius
 
 // Forward declarations
 struct Scene;
 struct Engine;
+struct Light;
+struct ShadowAtlas;
 
 typedef struct ShadowCaster {
     GLuint fbo;
@@ -24,17 +32,103 @@ typedef struct ShadowCaster {
     float bias;
     float normal_bias;
     bool initialized;
+
+    // Atlas rect in texels and perspective depth planes, for shadow atlas tiles
+    int tile_x;
+    int tile_y;
+    int tile_size;
+    float tile_near;
+    float tile_far;
+
+    // Last frame's shadow pass into this layer
+    size_t caster_count; // Meshes drawn
+    size_t culled_count; // Meshes and subtrees outside the light volume
+
+    // Static cache layer: what it was drawn with, and whether the live layer is a plain copy
+    mat4 static_matrix;
+    unsigned static_version;
+    bool static_valid;
+    bool live_is_static;
 } ShadowCaster;
 
+// Filtering of shadow lookups in the main pass. Every tap is a hardware depth comparison,
+// which the texture's linear filtering turns into a bilinear 2x2 PCF.
+typedef enum ShadowFilter {
+    SHADOW_FILTER_HARD,    // One tap
+    SHADOW_FILTER_POISSON, // Poisson disk of filter_radius, rotated per pixel
+    SHADOW_FILTER_PCSS,    // Blocker search, then a Poisson disk sized by the penumbra
+    SHADOW_FILTER_COUNT,
+} ShadowFilter;
+
+// A shadowed light's maps: cascades in consecutive layers of the shadow map array for
+// directional lights, consecutive atlas tiles (one per cube face for point lights) otherwise
+typedef struct ShadowLight {
+    int first_layer;
+    int cascade_count;
+    int first_tile;
+    int tile_count;
+} ShadowLight;
+
+/*
+ * Shadow System
+ *
+ * Directional lights use cascaded shadow maps: the camera frustum out to shadow_distance
+ * is split into cascade_count slices, blending logarithmic and uniform spacing by
+ * split_lambda, and each slice gets an orthographic light volume fitted around it and
+ * snapped to whole texels so shadows do not shimmer as the camera moves. Each cascade is
+ * one layer of shadow_map_array; layers are handed out to lights in order until
+ * MAX_SHADOW_LAYERS runs out, so a late light may get fewer cascades.
+ *
+ * Point and spot lights render into tiles of the shadow atlas. Lights whose range misses
+ * the view frustum are skipped; the rest are ranked by how much of the screen their range
+ * covers, which also picks their tile size, and placed in that order.
+ */
 typedef struct ShadowSystem {
-    ShadowCaster casters[MAX_SHADOW_LIGHTS];
-    size_t active_count;
+    ShadowCaster casters[MAX_SHADOW_LAYERS]; // One per array layer
+    size_t layer_count;                      // Layers rendered this frame
+    ShadowLight lights[MAX_SHADOWED_LIGHTS];
+    size_t active_count; // Shadowed lights this frame
+    struct ShadowAtlas* atlas;
     int default_map_size;
     ShaderProgram* depth_program;
+
+    int cascade_count;     // Cascades per directional light, 1..MAX_SHADOW_CASCADES
+    float split_lambda;    // 0 = uniform splits, 1 = logarithmic
+    float shadow_distance; // View depth covered by the last cascade, clamped to the far clip
+    float caster_extent;   // How far toward the light casters are captured beyond a cascade
+    float cascade_splits[MAX_SHADOW_CASCADES]; // Far view depth of each cascade this frame
+
+    // Render every layer in one traversal through the engine's "shadow_layered" program,
+    // submitting each caster once. Falls back to a pass per layer without the program.
+    bool layered;
+
+    // Cache static casters in static_map_array. A cached layer is redrawn only when its
+    // light-space fit changes (light direction, or the camera moving a whole cascade centre
+    // step) or a static node below the scene root moves, is added or changes dynamic flag;
+    // stale layers are redrawn together in one pass. Each frame copies cached layers into
+    // shadow_map_array and draws dynamic nodes and skinned meshes on top; with no dynamic
+    // casters an unchanged layer costs nothing. Costs a second array of the same size.
+    bool cache_static;
+    size_t static_rebuilds; // Layers redrawn into the cache last frame
+
+    // Main pass filtering. filter_radius is the Poisson disk radius in texels; light_size is
+    // the PCSS light size in texels, which bounds both its blocker search and penumbra. Point
+    // and spot penumbrae scale it by (receiver - blocker) / blocker in linear depth, cascade
+    // penumbrae by the receiver-blocker distance in world units.
+    ShadowFilter filter;
+    float filter_radius;
+    float light_size;
+
+    // Fixed volume around the origin, used when there is no camera to fit cascades to
     float ortho_size;
     float near_plane;
     float far_plane;
+
     GLuint shadow_map_array;
+    GLuint static_map_array;
+    GLuint static_fbo;
+    GLuint depth_sampler; // Plain depth reads of the maps, for the PCSS blocker search
+    int layer_capacity; // Layers allocated in each array
     bool initialized;
 } ShadowSystem;
 
@@ -58,9 +152,26 @@ void end_shadow_pass(ShadowSystem* system);
 void compute_directional_light_space_matrix(vec3 direction, vec3 scene_center, float ortho_size,
                                             float near_plane, float far_plane, mat4 dest);
 
-// Shadow map binding for main render pass
+// Far view depth of each of count cascades between near_clip and far_clip
+void compute_cascade_splits(float near_clip, float far_clip, int count, float lambda,
+                            float* out_splits);
+
+// Texel-snapped light space matrix enclosing the view frustum between slice_near and
+// slice_far, reaching caster_extent further toward the light
+void compute_cascade_light_space_matrix(vec3 direction, mat4 view, float fov_radians,
+                                        float aspect_ratio, float slice_near, float slice_far,
+                                        float caster_extent, int map_size, mat4 dest);
+
+// Shadow map binding for main render pass. lights are the light uniforms of the draw, in
+// order; the first MAX_SHADOW_LIGHTS of them with shadows get shadow slots.
 void bind_shadow_maps_to_program(ShadowSystem* system, ShaderProgram* program,
-                                 const int* shadow_light_indices);
+                                 struct Light** lights, size_t light_count);
+
+// Point the shadow samplers at their units with nothing bound, for scenes without shadows
+void bind_no_shadows_to_program(ShaderProgram* program);
+
+// Display name of a filter mode
+const char* shadow_filter_name(ShadowFilter filter);
 
 // Main shadow rendering function
 void render_shadow_depth_pass(struct Engine* engine, struct Scene* scene);
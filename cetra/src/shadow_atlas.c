@@ -0,0 +1,265 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <GL/glew.h>
+#include <cglm/cglm.h>
+
+#include "shadow_atlas.h"
+#include "light.h"
+#include "uniform.h"
+#include "ext/log.h"
+
+ShadowAtlas* create_shadow_atlas() {
+    ShadowAtlas* atlas = calloc(1, sizeof(ShadowAtlas));
+    if (!atlas) {
+        log_error("Failed to allocate shadow atlas");
+        return NULL;
+    }
+
+    for (int i = 0; i < MAX_SHADOW_TILES; i++) {
+        atlas->tiles[i].bias = 0.0005f;
+        glm_mat4_identity(atlas->tiles[i].light_space_matrix);
+    }
+    return atlas;
+}
+
+void free_shadow_atlas(ShadowAtlas* atlas) {
+    if (!atlas)
+        return;
+
+    if (atlas->fbo)
+        glDeleteFramebuffers(1, &atlas->fbo);
+    if (atlas->texture)
+        glDeleteTextures(1, &atlas->texture);
+    if (atlas->tile_texture)
+        glDeleteTextures(1, &atlas->tile_texture);
+    if (atlas->tile_buffer)
+        glDeleteBuffers(1, &atlas->tile_buffer);
+
+    free(atlas);
+}
+
+/*
+ * Allocation
+ */
+
+int shadow_tile_size_for_coverage(float coverage) {
+    float wanted = glm_clamp(coverage, 0.0f, 1.0f) * (float)SHADOW_ATLAS_MAX_TILE;
+
+    int size = SHADOW_ATLAS_MIN_TILE;
+    while (size < SHADOW_ATLAS_MAX_TILE && (float)size < wanted)
+        size *= 2;
+    return size;
+}
+
+static void _mark_cells(ShadowAtlas* atlas, int x, int y, int size, unsigned char value) {
+    int cx = x / SHADOW_ATLAS_MIN_TILE;
+    int cy = y / SHADOW_ATLAS_MIN_TILE;
+    int n = size / SHADOW_ATLAS_MIN_TILE;
+    for (int j = cy; j < cy + n; j++)
+        memset(&atlas->cells[j * SHADOW_ATLAS_GRID + cx], value, n);
+}
+
+static bool _cells_free(const ShadowAtlas* atlas, int cx, int cy, int n) {
+    for (int j = cy; j < cy + n; j++) {
+        for (int i = cx; i < cx + n; i++) {
+            if (atlas->cells[j * SHADOW_ATLAS_GRID + i])
+                return false;
+        }
+    }
+    return true;
+}
+
+// First free square of size texels, at a position aligned to its size
+static bool _find_free_tile(const ShadowAtlas* atlas, int size, int* out_x, int* out_y) {
+    int n = size / SHADOW_ATLAS_MIN_TILE;
+    for (int cy = 0; cy + n <= SHADOW_ATLAS_GRID; cy += n) {
+        for (int cx = 0; cx + n <= SHADOW_ATLAS_GRID; cx += n) {
+            if (_cells_free(atlas, cx, cy, n)) {
+                *out_x = cx * SHADOW_ATLAS_MIN_TILE;
+                *out_y = cy * SHADOW_ATLAS_MIN_TILE;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static void _release_entry(ShadowAtlas* atlas, ShadowAtlasEntry* entry) {
+    for (int f = 0; f < entry->face_count; f++)
+        _mark_cells(atlas, entry->x[f], entry->y[f], entry->tile_size, 0);
+    memset(entry, 0, sizeof(*entry));
+}
+
+// Place every face at size, or none of them
+static bool _place_entry(ShadowAtlas* atlas, ShadowAtlasEntry* entry, int size, int faces) {
+    for (int f = 0; f < faces; f++) {
+        if (!_find_free_tile(atlas, size, &entry->x[f], &entry->y[f])) {
+            for (int g = 0; g < f; g++)
+                _mark_cells(atlas, entry->x[g], entry->y[g], size, 0);
+            return false;
+        }
+        _mark_cells(atlas, entry->x[f], entry->y[f], size, 1);
+    }
+    entry->tile_size = size;
+    entry->face_count = faces;
+    return true;
+}
+
+static ShadowAtlasEntry* _find_entry(ShadowAtlas* atlas, const Light* light) {
+    for (int i = 0; i < MAX_SHADOW_ATLAS_LIGHTS; i++) {
+        if (atlas->entries[i].light == light)
+            return &atlas->entries[i];
+    }
+    return NULL;
+}
+
+void update_shadow_atlas(ShadowAtlas* atlas, ShadowAtlasRequest* requests, size_t count) {
+    if (!atlas)
+        return;
+
+    for (int i = 0; i < MAX_SHADOW_ATLAS_LIGHTS; i++)
+        atlas->entries[i].used = false;
+
+    // Keep tiles whose original request still holds; shrinking waits until it is two steps.
+    // Comparing against the request rather than the placed size keeps a tile that was placed
+    // smaller because the atlas was full.
+    for (size_t r = 0; r < count; r++) {
+        ShadowAtlasRequest* req = &requests[r];
+        req->entry = NULL;
+
+        ShadowAtlasEntry* entry = _find_entry(atlas, req->light);
+        if (entry && entry->face_count == req->face_count &&
+            (entry->requested_size == req->tile_size ||
+             entry->requested_size == req->tile_size * 2)) {
+            entry->used = true;
+            req->entry = entry;
+        }
+    }
+
+    for (int i = 0; i < MAX_SHADOW_ATLAS_LIGHTS; i++) {
+        if (atlas->entries[i].light && !atlas->entries[i].used)
+            _release_entry(atlas, &atlas->entries[i]);
+    }
+
+    // Place the rest in importance order
+    for (size_t r = 0; r < count; r++) {
+        ShadowAtlasRequest* req = &requests[r];
+        if (req->entry)
+            continue;
+
+        ShadowAtlasEntry* slot = _find_entry(atlas, NULL);
+        if (!slot)
+            break;
+
+        for (int size = req->tile_size; size >= SHADOW_ATLAS_MIN_TILE; size /= 2) {
+            if (_place_entry(atlas, slot, size, req->face_count)) {
+                slot->light = req->light;
+                slot->requested_size = req->tile_size;
+                slot->used = true;
+                req->entry = slot;
+                break;
+            }
+        }
+    }
+
+    atlas->entry_count = 0;
+    for (int i = 0; i < MAX_SHADOW_ATLAS_LIGHTS; i++) {
+        if (atlas->entries[i].light)
+            atlas->entry_count++;
+    }
+}
+
+/*
+ * GPU
+ */
+
+int init_shadow_atlas_textures(ShadowAtlas* atlas) {
+    if (!atlas)
+        return -1;
+    if (atlas->texture)
+        return 0;
+
+    glGenTextures(1, &atlas->texture);
+    glBindTexture(GL_TEXTURE_2D, atlas->texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, SHADOW_ATLAS_SIZE, SHADOW_ATLAS_SIZE, 0,
+                 GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &atlas->fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, atlas->fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, atlas->texture, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        log_error("Shadow atlas framebuffer incomplete: 0x%x", status);
+        return -1;
+    }
+
+    glGenBuffers(1, &atlas->tile_buffer);
+    glBindBuffer(GL_TEXTURE_BUFFER, atlas->tile_buffer);
+    glBufferData(GL_TEXTURE_BUFFER, MAX_SHADOW_TILES * SHADOW_TILE_TEXELS * sizeof(vec4), NULL,
+                 GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    glGenTextures(1, &atlas->tile_texture);
+    glBindTexture(GL_TEXTURE_BUFFER, atlas->tile_texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, atlas->tile_buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    return 0;
+}
+
+void upload_shadow_tiles(ShadowAtlas* atlas) {
+    if (!atlas || !atlas->tile_buffer || atlas->tile_count == 0)
+        return;
+
+    vec4 texels[MAX_SHADOW_TILES * SHADOW_TILE_TEXELS];
+    float inv_size = 1.0f / (float)SHADOW_ATLAS_SIZE;
+    for (size_t i = 0; i < atlas->tile_count; i++) {
+        const ShadowCaster* tile = &atlas->tiles[i];
+        vec4* out = &texels[i * SHADOW_TILE_TEXELS];
+        for (int c = 0; c < 4; c++)
+            glm_vec4_copy((float*)tile->light_space_matrix[c], out[c]);
+        out[4][0] = (float)tile->tile_x * inv_size;
+        out[4][1] = (float)tile->tile_y * inv_size;
+        out[4][2] = (float)tile->tile_size * inv_size;
+        out[4][3] = tile->bias;
+        out[5][0] = tile->tile_near;
+        out[5][1] = tile->tile_far;
+        out[5][2] = 0.0f;
+        out[5][3] = 0.0f;
+    }
+
+    glBindBuffer(GL_TEXTURE_BUFFER, atlas->tile_buffer);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, atlas->tile_count * SHADOW_TILE_TEXELS * sizeof(vec4),
+                    texels);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void bind_shadow_atlas(ShadowAtlas* atlas, ShaderProgram* program, GLuint depth_sampler) {
+    if (!program || !program->uniforms)
+        return;
+
+    // Samplers always point at their own units, even with nothing bound, so they never
+    // share unit 0 with a sampler of another type
+    glActiveTexture(GL_TEXTURE0 + SHADOW_ATLAS_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, atlas ? atlas->texture : 0);
+    glActiveTexture(GL_TEXTURE0 + SHADOW_ATLAS_DEPTH_UNIT);
+    glBindTexture(GL_TEXTURE_2D, atlas ? atlas->texture : 0);
+    glBindSampler(SHADOW_ATLAS_DEPTH_UNIT, depth_sampler);
+    glActiveTexture(GL_TEXTURE0 + SHADOW_TILE_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, atlas ? atlas->tile_texture : 0);
+    glActiveTexture(GL_TEXTURE0);
+
+    uniform_set_int(program->uniforms, "shadowAtlas", SHADOW_ATLAS_TEXTURE_UNIT);
+    uniform_set_int(program->uniforms, "shadowAtlasDepth", SHADOW_ATLAS_DEPTH_UNIT);
+    uniform_set_int(program->uniforms, "shadowTiles", SHADOW_TILE_TEXTURE_UNIT);
+}
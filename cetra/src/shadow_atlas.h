@@ -0,0 +1,103 @@
+#ifndef _SHADOW_ATLAS_H_
+#define _SHADOW_ATLAS_H_
+
+#include <GL/glew.h>
+#include <cglm/cglm.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "program.h"
+#include "shadow.h"
+
+#define SHADOW_ATLAS_SIZE         4096
+#define SHADOW_ATLAS_MIN_TILE     128
+#define SHADOW_ATLAS_MAX_TILE     1024
+#define SHADOW_ATLAS_GRID         (SHADOW_ATLAS_SIZE / SHADOW_ATLAS_MIN_TILE)
+#define MAX_SHADOW_ATLAS_LIGHTS   32
+#define MAX_SHADOW_TILES          64
+#define SHADOW_ATLAS_TEXTURE_UNIT 23
+#define SHADOW_TILE_TEXTURE_UNIT  24
+#define SHADOW_ATLAS_DEPTH_UNIT   26 // The atlas again, read without comparison
+#define SHADOW_TILE_TEXELS        6 // Matrix columns, atlas offset/scale/bias, near/far planes
+
+struct Light;
+
+// A light's tiles, kept across frames while its requested size holds
+typedef struct ShadowAtlasEntry {
+    struct Light* light;
+    int tile_size;
+    int requested_size; // Size asked for when placed; tile_size is smaller if the atlas was full
+    int face_count;     // 6 for point lights (cube faces), 1 for spot lights
+    int x[6];           // Tile corners in texels
+    int y[6];
+    bool used;
+} ShadowAtlasEntry;
+
+// Filled in by the caller, most important first; entry is NULL when the atlas is full
+typedef struct ShadowAtlasRequest {
+    struct Light* light;
+    int tile_size;
+    int face_count;
+    ShadowAtlasEntry* entry;
+} ShadowAtlasRequest;
+
+/*
+ * Shadow Atlas
+ *
+ * One depth texture shared by every shadowed point and spot light. Tiles are power-of-two
+ * squares between SHADOW_ATLAS_MIN_TILE and SHADOW_ATLAS_MAX_TILE, placed on a grid of
+ * minimum-size cells at positions aligned to their own size, which keeps the packing
+ * buddy-like without a tree. A light keeps its tiles between frames until it is no longer
+ * requested or its size changes by more than one step down; growing is immediate.
+ *
+ * Each frame's tiles are also ShadowCasters, so the shadow pass culls and counts them like
+ * cascade layers. Their matrices and atlas rects go to the shader in a texture buffer.
+ */
+typedef struct ShadowAtlas {
+    unsigned char cells[SHADOW_ATLAS_GRID * SHADOW_ATLAS_GRID]; // Occupied minimum tiles
+
+    ShadowAtlasEntry entries[MAX_SHADOW_ATLAS_LIGHTS];
+    size_t entry_count;
+
+    // This frame's tiles, with rects in tile_x/tile_y/tile_size
+    ShadowCaster tiles[MAX_SHADOW_TILES];
+    size_t tile_count;
+
+    GLuint texture;      // SHADOW_ATLAS_SIZE^2 depth
+    GLuint fbo;
+    GLuint tile_buffer;  // GL_TEXTURE_BUFFER of SHADOW_TILE_TEXELS per tile
+    GLuint tile_texture; // samplerBuffer view of tile_buffer
+} ShadowAtlas;
+
+/*
+ * Lifecycle
+ */
+ShadowAtlas* create_shadow_atlas();
+void free_shadow_atlas(ShadowAtlas* atlas);
+
+/*
+ * Allocation
+ */
+
+// Power-of-two tile size for a light covering coverage (0..1) of the screen
+int shadow_tile_size_for_coverage(float coverage);
+
+// Keep, move or drop every light's tiles to satisfy this frame's requests. Lights that
+// are not requested give their tiles back first; new allocations then go in request order,
+// halving the size until they fit.
+void update_shadow_atlas(ShadowAtlas* atlas, ShadowAtlasRequest* requests, size_t count);
+
+/*
+ * GPU
+ */
+
+// Create the atlas texture and tile buffer on first use
+int init_shadow_atlas_textures(ShadowAtlas* atlas);
+
+// Upload this frame's tile matrices and rects
+void upload_shadow_tiles(ShadowAtlas* atlas);
+
+// Bind atlas and tile records to program; depth_sampler reads the atlas without comparison
+void bind_shadow_atlas(ShadowAtlas* atlas, ShaderProgram* program, GLuint depth_sampler);
+
+#endif // _SHADOW_ATLAS_H_
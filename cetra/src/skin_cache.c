@@ -0,0 +1,227 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <GL/glew.h>
+
+#include "skin_cache.h"
+#include "bone_palette.h"
+#include "engine.h"
+#include "mesh.h"
+#include "scene.h"
+#include "uniform.h"
+#include "ext/log.h"
+
+SkinCache* create_skin_cache(void) {
+    SkinCache* cache = calloc(1, sizeof(SkinCache));
+    if (!cache) {
+        log_error("Failed to allocate skin cache");
+        return NULL;
+    }
+    return cache;
+}
+
+void free_skin_cache(SkinCache* cache) {
+    if (!cache)
+        return;
+
+    if (cache->texture)
+        glDeleteTextures(1, &cache->texture);
+    if (cache->buffer)
+        glDeleteBuffers(1, &cache->buffer);
+
+    // The program belongs to the engine
+    free(cache->entries);
+    free(cache);
+}
+
+static int _compare_entries(const void* a, const void* b) {
+    const SkinnedMeshEntry* x = a;
+    const SkinnedMeshEntry* y = b;
+    if (x->mesh != y->mesh)
+        return (uintptr_t)x->mesh < (uintptr_t)y->mesh ? -1 : 1;
+    if (x->state != y->state)
+        return (uintptr_t)x->state < (uintptr_t)y->state ? -1 : 1;
+    return 0;
+}
+
+static int _add_entry(SkinCache* cache, Mesh* mesh, AnimationState* state) {
+    if (cache->entry_count >= cache->entry_capacity) {
+        size_t new_capacity = cache->entry_capacity ? cache->entry_capacity * 2 : 64;
+        SkinnedMeshEntry* entries =
+            realloc(cache->entries, new_capacity * sizeof(SkinnedMeshEntry));
+        if (!entries) {
+            log_error("Failed to grow skin cache entries");
+            return -1;
+        }
+        cache->entries = entries;
+        cache->entry_capacity = new_capacity;
+    }
+
+    SkinnedMeshEntry* entry = &cache->entries[cache->entry_count++];
+    entry->mesh = mesh;
+    entry->state = state;
+    entry->vertex_base = -1;
+    return 0;
+}
+
+// Collect posed skinned meshes and write their palettes
+static void _collect_skinned_meshes(SkinCache* cache, BonePalette* palette, SceneNode* node) {
+    if (!node)
+        return;
+
+    for (size_t i = 0; i < node->mesh_count; i++) {
+        Mesh* mesh = node->meshes[i];
+        if (!mesh || !mesh->is_skinned || mesh->vertex_count == 0)
+            continue;
+
+        AnimationState* state = get_node_animation_state(node);
+        if (!state || write_bone_palette(palette, state) < 0)
+            continue;
+
+        _add_entry(cache, mesh, state);
+    }
+
+    for (size_t i = 0; i < node->children_count; i++) {
+        _collect_skinned_meshes(cache, palette, node->children[i]);
+    }
+}
+
+static int _ensure_buffer_capacity(SkinCache* cache, size_t vertex_count) {
+    if (!cache->buffer) {
+        glGenBuffers(1, &cache->buffer);
+        glGenTextures(1, &cache->texture);
+        if (!cache->buffer || !cache->texture) {
+            log_error("Failed to create skin cache buffer");
+            return -1;
+        }
+        glBindTexture(GL_TEXTURE_BUFFER, cache->texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, cache->buffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+
+    if (vertex_count <= cache->buffer_capacity)
+        return 0;
+
+    size_t new_capacity = cache->buffer_capacity ? cache->buffer_capacity : 4096;
+    while (new_capacity < vertex_count)
+        new_capacity *= 2;
+
+    GLint max_texels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texels);
+    if (max_texels > 0 && vertex_count * SKIN_CACHE_TEXELS_PER_VERTEX > (size_t)max_texels) {
+        log_error("Skin cache needs %zu vertices, more than a texture buffer holds",
+                  vertex_count);
+        return -1;
+    }
+
+    glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, cache->buffer);
+    glBufferData(GL_TRANSFORM_FEEDBACK_BUFFER,
+                 new_capacity * SKIN_CACHE_TEXELS_PER_VERTEX * sizeof(float) * 4, NULL,
+                 GL_DYNAMIC_COPY);
+    glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, 0);
+    cache->buffer_capacity = new_capacity;
+    return 0;
+}
+
+int update_skin_cache(Engine* engine, Scene* scene) {
+    if (!engine || !scene || !scene->skin_cache || !scene->bone_palette)
+        return -1;
+
+    SkinCache* cache = scene->skin_cache;
+    AnimationWorld* world = scene->animation_world;
+    if (!world)
+        return -1;
+
+    // Poses only change in update_animation_world
+    if (cache->built && cache->world_frame == world->frame_index &&
+        cache->world_instances == world->instance_count)
+        return 0;
+
+    cache->built = true;
+    cache->world_frame = world->frame_index;
+    cache->world_instances = world->instance_count;
+    cache->entry_count = 0;
+    cache->vertex_count = 0;
+
+    if (!cache->program) {
+        cache->program = get_engine_shader_program_by_name(engine, "skinning");
+        if (!cache->program)
+            return -1;
+    }
+
+    BonePalette* palette = scene->bone_palette;
+    begin_bone_palette_frame(palette);
+    _collect_skinned_meshes(cache, palette, scene->root_node);
+    if (cache->entry_count == 0)
+        return 0;
+
+    // Meshes shared by several nodes of one character are skinned once
+    qsort(cache->entries, cache->entry_count, sizeof(SkinnedMeshEntry), _compare_entries);
+    size_t unique = 0;
+    for (size_t i = 0; i < cache->entry_count; i++) {
+        if (unique > 0 && _compare_entries(&cache->entries[unique - 1], &cache->entries[i]) == 0)
+            continue;
+        cache->entries[unique] = cache->entries[i];
+        cache->entries[unique].vertex_base = (int)cache->vertex_count;
+        cache->vertex_count += cache->entries[unique].mesh->vertex_count;
+        unique++;
+    }
+    cache->entry_count = unique;
+
+    if (_ensure_buffer_capacity(cache, cache->vertex_count) != 0 ||
+        upload_bone_palette(palette) != 0) {
+        cache->entry_count = 0;
+        return -1;
+    }
+
+    ShaderProgram* program = cache->program;
+    glUseProgram(program->id);
+    bind_bone_palette(palette, program);
+    glEnable(GL_RASTERIZER_DISCARD);
+
+    const size_t vertex_bytes = SKIN_CACHE_TEXELS_PER_VERTEX * sizeof(float) * 4;
+    for (size_t i = 0; i < cache->entry_count; i++) {
+        SkinnedMeshEntry* entry = &cache->entries[i];
+        Mesh* mesh = entry->mesh;
+
+        uniform_set_int(program->uniforms, "paletteOffset", entry->state->palette_offset);
+        glBindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, 0, cache->buffer,
+                          (GLintptr)(entry->vertex_base * vertex_bytes),
+                          (GLsizeiptr)(mesh->vertex_count * vertex_bytes));
+
+        glBindVertexArray(mesh->vao);
+        glBeginTransformFeedback(GL_POINTS);
+        glDrawArrays(GL_POINTS, 0, (GLsizei)mesh->vertex_count);
+        glEndTransformFeedback();
+    }
+
+    glBindVertexArray(0);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glDisable(GL_RASTERIZER_DISCARD);
+    glUseProgram(0);
+
+    return 0;
+}
+
+int find_skinned_vertices(const SkinCache* cache, const Mesh* mesh,
+                          const AnimationState* state) {
+    if (!cache || !mesh || !state || cache->entry_count == 0)
+        return -1;
+
+    SkinnedMeshEntry key = {.mesh = (Mesh*)mesh, .state = (AnimationState*)state};
+    const SkinnedMeshEntry* entry = bsearch(&key, cache->entries, cache->entry_count,
+                                            sizeof(SkinnedMeshEntry), _compare_entries);
+    return entry ? entry->vertex_base : -1;
+}
+
+void bind_skin_cache(SkinCache* cache, ShaderProgram* program) {
+    if (!program || !program->uniforms)
+        return;
+
+    // Own unit, as with the bone palette, so samplerBuffer never aliases a sampler2D
+    glActiveTexture(GL_TEXTURE0 + SKIN_CACHE_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_BUFFER, cache ? cache->texture : 0);
+    glActiveTexture(GL_TEXTURE0);
+    uniform_set_int(program->uniforms, "skinnedVertices", SKIN_CACHE_TEXTURE_UNIT);
+}
@@ -0,0 +1,75 @@
+#ifndef _SKIN_CACHE_H_
+#define _SKIN_CACHE_H_
+
+#include <GL/glew.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "animation.h"
+#include "program.h"
+
+#define SKIN_CACHE_TEXTURE_UNIT      19
+#define SKIN_CACHE_TEXELS_PER_VERTEX 4 // Position, normal, tangent, bitangent
+
+struct Mesh;
+struct Scene;
+struct Engine;
+
+// One mesh skinned with one pose
+typedef struct SkinnedMeshEntry {
+    struct Mesh* mesh;
+    AnimationState* state;
+    int vertex_base; // First vertex of the output in the cache buffer
+} SkinnedMeshEntry;
+
+/*
+ * Skin Cache
+ *
+ * Skinning pre-pass. Once per animation update, every posed skinned mesh in the scene
+ * runs through the "skinning" program with rasterization disabled, and transform
+ * feedback writes its model-space vertices into one buffer. The shadow passes and the
+ * main pass then read those vertices through a samplerBuffer by gl_VertexID instead
+ * of skinning again, so skinning cost no longer grows with the number of passes.
+ *
+ * Off-screen characters are skinned as well, since their shadows may still be in view.
+ */
+typedef struct SkinCache {
+    SkinnedMeshEntry* entries; // Sorted by mesh, then state
+    size_t entry_count;
+    size_t entry_capacity;
+    size_t vertex_count; // Vertices written by the last update
+
+    GLuint buffer;          // Transform feedback output
+    GLuint texture;         // samplerBuffer view of buffer
+    size_t buffer_capacity; // In vertices
+
+    ShaderProgram* program; // Engine's "skinning" program
+
+    // Animation world state the cache was built from
+    bool built;
+    unsigned int world_frame;
+    size_t world_instances;
+} SkinCache;
+
+/*
+ * Lifecycle
+ */
+SkinCache* create_skin_cache(void);
+void free_skin_cache(SkinCache* cache);
+
+/*
+ * Update
+ */
+
+// Skin every posed skinned mesh in scene. Does nothing when the animation world has not
+// updated since the last call, so every pass of a frame can call it.
+int update_skin_cache(struct Engine* engine, struct Scene* scene);
+
+// First cached vertex of mesh posed by state, or -1 when it was not skinned
+int find_skinned_vertices(const SkinCache* cache, const struct Mesh* mesh,
+                          const AnimationState* state);
+
+// Bind the cached vertices to SKIN_CACHE_TEXTURE_UNIT and point program's sampler at them
+void bind_skin_cache(SkinCache* cache, ShaderProgram* program);
+
+#endif // _SKIN_CACHE_H_
@@ -16,65 +16,94 @@
 #define STB_TRUETYPE_IMPLEMENTATION
 #include "ext/stb_truetype.h"
 
-// Default character set for atlas generation
-static const char* DEFAULT_CHARSET = " !\"#$%&'()*+,-./0123456789:;<=>?@"
-                                     "ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_`"
-                                     "abcdefghijklmnopqrstuvwxyz{|}~";
-
-// --- FontPool ---
+// SDF bitmaps map the glyph edge to this value, rising SDF_ON_EDGE_VALUE / spread per texel
+#define SDF_ON_EDGE_VALUE 180
+
+// --- UTF-8 ---
+
+// Decode the codepoint at s and return the byte after it. Malformed sequences decode to
+// U+FFFD one byte at a time.
+static const char* utf8_next(const char* s, int* out_codepoint) {
+    static const int min_codepoint[5] = {0, 0, 0x80, 0x800, 0x10000};
+    const unsigned char* p = (const unsigned char*)s;
+
+    int codepoint;
+    int length;
+    if (p[0] < 0x80) {
+        *out_codepoint = p[0];
+        return s + 1;
+    } else if ((p[0] & 0xE0) == 0xC0) {
+        codepoint = p[0] & 0x1F;
+        length = 2;
+    } else if ((p[0] & 0xF0) == 0xE0) {
+        codepoint = p[0] & 0x0F;
+        length = 3;
+    } else if ((p[0] & 0xF8) == 0xF0) {
+        codepoint = p[0] & 0x07;
+        length = 4;
+    } else {
+        *out_codepoint = 0xFFFD;
+        return s + 1;
+    }
 
-FontPool* create_font_pool(void) {
-    FontPool* pool = calloc(1, sizeof(FontPool));
-    if (!pool)
-        return NULL;
+    // A NUL inside the sequence fails here too, so truncated text never reads past its end
+    for (int i = 1; i < length; i++) {
+        if ((p[i] & 0xC0) != 0x80) {
+            *out_codepoint = 0xFFFD;
+            return s + 1;
+        }
+        codepoint = (codepoint << 6) | (p[i] & 0x3F);
+    }
 
-    pool->font_capacity = 16;
-    pool->fonts = calloc(pool->font_capacity, sizeof(Font*));
-    if (!pool->fonts) {
-        free(pool);
-        return NULL;
+    // Overlong forms, surrogates and values past U+10FFFF
+    if (codepoint < min_codepoint[length] || codepoint > 0x10FFFF ||
+        (codepoint >= 0xD800 && codepoint <= 0xDFFF)) {
+        *out_codepoint = 0xFFFD;
+        return s + 1;
     }
 
-    return pool;
+    *out_codepoint = codepoint;
+    return s + length;
 }
 
-void free_font_pool(FontPool* pool) {
-    if (!pool)
-        return;
-
-    // Free all fonts
-    Font* font;
-    Font* tmp;
-    HASH_ITER(hh, pool->font_cache, font, tmp) {
-        HASH_DEL(pool->font_cache, font);
-
-        // Free glyph cache
-        GlyphInfo* glyph;
-        GlyphInfo* gtmp;
-        HASH_ITER(hh, font->glyph_cache, glyph, gtmp) {
-            HASH_DEL(font->glyph_cache, glyph);
-            free(glyph);
-        }
+// --- Glyph Atlas ---
 
-        if (font->atlas_texture_id)
-            glDeleteTextures(1, &font->atlas_texture_id);
-        free(font->name);
-        free(font->filepath);
-        free(font->ttf_buffer);
-        free(font->stb_font_info);
-        free(font);
-    }
+static int atlas_size_for_font(const Font* font) {
+    int cell = (int)ceilf(font->base_size + 2.0f * font->sdf_spread) + FONT_GLYPH_PADDING;
+    int wanted = cell * FONT_ATLAS_GLYPHS_PER_SIDE;
 
-    free(pool->fonts);
-    free(pool);
+    int size = FONT_ATLAS_MIN_SIZE;
+    while (size < FONT_ATLAS_MAX_SIZE && size < wanted)
+        size *= 2;
+    return size;
 }
 
-// --- Font Loading ---
+static void reset_atlas_packer(Font* font) {
+    stbrp_init_target((stbrp_context*)font->atlas_packer, font->atlas_width, font->atlas_height,
+                      (stbrp_node*)font->atlas_nodes, font->atlas_width);
+}
 
-static void generate_glyph_atlas(Font* font, const char* charset) {
-    if (!font || !font->stb_font_info)
+static void mark_atlas_dirty(Font* font, int x0, int y0, int x1, int y1) {
+    if (font->dirty_x0 >= font->dirty_x1) {
+        font->dirty_x0 = x0;
+        font->dirty_y0 = y0;
+        font->dirty_x1 = x1;
+        font->dirty_y1 = y1;
         return;
+    }
+
+    if (x0 < font->dirty_x0)
+        font->dirty_x0 = x0;
+    if (y0 < font->dirty_y0)
+        font->dirty_y0 = y0;
+    if (x1 > font->dirty_x1)
+        font->dirty_x1 = x1;
+    if (y1 > font->dirty_y1)
+        font->dirty_y1 = y1;
+}
 
+// Font metrics, an empty atlas texture and the packer; glyphs come later, on first use
+static int init_glyph_atlas(Font* font) {
     const stbtt_fontinfo* info = (const stbtt_fontinfo*)font->stb_font_info;
     float scale = stbtt_ScaleForPixelHeight(info, font->base_size);
 
@@ -85,123 +114,22 @@ static void generate_glyph_atlas(Font* font, const char* charset) {
     font->descent = descent_i * scale;
     font->line_height = (ascent_i - descent_i + line_gap) * scale;
 
-    // Start with 1024 to avoid resize issues with large SDF glyphs
-    int atlas_size = 1024;
-    int padding = font->is_sdf ? (int)(font->sdf_spread + 1) : 2;
-    int on_edge_value = 180;
-    float pixel_dist_scale = font->is_sdf ? (float)on_edge_value / font->sdf_spread : 0;
-
-    // Allocate atlas
-    unsigned char* atlas_data = calloc(atlas_size * atlas_size, 1);
-    if (!atlas_data)
-        return;
-
-    int cursor_x = padding;
-    int cursor_y = padding;
-    int row_height = 0;
-
-    // Process each character
-    size_t charset_len = strlen(charset);
-    for (size_t i = 0; i < charset_len; i++) {
-        int codepoint = (unsigned char)charset[i];
-
-        // Get glyph metrics
-        int advance, left_bearing;
-        stbtt_GetCodepointHMetrics(info, codepoint, &advance, &left_bearing);
-
-        int x0, y0, x1, y1;
-        if (font->is_sdf) {
-            int w, h;
-            stbtt_GetCodepointSDF(info, scale, codepoint, (int)font->sdf_spread, on_edge_value,
-                                  pixel_dist_scale, &w, &h, &x0, &y0);
-            // Adjust to get bounding box
-            x1 = x0 + w;
-            y1 = y0 + h;
-        } else {
-            stbtt_GetCodepointBitmapBox(info, codepoint, scale, scale, &x0, &y0, &x1, &y1);
-        }
-
-        int glyph_w = x1 - x0;
-        int glyph_h = y1 - y0;
-
-        // Check if we need to wrap to next row
-        if (cursor_x + glyph_w + padding > atlas_size) {
-            cursor_x = padding;
-            cursor_y += row_height + padding;
-            row_height = 0;
-        }
-
-        // Check if we need bigger atlas
-        while (cursor_y + glyph_h + padding > atlas_size) {
-            // Reallocate with larger size
-            int new_size = atlas_size * 2;
-            unsigned char* new_data = calloc(new_size * new_size, 1);
-            if (!new_data) {
-                free(atlas_data);
-                return;
-            }
-            // Copy old data row by row (stride changes)
-            for (int row = 0; row < atlas_size; row++) {
-                memcpy(new_data + row * new_size, atlas_data + row * atlas_size, atlas_size);
-            }
-            free(atlas_data);
-            atlas_data = new_data;
-            atlas_size = new_size;
-        }
-
-        // Render glyph to atlas
-        if (glyph_w > 0 && glyph_h > 0) {
-            unsigned char* dest = atlas_data + cursor_y * atlas_size + cursor_x;
-
-            if (font->is_sdf) {
-                int w, h, xoff, yoff;
-                unsigned char* sdf_data =
-                    stbtt_GetCodepointSDF(info, scale, codepoint, (int)font->sdf_spread,
-                                          on_edge_value, pixel_dist_scale, &w, &h, &xoff, &yoff);
-                if (sdf_data) {
-                    for (int row = 0; row < h; row++) {
-                        memcpy(dest + row * atlas_size, sdf_data + row * w, w);
-                    }
-                    stbtt_FreeSDF(sdf_data, NULL);
-                }
-            } else {
-                stbtt_MakeCodepointBitmap(info, dest, glyph_w, glyph_h, atlas_size, scale, scale,
-                                          codepoint);
-            }
-        }
-
-        // Create glyph info with UVs based on current atlas_size
-        // Note: if atlas resizes later, these UVs become invalid, but we resize
-        // BEFORE placing glyphs, so this glyph's UVs use the correct final size
-        GlyphInfo* glyph = calloc(1, sizeof(GlyphInfo));
-        if (glyph) {
-            glyph->codepoint = codepoint;
-            glyph->advance_x = advance * scale;
-            glyph->left_bearing = left_bearing * scale;
-            glyph->x0 = (float)x0;
-            glyph->y0 = (float)y0;
-            glyph->x1 = (float)x1;
-            glyph->y1 = (float)y1;
-
-            // UV coordinates (normalized)
-            glyph->u0 = (float)cursor_x / atlas_size;
-            glyph->v0 = (float)cursor_y / atlas_size;
-            glyph->u1 = (float)(cursor_x + glyph_w) / atlas_size;
-            glyph->v1 = (float)(cursor_y + glyph_h) / atlas_size;
-
-            HASH_ADD_INT(font->glyph_cache, codepoint, glyph);
-        }
+    int atlas_size = atlas_size_for_font(font);
+    font->atlas_pixels = calloc((size_t)atlas_size * atlas_size, 1);
+    font->atlas_packer = malloc(sizeof(stbrp_context));
+    font->atlas_nodes = malloc(atlas_size * sizeof(stbrp_node));
+    if (!font->atlas_pixels || !font->atlas_packer || !font->atlas_nodes)
+        return -1;
 
-        cursor_x += glyph_w + padding;
-        if (glyph_h > row_height)
-            row_height = glyph_h;
-    }
+    font->atlas_width = atlas_size;
+    font->atlas_height = atlas_size;
+    reset_atlas_packer(font);
 
     // Create OpenGL texture
     glGenTextures(1, &font->atlas_texture_id);
     glBindTexture(GL_TEXTURE_2D, font->atlas_texture_id);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, atlas_size, atlas_size, 0, GL_RED, GL_UNSIGNED_BYTE,
-                 atlas_data);
+                 font->atlas_pixels);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
@@ -212,12 +140,253 @@ static void generate_glyph_atlas(Font* font, const char* charset) {
     GLint swizzle[] = {GL_RED, GL_RED, GL_RED, GL_RED};
     glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
 
-    font->atlas_width = atlas_size;
-    font->atlas_height = atlas_size;
+    return 0;
+}
+
+static void free_glyph_atlas(Font* font) {
+    GlyphInfo* glyph;
+    GlyphInfo* tmp;
+    HASH_ITER(hh, font->glyph_cache, glyph, tmp) {
+        HASH_DEL(font->glyph_cache, glyph);
+        free(glyph);
+    }
 
-    free(atlas_data);
+    if (font->atlas_texture_id)
+        glDeleteTextures(1, &font->atlas_texture_id);
+    free(font->atlas_pixels);
+    free(font->atlas_packer);
+    free(font->atlas_nodes);
 }
 
+// Metrics only; the box is the one rasterize_glyph will fill, SDF spread included
+static GlyphInfo* add_glyph(Font* font, int codepoint) {
+    const stbtt_fontinfo* info = (const stbtt_fontinfo*)font->stb_font_info;
+    float scale = stbtt_ScaleForPixelHeight(info, font->base_size);
+
+    GlyphInfo* glyph = calloc(1, sizeof(GlyphInfo));
+    if (!glyph)
+        return NULL;
+
+    glyph->codepoint = codepoint;
+    glyph->glyph_index = stbtt_FindGlyphIndex(info, codepoint);
+
+    int advance, left_bearing;
+    stbtt_GetGlyphHMetrics(info, glyph->glyph_index, &advance, &left_bearing);
+    glyph->advance_x = advance * scale;
+    glyph->left_bearing = left_bearing * scale;
+
+    int x0, y0, x1, y1;
+    stbtt_GetGlyphBitmapBox(info, glyph->glyph_index, scale, scale, &x0, &y0, &x1, &y1);
+    if (x0 < x1 && y0 < y1) {
+        int spread = font->is_sdf ? (int)font->sdf_spread : 0;
+        glyph->x0 = (float)(x0 - spread);
+        glyph->y0 = (float)(y0 - spread);
+        glyph->x1 = (float)(x1 + spread);
+        glyph->y1 = (float)(y1 + spread);
+    }
+
+    HASH_ADD_INT(font->glyph_cache, codepoint, glyph);
+    return glyph;
+}
+
+static bool pack_glyph(Font* font, GlyphInfo* glyph) {
+    int w = (int)(glyph->x1 - glyph->x0);
+    int h = (int)(glyph->y1 - glyph->y0);
+
+    stbrp_rect rect = {.w = w + FONT_GLYPH_PADDING, .h = h + FONT_GLYPH_PADDING};
+    stbrp_pack_rects((stbrp_context*)font->atlas_packer, &rect, 1);
+    if (!rect.was_packed)
+        return false;
+
+    glyph->atlas_x = rect.x;
+    glyph->atlas_y = rect.y;
+    glyph->in_atlas = true;
+    font->atlas_glyph_count++;
+
+    // UV coordinates (normalized)
+    glyph->u0 = (float)rect.x / font->atlas_width;
+    glyph->v0 = (float)rect.y / font->atlas_height;
+    glyph->u1 = (float)(rect.x + w) / font->atlas_width;
+    glyph->v1 = (float)(rect.y + h) / font->atlas_height;
+    return true;
+}
+
+static int compare_glyph_use(const void* a, const void* b) {
+    const GlyphInfo* ga = *(GlyphInfo* const*)a;
+    const GlyphInfo* gb = *(GlyphInfo* const*)b;
+    // Most recently used first
+    return (gb->last_used > ga->last_used) - (gb->last_used < ga->last_used);
+}
+
+// Drop the least recently used half of the atlas, sparing glyphs used this tick, and
+// repack the rest from a clean packer. False when nothing could be dropped.
+static bool evict_glyphs(Font* font) {
+    GlyphInfo** glyphs = malloc(font->atlas_glyph_count * sizeof(GlyphInfo*));
+    unsigned char* pixels = calloc((size_t)font->atlas_width * font->atlas_height, 1);
+    if (!glyphs || !pixels) {
+        free(glyphs);
+        free(pixels);
+        return false;
+    }
+
+    size_t count = 0;
+    GlyphInfo* glyph;
+    GlyphInfo* tmp;
+    HASH_ITER(hh, font->glyph_cache, glyph, tmp) {
+        if (glyph->in_atlas)
+            glyphs[count++] = glyph;
+    }
+    qsort(glyphs, count, sizeof(GlyphInfo*), compare_glyph_use);
+
+    size_t keep = count - count / 2;
+    while (keep < count && glyphs[keep]->last_used == font->use_tick)
+        keep++;
+    if (keep == count) {
+        free(glyphs);
+        free(pixels);
+        return false;
+    }
+
+    reset_atlas_packer(font);
+    font->atlas_glyph_count = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        glyph = glyphs[i];
+        int old_x = glyph->atlas_x;
+        int old_y = glyph->atlas_y;
+        glyph->in_atlas = false;
+        if (i >= keep || !pack_glyph(font, glyph))
+            continue;
+
+        int w = (int)(glyph->x1 - glyph->x0);
+        int h = (int)(glyph->y1 - glyph->y0);
+        for (int row = 0; row < h; row++) {
+            memcpy(pixels + (size_t)(glyph->atlas_y + row) * font->atlas_width + glyph->atlas_x,
+                   font->atlas_pixels + (size_t)(old_y + row) * font->atlas_width + old_x, w);
+        }
+    }
+
+    free(font->atlas_pixels);
+    font->atlas_pixels = pixels;
+    mark_atlas_dirty(font, 0, 0, font->atlas_width, font->atlas_height);
+    font->atlas_generation++;
+
+    log_debug("Evicted %zu glyphs from %s", count - keep, font->name);
+    free(glyphs);
+    return true;
+}
+
+static void rasterize_glyph(Font* font, GlyphInfo* glyph) {
+    if (!pack_glyph(font, glyph) && !(evict_glyphs(font) && pack_glyph(font, glyph))) {
+        log_warn("Glyph U+%04X does not fit the atlas of %s", glyph->codepoint, font->name);
+        return;
+    }
+
+    const stbtt_fontinfo* info = (const stbtt_fontinfo*)font->stb_font_info;
+    float scale = stbtt_ScaleForPixelHeight(info, font->base_size);
+    int w = (int)(glyph->x1 - glyph->x0);
+    int h = (int)(glyph->y1 - glyph->y0);
+    unsigned char* dest =
+        font->atlas_pixels + (size_t)glyph->atlas_y * font->atlas_width + glyph->atlas_x;
+
+    if (font->is_sdf) {
+        float pixel_dist_scale = (float)SDF_ON_EDGE_VALUE / font->sdf_spread;
+        int sdf_w, sdf_h, xoff, yoff;
+        unsigned char* sdf_data = stbtt_GetGlyphSDF(
+            info, scale, glyph->glyph_index, (int)font->sdf_spread, SDF_ON_EDGE_VALUE,
+            pixel_dist_scale, &sdf_w, &sdf_h, &xoff, &yoff);
+        if (sdf_data) {
+            int rows = sdf_h < h ? sdf_h : h;
+            int cols = sdf_w < w ? sdf_w : w;
+            for (int row = 0; row < rows; row++) {
+                memcpy(dest + (size_t)row * font->atlas_width, sdf_data + row * sdf_w, cols);
+            }
+            stbtt_FreeSDF(sdf_data, NULL);
+        }
+    } else {
+        stbtt_MakeGlyphBitmap(info, dest, w, h, font->atlas_width, scale, scale,
+                              glyph->glyph_index);
+    }
+
+    mark_atlas_dirty(font, glyph->atlas_x, glyph->atlas_y, glyph->atlas_x + w,
+                     glyph->atlas_y + h);
+}
+
+// Cached metrics for codepoint; with rasterize, also stamped as used this tick and packed
+// into the atlas if it is not there yet
+static GlyphInfo* find_glyph(Font* font, int codepoint, bool rasterize) {
+    GlyphInfo* glyph;
+    HASH_FIND_INT(font->glyph_cache, &codepoint, glyph);
+    if (!glyph)
+        glyph = add_glyph(font, codepoint);
+    if (!glyph || !rasterize)
+        return glyph;
+
+    glyph->last_used = font->use_tick;
+    if (!glyph->in_atlas && glyph->x0 < glyph->x1)
+        rasterize_glyph(font, glyph);
+    return glyph;
+}
+
+void font_flush_atlas(Font* font) {
+    if (!font || font->dirty_x0 >= font->dirty_x1)
+        return;
+
+    int x = font->dirty_x0;
+    int y = font->dirty_y0;
+    glBindTexture(GL_TEXTURE_2D, font->atlas_texture_id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, font->atlas_width);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, font->dirty_x1 - x, font->dirty_y1 - y, GL_RED,
+                    GL_UNSIGNED_BYTE, font->atlas_pixels + (size_t)y * font->atlas_width + x);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    font->dirty_x0 = font->dirty_y0 = 0;
+    font->dirty_x1 = font->dirty_y1 = 0;
+}
+
+// --- FontPool ---
+
+FontPool* create_font_pool(void) {
+    FontPool* pool = calloc(1, sizeof(FontPool));
+    if (!pool)
+        return NULL;
+
+    pool->font_capacity = 16;
+    pool->fonts = calloc(pool->font_capacity, sizeof(Font*));
+    if (!pool->fonts) {
+        free(pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+void free_font_pool(FontPool* pool) {
+    if (!pool)
+        return;
+
+    // Free all fonts
+    Font* font;
+    Font* tmp;
+    HASH_ITER(hh, pool->font_cache, font, tmp) {
+        HASH_DEL(pool->font_cache, font);
+
+        free_glyph_atlas(font);
+        free(font->name);
+        free(font->filepath);
+        free(font->ttf_buffer);
+        free(font->stb_font_info);
+        free(font);
+    }
+
+    free(pool->fonts);
+    free(pool);
+}
+
+// --- Font Loading ---
+
 Font* load_font(FontPool* pool, const char* filepath, float base_size, bool use_sdf) {
     if (!pool || !filepath)
         return NULL;
@@ -286,8 +455,17 @@ Font* load_font(FontPool* pool, const char* filepath, float base_size, bool use_
     font->sdf_scale = 1.0f;
     font->ref_count = 1;
 
-    // Generate atlas
-    generate_glyph_atlas(font, DEFAULT_CHARSET);
+    // Empty atlas; glyphs are rasterized as text first uses them
+    if (init_glyph_atlas(font) != 0) {
+        log_error("Failed to allocate glyph atlas: %s", filepath);
+        free_glyph_atlas(font);
+        free(font->name);
+        free(font->filepath);
+        free(info);
+        free(ttf_buffer);
+        free(font);
+        return NULL;
+    }
 
     // Add to cache
     HASH_ADD_KEYPTR(hh, pool->font_cache, font->name, strlen(font->name), font);
@@ -328,9 +506,8 @@ GlyphInfo* font_get_glyph(Font* font, int codepoint) {
     if (!font)
         return NULL;
 
-    GlyphInfo* glyph;
-    HASH_FIND_INT(font->glyph_cache, &codepoint, glyph);
-    return glyph;
+    font->use_tick++;
+    return find_glyph(font, codepoint, true);
 }
 
 // --- TextMesh ---
@@ -477,10 +654,7 @@ void text_mesh_set_transform(TextMesh* mesh, mat4 transform) {
     glm_mat4_copy(transform, mesh->transform);
 }
 
-void text_mesh_rebuild(TextMesh* mesh) {
-    if (!mesh || !mesh->font || !mesh->text)
-        return;
-
+static void build_text_quads(TextMesh* mesh) {
     Font* font = mesh->font;
     float scale = mesh->font_size / font->base_size;
 
@@ -505,8 +679,9 @@ void text_mesh_rebuild(TextMesh* mesh) {
     size_t ii = 0;
     size_t char_idx = 0;
 
-    for (size_t i = 0; i < char_count; i++) {
-        int codepoint = (unsigned char)mesh->text[i];
+    for (const char* p = mesh->text; *p;) {
+        int codepoint;
+        p = utf8_next(p, &codepoint);
 
         // Handle newlines (Y-down: increase y to go down)
         if (codepoint == '\n') {
@@ -516,12 +691,19 @@ void text_mesh_rebuild(TextMesh* mesh) {
             continue;
         }
 
-        GlyphInfo* glyph = font_get_glyph(font, codepoint);
+        GlyphInfo* glyph = find_glyph(font, codepoint, true);
         if (!glyph) {
             char_idx++;
             continue;
         }
 
+        // Blank glyphs, and ones the atlas had no room for, only advance
+        if (!glyph->in_atlas) {
+            cursor_x += glyph->advance_x * scale;
+            char_idx++;
+            continue;
+        }
+
         // Calculate quad corners
         float x0 = cursor_x + glyph->x0 * scale;
         float y0 = cursor_y - glyph->y1 * scale;
@@ -573,6 +755,26 @@ void text_mesh_rebuild(TextMesh* mesh) {
 
     mesh->vertex_count = vi;
     mesh->index_count = ii;
+}
+
+void text_mesh_rebuild(TextMesh* mesh) {
+    if (!mesh || !mesh->font || !mesh->text)
+        return;
+
+    Font* font = mesh->font;
+    font->use_tick++;
+
+    // A glyph that only fit after an eviction moved those placed before it; the second pass
+    // finds them all resident and protected. Should the atlas still move, the generation
+    // recorded here is stale and the next render rebuilds.
+    for (int pass = 0; pass < 2; pass++) {
+        unsigned int generation = font->atlas_generation;
+        build_text_quads(mesh);
+        mesh->atlas_generation = generation;
+        if (font->atlas_generation == generation)
+            break;
+    }
+
     mesh->needs_rebuild = false;
 }
 
@@ -620,15 +822,18 @@ float text_measure_width(Font* font, const char* text, float size) {
     float width = 0.0f;
     float max_width = 0.0f;
 
-    for (const char* p = text; *p; p++) {
-        if (*p == '\n') {
+    for (const char* p = text; *p;) {
+        int codepoint;
+        p = utf8_next(p, &codepoint);
+
+        if (codepoint == '\n') {
             if (width > max_width)
                 max_width = width;
             width = 0.0f;
             continue;
         }
 
-        const GlyphInfo* glyph = font_get_glyph(font, (unsigned char)*p);
+        const GlyphInfo* glyph = find_glyph(font, codepoint, false);
         if (glyph) {
             width += glyph->advance_x * scale;
         }
@@ -676,8 +881,9 @@ void text_measure_bounds(Font* font, const char* text, float size, float* out_x0
     float max_x = -1e9f, max_y = -1e9f;
     bool has_glyphs = false;
 
-    for (const char* p = text; *p; p++) {
-        int codepoint = (unsigned char)*p;
+    for (const char* p = text; *p;) {
+        int codepoint;
+        p = utf8_next(p, &codepoint);
 
         if (codepoint == '\n') {
             cursor_x = 0.0f;
@@ -685,7 +891,7 @@ void text_measure_bounds(Font* font, const char* text, float size, float* out_x0
             continue;
         }
 
-        const GlyphInfo* glyph = font_get_glyph(font, codepoint);
+        const GlyphInfo* glyph = find_glyph(font, codepoint, false);
         if (!glyph)
             continue;
 
@@ -775,7 +981,7 @@ void render_text_2d_effect(TextRenderer* renderer, TextMesh* mesh, const TextEff
     if (!renderer || !mesh || !renderer->text_program || mesh->vertex_count == 0 || !config)
         return;
 
-    if (mesh->needs_rebuild) {
+    if (mesh->needs_rebuild || mesh->atlas_generation != mesh->font->atlas_generation) {
         text_mesh_rebuild(mesh);
         text_mesh_upload(mesh);
     }
@@ -806,8 +1012,9 @@ void render_text_2d_effect(TextRenderer* renderer, TextMesh* mesh, const TextEff
         uniform_set_float(u, "plasmaIntensity", config->plasma.intensity);
     }
 
-    // Bind font atlas
+    // Bind font atlas, with any glyphs new since the last draw
     glActiveTexture(GL_TEXTURE0);
+    font_flush_atlas(mesh->font);
     glBindTexture(GL_TEXTURE_2D, mesh->font->atlas_texture_id);
     uniform_set_int(u, "fontAtlas", 0);
 
@@ -835,7 +1042,7 @@ void render_text_3d(TextRenderer* renderer, TextMesh* mesh, mat4 view, mat4 proj
     if (!renderer || !mesh || !renderer->text_program || mesh->vertex_count == 0)
         return;
 
-    if (mesh->needs_rebuild) {
+    if (mesh->needs_rebuild || mesh->atlas_generation != mesh->font->atlas_generation) {
         text_mesh_rebuild(mesh);
         text_mesh_upload(mesh);
     }
@@ -854,8 +1061,9 @@ void render_text_3d(TextRenderer* renderer, TextMesh* mesh, mat4 view, mat4 proj
     uniform_set_float(u, "sdfEdge", 0.5f);
     uniform_set_float(u, "sdfSmoothing", 0.1f);
 
-    // Bind font atlas
+    // Bind font atlas, with any glyphs new since the last draw
     glActiveTexture(GL_TEXTURE0);
+    font_flush_atlas(mesh->font);
     glBindTexture(GL_TEXTURE_2D, mesh->font->atlas_texture_id);
     uniform_set_int(u, "fontAtlas", 0);
 
@@ -6,12 +6,20 @@
 #include <stdbool.h>
 #include <uthash.h>
 
+// Glyph atlas side, sized for about FONT_ATLAS_GLYPHS_PER_SIDE glyphs at the base size
+#define FONT_ATLAS_GLYPHS_PER_SIDE 12
+#define FONT_ATLAS_MIN_SIZE        1024
+#define FONT_ATLAS_MAX_SIZE        4096
+#define FONT_GLYPH_PADDING         2 // Texels between packed glyphs
+
 // Forward declarations
 struct ShaderProgram;
 
-// Glyph information for a single character
+// Glyph information for a single character. Metrics stay cached once looked up; the
+// bitmap lives in the atlas only while in_atlas is set.
 typedef struct GlyphInfo {
     int codepoint;
+    int glyph_index;
     float advance_x;
     float left_bearing;
 
@@ -21,10 +29,23 @@ typedef struct GlyphInfo {
     // UV coordinates in atlas (normalized 0-1)
     float u0, v0, u1, v1;
 
+    // Atlas placement in texels, and the font use_tick it was last drawn at
+    int atlas_x, atlas_y;
+    bool in_atlas;
+    unsigned int last_used;
+
     UT_hash_handle hh;
 } GlyphInfo;
 
-// Font with glyph atlas
+/*
+ * Font with glyph atlas
+ *
+ * Glyphs are rasterized on first use and packed into the atlas with stb_rect_pack. New
+ * glyphs go into a CPU copy of the atlas and grow a dirty rectangle, which is uploaded with
+ * one glTexSubImage2D before the atlas is next drawn. When a glyph no longer fits, the
+ * least recently used glyphs are dropped and the rest repacked; that bumps
+ * atlas_generation so text meshes built against the old layout rebuild.
+ */
 typedef struct Font {
     char* name;
     char* filepath;
@@ -34,6 +55,16 @@ typedef struct Font {
     int atlas_width;
     int atlas_height;
 
+    // Dynamic packing state
+    unsigned char* atlas_pixels; // CPU copy, atlas_width * atlas_height
+    void* atlas_packer;          // stbrp_context
+    void* atlas_nodes;           // stbrp_node per atlas column
+    int dirty_x0, dirty_y0;      // Texels changed since the last upload, empty when x0 >= x1
+    int dirty_x1, dirty_y1;
+    unsigned int atlas_generation;
+    unsigned int use_tick; // Advanced per text build; glyphs drawn this tick are never evicted
+    size_t atlas_glyph_count;
+
     // Glyph data
     GlyphInfo* glyph_cache;
     float base_size;
@@ -124,6 +155,8 @@ typedef struct TextMesh {
     float* char_colors;
     float* char_offsets;
 
+    unsigned int atlas_generation; // Font atlas layout the vertices were built against
+
     bool needs_rebuild;
     bool is_screen_space;
 } TextMesh;
@@ -148,8 +181,10 @@ Font* get_font(FontPool* pool, const char* name);
 void font_retain(Font* font);
 void font_release(Font* font);
 
-// Glyph access
+// Glyph access, rasterizing into the atlas on first use. The glyph is uploaded by the next
+// font_flush_atlas; text rendering flushes on its own.
 GlyphInfo* font_get_glyph(Font* font, int codepoint);
+void font_flush_atlas(Font* font);
 
 // TextMesh
 TextMesh* create_text_mesh(Font* font, const char* text, float font_size);
@@ -161,7 +196,7 @@ void text_mesh_set_font_size(TextMesh* mesh, float size);
 void text_mesh_set_alignment(TextMesh* mesh, TextAlignment alignment);
 void text_mesh_set_max_width(TextMesh* mesh, float width);
 
-// Per-character animation
+// Per-character animation; index counts UTF-8 codepoints
 void text_mesh_set_char_color(TextMesh* mesh, size_t index, vec4 color);
 void text_mesh_set_char_offset(TextMesh* mesh, size_t index, vec3 offset);
 
@@ -151,7 +151,8 @@ void uniform_cache_lights(UniformManager* mgr, size_t max_lights) {
     }
 }
 
-void uniform_cache_shadows(UniformManager* mgr, size_t max_shadow_lights) {
+void uniform_cache_shadows(UniformManager* mgr, size_t max_shadow_lights,
+                           size_t max_shadow_layers, size_t max_cascades) {
     if (!mgr)
         return;
 
@@ -159,12 +160,31 @@ void uniform_cache_shadows(UniformManager* mgr, size_t max_shadow_lights) {
     uniform_location(mgr, "numShadowLights");
     uniform_location(mgr, "shadowBias");
     uniform_location(mgr, "shadowTexelSize");
-
+    uniform_location(mgr, "shadowDepthMaps");
+    uniform_location(mgr, "shadowFilter");
+    uniform_location(mgr, "shadowFilterRadius");
+    uniform_location(mgr, "shadowLightSize");
+    uniform_location(mgr, "shadowAtlas");
+    uniform_location(mgr, "shadowAtlasDepth");
+    uniform_location(mgr, "shadowTiles");
+
+    char name[64];
     for (size_t i = 0; i < max_shadow_lights; i++) {
-        char name[64];
+        snprintf(name, sizeof(name), "shadowLightIndex[%zu]", i);
+        uniform_location(mgr, name);
+        snprintf(name, sizeof(name), "shadowFirstLayer[%zu]", i);
+        uniform_location(mgr, name);
+        snprintf(name, sizeof(name), "shadowCascadeCount[%zu]", i);
+        uniform_location(mgr, name);
+        snprintf(name, sizeof(name), "shadowFirstTile[%zu]", i);
+        uniform_location(mgr, name);
+    }
+    for (size_t i = 0; i < max_shadow_layers; i++) {
         snprintf(name, sizeof(name), "lightSpaceMatrix[%zu]", i);
         uniform_location(mgr, name);
-        snprintf(name, sizeof(name), "shadowLightIndex[%zu]", i);
+    }
+    for (size_t i = 0; i < max_cascades; i++) {
+        snprintf(name, sizeof(name), "cascadeSplits[%zu]", i);
         uniform_location(mgr, name);
     }
 }
@@ -0,0 +1,389 @@
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <GL/glew.h>
+#include <cglm/cglm.h>
+
+#include "vat.h"
+#include "mesh.h"
+#include "uniform.h"
+#include "ext/log.h"
+
+void free_vertex_animation(VertexAnimation* vat) {
+    if (!vat)
+        return;
+
+    if (vat->position_texture)
+        glDeleteTextures(1, &vat->position_texture);
+    if (vat->normal_texture)
+        glDeleteTextures(1, &vat->normal_texture);
+
+    free(vat->positions);
+    free(vat->normals);
+    free(vat);
+}
+
+static VertexAnimation* _alloc_vertex_animation(size_t vertex_count, size_t frame_count) {
+    VertexAnimation* vat = calloc(1, sizeof(VertexAnimation));
+    if (!vat) {
+        log_error("Failed to allocate vertex animation");
+        return NULL;
+    }
+
+    size_t floats = vertex_count * frame_count * 4;
+    vat->positions = malloc(floats * sizeof(float));
+    vat->normals = malloc(floats * sizeof(float));
+    if (!vat->positions || !vat->normals) {
+        log_error("Failed to allocate %zu baked frames of %zu vertices", frame_count,
+                  vertex_count);
+        free_vertex_animation(vat);
+        return NULL;
+    }
+
+    vat->vertex_count = vertex_count;
+    vat->frame_count = frame_count;
+    return vat;
+}
+
+/*
+ * Baking
+ */
+
+// Frames sampled from a clip at fps. Baked clips loop, so sampling stops short of the
+// end, which the shader reaches by blending the last frame back into the first.
+static size_t _clip_frame_count(const Animation* clip, float fps) {
+    float ticks_per_second = clip->ticks_per_second > 0.0f ? clip->ticks_per_second : 25.0f;
+    float seconds = clip->duration / ticks_per_second;
+    size_t frames = (size_t)ceilf(seconds * fps - 0.001f);
+    if (frames == 0)
+        frames = 1;
+    return frames;
+}
+
+VertexAnimation* bake_vertex_animation(const Mesh* mesh, Animation** clips, size_t clip_count,
+                                       float fps) {
+    if (!mesh || !clips || clip_count == 0) {
+        log_error("Invalid input to bake_vertex_animation");
+        return NULL;
+    }
+    if (!mesh->is_skinned || !mesh->skeleton || !mesh->bone_ids || !mesh->bone_weights ||
+        !mesh->vertices || mesh->vertex_count == 0) {
+        log_error("Cannot bake vertex animation: mesh is not skinned");
+        return NULL;
+    }
+    if (clip_count > VAT_MAX_CLIPS) {
+        log_warn("Baking the first %d of %zu clips", VAT_MAX_CLIPS, clip_count);
+        clip_count = VAT_MAX_CLIPS;
+    }
+    if (fps <= 0.0f)
+        fps = VAT_DEFAULT_FPS;
+
+    size_t frame_count = 0;
+    for (size_t c = 0; c < clip_count; c++) {
+        if (!clips[c]) {
+            log_error("Cannot bake vertex animation: clip %zu is NULL", c);
+            return NULL;
+        }
+        frame_count += _clip_frame_count(clips[c], fps);
+    }
+
+    VertexAnimation* vat = _alloc_vertex_animation(mesh->vertex_count, frame_count);
+    if (!vat)
+        return NULL;
+
+    AnimationState* state = create_animation_state(mesh->skeleton);
+    if (!state) {
+        free_vertex_animation(vat);
+        return NULL;
+    }
+
+    glm_vec3_fill(vat->bounds_min, FLT_MAX);
+    glm_vec3_fill(vat->bounds_max, -FLT_MAX);
+
+    size_t frame = 0;
+    for (size_t c = 0; c < clip_count; c++) {
+        Animation* clip = clips[c];
+        VatClip* out = &vat->clips[vat->clip_count++];
+        snprintf(out->name, sizeof(out->name), "%s", clip->name ? clip->name : "");
+        out->first_frame = (uint32_t)frame;
+        out->frame_count = (uint32_t)_clip_frame_count(clip, fps);
+        out->fps = fps;
+        out->looping = true;
+
+        float ticks_per_second = clip->ticks_per_second > 0.0f ? clip->ticks_per_second : 25.0f;
+        set_animation(state, clip);
+
+        for (uint32_t f = 0; f < out->frame_count; f++, frame++) {
+            state->current_time = fminf((float)f / fps * ticks_per_second, clip->duration);
+            compute_bone_matrices(state);
+
+            float* positions = vat->positions + frame * vat->vertex_count * 4;
+            float* normals = vat->normals + frame * vat->vertex_count * 4;
+            for (size_t v = 0; v < vat->vertex_count; v++) {
+                skin_mesh_vertex(mesh, state->bone_matrices, state->active_bone_count, v,
+                                 positions + v * 4, normals + v * 4);
+                positions[v * 4 + 3] = 1.0f;
+                normals[v * 4 + 3] = 0.0f;
+                glm_vec3_minv(vat->bounds_min, positions + v * 4, vat->bounds_min);
+                glm_vec3_maxv(vat->bounds_max, positions + v * 4, vat->bounds_max);
+            }
+        }
+    }
+
+    free_animation_state(state);
+
+    log_info("Baked %zu clips into %zu frames of %zu vertices", vat->clip_count,
+             vat->frame_count, vat->vertex_count);
+    return vat;
+}
+
+int find_vat_clip(const VertexAnimation* vat, const char* name) {
+    if (!vat || !name)
+        return -1;
+
+    for (size_t i = 0; i < vat->clip_count; i++) {
+        if (strcmp(vat->clips[i].name, name) == 0)
+            return (int)i;
+    }
+    return -1;
+}
+
+/*
+ * Files
+ *
+ * Header (magic, version, vertex count, frame count, clip count), bounds, clips, then
+ * all positions and all normals. Native byte order; the cache is not meant to travel.
+ */
+typedef struct VatFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertex_count;
+    uint32_t frame_count;
+    uint32_t clip_count;
+    float bounds_min[3];
+    float bounds_max[3];
+} VatFileHeader;
+
+typedef struct VatFileClip {
+    char name[VAT_CLIP_NAME_LENGTH];
+    uint32_t first_frame;
+    uint32_t frame_count;
+    float fps;
+    uint32_t looping;
+} VatFileClip;
+
+int save_vertex_animation(const VertexAnimation* vat, const char* path) {
+    if (!vat || !path)
+        return -1;
+
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        log_error("Failed to open %s for writing", path);
+        return -1;
+    }
+
+    VatFileHeader header = {
+        .magic = VAT_FILE_MAGIC,
+        .version = VAT_FILE_VERSION,
+        .vertex_count = (uint32_t)vat->vertex_count,
+        .frame_count = (uint32_t)vat->frame_count,
+        .clip_count = (uint32_t)vat->clip_count,
+    };
+    memcpy(header.bounds_min, vat->bounds_min, sizeof(header.bounds_min));
+    memcpy(header.bounds_max, vat->bounds_max, sizeof(header.bounds_max));
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (size_t i = 0; ok && i < vat->clip_count; i++) {
+        VatFileClip clip = {0};
+        memcpy(clip.name, vat->clips[i].name, sizeof(clip.name));
+        clip.first_frame = vat->clips[i].first_frame;
+        clip.frame_count = vat->clips[i].frame_count;
+        clip.fps = vat->clips[i].fps;
+        clip.looping = vat->clips[i].looping ? 1 : 0;
+        ok = fwrite(&clip, sizeof(clip), 1, file) == 1;
+    }
+
+    size_t floats = vat->vertex_count * vat->frame_count * 4;
+    ok = ok && fwrite(vat->positions, sizeof(float), floats, file) == floats;
+    ok = ok && fwrite(vat->normals, sizeof(float), floats, file) == floats;
+
+    if (fclose(file) != 0)
+        ok = false;
+    if (!ok) {
+        log_error("Failed to write vertex animation to %s", path);
+        return -1;
+    }
+    return 0;
+}
+
+VertexAnimation* load_vertex_animation(const char* path) {
+    if (!path)
+        return NULL;
+
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        log_error("Failed to open vertex animation %s", path);
+        return NULL;
+    }
+
+    VatFileHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != VAT_FILE_MAGIC ||
+        header.version != VAT_FILE_VERSION || header.clip_count > VAT_MAX_CLIPS ||
+        header.vertex_count == 0 || header.frame_count == 0) {
+        log_error("Invalid vertex animation file %s", path);
+        fclose(file);
+        return NULL;
+    }
+
+    VertexAnimation* vat = _alloc_vertex_animation(header.vertex_count, header.frame_count);
+    if (!vat) {
+        fclose(file);
+        return NULL;
+    }
+    memcpy(vat->bounds_min, header.bounds_min, sizeof(header.bounds_min));
+    memcpy(vat->bounds_max, header.bounds_max, sizeof(header.bounds_max));
+
+    bool ok = true;
+    for (uint32_t i = 0; ok && i < header.clip_count; i++) {
+        VatFileClip clip;
+        ok = fread(&clip, sizeof(clip), 1, file) == 1 &&
+             (uint64_t)clip.first_frame + clip.frame_count <= header.frame_count;
+        if (!ok)
+            break;
+
+        VatClip* out = &vat->clips[vat->clip_count++];
+        memcpy(out->name, clip.name, sizeof(out->name));
+        out->name[VAT_CLIP_NAME_LENGTH - 1] = '\0';
+        out->first_frame = clip.first_frame;
+        out->frame_count = clip.frame_count;
+        out->fps = clip.fps;
+        out->looping = clip.looping != 0;
+    }
+
+    size_t floats = vat->vertex_count * vat->frame_count * 4;
+    ok = ok && fread(vat->positions, sizeof(float), floats, file) == floats;
+    ok = ok && fread(vat->normals, sizeof(float), floats, file) == floats;
+    fclose(file);
+
+    if (!ok) {
+        log_error("Truncated vertex animation file %s", path);
+        free_vertex_animation(vat);
+        return NULL;
+    }
+    return vat;
+}
+
+/*
+ * GPU
+ */
+
+// Upload frame-major CPU data into rows of texture_width texels
+static GLuint _create_frame_texture(const VertexAnimation* vat, const float* data,
+                                    GLenum internal_format, float* staging) {
+    size_t width = (size_t)vat->texture_width;
+    size_t row_texels = width * (size_t)vat->rows_per_frame;
+    size_t height = vat->frame_count * (size_t)vat->rows_per_frame;
+
+    // Pad each frame out to whole rows
+    for (size_t f = 0; f < vat->frame_count; f++) {
+        float* dst = staging + f * row_texels * 4;
+        memcpy(dst, data + f * vat->vertex_count * 4, vat->vertex_count * 4 * sizeof(float));
+        memset(dst + vat->vertex_count * 4, 0,
+               (row_texels - vat->vertex_count) * 4 * sizeof(float));
+    }
+
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, internal_format, (GLsizei)width, (GLsizei)height, 0, GL_RGBA,
+                 GL_FLOAT, staging);
+
+    // Read with texelFetch; frames are blended in the shader
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
+
+int upload_vertex_animation(VertexAnimation* vat) {
+    if (!vat)
+        return -1;
+    if (vat->position_texture)
+        return 0;
+
+    GLint max_size = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+    if (max_size <= 0)
+        max_size = 4096;
+
+    size_t width = vat->vertex_count < (size_t)max_size ? vat->vertex_count : (size_t)max_size;
+    size_t rows = (vat->vertex_count + width - 1) / width;
+    if (vat->frame_count * rows > (size_t)max_size) {
+        log_error("Vertex animation of %zu frames x %zu rows exceeds the %d texel texture limit",
+                  vat->frame_count, rows, max_size);
+        return -1;
+    }
+    vat->texture_width = (int)width;
+    vat->rows_per_frame = (int)rows;
+
+    float* staging = malloc(vat->frame_count * rows * width * 4 * sizeof(float));
+    if (!staging) {
+        log_error("Failed to allocate vertex animation upload staging");
+        return -1;
+    }
+
+    vat->position_texture = _create_frame_texture(vat, vat->positions, GL_RGBA32F, staging);
+    vat->normal_texture = _create_frame_texture(vat, vat->normals, GL_RGBA16F, staging);
+    free(staging);
+
+    if (!vat->position_texture || !vat->normal_texture) {
+        log_error("Failed to create vertex animation textures");
+        return -1;
+    }
+    return 0;
+}
+
+void bind_vertex_animation(VertexAnimation* vat, ShaderProgram* program) {
+    if (!vat || !program || !program->uniforms)
+        return;
+
+    UniformManager* u = program->uniforms;
+
+    glActiveTexture(GL_TEXTURE0 + VAT_POSITION_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, vat->position_texture);
+    glActiveTexture(GL_TEXTURE0 + VAT_NORMAL_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, vat->normal_texture);
+    glActiveTexture(GL_TEXTURE0);
+
+    uniform_set_int(u, "vatPositions", VAT_POSITION_TEXTURE_UNIT);
+    uniform_set_int(u, "vatNormals", VAT_NORMAL_TEXTURE_UNIT);
+    uniform_set_int(u, "vatWidth", vat->texture_width);
+    uniform_set_int(u, "vatRowsPerFrame", vat->rows_per_frame);
+    uniform_set_int(u, "numClips", (int)vat->clip_count);
+
+    GLint loc;
+    for (size_t i = 0; i < vat->clip_count; i++) {
+        const VatClip* clip = &vat->clips[i];
+
+        loc = uniform_array_location(u, "clips", i, "firstFrame");
+        if (loc >= 0)
+            glUniform1i(loc, (GLint)clip->first_frame);
+
+        loc = uniform_array_location(u, "clips", i, "frameCount");
+        if (loc >= 0)
+            glUniform1i(loc, (GLint)clip->frame_count);
+
+        loc = uniform_array_location(u, "clips", i, "fps");
+        if (loc >= 0)
+            glUniform1f(loc, clip->fps);
+
+        loc = uniform_array_location(u, "clips", i, "looping");
+        if (loc >= 0)
+            glUniform1i(loc, clip->looping ? 1 : 0);
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef _VAT_H_
+#define _VAT_H_
+
+#include <GL/glew.h>
+#include <cglm/cglm.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "animation.h"
+#include "program.h"
+
+#define VAT_MAX_CLIPS              16 // Matches the clip uniform arrays in pbr_vat_vert.glsl
+#define VAT_CLIP_NAME_LENGTH       64
+#define VAT_POSITION_TEXTURE_UNIT  20
+#define VAT_NORMAL_TEXTURE_UNIT    21
+#define VAT_DEFAULT_FPS            30.0f
+#define VAT_FILE_MAGIC             0x54415643u // "CVAT"
+#define VAT_FILE_VERSION           1
+
+struct Mesh;
+
+// A baked clip: frame_count consecutive frames starting at first_frame
+typedef struct VatClip {
+    char name[VAT_CLIP_NAME_LENGTH];
+    uint32_t first_frame;
+    uint32_t frame_count;
+    float fps;
+    bool looping; // Looping clips blend their last frame back into the first
+} VatClip;
+
+/*
+ * Vertex Animation Texture
+ *
+ * Skinned vertex positions and normals of one mesh, baked offline for every frame of
+ * a set of clips. Rendered through the crowd path (see crowd.h), where the vertex
+ * shader reads and interpolates two frames per vertex, so playback costs no CPU time
+ * and a constant GPU cost per vertex however many bones the source skeleton had.
+ *
+ * Frames are stored row-major: a frame takes rows_per_frame rows of texture_width
+ * texels, vertex v at (v % texture_width, frame * rows_per_frame + v / texture_width).
+ *
+ * Textures are created on the first upload; the CPU copy is kept for saving.
+ */
+typedef struct VertexAnimation {
+    size_t vertex_count;
+    size_t frame_count; // Across all clips
+    float* positions;   // frame_count * vertex_count * 4 (xyz, 1)
+    float* normals;     // frame_count * vertex_count * 4 (xyz, 0)
+
+    VatClip clips[VAT_MAX_CLIPS];
+    size_t clip_count;
+
+    // Model-space bounds over every baked frame
+    vec3 bounds_min;
+    vec3 bounds_max;
+
+    GLuint position_texture; // GL_RGBA32F
+    GLuint normal_texture;   // GL_RGBA16F
+    int texture_width;
+    int rows_per_frame;
+} VertexAnimation;
+
+/*
+ * Lifecycle
+ */
+void free_vertex_animation(VertexAnimation* vat);
+
+/*
+ * Baking
+ */
+
+// Play each clip on mesh at fps on the CPU and record every skinned frame. All clips
+// must share one skeleton, which the mesh's bone ids index.
+VertexAnimation* bake_vertex_animation(const struct Mesh* mesh, Animation** clips,
+                                       size_t clip_count, float fps);
+
+// Clip index by name, or -1
+int find_vat_clip(const VertexAnimation* vat, const char* name);
+
+/*
+ * Files
+ */
+int save_vertex_animation(const VertexAnimation* vat, const char* path);
+VertexAnimation* load_vertex_animation(const char* path);
+
+/*
+ * GPU
+ */
+
+// Create the textures, once
+int upload_vertex_animation(VertexAnimation* vat);
+
+// Bind the textures to their units and set program's VAT and clip uniforms
+void bind_vertex_animation(VertexAnimation* vat, ShaderProgram* program);
+
+#endif // _VAT_H_
@@ -0,0 +1,143 @@
+#include <stdlib.h>
+
+#include "worker_pool.h"
+#include "ext/log.h"
+
+typedef struct {
+    WorkerPool* pool;
+    int index;
+} WorkerSlot;
+
+static void* _worker_pool_thread(void* arg) {
+    WorkerSlot* slot = (WorkerSlot*)arg;
+    WorkerPool* pool = slot->pool;
+    int index = slot->index;
+    free(slot);
+
+    pthread_mutex_lock(&pool->mutex);
+    unsigned int seen = 0; // Jobs posted before this thread got here still count
+    for (;;) {
+        while (!pool->shutdown && pool->generation == seen)
+            pthread_cond_wait(&pool->work_cond, &pool->mutex);
+        if (pool->shutdown)
+            break;
+
+        seen = pool->generation;
+        if (index >= pool->active)
+            continue;
+
+        WorkerFunc func = pool->func;
+        void* func_arg = pool->arg;
+        pthread_mutex_unlock(&pool->mutex);
+        func(func_arg);
+        pthread_mutex_lock(&pool->mutex);
+
+        if (--pool->pending == 0)
+            pthread_cond_signal(&pool->done_cond);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return NULL;
+}
+
+WorkerPool* create_worker_pool(int thread_count) {
+    WorkerPool* pool = calloc(1, sizeof(WorkerPool));
+    if (!pool) {
+        log_error("Failed to allocate memory for WorkerPool");
+        return NULL;
+    }
+
+    if (pthread_mutex_init(&pool->run_mutex, NULL) != 0 ||
+        pthread_mutex_init(&pool->mutex, NULL) != 0 ||
+        pthread_cond_init(&pool->work_cond, NULL) != 0 ||
+        pthread_cond_init(&pool->done_cond, NULL) != 0) {
+        log_error("Failed to initialize worker pool synchronization");
+        free(pool);
+        return NULL;
+    }
+
+    if (thread_count > WORKER_POOL_MAX_THREADS)
+        thread_count = WORKER_POOL_MAX_THREADS;
+
+    // Jobs simply get fewer threads if some fail to start
+    for (int i = 0; i < thread_count; i++) {
+        WorkerSlot* slot = malloc(sizeof(WorkerSlot));
+        if (!slot)
+            break;
+        slot->pool = pool;
+        slot->index = i;
+        if (pthread_create(&pool->threads[i], NULL, _worker_pool_thread, slot) != 0) {
+            log_error("Failed to create pool worker %d", i);
+            free(slot);
+            break;
+        }
+        pool->thread_count++;
+    }
+
+    return pool;
+}
+
+void free_worker_pool(WorkerPool* pool) {
+    if (!pool)
+        return;
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (int i = 0; i < pool->thread_count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&pool->done_cond);
+    pthread_cond_destroy(&pool->work_cond);
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_mutex_destroy(&pool->run_mutex);
+    free(pool);
+}
+
+void run_worker_pool(WorkerPool* pool, WorkerFunc func, void* arg, int worker_count) {
+    if (!func)
+        return;
+
+    int helpers = worker_count - 1;
+    if (!pool || helpers <= 0) {
+        func(arg);
+        return;
+    }
+    if (helpers > pool->thread_count)
+        helpers = pool->thread_count;
+
+    pthread_mutex_lock(&pool->run_mutex);
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->func = func;
+    pool->arg = arg;
+    pool->active = helpers;
+    pool->pending = helpers;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->mutex);
+
+    // The calling thread works as well
+    func(arg);
+
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->pending > 0)
+        pthread_cond_wait(&pool->done_cond, &pool->mutex);
+    pthread_mutex_unlock(&pool->mutex);
+
+    pthread_mutex_unlock(&pool->run_mutex);
+}
+
+static WorkerPool* shared_pool = NULL;
+static pthread_once_t shared_pool_once = PTHREAD_ONCE_INIT;
+
+static void _create_shared_pool(void) {
+    shared_pool = create_worker_pool(WORKER_POOL_MAX_THREADS - 1);
+}
+
+WorkerPool* get_shared_worker_pool(void) {
+    pthread_once(&shared_pool_once, _create_shared_pool);
+    return shared_pool;
+}
@@ -0,0 +1,58 @@
+#ifndef _WORKER_POOL_H_
+#define _WORKER_POOL_H_
+
+#include <pthread.h>
+#include <stdbool.h>
+
+#define WORKER_POOL_MAX_THREADS 16
+
+typedef void* (*WorkerFunc)(void* arg);
+
+/*
+ * Worker Pool
+ *
+ * Threads started once and parked on a condition variable between jobs, for per-frame
+ * fork/join work where creating threads each time would cost more than the work saves.
+ * A job runs one function on up to thread_count pool threads plus the calling thread,
+ * all with the same argument; the function splits the work itself (typically with an
+ * atomic cursor). Jobs from different callers are serialized.
+ */
+typedef struct WorkerPool {
+    pthread_t threads[WORKER_POOL_MAX_THREADS];
+    int thread_count; // Started, not counting the caller
+
+    pthread_mutex_t run_mutex; // Held for a whole job
+    pthread_mutex_t mutex;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+
+    WorkerFunc func;
+    void* arg;
+    int active;              // Pool threads taking part in the current job
+    int pending;             // Of those, still running it
+    unsigned int generation; // Bumped per job
+    bool shutdown;
+} WorkerPool;
+
+/*
+ * Lifecycle
+ */
+
+// Start up to thread_count threads; fewer if some fail to start, even none
+WorkerPool* create_worker_pool(int thread_count);
+void free_worker_pool(WorkerPool* pool);
+
+/*
+ * Jobs
+ */
+
+// Run func(arg) on the calling thread and worker_count - 1 pool threads, returning when
+// all are done. A NULL pool runs func on the calling thread only.
+void run_worker_pool(WorkerPool* pool, WorkerFunc func, void* arg, int worker_count);
+
+// Process-wide pool of WORKER_POOL_MAX_THREADS - 1 threads, started on first use and kept
+// for the life of the process, so subsystems share one set of threads instead of each
+// starting their own. May return NULL. Must not be called from inside one of its jobs.
+WorkerPool* get_shared_worker_pool(void);
+
+#endif // _WORKER_POOL_H_
@@ -0,0 +1,80 @@
+// Occlusion Buffer Test
+//
+// Rasterizes an occluder whose right edge sits partway into a texel and checks that a box
+// poking out past that edge is not culled, while one fully behind the occluder is.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <cglm/cglm.h>
+
+#include "cetra/mesh.h"
+#include "cetra/occlusion.h"
+
+// Identity view-projection: NDC x maps to pixel (x * 0.5 + 0.5) * width
+static float _pixel_to_ndc(float pixel, int size) {
+    return pixel / (float)size * 2.0f - 1.0f;
+}
+
+static int failures = 0;
+
+static void _expect(bool condition, const char* what) {
+    if (!condition) {
+        fprintf(stderr, "FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+int main(void) {
+    OcclusionBuffer* buf = create_occlusion_buffer(OCCLUSION_BUFFER_WIDTH,
+                                                   OCCLUSION_BUFFER_HEIGHT);
+    if (!buf) {
+        fprintf(stderr, "FAIL: create_occlusion_buffer\n");
+        return 1;
+    }
+
+    // Occluder at NDC z 0 with its right edge 0.6 pixels into column 128, so that column's
+    // centre is covered but not the whole column
+    float edge = _pixel_to_ndc(128.6f, buf->width);
+    float vertices[] = {
+        -2.0f, -2.0f, 0.0f, edge, -2.0f, 0.0f, edge, 2.0f, 0.0f, -2.0f, 2.0f, 0.0f,
+    };
+    unsigned int indices[] = {0, 1, 2, 0, 2, 3};
+
+    Mesh occluder = {0};
+    occluder.draw_mode = TRIANGLES;
+    occluder.vertices = vertices;
+    occluder.vertex_count = 4;
+    occluder.indices = indices;
+    occluder.index_count = 6;
+
+    mat4 identity = GLM_MAT4_IDENTITY_INIT;
+    occlusion_begin_frame(buf, identity);
+    occlusion_rasterize_mesh(buf, &occluder, identity);
+    occlusion_build_pyramid(buf);
+
+    // Behind the occluder, small enough to be tested at full resolution, and reaching 0.3
+    // pixels past the occluder's edge into the column its centre test covered
+    vec3 past_min = {_pixel_to_ndc(127.2f, buf->width), _pixel_to_ndc(60.2f, buf->height), 0.5f};
+    vec3 past_max = {_pixel_to_ndc(128.9f, buf->width), _pixel_to_ndc(61.5f, buf->height), 0.6f};
+    _expect(occlusion_test_aabb(buf, past_min, past_max),
+            "box past the occluder edge is culled");
+
+    // Entirely behind the occluder
+    vec3 hidden_min = {-0.8f, -0.5f, 0.5f};
+    vec3 hidden_max = {-0.2f, 0.5f, 0.6f};
+    _expect(!occlusion_test_aabb(buf, hidden_min, hidden_max),
+            "box fully behind the occluder is visible");
+
+    // In front of the occluder
+    vec3 front_min = {-0.8f, -0.5f, -0.6f};
+    vec3 front_max = {-0.2f, 0.5f, -0.5f};
+    _expect(occlusion_test_aabb(buf, front_min, front_max),
+            "box in front of the occluder is culled");
+
+    free_occlusion_buffer(buf);
+
+    if (failures == 0)
+        printf("occlusion_test: all checks passed\n");
+    return failures == 0 ? 0 : 1;
+}